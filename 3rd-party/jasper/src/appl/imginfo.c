@@ -87,6 +87,7 @@ typedef enum {
 	OPT_HELP,
 	OPT_VERSION,
 	OPT_VERBOSE,
+	OPT_FAST,
 	OPT_INFILE
 } optid_t;
 
@@ -96,6 +97,7 @@ typedef enum {
 
 static void usage(void);
 static void cmdinfo(void);
+static int probe(jas_stream_t *in, int fmtid, jas_image_info_t *info);
 
 /******************************************************************************\
 *
@@ -105,6 +107,7 @@ static jas_opt_t opts[] = {
 	{OPT_HELP, "help", 0},
 	{OPT_VERSION, "version", 0},
 	{OPT_VERBOSE, "verbose", 0},
+	{OPT_FAST, "fast", 0},
 	{OPT_INFILE, "f", JAS_OPT_HASARG},
 	{-1, 0, 0}
 };
@@ -127,6 +130,9 @@ int main(int argc, char **argv)
 	int depth;
 	int numcmpts;
 	int verbose;
+	int fast;
+	long rawsize;
+	jas_image_info_t info;
 	char *fmtname;
 	jp2_box_t *box = NULL;
 	double vres, hres, powv, powh, resv, resh;
@@ -140,6 +146,8 @@ int main(int argc, char **argv)
 
 	infile = 0;
 	verbose = 0;
+	fast = 0;
+	image = 0;
 
 	/* Parse the command line options. */
 	while ((id = jas_getopt(argc, argv, opts)) >= 0) {
@@ -147,6 +155,9 @@ int main(int argc, char **argv)
 		case OPT_VERBOSE:
 			verbose = 1;
 			break;
+		case OPT_FAST:
+			fast = 1;
+			break;
 		case OPT_VERSION:
 			printf("%s\n", JAS_VERSION);
 			exit(EXIT_SUCCESS);
@@ -182,10 +193,18 @@ int main(int argc, char **argv)
 		fprintf(stderr, "unknown image format\n");
 	}
 
-	/* Decode the image. */
-	if (!(image = jas_image_decode(instream, fmtid, 0))) {
-		fprintf(stderr, "cannot load image\n");
-		return EXIT_FAILURE;
+	if (fast) {
+		/* Only read the image headers. */
+		if (probe(instream, fmtid, &info)) {
+			fprintf(stderr, "cannot read image header\n");
+			return EXIT_FAILURE;
+		}
+	} else {
+		/* Decode the image. */
+		if (!(image = jas_image_decode(instream, fmtid, 0))) {
+			fprintf(stderr, "cannot load image\n");
+			return EXIT_FAILURE;
+		}
 	}
 
 	hres = vres = resh = resv = powh = powv = 0.0;
@@ -254,7 +273,7 @@ int main(int argc, char **argv)
 		depth = 8;
 			// <LD> 01/Jan/2005: Always force conversion to sRGB. Seems to be required for many types of JPEG2000 file.
 		// if (depth!=1 && depth!=4 && depth!=8)
-		if (image->numcmpts_>=3 && depth <=8 && image->clrspc_ != JAS_CLRSPC_SRGB && image->cmprof_ != NULL)
+		if (image && image->numcmpts_>=3 && depth <=8 && image->clrspc_ != JAS_CLRSPC_SRGB && image->cmprof_ != NULL)
 		{
 			jas_image_t *newimage;
 			jas_cmprof_t *inprof = NULL;
@@ -279,18 +298,34 @@ int main(int argc, char **argv)
 	/* Close the image file. */
 	jas_stream_close(instream);
 
-	numcmpts = jas_image_numcmpts(image);
-	width = jas_image_cmptwidth(image, 0);
-	height = jas_image_cmptheight(image, 0);
-	depth = jas_image_cmptprec(image, 0);
+	if (image) {
+		numcmpts = jas_image_numcmpts(image);
+		width = jas_image_cmptwidth(image, 0);
+		height = jas_image_cmptheight(image, 0);
+		depth = jas_image_cmptprec(image, 0);
+		rawsize = jas_image_rawsize(image);
+	} else {
+		numcmpts = info.numcmpts;
+		width = info.width;
+		height = info.height;
+		depth = info.prec;
+		rawsize = (long) numcmpts * width * height * ((depth + 7) / 8);
+	}
 
 	if (!(fmtname = jas_image_fmttostr(fmtid))) {
 		abort();
 	}
 	
-	printf("%s %d %d %d %d %3.2f %3.2f %ld\n", fmtname, numcmpts, width, height, depth, resh, resv, (long) jas_image_rawsize(image));
+	if (fast) {
+		printf("%s %d %d %d %d %3.2f %3.2f %ld %ld %ld %d %d %d %d\n", fmtname, numcmpts, width, height, depth, resh, resv, rawsize,
+		  (long) info.tilewidth, (long) info.tileheight, info.numhtiles, info.numvtiles, info.numrlvls, info.numlyrs);
+	} else {
+		printf("%s %d %d %d %d %3.2f %3.2f %ld\n", fmtname, numcmpts, width, height, depth, resh, resv, rawsize);
+	}
 
-	jas_image_destroy(image);
+	if (image) {
+		jas_image_destroy(image);
+	}
 	jas_image_clearfmts();
 
 	return EXIT_SUCCESS;
@@ -300,6 +335,24 @@ int main(int argc, char **argv)
 *
 \******************************************************************************/
 
+static int probe(jas_stream_t *in, int fmtid, jas_image_info_t *info)
+{
+	char *fmtname;
+
+	if (!(fmtname = jas_image_fmttostr(fmtid))) {
+		return -1;
+	}
+	if (!strcmp(fmtname, "jp2")) {
+		return jp2_probe(in, info);
+	}
+	if (!strcmp(fmtname, "jpc")) {
+		return jpc_probe(in, info);
+	}
+
+	fprintf(stderr, "the fast mode only supports the JP2 and JPC formats\n");
+	return -1;
+}
+
 static void cmdinfo()
 {
 	fprintf(stderr, "Image Information Utility (Version %s).\n",
@@ -315,6 +368,6 @@ static void usage()
 	cmdinfo();
 	fprintf(stderr, "usage:\n");
 	fprintf(stderr,"%s ", cmdname);
-	fprintf(stderr, "[-f image_file]\n");
+	fprintf(stderr, "[-f image_file] [--fast]\n");
 	exit(EXIT_FAILURE);
 }
@@ -76,6 +76,7 @@
 #include <string.h>
 #include <assert.h>
 #include <ctype.h>
+#include <limits.h>
 
 #include "jasper/jas_math.h"
 #include "jasper/jas_image.h"
@@ -88,20 +89,96 @@
 
 #define	FLOORDIV(x, y) ((x) / (y))
 
+/* Are the samples of a component held in memory or in pages? */
+#define	jas_image_cmpt_hasplane(cmpt) \
+	((cmpt)->datatype_ != JAS_IMAGE_DATA_NONE)
+
+/* A page of the samples of a component (i.e., a band of whole rows). */
+typedef struct {
+
+	unsigned char *data_;
+	/* The samples in the page (or null if the page is not resident). */
+
+	bool spilled_;
+	/* Has the page been written to the spill file? */
+
+	bool dirty_;
+	/* Has the page been modified since it was last written to the spill
+	  file? */
+
+	unsigned long lastuse_;
+	/* The time at which the page was last accessed. */
+
+} jas_image_page_t;
+
+struct jas_image_pager_s {
+
+	size_t rowsize_;
+	/* The number of bytes in a row. */
+
+	jas_image_coord_t rowsperpage_;
+	/* The number of rows in each page (except possibly the last). */
+
+	jas_image_coord_t height_;
+	/* The number of rows in all of the pages. */
+
+	size_t pagesize_;
+	/* The number of bytes in a full page. */
+
+	int numpages_;
+	jas_image_page_t *pages_;
+	/* The pages. */
+
+	int numresident_;
+	int maxresident_;
+	int *resident_;
+	/* The indices of the pages that are resident. */
+
+	unsigned long clock_;
+	/* The access counter used to find the least recently used page. */
+
+	jas_stream_t *spill_;
+	/* The file to which evicted pages are written (or null if no page has
+	  been written yet). */
+
+};
+
 /******************************************************************************\
 * Local prototypes.
 \******************************************************************************/
 
 static jas_image_cmpt_t *jas_image_cmpt_create0(void);
 static void jas_image_cmpt_destroy(jas_image_cmpt_t *cmpt);
+static jas_image_t *jas_image_create2(int numcmpts,
+  jas_image_cmptparm_t *cmptparms, jas_clrspc_t clrspc, bool nostorage);
 static jas_image_cmpt_t *jas_image_cmpt_create(uint_fast32_t tlx, uint_fast32_t tly,
   uint_fast32_t hstep, uint_fast32_t vstep, uint_fast32_t width, uint_fast32_t
-  height, uint_fast16_t depth, bool sgnd, uint_fast32_t inmem);
+  height, uint_fast16_t depth, bool sgnd, uint_fast32_t inmem, bool nostorage,
+  size_t budget);
 static void jas_image_setbbox(jas_image_t *image);
 static jas_image_cmpt_t *jas_image_cmpt_copy(jas_image_cmpt_t *cmpt);
 static int jas_image_growcmpts(jas_image_t *image, int maxcmpts);
 static uint_fast32_t inttobits(jas_seqent_t v, int prec, bool sgnd);
 static jas_seqent_t bitstoint(uint_fast32_t v, int prec, bool sgnd);
+static int jas_image_cmpt_datatype(int prec, bool sgnd);
+static size_t jas_image_cmpt_datasize(int datatype);
+static void *jas_image_cmpt_row(jas_image_cmpt_t *cmpt, jas_image_coord_t y,
+  bool write);
+static jas_seqent_t jas_image_cmpt_wrap(jas_image_cmpt_t *cmpt, jas_seqent_t v);
+static int jas_image_cmpt_getsmpl(jas_image_cmpt_t *cmpt,
+  jas_image_coord_t x, jas_image_coord_t y, jas_seqent_t *v);
+static int jas_image_cmpt_putsmpl(jas_image_cmpt_t *cmpt, jas_image_coord_t x,
+  jas_image_coord_t y, jas_seqent_t v);
+static jas_image_pager_t *jas_image_pager_create(jas_image_coord_t width,
+  jas_image_coord_t height, size_t smplsize, size_t budget);
+static void jas_image_pager_destroy(jas_image_pager_t *pager);
+static unsigned char *jas_image_pager_getrow(jas_image_pager_t *pager,
+  jas_image_coord_t y, bool write);
+static int jas_image_pager_load(jas_image_pager_t *pager, int pageno);
+static int jas_image_pager_spill(jas_image_pager_t *pager, int pageno);
+static int jas_image_loadcmpt(jas_image_t *image, jas_image_cmpt_t *cmpt,
+  jas_image_coord_t x, jas_image_coord_t y, jas_image_coord_t width,
+  jas_image_coord_t height);
 static int putint(jas_stream_t *out, int sgnd, int prec, long val);
 static int getint(jas_stream_t *in, int sgnd, int prec, long *val);
 static void jas_image_calcbbox2(jas_image_t *image, jas_image_coord_t *tlx,
@@ -120,15 +197,38 @@ static void jas_image_calcbbox2(jas_image_t *image, jas_image_coord_t *tlx,
 static int jas_image_numfmts = 0;
 static jas_image_fmtinfo_t jas_image_fmtinfos[JAS_IMAGE_MAXFMTS];
 
+/* The amount of memory that the resident pages of an image may use. */
+static size_t jas_image_pagebudget = JAS_IMAGE_PAGEBUDGET;
+
 /******************************************************************************\
 * Create and destroy operations.
 \******************************************************************************/
 
 jas_image_t *jas_image_create(int numcmpts, jas_image_cmptparm_t *cmptparms,
   int clrspc)
+{
+	return jas_image_create2(numcmpts, cmptparms, clrspc, false);
+}
+
+jas_image_t *jas_image_createfromsrc(int numcmpts,
+  jas_image_cmptparm_t *cmptparms, jas_clrspc_t clrspc,
+  jas_image_srcops_t *srcops, jas_image_srcobj_t *srcobj)
 {
 	jas_image_t *image;
-	uint_fast32_t rawsize;
+
+	if (!(image = jas_image_create2(numcmpts, cmptparms, clrspc, true))) {
+		return 0;
+	}
+	image->srcops_ = srcops;
+	image->srcobj_ = srcobj;
+	return image;
+}
+
+static jas_image_t *jas_image_create2(int numcmpts,
+  jas_image_cmptparm_t *cmptparms, jas_clrspc_t clrspc, bool nostorage)
+{
+	jas_image_t *image;
+	uint_fast64_t rawsize;
 	uint_fast32_t inmem;
 	int cmptno;
 	jas_image_cmptparm_t *cmptparm;
@@ -152,16 +252,18 @@ jas_image_t *jas_image_create(int numcmpts, jas_image_cmptparm_t *cmptparms,
 		image->cmpts_[cmptno] = 0;
 	}
 
-	/* Compute the approximate raw size of the image. */
+	/* Compute the approximate raw size of the image.  This is done in 64
+	  bits, as the size of a large image need not fit in 32 bits. */
 	rawsize = 0;
 	for (cmptno = 0, cmptparm = cmptparms; cmptno < numcmpts; ++cmptno,
 	  ++cmptparm) {
-		rawsize += cmptparm->width * cmptparm->height *
-		  (cmptparm->prec + 7) / 8;
+		rawsize += JAS_CAST(uint_fast64_t, cmptparm->width) *
+		  cmptparm->height * (cmptparm->prec + 7) / 8;
 	}
 	/* Decide whether to buffer the image data in memory, based on the
 	  raw size of the image. */
 	inmem = (rawsize < JAS_IMAGE_INMEMTHRESH);
+	image->inmem_ = inmem;
 
 	/* Create the individual image components. */
 	for (cmptno = 0, cmptparm = cmptparms; cmptno < numcmpts; ++cmptno,
@@ -169,7 +271,8 @@ jas_image_t *jas_image_create(int numcmpts, jas_image_cmptparm_t *cmptparms,
 		if (!(image->cmpts_[cmptno] = jas_image_cmpt_create(cmptparm->tlx,
 		  cmptparm->tly, cmptparm->hstep, cmptparm->vstep,
 		  cmptparm->width, cmptparm->height, cmptparm->prec,
-		  cmptparm->sgnd, inmem))) {
+		  cmptparm->sgnd, inmem, nostorage,
+		  jas_image_pagebudget / numcmpts))) {
 			jas_image_destroy(image);
 			return 0;
 		}
@@ -201,6 +304,10 @@ jas_image_t *jas_image_create0()
 	image->cmpts_ = 0;
 	image->inmem_ = true;
 	image->cmprof_ = 0;
+	image->srcops_ = 0;
+	image->srcobj_ = 0;
+	image->loadops_ = 0;
+	image->loadobj_ = 0;
 
 	return image;
 }
@@ -211,6 +318,10 @@ jas_image_t *jas_image_copy(jas_image_t *image)
 	int cmptno;
 
 	newimage = jas_image_create0();
+	/* The copy cannot share the loader, so all of the samples are needed. */
+	if (jas_image_load(image)) {
+		goto error;
+	}
 	if (jas_image_growcmpts(newimage, image->numcmpts_)) {
 		goto error;
 	}
@@ -223,6 +334,10 @@ jas_image_t *jas_image_copy(jas_image_t *image)
 
 	jas_image_setbbox(newimage);
 
+	newimage->inmem_ = image->inmem_;
+	newimage->srcops_ = image->srcops_;
+	newimage->srcobj_ = image->srcobj_;
+
 	if (image->cmprof_) {
 		if (!(newimage->cmprof_ = jas_cmprof_copy(image->cmprof_)))
 			goto error;
@@ -244,12 +359,17 @@ static jas_image_cmpt_t *jas_image_cmpt_create0()
 	}
 	memset(cmpt, 0, sizeof(jas_image_cmpt_t));
 	cmpt->type_ = JAS_IMAGE_CT_UNKNOWN;
+	cmpt->loadno_ = -1;
 	return cmpt;
 }
 
 static jas_image_cmpt_t *jas_image_cmpt_copy(jas_image_cmpt_t *cmpt)
 {
 	jas_image_cmpt_t *newcmpt;
+	size_t size;
+	jas_image_coord_t y;
+	void *src;
+	void *dst;
 
 	if (!(newcmpt = jas_image_cmpt_create0())) {
 		return 0;
@@ -264,6 +384,39 @@ static jas_image_cmpt_t *jas_image_cmpt_copy(jas_image_cmpt_t *cmpt)
 	newcmpt->sgnd_ = cmpt->sgnd_;
 	newcmpt->cps_ = cmpt->cps_;
 	newcmpt->type_ = cmpt->type_;
+	if (cmpt->data_) {
+		size = jas_image_cmpt_datasize(cmpt->datatype_) *
+		  JAS_CAST(size_t, cmpt->width_) * cmpt->height_;
+		if (!(newcmpt->data_ = jas_malloc(size ? size : 1))) {
+			jas_image_cmpt_destroy(newcmpt);
+			return 0;
+		}
+		memcpy(newcmpt->data_, cmpt->data_, size);
+		newcmpt->datatype_ = cmpt->datatype_;
+		return newcmpt;
+	}
+	if (cmpt->pager_) {
+		if (!(newcmpt->pager_ = jas_image_pager_create(cmpt->width_,
+		  cmpt->height_, jas_image_cmpt_datasize(cmpt->datatype_),
+		  cmpt->pager_->maxresident_ * cmpt->pager_->pagesize_))) {
+			jas_image_cmpt_destroy(newcmpt);
+			return 0;
+		}
+		newcmpt->datatype_ = cmpt->datatype_;
+		for (y = 0; y < cmpt->height_; ++y) {
+			if (!(src = jas_image_cmpt_row(cmpt, y, false)) ||
+			  !(dst = jas_image_cmpt_row(newcmpt, y, true))) {
+				jas_image_cmpt_destroy(newcmpt);
+				return 0;
+			}
+			memcpy(dst, src, cmpt->pager_->rowsize_);
+		}
+		return newcmpt;
+	}
+	if (!cmpt->stream_) {
+		/* The component has no storage, so there is nothing to copy. */
+		return newcmpt;
+	}
 	if (!(newcmpt->stream_ = jas_stream_memopen(0, 0))) {
 		return 0;
 	}
@@ -283,6 +436,9 @@ void jas_image_destroy(jas_image_t *image)
 {
 	int i;
 
+	if (image->loadops_) {
+		(*image->loadops_->destroy_)(image->loadobj_);
+	}
 	if (image->cmpts_) {
 		for (i = 0; i < image->numcmpts_; ++i) {
 			jas_image_cmpt_destroy(image->cmpts_[i]);
@@ -297,10 +453,13 @@ void jas_image_destroy(jas_image_t *image)
 
 static jas_image_cmpt_t *jas_image_cmpt_create(uint_fast32_t tlx, uint_fast32_t tly,
   uint_fast32_t hstep, uint_fast32_t vstep, uint_fast32_t width, uint_fast32_t
-  height, uint_fast16_t depth, bool sgnd, uint_fast32_t inmem)
+  height, uint_fast16_t depth, bool sgnd, uint_fast32_t inmem, bool nostorage,
+  size_t budget)
 {
 	jas_image_cmpt_t *cmpt;
 	long size;
+	size_t n;
+	int datatype;
 
 	if (!(cmpt = jas_malloc(sizeof(jas_image_cmpt_t)))) {
 		return 0;
@@ -317,6 +476,50 @@ static jas_image_cmpt_t *jas_image_cmpt_create(uint_fast32_t tlx, uint_fast32_t
 	cmpt->sgnd_ = sgnd;
 	cmpt->stream_ = 0;
 	cmpt->cps_ = (depth + 7) / 8;
+	cmpt->data_ = 0;
+	cmpt->datatype_ = JAS_IMAGE_DATA_NONE;
+	cmpt->pager_ = 0;
+	cmpt->loadno_ = -1;
+
+	if (nostorage) {
+		return cmpt;
+	}
+
+	/* Keep the samples of a component that fits in memory in a plane of
+	  the narrowest type that can hold them, so that they can be read and
+	  written without going through a stream. */
+	datatype = jas_image_cmpt_datatype(depth, sgnd);
+	if (datatype != JAS_IMAGE_DATA_NONE && (inmem || !cmpt->width_ ||
+	  !cmpt->height_)) {
+		/* Reject a component whose size does not fit in a size_t, rather
+		  than allocate a plane that is too small for it. */
+		n = jas_image_cmpt_datasize(datatype);
+		if (cmpt->width_ && cmpt->height_ && (n > ((size_t) -1) /
+		  cmpt->width_ / cmpt->height_)) {
+			jas_image_cmpt_destroy(cmpt);
+			return 0;
+		}
+		n *= JAS_CAST(size_t, cmpt->width_) * cmpt->height_;
+		if (!(cmpt->data_ = jas_malloc(n ? n : 1))) {
+			jas_image_cmpt_destroy(cmpt);
+			return 0;
+		}
+		memset(cmpt->data_, 0, n);
+		cmpt->datatype_ = datatype;
+		return cmpt;
+	}
+
+	/* Keep the samples of a larger component in the same layout, but split
+	  into pages of which only some are resident at any time. */
+	if (datatype != JAS_IMAGE_DATA_NONE) {
+		if (!(cmpt->pager_ = jas_image_pager_create(cmpt->width_,
+		  cmpt->height_, jas_image_cmpt_datasize(datatype), budget))) {
+			jas_image_cmpt_destroy(cmpt);
+			return 0;
+		}
+		cmpt->datatype_ = datatype;
+		return cmpt;
+	}
 
 	size = cmpt->width_ * cmpt->height_ * cmpt->cps_;
 	cmpt->stream_ = (inmem) ? jas_stream_memopen(0, size) : jas_stream_tmpfile();
@@ -342,6 +545,12 @@ static void jas_image_cmpt_destroy(jas_image_cmpt_t *cmpt)
 	if (cmpt->stream_) {
 		jas_stream_close(cmpt->stream_);
 	}
+	if (cmpt->data_) {
+		jas_free(cmpt->data_);
+	}
+	if (cmpt->pager_) {
+		jas_image_pager_destroy(cmpt->pager_);
+	}
 	jas_free(cmpt);
 }
 
@@ -414,12 +623,19 @@ int jas_image_readcmpt(jas_image_t *image, int cmptno, jas_image_coord_t x,
 	jas_seqent_t *dr;
 	jas_seqent_t *d;
 	int drs;
+	void *row;
+	uint_least8_t *p8;
+	uint_least16_t *p16;
+	int_least32_t *p32;
 
 	if (cmptno < 0 || cmptno >= image->numcmpts_) {
 		return -1;
 	}
 
 	cmpt = image->cmpts_[cmptno];
+	if (!cmpt->stream_ && !jas_image_cmpt_hasplane(cmpt)) {
+		return -1;
+	}
 	if (x >= cmpt->width_ || y >= cmpt->height_ ||
 	  x + width > cmpt->width_ ||
 	  y + height > cmpt->height_) {
@@ -432,8 +648,39 @@ int jas_image_readcmpt(jas_image_t *image, int cmptno, jas_image_coord_t x,
 		}
 	}
 
+	if (jas_image_loadcmpt(image, cmpt, x, y, width, height)) {
+		return -1;
+	}
+
 	dr = jas_matrix_getref(data, 0, 0);
 	drs = jas_matrix_rowstep(data);
+	if (jas_image_cmpt_hasplane(cmpt)) {
+		for (i = 0; i < height; ++i, dr += drs) {
+			d = dr;
+			if (!(row = jas_image_cmpt_row(cmpt, y + i, false))) {
+				return -1;
+			}
+			switch (cmpt->datatype_) {
+			case JAS_IMAGE_DATA_UINT8:
+				p8 = (uint_least8_t *) row + x;
+				for (j = width; j > 0; --j) {
+					*d++ = *p8++;
+				}
+				break;
+			case JAS_IMAGE_DATA_UINT16:
+				p16 = (uint_least16_t *) row + x;
+				for (j = width; j > 0; --j) {
+					*d++ = *p16++;
+				}
+				break;
+			default:
+				p32 = (int_least32_t *) row + x;
+				memcpy(d, p32, width * sizeof(jas_seqent_t));
+				break;
+			}
+		}
+		return 0;
+	}
 	for (i = 0; i < height; ++i, dr += drs) {
 		d = dr;
 		if (jas_stream_seek(cmpt->stream_, (cmpt->width_ * (y + i) + x)
@@ -467,12 +714,20 @@ int jas_image_writecmpt(jas_image_t *image, int cmptno, jas_image_coord_t x, jas
 	jas_seqent_t v;
 	int k;
 	int c;
+	jas_seqent_t mask;
+	void *row;
+	uint_least8_t *p8;
+	uint_least16_t *p16;
+	int_least32_t *p32;
 
 	if (cmptno < 0 || cmptno >= image->numcmpts_) {
 		return -1;
 	}
 
 	cmpt = image->cmpts_[cmptno];
+	if (!cmpt->stream_ && !jas_image_cmpt_hasplane(cmpt)) {
+		return -1;
+	}
 	if (x >= cmpt->width_ || y >= cmpt->height_ ||
 	  x + width > cmpt->width_ ||
 	  y + height > cmpt->height_) {
@@ -485,6 +740,36 @@ int jas_image_writecmpt(jas_image_t *image, int cmptno, jas_image_coord_t x, jas
 
 	dr = jas_matrix_getref(data, 0, 0);
 	drs = jas_matrix_rowstep(data);
+	if (jas_image_cmpt_hasplane(cmpt)) {
+		mask = JAS_ONES(cmpt->prec_);
+		for (i = 0; i < height; ++i, dr += drs) {
+			d = dr;
+			if (!(row = jas_image_cmpt_row(cmpt, y + i, true))) {
+				return -1;
+			}
+			switch (cmpt->datatype_) {
+			case JAS_IMAGE_DATA_UINT8:
+				p8 = (uint_least8_t *) row + x;
+				for (j = width; j > 0; --j) {
+					*p8++ = *d++ & mask;
+				}
+				break;
+			case JAS_IMAGE_DATA_UINT16:
+				p16 = (uint_least16_t *) row + x;
+				for (j = width; j > 0; --j) {
+					*p16++ = *d++ & mask;
+				}
+				break;
+			default:
+				p32 = (int_least32_t *) row + x;
+				for (j = width; j > 0; --j) {
+					*p32++ = jas_image_cmpt_wrap(cmpt, *d++);
+				}
+				break;
+			}
+		}
+		return 0;
+	}
 	for (i = 0; i < height; ++i, dr += drs) {
 		d = dr;
 		if (jas_stream_seek(cmpt->stream_, (cmpt->width_ * (y + i) + x)
@@ -669,7 +954,8 @@ int jas_image_addcmpt(jas_image_t *image, int cmptno,
 	if (!(newcmpt = jas_image_cmpt_create(cmptparm->tlx,
 	  cmptparm->tly, cmptparm->hstep, cmptparm->vstep,
 	  cmptparm->width, cmptparm->height, cmptparm->prec,
-	  cmptparm->sgnd, 1))) {
+	  cmptparm->sgnd, image->inmem_, false,
+	  jas_image_pagebudget / (image->numcmpts_ + 1)))) {
 		return -1;
 	}
 	if (cmptno < image->numcmpts_) {
@@ -729,6 +1015,293 @@ static jas_seqent_t bitstoint(uint_fast32_t v, int prec, bool sgnd)
 	return ret;
 }
 
+/* Get the narrowest in-memory sample type for the given precision and
+  signedness (or JAS_IMAGE_DATA_NONE if the samples must be kept in a
+  stream). */
+static int jas_image_cmpt_datatype(int prec, bool sgnd)
+{
+	if (prec < 1 || prec >= 32) {
+		return JAS_IMAGE_DATA_NONE;
+	}
+	if (!sgnd && prec <= 8) {
+		return JAS_IMAGE_DATA_UINT8;
+	}
+	if (!sgnd && prec <= 16) {
+		return JAS_IMAGE_DATA_UINT16;
+	}
+	return JAS_IMAGE_DATA_INT32;
+}
+
+static size_t jas_image_cmpt_datasize(int datatype)
+{
+	switch (datatype) {
+	case JAS_IMAGE_DATA_UINT8:
+		return sizeof(uint_least8_t);
+	case JAS_IMAGE_DATA_UINT16:
+		return sizeof(uint_least16_t);
+	case JAS_IMAGE_DATA_INT32:
+		return sizeof(int_least32_t);
+	}
+	return 0;
+}
+
+/* Get a row of a component held in memory or in pages.  The write flag
+  tells whether the row is going to be modified. */
+static void *jas_image_cmpt_row(jas_image_cmpt_t *cmpt, jas_image_coord_t y,
+  bool write)
+{
+	if (cmpt->pager_) {
+		return jas_image_pager_getrow(cmpt->pager_, y, write);
+	}
+	return (unsigned char *) cmpt->data_ + (size_t) cmpt->width_ * y *
+	  jas_image_cmpt_datasize(cmpt->datatype_);
+}
+
+/* Reduce a sample value to the precision of a component, as storing it in
+  the component and reading it back does. */
+static jas_seqent_t jas_image_cmpt_wrap(jas_image_cmpt_t *cmpt, jas_seqent_t v)
+{
+	return bitstoint(inttobits(v, cmpt->prec_, cmpt->sgnd_), cmpt->prec_,
+	  cmpt->sgnd_);
+}
+
+static int jas_image_cmpt_getsmpl(jas_image_cmpt_t *cmpt,
+  jas_image_coord_t x, jas_image_coord_t y, jas_seqent_t *v)
+{
+	void *row;
+	if (!(row = jas_image_cmpt_row(cmpt, y, false))) {
+		return -1;
+	}
+	switch (cmpt->datatype_) {
+	case JAS_IMAGE_DATA_UINT8:
+		*v = ((uint_least8_t *) row)[x];
+		break;
+	case JAS_IMAGE_DATA_UINT16:
+		*v = ((uint_least16_t *) row)[x];
+		break;
+	default:
+		*v = ((int_least32_t *) row)[x];
+		break;
+	}
+	return 0;
+}
+
+static int jas_image_cmpt_putsmpl(jas_image_cmpt_t *cmpt, jas_image_coord_t x,
+  jas_image_coord_t y, jas_seqent_t v)
+{
+	void *row;
+	if (!(row = jas_image_cmpt_row(cmpt, y, true))) {
+		return -1;
+	}
+	v = jas_image_cmpt_wrap(cmpt, v);
+	switch (cmpt->datatype_) {
+	case JAS_IMAGE_DATA_UINT8:
+		((uint_least8_t *) row)[x] = v;
+		break;
+	case JAS_IMAGE_DATA_UINT16:
+		((uint_least16_t *) row)[x] = v;
+		break;
+	default:
+		((int_least32_t *) row)[x] = v;
+		break;
+	}
+	return 0;
+}
+
+void *jas_image_cmptrow(jas_image_t *image, int cmptno, jas_image_coord_t y)
+{
+	jas_image_cmpt_t *cmpt;
+
+	if (cmptno < 0 || cmptno >= image->numcmpts_) {
+		return 0;
+	}
+	cmpt = image->cmpts_[cmptno];
+	if (!jas_image_cmpt_hasplane(cmpt) || y < 0 || y >= cmpt->height_) {
+		return 0;
+	}
+	if (jas_image_loadcmpt(image, cmpt, 0, y, cmpt->width_, 1)) {
+		return 0;
+	}
+	/* The caller may modify the row. */
+	return jas_image_cmpt_row(cmpt, y, true);
+}
+
+void jas_image_setpagebudget(size_t budget)
+{
+	jas_image_pagebudget = budget;
+}
+
+/******************************************************************************\
+* Component page operations.
+\******************************************************************************/
+
+static jas_image_pager_t *jas_image_pager_create(jas_image_coord_t width,
+  jas_image_coord_t height, size_t smplsize, size_t budget)
+{
+	jas_image_pager_t *pager;
+	int i;
+
+	if (!(pager = jas_malloc(sizeof(jas_image_pager_t)))) {
+		return 0;
+	}
+	pager->rowsize_ = (size_t) width * smplsize;
+	pager->rowsperpage_ = JAS_IMAGE_PAGESIZE / pager->rowsize_;
+	if (pager->rowsperpage_ < 1) {
+		pager->rowsperpage_ = 1;
+	}
+	pager->height_ = height;
+	pager->pagesize_ = pager->rowsize_ * pager->rowsperpage_;
+	pager->numpages_ = (height + pager->rowsperpage_ - 1) /
+	  pager->rowsperpage_;
+	pager->pages_ = 0;
+	pager->numresident_ = 0;
+	pager->maxresident_ = budget / pager->pagesize_;
+	if (pager->maxresident_ < 2) {
+		pager->maxresident_ = 2;
+	}
+	if (pager->maxresident_ > pager->numpages_) {
+		pager->maxresident_ = pager->numpages_;
+	}
+	pager->resident_ = 0;
+	pager->clock_ = 0;
+	pager->spill_ = 0;
+
+	/* The spill file is addressed with stream offsets. */
+	if ((size_t) (pager->numpages_ - 1) > LONG_MAX / pager->pagesize_) {
+		jas_image_pager_destroy(pager);
+		return 0;
+	}
+
+	if (!(pager->pages_ = jas_malloc(pager->numpages_ *
+	  sizeof(jas_image_page_t))) ||
+	  !(pager->resident_ = jas_malloc(pager->maxresident_ * sizeof(int)))) {
+		jas_image_pager_destroy(pager);
+		return 0;
+	}
+	for (i = 0; i < pager->numpages_; ++i) {
+		pager->pages_[i].data_ = 0;
+		pager->pages_[i].spilled_ = false;
+		pager->pages_[i].dirty_ = false;
+		pager->pages_[i].lastuse_ = 0;
+	}
+	return pager;
+}
+
+static void jas_image_pager_destroy(jas_image_pager_t *pager)
+{
+	int i;
+
+	for (i = 0; i < pager->numresident_; ++i) {
+		jas_free(pager->pages_[pager->resident_[i]].data_);
+	}
+	if (pager->pages_) {
+		jas_free(pager->pages_);
+	}
+	if (pager->resident_) {
+		jas_free(pager->resident_);
+	}
+	if (pager->spill_) {
+		jas_stream_close(pager->spill_);
+	}
+	jas_free(pager);
+}
+
+static unsigned char *jas_image_pager_getrow(jas_image_pager_t *pager,
+  jas_image_coord_t y, bool write)
+{
+	jas_image_page_t *page;
+	int pageno;
+
+	pageno = y / pager->rowsperpage_;
+	page = &pager->pages_[pageno];
+	if (!page->data_ && jas_image_pager_load(pager, pageno)) {
+		return 0;
+	}
+	page->lastuse_ = ++pager->clock_;
+	if (write) {
+		page->dirty_ = true;
+	}
+	return page->data_ + (y - pageno * pager->rowsperpage_) *
+	  pager->rowsize_;
+}
+
+/* Make a page resident, evicting the least recently used page if the
+  budget has been reached. */
+static int jas_image_pager_load(jas_image_pager_t *pager, int pageno)
+{
+	jas_image_page_t *page;
+	jas_image_page_t *victim;
+	unsigned char *data;
+	int slot;
+	int i;
+	int len;
+
+	page = &pager->pages_[pageno];
+	len = JAS_MIN(pager->rowsperpage_, pager->height_ - pageno *
+	  pager->rowsperpage_) * pager->rowsize_;
+
+	if (pager->numresident_ < pager->maxresident_) {
+		if (!(data = jas_malloc(pager->pagesize_))) {
+			return -1;
+		}
+		slot = pager->numresident_++;
+	} else {
+		slot = 0;
+		for (i = 1; i < pager->numresident_; ++i) {
+			if (pager->pages_[pager->resident_[i]].lastuse_ <
+			  pager->pages_[pager->resident_[slot]].lastuse_) {
+				slot = i;
+			}
+		}
+		if (jas_image_pager_spill(pager, pager->resident_[slot])) {
+			return -1;
+		}
+		victim = &pager->pages_[pager->resident_[slot]];
+		data = victim->data_;
+		victim->data_ = 0;
+	}
+	pager->resident_[slot] = pageno;
+
+	if (!page->spilled_) {
+		/* The page has never been written, so it is still all zero. */
+		memset(data, 0, len);
+	} else if (jas_stream_seek(pager->spill_, (long) (pageno *
+	  pager->pagesize_), SEEK_SET) < 0 ||
+	  jas_stream_read(pager->spill_, data, len) != len) {
+		jas_free(data);
+		pager->resident_[slot] = pager->resident_[--pager->numresident_];
+		return -1;
+	}
+	page->data_ = data;
+	page->dirty_ = false;
+	return 0;
+}
+
+/* Write a resident page to the spill file, if it has been modified. */
+static int jas_image_pager_spill(jas_image_pager_t *pager, int pageno)
+{
+	jas_image_page_t *page;
+	int len;
+
+	page = &pager->pages_[pageno];
+	if (!page->dirty_) {
+		return 0;
+	}
+	if (!pager->spill_ && !(pager->spill_ = jas_stream_tmpfile())) {
+		return -1;
+	}
+	len = JAS_MIN(pager->rowsperpage_, pager->height_ - pageno *
+	  pager->rowsperpage_) * pager->rowsize_;
+	if (jas_stream_seek(pager->spill_, (long) (pageno * pager->pagesize_),
+	  SEEK_SET) < 0 || jas_stream_write(pager->spill_, page->data_, len) !=
+	  len) {
+		return -1;
+	}
+	page->spilled_ = true;
+	page->dirty_ = false;
+	return 0;
+}
+
 static void jas_image_setbbox(jas_image_t *image)
 {
 	jas_image_cmpt_t *cmpt;
@@ -796,6 +1369,11 @@ int jas_image_copycmpt(jas_image_t *dstimage, int dstcmptno, jas_image_t *srcima
 			return -1;
 		}
 	}
+	if (jas_image_loadcmpt(srcimage, srcimage->cmpts_[srccmptno], 0, 0,
+	  srcimage->cmpts_[srccmptno]->width_,
+	  srcimage->cmpts_[srccmptno]->height_)) {
+		return -1;
+	}
 	if (!(newcmpt = jas_image_cmpt_copy(srcimage->cmpts_[srccmptno]))) {
 		return -1;
 	}
@@ -891,9 +1469,16 @@ int jas_image_readcmptsample(jas_image_t *image, int cmptno, int x, int y)
 	uint_fast32_t v;
 	int k;
 	int c;
+	jas_seqent_t s;
 
 	cmpt = image->cmpts_[cmptno];
 
+	if (jas_image_loadcmpt(image, cmpt, x, y, 1, 1)) {
+		return -1;
+	}
+	if (jas_image_cmpt_hasplane(cmpt)) {
+		return jas_image_cmpt_getsmpl(cmpt, x, y, &s) ? (-1) : s;
+	}
 	if (jas_stream_seek(cmpt->stream_, (cmpt->width_ * y + x) * cmpt->cps_,
 	  SEEK_SET) < 0) {
 		return -1;
@@ -918,6 +1503,10 @@ void jas_image_writecmptsample(jas_image_t *image, int cmptno, int x, int y,
 
 	cmpt = image->cmpts_[cmptno];
 
+	if (jas_image_cmpt_hasplane(cmpt)) {
+		jas_image_cmpt_putsmpl(cmpt, x, y, v);
+		return;
+	}
 	if (jas_stream_seek(cmpt->stream_, (cmpt->width_ * y + x) * cmpt->cps_,
 	  SEEK_SET) < 0) {
 		return;
@@ -944,6 +1533,67 @@ int jas_image_getcmptbytype(jas_image_t *image, int ctype)
 	return -1;
 }
 
+void jas_image_setloader(jas_image_t *image, jas_image_loadops_t *loadops,
+  jas_image_loadobj_t *loadobj)
+{
+	int cmptno;
+
+	for (cmptno = 0; cmptno < image->numcmpts_; ++cmptno) {
+		image->cmpts_[cmptno]->loadno_ = cmptno;
+	}
+	image->loadops_ = loadops;
+	image->loadobj_ = loadobj;
+}
+
+int jas_image_getcmptbyloadno(jas_image_t *image, int loadno)
+{
+	int cmptno;
+
+	for (cmptno = 0; cmptno < image->numcmpts_; ++cmptno) {
+		if (image->cmpts_[cmptno]->loadno_ == loadno) {
+			return cmptno;
+		}
+	}
+	return -1;
+}
+
+int jas_image_load(jas_image_t *image)
+{
+	jas_image_cmpt_t *cmpt;
+	int cmptno;
+
+	if (!image->loadops_) {
+		return 0;
+	}
+	for (cmptno = 0; cmptno < image->numcmpts_; ++cmptno) {
+		cmpt = image->cmpts_[cmptno];
+		if (jas_image_loadcmpt(image, cmpt, 0, 0, cmpt->width_,
+		  cmpt->height_)) {
+			return -1;
+		}
+	}
+	(*image->loadops_->destroy_)(image->loadobj_);
+	image->loadops_ = 0;
+	image->loadobj_ = 0;
+	for (cmptno = 0; cmptno < image->numcmpts_; ++cmptno) {
+		image->cmpts_[cmptno]->loadno_ = -1;
+	}
+	return 0;
+}
+
+/* Make sure that the samples of a region of a component are present, if
+  the image has a loader. */
+static int jas_image_loadcmpt(jas_image_t *image, jas_image_cmpt_t *cmpt,
+  jas_image_coord_t x, jas_image_coord_t y, jas_image_coord_t width,
+  jas_image_coord_t height)
+{
+	if (!image->loadops_ || cmpt->loadno_ < 0) {
+		return 0;
+	}
+	return (*image->loadops_->load_)(image->loadobj_, cmpt->loadno_, x, y,
+	  width, height);
+}
+
 
 
 
@@ -973,6 +1623,7 @@ int jas_image_readcmpt2(jas_image_t *image, int cmptno, jas_image_coord_t x,
 	jas_image_coord_t j;
 	long v;
 	long *bufptr;
+	jas_seqent_t s;
 
 	if (cmptno < 0 || cmptno >= image->numcmpts_)
 		goto error;
@@ -981,8 +1632,20 @@ int jas_image_readcmpt2(jas_image_t *image, int cmptno, jas_image_coord_t x,
 	  width < 0 || height < 0 || x + width > cmpt->width_ ||
 	  y + height > cmpt->height_)
 		goto error;
+	if (jas_image_loadcmpt(image, cmpt, x, y, width, height))
+		goto error;
 
 	bufptr = buf;
+	if (jas_image_cmpt_hasplane(cmpt)) {
+		for (i = 0; i < height; ++i) {
+			for (j = 0; j < width; ++j) {
+				if (jas_image_cmpt_getsmpl(cmpt, x + j, y + i, &s))
+					goto error;
+				*bufptr++ = s;
+			}
+		}
+		return 0;
+	}
 	for (i = 0; i < height; ++i) {
 		if (jas_stream_seek(cmpt->stream_, (cmpt->width_ * (y + i) + x)
 		  * cmpt->cps_, SEEK_SET) < 0)
@@ -1018,6 +1681,15 @@ int jas_image_writecmpt2(jas_image_t *image, int cmptno, jas_image_coord_t x,
 		goto error;
 
 	bufptr = buf;
+	if (jas_image_cmpt_hasplane(cmpt)) {
+		for (i = 0; i < height; ++i) {
+			for (j = 0; j < width; ++j) {
+				if (jas_image_cmpt_putsmpl(cmpt, x + j, y + i, *bufptr++))
+					goto error;
+			}
+		}
+		return 0;
+	}
 	for (i = 0; i < height; ++i) {
 		if (jas_stream_seek(cmpt->stream_, (cmpt->width_ * (y + i) + x)
 		  * cmpt->cps_, SEEK_SET) < 0)
@@ -1062,12 +1734,16 @@ int jas_image_sampcmpt(jas_image_t *image, int cmptno, int newcmptno,
 	jas_image_coord_t x;
 	jas_image_coord_t y;
 	long v;
+	jas_seqent_t s;
 	jas_image_coord_t cmptbrx;
 	jas_image_coord_t cmptbry;
 
 	assert(cmptno >= 0 && cmptno < image->numcmpts_);
 	oldcmpt = image->cmpts_[cmptno];
 	assert(oldcmpt->tlx_ == 0 && oldcmpt->tly_ == 0);
+	if (jas_image_loadcmpt(image, oldcmpt, 0, 0, oldcmpt->width_,
+	  oldcmpt->height_))
+		goto error;
 	jas_image_calcbbox2(image, &tlx, &tly, &brx, &bry);
 	width = FLOORDIV(brx - ho + hs, hs);
 	height = FLOORDIV(bry - vo + vs, vs);
@@ -1084,7 +1760,9 @@ int jas_image_sampcmpt(jas_image_t *image, int cmptno, int newcmptno,
 cmptbrx = oldcmpt->tlx_ + (oldcmpt->width_ - 1) * oldcmpt->hstep_;
 cmptbry = oldcmpt->tly_ + (oldcmpt->height_ - 1) * oldcmpt->vstep_;
 	newcmpt = image->cmpts_[newcmptno];
-	jas_stream_rewind(newcmpt->stream_);
+	if (newcmpt->stream_) {
+		jas_stream_rewind(newcmpt->stream_);
+	}
 	for (i = 0; i < height; ++i) {
 		y = newcmpt->tly_ + newcmpt->vstep_ * i;
 		for (j = 0; j < width; ++j) {
@@ -1116,18 +1794,27 @@ cmptbry = oldcmpt->tly_ + (oldcmpt->height_ - 1) * oldcmpt->vstep_;
 			}
 			assert(oldx >= 0 && oldx < oldcmpt->width_ &&
 			  oldy >= 0 && oldy < oldcmpt->height_);
-			if (jas_stream_seek(oldcmpt->stream_, oldcmpt->cps_ *
-			  (oldy * oldcmpt->width_ + oldx), SEEK_SET) < 0)
-				goto error;
-			if (getint(oldcmpt->stream_, oldcmpt->sgnd_,
-			  oldcmpt->prec_, &v))
-				goto error;
+			if (jas_image_cmpt_hasplane(oldcmpt)) {
+				if (jas_image_cmpt_getsmpl(oldcmpt, oldx, oldy, &s))
+					goto error;
+				v = s;
+			} else {
+				if (jas_stream_seek(oldcmpt->stream_, oldcmpt->cps_ *
+				  (oldy * oldcmpt->width_ + oldx), SEEK_SET) < 0)
+					goto error;
+				if (getint(oldcmpt->stream_, oldcmpt->sgnd_,
+				  oldcmpt->prec_, &v))
+					goto error;
+			}
 			if (newcmpt->prec_ != oldcmpt->prec_ ||
 			  newcmpt->sgnd_ != oldcmpt->sgnd_) {
 				v = convert(v, oldcmpt->sgnd_, oldcmpt->prec_,
 				  newcmpt->sgnd_, newcmpt->prec_);
 			}
-			if (putint(newcmpt->stream_, newcmpt->sgnd_,
+			if (jas_image_cmpt_hasplane(newcmpt)) {
+				if (jas_image_cmpt_putsmpl(newcmpt, j, i, v))
+					goto error;
+			} else if (putint(newcmpt->stream_, newcmpt->sgnd_,
 			  newcmpt->prec_, v))
 				goto error;
 		}
@@ -66,6 +66,19 @@
 #include "jasper/jas_types.h"
 #include "jasper/jas_image.h"
 #include "jasper/jas_init.h"
+#include "jasper/jas_thread.h"
+
+/******************************************************************************\
+* Local data.
+\******************************************************************************/
+
+/* The number of jas_init calls not yet matched by a jas_cleanup call. */
+static int jas_initcnt = 0;
+
+/* Has the exit handler been registered? */
+static bool jas_atexitdone = false;
+
+static void jas_exit(void);
 
 /******************************************************************************\
 * Code.
@@ -77,6 +90,13 @@ int jas_init()
 	jas_image_fmtops_t fmtops;
 	int fmtid;
 
+	/* The format table only needs to be set up by the first caller. */
+	jas_thread_lockinit();
+	if (jas_initcnt++ > 0) {
+		jas_thread_unlockinit();
+		return 0;
+	}
+
 	fmtid = 0;
 
 #if !defined(EXCLUDE_JP2_SUPPORT)
@@ -98,12 +118,36 @@ int jas_init()
 	at least one memory allocation is performed.  This is desirable
 	as it ensures that the JasPer exit handler is called before the
 	debug memory allocator exit handler. */
-	atexit(jas_cleanup);
+	if (!jas_atexitdone) {
+		atexit(jas_exit);
+		jas_atexitdone = true;
+	}
+	jas_thread_unlockinit();
 
 	return 0;
 }
 
 void jas_cleanup()
 {
+	/* Keep the format table until the last user is done with it. */
+	jas_thread_lockinit();
+	if (jas_initcnt > 0 && --jas_initcnt > 0) {
+		jas_thread_unlockinit();
+		return;
+	}
+	jas_image_clearfmts();
+	jas_thread_unlockinit();
+	/* The worker threads are kept for the life of the process, as other
+	  users of the library (e.g., in other threads) may still be performing
+	  loops on them. */
+}
+
+static void jas_exit()
+{
+	jas_thread_lockinit();
+	jas_initcnt = 0;
 	jas_image_clearfmts();
+	jas_thread_unlockinit();
+	/* The worker threads are left alone, as they may already have been
+	  terminated by the time the process exits. */
 }
@@ -72,6 +72,7 @@
 \******************************************************************************/
 
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include <math.h>
 
@@ -79,6 +80,12 @@
 #include "jasper/jas_malloc.h"
 #include "jasper/jas_math.h"
 
+/******************************************************************************\
+* Local prototypes.
+\******************************************************************************/
+
+static int jas_matrix_padrowstep(int numrows, int numcols);
+
 /******************************************************************************\
 * Constructors and destructors.
 \******************************************************************************/
@@ -100,7 +107,6 @@ jas_matrix_t *jas_seq2d_create(int xstart, int ystart, int xend, int yend)
 jas_matrix_t *jas_matrix_create(int numrows, int numcols)
 {
 	jas_matrix_t *matrix;
-	int i;
 
 	if (!(matrix = jas_malloc(sizeof(jas_matrix_t)))) {
 		return 0;
@@ -108,33 +114,22 @@ jas_matrix_t *jas_matrix_create(int numrows, int numcols)
 	matrix->flags_ = 0;
 	matrix->numrows_ = numrows;
 	matrix->numcols_ = numcols;
-	matrix->rows_ = 0;
 	matrix->maxrows_ = numrows;
 	matrix->data_ = 0;
-	matrix->datasize_ = numrows * numcols;
-
-	if (matrix->maxrows_ > 0) {
-		if (!(matrix->rows_ = jas_malloc(matrix->maxrows_ *
-		  sizeof(jas_seqent_t *)))) {
-			jas_matrix_destroy(matrix);
-			return 0;
-		}
-	}
+	matrix->rowstep_ = jas_matrix_padrowstep(numrows, numcols);
+	matrix->block_ = 0;
+	matrix->datasize_ = numrows * matrix->rowstep_;
 
 	if (matrix->datasize_ > 0) {
-		if (!(matrix->data_ = jas_malloc(matrix->datasize_ *
-		  sizeof(jas_seqent_t)))) {
+		/* Allocate enough extra space to align the data. */
+		if (!(matrix->block_ = jas_malloc(matrix->datasize_ *
+		  sizeof(jas_seqent_t) + JAS_MATRIX_ALIGN - 1))) {
 			jas_matrix_destroy(matrix);
 			return 0;
 		}
-	}
-
-	for (i = 0; i < numrows; ++i) {
-		matrix->rows_[i] = &matrix->data_[i * matrix->numcols_];
-	}
-
-	for (i = 0; i < matrix->datasize_; ++i) {
-		matrix->data_[i] = 0;
+		matrix->data_ = (jas_seqent_t *) (((uintptr_t) matrix->block_ +
+		  JAS_MATRIX_ALIGN - 1) & ~JAS_CAST(uintptr_t, JAS_MATRIX_ALIGN - 1));
+		memset(matrix->data_, 0, matrix->datasize_ * sizeof(jas_seqent_t));
 	}
 
 	matrix->xstart_ = 0;
@@ -147,14 +142,10 @@ jas_matrix_t *jas_matrix_create(int numrows, int numcols)
 
 void jas_matrix_destroy(jas_matrix_t *matrix)
 {
-	if (matrix->data_) {
+	if (matrix->block_) {
 		assert(!(matrix->flags_ & JAS_MATRIX_REF));
-		jas_free(matrix->data_);
-		matrix->data_ = 0;
-	}
-	if (matrix->rows_) {
-		jas_free(matrix->rows_);
-		matrix->rows_ = 0;
+		jas_free(matrix->block_);
+		matrix->block_ = 0;
 	}
 	jas_free(matrix);
 }
@@ -203,27 +194,20 @@ void jas_seq2d_bindsub(jas_matrix_t *s, jas_matrix_t *s1, int xstart, int ystart
 void jas_matrix_bindsub(jas_matrix_t *mat0, jas_matrix_t *mat1, int r0, int c0,
   int r1, int c1)
 {
-	int i;
-
-	if (mat0->data_) {
-		if (!(mat0->flags_ & JAS_MATRIX_REF)) {
-			jas_free(mat0->data_);
-		}
-		mat0->data_ = 0;
-		mat0->datasize_ = 0;
-	}
-	if (mat0->rows_) {
-		jas_free(mat0->rows_);
-		mat0->rows_ = 0;
+	if (mat0->block_) {
+		jas_free(mat0->block_);
+		mat0->block_ = 0;
 	}
 	mat0->flags_ |= JAS_MATRIX_REF;
 	mat0->numrows_ = r1 - r0 + 1;
 	mat0->numcols_ = c1 - c0 + 1;
 	mat0->maxrows_ = mat0->numrows_;
-	mat0->rows_ = jas_malloc(mat0->maxrows_ * sizeof(jas_seqent_t *));
-	for (i = 0; i < mat0->numrows_; ++i) {
-		mat0->rows_[i] = mat1->rows_[r0 + i] + c0;
-	}
+	mat0->datasize_ = 0;
+	/* The rows are those of the other matrix, so they are spaced the same
+	  way. */
+	mat0->rowstep_ = mat1->rowstep_;
+	mat0->data_ = (mat0->numrows_ > 0 && mat0->numcols_ > 0) ?
+	  jas_matrix_getref(mat1, r0, c0) : 0;
 
 	mat0->xstart_ = mat1->xstart_ + c0;
 	mat0->ystart_ = mat1->ystart_ + r0;
@@ -263,12 +247,14 @@ void jas_matrix_divpow2(jas_matrix_t *matrix, int n)
 	jas_seqent_t *data;
 
 	rowstep = jas_matrix_rowstep(matrix);
-	for (i = matrix->numrows_, rowstart = matrix->rows_[0]; i > 0; --i,
-	  rowstart += rowstep) {
-		for (j = matrix->numcols_, data = rowstart; j > 0; --j,
-		  ++data) {
-			*data = (*data >= 0) ? ((*data) >> n) :
-			  (-((-(*data)) >> n));
+	if (matrix->numrows_ > 0 && matrix->numcols_ > 0) {
+		for (i = matrix->numrows_, rowstart = matrix->data_; i > 0;
+		  --i, rowstart += rowstep) {
+			for (j = matrix->numcols_, data = rowstart; j > 0; --j,
+			  ++data) {
+				*data = (*data >= 0) ? ((*data) >> n) :
+				  (-((-(*data)) >> n));
+			}
 		}
 	}
 }
@@ -283,16 +269,18 @@ void jas_matrix_clip(jas_matrix_t *matrix, jas_seqent_t minval, jas_seqent_t max
 	int rowstep;
 
 	rowstep = jas_matrix_rowstep(matrix);
-	for (i = matrix->numrows_, rowstart = matrix->rows_[0]; i > 0; --i,
-	  rowstart += rowstep) {
-		data = rowstart;
-		for (j = matrix->numcols_, data = rowstart; j > 0; --j,
-		  ++data) {
-			v = *data;
-			if (v < minval) {
-				*data = minval;
-			} else if (v > maxval) {
-				*data = maxval;
+	if (matrix->numrows_ > 0 && matrix->numcols_ > 0) {
+		for (i = matrix->numrows_, rowstart = matrix->data_; i > 0;
+		  --i, rowstart += rowstep) {
+			data = rowstart;
+			for (j = matrix->numcols_, data = rowstart; j > 0; --j,
+			  ++data) {
+				v = *data;
+				if (v < minval) {
+					*data = minval;
+				} else if (v > maxval) {
+					*data = maxval;
+				}
 			}
 		}
 	}
@@ -308,11 +296,13 @@ void jas_matrix_asr(jas_matrix_t *matrix, int n)
 
 	assert(n >= 0);
 	rowstep = jas_matrix_rowstep(matrix);
-	for (i = matrix->numrows_, rowstart = matrix->rows_[0]; i > 0; --i,
-	  rowstart += rowstep) {
-		for (j = matrix->numcols_, data = rowstart; j > 0; --j,
-		  ++data) {
-			*data >>= n;
+	if (matrix->numrows_ > 0 && matrix->numcols_ > 0) {
+		for (i = matrix->numrows_, rowstart = matrix->data_; i > 0;
+		  --i, rowstart += rowstep) {
+			for (j = matrix->numcols_, data = rowstart; j > 0; --j,
+			  ++data) {
+				*data >>= n;
+			}
 		}
 	}
 }
@@ -326,11 +316,13 @@ void jas_matrix_asl(jas_matrix_t *matrix, int n)
 	jas_seqent_t *data;
 
 	rowstep = jas_matrix_rowstep(matrix);
-	for (i = matrix->numrows_, rowstart = matrix->rows_[0]; i > 0; --i,
-	  rowstart += rowstep) {
-		for (j = matrix->numcols_, data = rowstart; j > 0; --j,
-		  ++data) {
-			*data <<= n;
+	if (matrix->numrows_ > 0 && matrix->numcols_ > 0) {
+		for (i = matrix->numrows_, rowstart = matrix->data_; i > 0;
+		  --i, rowstart += rowstep) {
+			for (j = matrix->numcols_, data = rowstart; j > 0; --j,
+			  ++data) {
+				*data <<= n;
+			}
 		}
 	}
 }
@@ -341,24 +333,43 @@ void jas_matrix_asl(jas_matrix_t *matrix, int n)
 
 int jas_matrix_resize(jas_matrix_t *matrix, int numrows, int numcols)
 {
-	int size;
-	int i;
+	int rowstep;
 
-	size = numrows * numcols;
-	if (size > matrix->datasize_ || numrows > matrix->maxrows_) {
+	/* Padded rows are preferred, but a matrix can always be resized to
+	  anything that fits in its buffer without padding. */
+	rowstep = jas_matrix_padrowstep(numrows, numcols);
+	if (numrows * rowstep > matrix->datasize_) {
+		rowstep = numcols;
+	}
+	if (numrows * rowstep > matrix->datasize_ ||
+	  numrows > matrix->maxrows_) {
 		return -1;
 	}
 
 	matrix->numrows_ = numrows;
 	matrix->numcols_ = numcols;
-
-	for (i = 0; i < numrows; ++i) {
-		matrix->rows_[i] = &matrix->data_[numcols * i];
-	}
+	matrix->rowstep_ = rowstep;
 
 	return 0;
 }
 
+/* Get the spacing between rows for a matrix that owns its data.  The rows
+  of a matrix with more than one row are padded to JAS_MATRIX_ALIGN bytes,
+  unless the padding would add more than a quarter to the size of the
+  matrix (e.g., for a matrix that is a single column wide). */
+static int jas_matrix_padrowstep(int numrows, int numcols)
+{
+	int n;
+	int rowstep;
+
+	if (numrows <= 1) {
+		return numcols;
+	}
+	n = JAS_MATRIX_ALIGN / sizeof(jas_seqent_t);
+	rowstep = ((numcols + n - 1) / n) * n;
+	return (rowstep - numcols <= numcols / 4) ? rowstep : numcols;
+}
+
 void jas_matrix_setall(jas_matrix_t *matrix, jas_seqent_t val)
 {
 	int i;
@@ -368,11 +379,13 @@ void jas_matrix_setall(jas_matrix_t *matrix, jas_seqent_t val)
 	jas_seqent_t *data;
 
 	rowstep = jas_matrix_rowstep(matrix);
-	for (i = matrix->numrows_, rowstart = matrix->rows_[0]; i > 0; --i,
-	  rowstart += rowstep) {
-		for (j = matrix->numcols_, data = rowstart; j > 0; --j,
-		  ++data) {
-			*data = val;
+	if (matrix->numrows_ > 0 && matrix->numcols_ > 0) {
+		for (i = matrix->numrows_, rowstart = matrix->data_; i > 0;
+		  --i, rowstart += rowstep) {
+			for (j = matrix->numcols_, data = rowstart; j > 0; --j,
+			  ++data) {
+				*data = val;
+			}
 		}
 	}
 }
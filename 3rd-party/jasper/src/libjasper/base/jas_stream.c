@@ -75,6 +75,7 @@
 #if defined(HAVE_FCNTL_H)
 #include <fcntl.h>
 #endif
+#include <limits.h>
 #include <stdlib.h>
 #include <stdarg.h>
 #include <stdio.h>
@@ -91,6 +92,11 @@
 #include "jasper/jas_malloc.h"
 #include "jasper/jas_math.h"
 
+#if !defined(HAVE_WINDOWS_H) && defined(HAVE_UNISTD_H)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 /******************************************************************************\
 * Local function prototypes.
 \******************************************************************************/
@@ -100,12 +106,28 @@ static void jas_stream_destroy(jas_stream_t *stream);
 static jas_stream_t *jas_stream_create(void);
 static void jas_stream_initbuf(jas_stream_t *stream, int bufmode, char *buf,
   int bufsize);
+static int jas_stream_bufavail(jas_stream_t *stream, int cnt);
+static int jas_stream_canbypass(jas_stream_t *stream, int cnt, int mode);
 
 static int mem_read(jas_stream_obj_t *obj, char *buf, int cnt);
 static int mem_write(jas_stream_obj_t *obj, char *buf, int cnt);
 static long mem_seek(jas_stream_obj_t *obj, long offset, int origin);
 static int mem_close(jas_stream_obj_t *obj);
 
+static int chunk_read(jas_stream_obj_t *obj, char *buf, int cnt);
+static int chunk_write(jas_stream_obj_t *obj, char *buf, int cnt);
+static long chunk_seek(jas_stream_obj_t *obj, long offset, int origin);
+static int chunk_close(jas_stream_obj_t *obj);
+static int chunk_drain(jas_stream_chunkobj_t *c, jas_stream_t *out, int cnt);
+
+static int view_read(jas_stream_obj_t *obj, char *buf, int cnt);
+static int view_write(jas_stream_obj_t *obj, char *buf, int cnt);
+static long view_seek(jas_stream_obj_t *obj, long offset, int origin);
+static int view_close(jas_stream_obj_t *obj);
+
+static int mmap_map(jas_stream_mmapobj_t *obj, const wchar_t *filename);
+static int mmap_close(jas_stream_obj_t *obj);
+
 static int sfile_read(jas_stream_obj_t *obj, char *buf, int cnt);
 static int sfile_write(jas_stream_obj_t *obj, char *buf, int cnt);
 static long sfile_seek(jas_stream_obj_t *obj, long offset, int origin);
@@ -141,6 +163,29 @@ static jas_stream_ops_t jas_stream_memops = {
 	mem_close
 };
 
+static jas_stream_ops_t jas_stream_chunkops = {
+	chunk_read,
+	chunk_write,
+	chunk_seek,
+	chunk_close
+};
+
+static jas_stream_ops_t jas_stream_viewops = {
+	view_read,
+	view_write,
+	view_seek,
+	view_close
+};
+
+/* A mapped file is read like any other view, it only needs to be unmapped
+  when the stream is closed. */
+static jas_stream_ops_t jas_stream_mmapops = {
+	view_read,
+	view_write,
+	view_seek,
+	mmap_close
+};
+
 /******************************************************************************\
 * Code for opening and closing streams.
 \******************************************************************************/
@@ -251,6 +296,125 @@ jas_stream_t *jas_stream_memopen(unsigned char *buf, int bufsize)
 	return stream;
 }
 
+jas_stream_t *jas_stream_chunkopen(int chunksize)
+{
+	jas_stream_t *stream;
+	jas_stream_chunkobj_t *obj;
+
+	if (!(stream = jas_stream_create())) {
+		return 0;
+	}
+
+	/* Like any other memory stream, a chunked memory stream is always
+	  opened for both reading and writing in binary mode. */
+	stream->openmode_ = JAS_STREAM_READ | JAS_STREAM_WRITE | JAS_STREAM_BINARY;
+	jas_stream_initbuf(stream, JAS_STREAM_FULLBUF, 0, 0);
+	stream->ops_ = &jas_stream_chunkops;
+
+	if (!(obj = jas_malloc(sizeof(jas_stream_chunkobj_t)))) {
+		jas_stream_destroy(stream);
+		return 0;
+	}
+	stream->obj_ = (void *) obj;
+
+	/* The chunks are only allocated as data is written. */
+	obj->chunks_ = 0;
+	obj->numchunks_ = 0;
+	obj->maxchunks_ = 0;
+	obj->chunksize_ = (chunksize > 0) ? chunksize : JAS_STREAM_CHUNKSIZE;
+	obj->len_ = 0;
+	obj->pos_ = 0;
+
+	return stream;
+}
+
+jas_stream_t *jas_stream_memview(const unsigned char *buf, int bufsize)
+{
+	jas_stream_t *stream;
+
+	if (bufsize < 0 || (!buf && bufsize > 0)) {
+		return 0;
+	}
+
+	if (!(stream = jas_stream_create())) {
+		return 0;
+	}
+
+	stream->openmode_ = JAS_STREAM_READ | JAS_STREAM_BINARY;
+
+	/* The caller's data is used as the stream buffer.  Since the buffer
+	  always holds the entire stream, it never needs to be refilled, and
+	  seeking only moves the current position within the buffer. */
+	stream->bufmode_ = JAS_STREAM_FULLBUF | JAS_STREAM_VIEWBUF |
+	  JAS_STREAM_RDBUF;
+	stream->bufbase_ = JAS_CAST(uchar *, buf);
+	stream->bufstart_ = stream->bufbase_;
+	stream->bufsize_ = bufsize;
+	stream->ptr_ = stream->bufstart_;
+	stream->cnt_ = bufsize;
+
+	stream->ops_ = &jas_stream_viewops;
+	stream->obj_ = 0;
+
+	return stream;
+}
+
+jas_stream_t *jas_stream_mmapopen(const wchar_t *filename)
+{
+	jas_stream_t *stream;
+	jas_stream_mmapobj_t *obj;
+
+	if (!(obj = jas_malloc(sizeof(jas_stream_mmapobj_t)))) {
+		return 0;
+	}
+	if (mmap_map(obj, filename)) {
+		jas_free(obj);
+		return 0;
+	}
+
+	/* The mapping is served directly as the stream buffer. */
+	if (!(stream = jas_stream_memview(obj->base_, obj->len_))) {
+		mmap_close(obj);
+		return 0;
+	}
+	stream->ops_ = &jas_stream_mmapops;
+	stream->obj_ = (void *) obj;
+
+	return stream;
+}
+
+unsigned char *jas_stream_memrelease(jas_stream_t *stream, long *len)
+{
+	jas_stream_memobj_t *obj;
+	unsigned char *buf;
+
+	if (stream->ops_ != &jas_stream_memops) {
+		return 0;
+	}
+	if (jas_stream_flush(stream)) {
+		return 0;
+	}
+	obj = (jas_stream_memobj_t *) stream->obj_;
+	if (!obj->myalloc_) {
+		return 0;
+	}
+
+	buf = obj->buf_;
+	if (len) {
+		*len = obj->len_;
+	}
+
+	/* The stream no longer owns the buffer, so leave it empty. */
+	obj->buf_ = 0;
+	obj->bufsize_ = 0;
+	obj->len_ = 0;
+	obj->pos_ = 0;
+	obj->growable_ = 0;
+	obj->myalloc_ = 0;
+
+	return buf;
+}
+
 jas_stream_t *jas_stream_fopen(const wchar_t *filename, const char *mode)
 {
 	jas_stream_t *stream;
@@ -530,6 +694,18 @@ int jas_stream_ungetc(jas_stream_t *stream, int c)
 	  to read). */
 	stream->flags_ &= ~JAS_STREAM_EOF;
 
+	if (stream->bufmode_ & JAS_STREAM_VIEWBUF) {
+		/* The data of a view cannot be modified, so only the character
+		  that was actually read can be put back. */
+		if (stream->ptr_[-1] != JAS_CAST(uchar, c)) {
+			return -1;
+		}
+		--stream->rwcnt_;
+		--stream->ptr_;
+		++stream->cnt_;
+		return 0;
+	}
+
 	--stream->rwcnt_;
 	--stream->ptr_;
 	++stream->cnt_;
@@ -537,9 +713,29 @@ int jas_stream_ungetc(jas_stream_t *stream, int c)
 	return 0;
 }
 
+const uchar *jas_stream_getview(jas_stream_t *stream, int cnt)
+{
+	const uchar *ptr;
+
+	if (!(stream->bufmode_ & JAS_STREAM_VIEWBUF) || cnt < 0 ||
+	  (stream->flags_ & JAS_STREAM_ERRMASK) || stream->cnt_ < cnt) {
+		return 0;
+	}
+	if (stream->rwlimit_ >= 0 && stream->rwcnt_ + cnt > stream->rwlimit_) {
+		return 0;
+	}
+
+	ptr = stream->ptr_;
+	stream->ptr_ += cnt;
+	stream->cnt_ -= cnt;
+	stream->rwcnt_ += cnt;
+	return ptr;
+}
+
 int jas_stream_read(jas_stream_t *stream, void *buf, int cnt)
 {
 	int n;
+	int m;
 	int c;
 	char *bufptr;
 
@@ -547,11 +743,36 @@ int jas_stream_read(jas_stream_t *stream, void *buf, int cnt)
 
 	n = 0;
 	while (n < cnt) {
-		if ((c = jas_stream_getc(stream)) == EOF) {
-			return n;
+		if ((m = jas_stream_bufavail(stream, cnt - n)) > 0) {
+			/* Copy the characters that are already in the buffer. */
+			memcpy(bufptr, stream->ptr_, m);
+			stream->ptr_ += m;
+			stream->cnt_ -= m;
+			stream->rwcnt_ += m;
+		} else if (jas_stream_canbypass(stream, cnt - n, JAS_STREAM_READ)) {
+			/* Read directly into the caller's buffer. */
+			m = cnt - n;
+			if (stream->rwlimit_ >= 0 && stream->rwlimit_ - stream->rwcnt_ < m) {
+				m = stream->rwlimit_ - stream->rwcnt_;
+			}
+			stream->bufmode_ |= JAS_STREAM_RDBUF;
+			stream->ptr_ = stream->bufstart_;
+			stream->cnt_ = 0;
+			if ((m = (*stream->ops_->read_)(stream->obj_, bufptr, m)) <= 0) {
+				stream->flags_ |= (m < 0) ? JAS_STREAM_ERR : JAS_STREAM_EOF;
+				return n;
+			}
+			stream->rwcnt_ += m;
+		} else {
+			/* Refill the buffer (or fail) one character at a time. */
+			if ((c = jas_stream_getc(stream)) == EOF) {
+				return n;
+			}
+			*bufptr = c;
+			m = 1;
 		}
-		*bufptr++ = c;
-		++n;
+		bufptr += m;
+		n += m;
 	}
 
 	return n;
@@ -560,17 +781,59 @@ int jas_stream_read(jas_stream_t *stream, void *buf, int cnt)
 int jas_stream_write(jas_stream_t *stream, const void *buf, int cnt)
 {
 	int n;
+	int m;
 	const char *bufptr;
 
+	/* The data of a view cannot be modified. */
+	if (stream->bufmode_ & JAS_STREAM_VIEWBUF) {
+		return 0;
+	}
+
 	bufptr = buf;
 
 	n = 0;
 	while (n < cnt) {
-		if (jas_stream_putc(stream, *bufptr) == EOF) {
+		if ((stream->flags_ & JAS_STREAM_ERRMASK) != 0) {
 			return n;
 		}
-		++bufptr;
-		++n;
+		m = cnt - n;
+		if (stream->rwlimit_ >= 0) {
+			if (stream->rwcnt_ >= stream->rwlimit_) {
+				stream->flags_ |= JAS_STREAM_RWLIMIT;
+				return n;
+			}
+			if (stream->rwlimit_ - stream->rwcnt_ < m) {
+				m = stream->rwlimit_ - stream->rwcnt_;
+			}
+		}
+		if (jas_stream_canbypass(stream, m, JAS_STREAM_WRITE)) {
+			/* Write any buffered data, and then write directly from the
+			  caller's buffer. */
+			if (jas_stream_flushbuf(stream, EOF) == EOF) {
+				return n;
+			}
+			if ((*stream->ops_->write_)(stream->obj_, JAS_CAST(char *, bufptr),
+			  m) != m) {
+				stream->flags_ |= JAS_STREAM_ERR;
+				return n;
+			}
+			stream->rwcnt_ += m;
+		} else if ((stream->bufmode_ & JAS_STREAM_WRBUF) && stream->cnt_ > 0) {
+			/* Copy as much as fits into the buffer. */
+			m = JAS_MIN(m, stream->cnt_);
+			memcpy(stream->ptr_, bufptr, m);
+			stream->ptr_ += m;
+			stream->cnt_ -= m;
+			stream->rwcnt_ += m;
+		} else {
+			/* Flush the full buffer one character at a time. */
+			if (jas_stream_putc2(stream, *bufptr) == EOF) {
+				return n;
+			}
+			m = 1;
+		}
+		bufptr += m;
+		n += m;
 	}
 
 	return n;
@@ -627,11 +890,21 @@ char *jas_stream_gets(jas_stream_t *stream, char *buf, int bufsize)
 int jas_stream_gobble(jas_stream_t *stream, int n)
 {
 	int m;
+	int k;
 	m = n;
-	for (m = n; m > 0; --m) {
+	while (m > 0) {
+		if ((k = jas_stream_bufavail(stream, m)) > 0) {
+			/* Skip the characters that are already in the buffer. */
+			stream->ptr_ += k;
+			stream->cnt_ -= k;
+			stream->rwcnt_ += k;
+			m -= k;
+			continue;
+		}
 		if (jas_stream_getc(stream) == EOF) {
 			return n - m;
 		}
+		--m;
 	}
 	return n;
 }
@@ -653,15 +926,18 @@ int jas_stream_pad(jas_stream_t *stream, int n, int c)
 
 int jas_stream_isseekable(jas_stream_t *stream)
 {
-	if (stream->ops_ == &jas_stream_memops) {
+	if (stream->ops_ == &jas_stream_memops ||
+	  stream->ops_ == &jas_stream_chunkops ||
+	  stream->ops_ == &jas_stream_viewops ||
+	  stream->ops_ == &jas_stream_mmapops) {
 		return 1;
-	} else if (stream->ops_ == &jas_stream_fileops) {
+	} else {
+		/* Whether a file (or a stream with user-defined operations) is
+		  seekable can only be determined by trying. */
 		if ((*stream->ops_->seek_)(stream->obj_, 0, SEEK_CUR) < 0) {
 			return 0;
 		}
 		return 1;
-	} else {
-		return 0;
 	}
 }
 
@@ -681,6 +957,29 @@ long jas_stream_seek(jas_stream_t *stream, long offset, int origin)
 	/* Reset the EOF indicator (since we may not be at the EOF anymore). */
 	stream->flags_ &= ~JAS_STREAM_EOF;
 
+	if (stream->bufmode_ & JAS_STREAM_VIEWBUF) {
+		/* The entire view is resident in the buffer. */
+		switch (origin) {
+		case SEEK_SET:
+			newpos = offset;
+			break;
+		case SEEK_END:
+			newpos = stream->bufsize_ + offset;
+			break;
+		case SEEK_CUR:
+			newpos = (stream->ptr_ - stream->bufstart_) + offset;
+			break;
+		default:
+			return -1;
+		}
+		if (newpos < 0 || newpos > stream->bufsize_) {
+			return -1;
+		}
+		stream->ptr_ = &stream->bufstart_[newpos];
+		stream->cnt_ = stream->bufsize_ - newpos;
+		return newpos;
+	}
+
 	if (stream->bufmode_ & JAS_STREAM_RDBUF) {
 		if (origin == SEEK_CUR) {
 			offset -= stream->cnt_;
@@ -707,6 +1006,10 @@ long jas_stream_tell(jas_stream_t *stream)
 	int adjust;
 	int offset;
 
+	if (stream->bufmode_ & JAS_STREAM_VIEWBUF) {
+		return stream->ptr_ - stream->bufstart_;
+	}
+
 	if (stream->bufmode_ & JAS_STREAM_RDBUF) {
 		adjust = -stream->cnt_;
 	} else if (stream->bufmode_ & JAS_STREAM_WRBUF) {
@@ -774,6 +1077,45 @@ static void jas_stream_initbuf(jas_stream_t *stream, int bufmode, char *buf,
 * Buffer filling and flushing code.
 \******************************************************************************/
 
+/* Get the number of characters (up to cnt) that can be read straight out
+  of the stream buffer, as jas_stream_getc would read them. */
+static int jas_stream_bufavail(jas_stream_t *stream, int cnt)
+{
+	int n;
+
+	if ((stream->flags_ & JAS_STREAM_ERRMASK) != 0 ||
+	  (stream->bufmode_ & JAS_STREAM_WRBUF)) {
+		return 0;
+	}
+	n = JAS_MIN(stream->cnt_, cnt);
+	if (stream->rwlimit_ >= 0 && stream->rwlimit_ - stream->rwcnt_ < n) {
+		n = stream->rwlimit_ - stream->rwcnt_;
+	}
+	return n;
+}
+
+/* Can a transfer of cnt characters bypass the stream buffer?  This is only
+  done when the transfer would fill the buffer anyway or the data is already
+  resident in memory, and, for reading, when the buffer is empty. */
+static int jas_stream_canbypass(jas_stream_t *stream, int cnt, int mode)
+{
+	if ((stream->flags_ & JAS_STREAM_ERRMASK) != 0 ||
+	  (stream->bufmode_ & JAS_STREAM_VIEWBUF)) {
+		return 0;
+	}
+	if (cnt < stream->bufsize_ && stream->ops_ != &jas_stream_memops &&
+	  stream->ops_ != &jas_stream_chunkops) {
+		return 0;
+	}
+	if (mode == JAS_STREAM_READ) {
+		return (stream->openmode_ & JAS_STREAM_READ) && stream->cnt_ <= 0 &&
+		  !(stream->bufmode_ & JAS_STREAM_WRBUF) &&
+		  (stream->rwlimit_ < 0 || stream->rwcnt_ < stream->rwlimit_);
+	}
+	return (stream->openmode_ & (JAS_STREAM_WRITE | JAS_STREAM_APPEND)) &&
+	  !(stream->bufmode_ & JAS_STREAM_RDBUF);
+}
+
 int jas_stream_flush(jas_stream_t *stream)
 {
 	if (stream->bufmode_ & JAS_STREAM_RDBUF) {
@@ -796,6 +1138,13 @@ int jas_stream_fillbuf(jas_stream_t *stream, int getflag)
 		return EOF;
 	}
 
+	/* A view has no more data once its buffer has been consumed. */
+	if (stream->bufmode_ & JAS_STREAM_VIEWBUF) {
+		stream->flags_ |= JAS_STREAM_EOF;
+		stream->cnt_ = 0;
+		return EOF;
+	}
+
 	/* Make a half-hearted attempt to confirm that the buffer is not
 	currently being used for writing.  This check is not intended
 	to be foolproof! */
@@ -906,11 +1255,43 @@ int jas_stream_copy(jas_stream_t *out, jas_stream_t *in, int n)
 	int all;
 	int c;
 	int m;
+	int k;
 
 	all = (n < 0) ? 1 : 0;
 
 	m = n;
 	while (all || m > 0) {
+		if ((k = jas_stream_bufavail(in, all ? in->cnt_ : m)) > 0) {
+			/* Write the characters in the input buffer in one go. */
+			if (jas_stream_write(out, in->ptr_, k) != k) {
+				return -1;
+			}
+			in->ptr_ += k;
+			in->cnt_ -= k;
+			in->rwcnt_ += k;
+			m -= k;
+			continue;
+		}
+		if (in->ops_ == &jas_stream_chunkops && in->cnt_ <= 0 &&
+		  !(in->bufmode_ & JAS_STREAM_WRBUF) &&
+		  !(in->flags_ & JAS_STREAM_ERRMASK)) {
+			/* The input buffer is empty, so hand the chunks holding the
+			  rest of the data to the output stream directly. */
+			k = all ? (-1) : m;
+			if (in->rwlimit_ >= 0 && (k < 0 || k > in->rwlimit_ -
+			  in->rwcnt_)) {
+				k = in->rwlimit_ - in->rwcnt_;
+			}
+			if ((k = chunk_drain((jas_stream_chunkobj_t *) in->obj_, out,
+			  k)) < 0) {
+				return -1;
+			}
+			if (k > 0) {
+				in->rwcnt_ += k;
+				m -= k;
+				continue;
+			}
+		}
 		if ((c = jas_stream_getc_macro(in)) == EOF) {
 			/* The next character of input could not be read. */
 			/* Return with an error if an I/O error occured
@@ -1116,6 +1497,302 @@ static int mem_close(jas_stream_obj_t *obj)
 	return 0;
 }
 
+/******************************************************************************\
+* Chunked memory stream object.
+\******************************************************************************/
+
+/* Copy cnt characters to the file data at the offset pos, or clear them if
+  buf is null.  The chunks spanning the data must already be allocated. */
+static void chunk_put(jas_stream_chunkobj_t *c, long pos, const char *buf,
+  int cnt)
+{
+	int off;
+	int n;
+
+	while (cnt > 0) {
+		off = pos % c->chunksize_;
+		n = JAS_MIN(c->chunksize_ - off, cnt);
+		if (buf) {
+			memcpy(&c->chunks_[pos / c->chunksize_][off], buf, n);
+			buf += n;
+		} else {
+			memset(&c->chunks_[pos / c->chunksize_][off], 0, n);
+		}
+		pos += n;
+		cnt -= n;
+	}
+}
+
+/* Allocate enough chunks to hold len characters. */
+static int chunk_reserve(jas_stream_chunkobj_t *c, long len)
+{
+	uchar **chunks;
+	long numchunks;
+	int maxchunks;
+
+	numchunks = (len + c->chunksize_ - 1) / c->chunksize_;
+	if (numchunks > INT_MAX) {
+		return -1;
+	}
+	if (numchunks > c->maxchunks_) {
+		/* Only the chunk table is ever reallocated, never the data. */
+		maxchunks = JAS_MAX(c->maxchunks_, 16);
+		while (maxchunks < numchunks) {
+			maxchunks = (maxchunks > INT_MAX / 2) ? numchunks :
+			  (maxchunks << 1);
+		}
+		if (!(chunks = jas_realloc(c->chunks_, maxchunks * sizeof(uchar *)))) {
+			return -1;
+		}
+		c->chunks_ = chunks;
+		c->maxchunks_ = maxchunks;
+	}
+	while (c->numchunks_ < numchunks) {
+		if (!(c->chunks_[c->numchunks_] = jas_malloc(c->chunksize_))) {
+			return -1;
+		}
+		++c->numchunks_;
+	}
+	return 0;
+}
+
+/* Write up to cnt characters (or all of the remaining characters, if cnt is
+  negative) from the current position of a chunked memory stream to another
+  stream, one chunk at a time. */
+static int chunk_drain(jas_stream_chunkobj_t *c, jas_stream_t *out, int cnt)
+{
+	int off;
+	int n;
+	int m;
+	int k;
+
+	n = (c->pos_ < c->len_) ? (c->len_ - c->pos_) : 0;
+	if (cnt >= 0 && cnt < n) {
+		n = cnt;
+	}
+	for (k = 0; k < n; k += m) {
+		off = c->pos_ % c->chunksize_;
+		m = JAS_MIN(c->chunksize_ - off, n - k);
+		if (jas_stream_write(out, &c->chunks_[c->pos_ / c->chunksize_][off],
+		  m) != m) {
+			return -1;
+		}
+		c->pos_ += m;
+	}
+	return n;
+}
+
+static int chunk_read(jas_stream_obj_t *obj, char *buf, int cnt)
+{
+	jas_stream_chunkobj_t *c = (jas_stream_chunkobj_t *)obj;
+	int off;
+	int n;
+	int m;
+	int k;
+
+	n = (c->pos_ < c->len_) ? (c->len_ - c->pos_) : 0;
+	n = JAS_MIN(n, cnt);
+	for (k = 0; k < n; k += m) {
+		off = c->pos_ % c->chunksize_;
+		m = JAS_MIN(c->chunksize_ - off, n - k);
+		memcpy(&buf[k], &c->chunks_[c->pos_ / c->chunksize_][off], m);
+		c->pos_ += m;
+	}
+	return n;
+}
+
+static int chunk_write(jas_stream_obj_t *obj, char *buf, int cnt)
+{
+	jas_stream_chunkobj_t *c = (jas_stream_chunkobj_t *)obj;
+	long newpos;
+
+	newpos = c->pos_ + cnt;
+	if (newpos < c->pos_ || newpos > INT_MAX || chunk_reserve(c, newpos)) {
+		return -1;
+	}
+	if (c->pos_ > c->len_) {
+		/* The current position is beyond the end of the file, so
+		  pad the file to the current position with zeros. */
+		chunk_put(c, c->len_, 0, c->pos_ - c->len_);
+	}
+	chunk_put(c, c->pos_, buf, cnt);
+	c->pos_ = newpos;
+	if (c->pos_ > c->len_) {
+		c->len_ = c->pos_;
+	}
+	return cnt;
+}
+
+static long chunk_seek(jas_stream_obj_t *obj, long offset, int origin)
+{
+	jas_stream_chunkobj_t *c = (jas_stream_chunkobj_t *)obj;
+	long newpos;
+
+	switch (origin) {
+	case SEEK_SET:
+		newpos = offset;
+		break;
+	case SEEK_END:
+		newpos = c->len_ + offset;
+		break;
+	case SEEK_CUR:
+		newpos = c->pos_ + offset;
+		break;
+	default:
+		abort();
+		break;
+	}
+	if (newpos < 0) {
+		return -1;
+	}
+	c->pos_ = newpos;
+
+	return c->pos_;
+}
+
+static int chunk_close(jas_stream_obj_t *obj)
+{
+	jas_stream_chunkobj_t *c = (jas_stream_chunkobj_t *)obj;
+	int i;
+
+	for (i = 0; i < c->numchunks_; ++i) {
+		jas_free(c->chunks_[i]);
+	}
+	if (c->chunks_) {
+		jas_free(c->chunks_);
+	}
+	jas_free(obj);
+	return 0;
+}
+
+/******************************************************************************\
+* Memory view stream object.
+\******************************************************************************/
+
+/* The view stream operations are never used for data transfer, since the
+  entire view always resides in the stream buffer. */
+
+static int view_read(jas_stream_obj_t *obj, char *buf, int cnt)
+{
+	/* Avoid compiler warnings about unused parameters. */
+	(void) obj;
+	(void) buf;
+	(void) cnt;
+
+	return 0;
+}
+
+static int view_write(jas_stream_obj_t *obj, char *buf, int cnt)
+{
+	/* Avoid compiler warnings about unused parameters. */
+	(void) obj;
+	(void) buf;
+	(void) cnt;
+
+	return -1;
+}
+
+static long view_seek(jas_stream_obj_t *obj, long offset, int origin)
+{
+	/* Avoid compiler warnings about unused parameters. */
+	(void) obj;
+	(void) offset;
+	(void) origin;
+
+	return -1;
+}
+
+static int view_close(jas_stream_obj_t *obj)
+{
+	/* Avoid compiler warnings about unused parameters. */
+	(void) obj;
+
+	return 0;
+}
+
+/******************************************************************************\
+* Memory-mapped file stream object.
+\******************************************************************************/
+
+static int mmap_map(jas_stream_mmapobj_t *obj, const wchar_t *filename)
+{
+#if defined(HAVE_WINDOWS_H)
+	HANDLE file;
+	HANDLE mapping;
+	LARGE_INTEGER size;
+
+	if ((file = CreateFileW(filename, GENERIC_READ, FILE_SHARE_READ, 0,
+	  OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0)) == INVALID_HANDLE_VALUE) {
+		return -1;
+	}
+	if (!GetFileSizeEx(file, &size) || size.QuadPart > INT_MAX) {
+		CloseHandle(file);
+		return -1;
+	}
+	obj->base_ = 0;
+	obj->len_ = JAS_CAST(int, size.QuadPart);
+
+	/* An empty file cannot be mapped, it is an empty view instead.  The
+	  view keeps the mapping alive after its handles have been closed. */
+	if (obj->len_ > 0) {
+		if ((mapping = CreateFileMappingW(file, 0, PAGE_READONLY, 0, 0, 0))) {
+			obj->base_ = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			CloseHandle(mapping);
+		}
+	}
+	CloseHandle(file);
+#elif defined(HAVE_UNISTD_H)
+	char path[4096];
+	struct stat st;
+	void *base;
+	int fd;
+
+	if (wcstombs(path, filename, sizeof(path)) >= sizeof(path)) {
+		return -1;
+	}
+	if ((fd = open(path, O_RDONLY)) < 0) {
+		return -1;
+	}
+	if (fstat(fd, &st) || st.st_size > INT_MAX) {
+		close(fd);
+		return -1;
+	}
+	obj->base_ = 0;
+	obj->len_ = JAS_CAST(int, st.st_size);
+
+	/* An empty file cannot be mapped, it is an empty view instead. */
+	if (obj->len_ > 0) {
+		if ((base = mmap(0, obj->len_, PROT_READ, MAP_PRIVATE, fd, 0)) !=
+		  MAP_FAILED) {
+			obj->base_ = base;
+		}
+	}
+	close(fd);
+#else
+	/* Memory mapping is not supported on this platform. */
+	obj = 0;
+	filename = 0;
+	return -1;
+#endif
+
+	return (obj->len_ > 0 && !obj->base_) ? (-1) : 0;
+}
+
+static int mmap_close(jas_stream_obj_t *obj)
+{
+	jas_stream_mmapobj_t *m = JAS_CAST(jas_stream_mmapobj_t *, obj);
+
+	if (m->base_) {
+#if defined(HAVE_WINDOWS_H)
+		UnmapViewOfFile(m->base_);
+#elif defined(HAVE_UNISTD_H)
+		munmap(m->base_, m->len_);
+#endif
+	}
+	jas_free(m);
+	return 0;
+}
+
 /******************************************************************************\
 * File stream object.
 \******************************************************************************/
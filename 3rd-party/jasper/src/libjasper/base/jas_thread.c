@@ -0,0 +1,466 @@
+/* __START_OF_JASPER_LICENSE__
+ * 
+ * JasPer License Version 2.0
+ * 
+ * Copyright (c) 2001-2006 Michael David Adams
+ * Copyright (c) 1999-2000 Image Power, Inc.
+ * Copyright (c) 1999-2000 The University of British Columbia
+ * 
+ * All rights reserved.
+ * 
+ * Permission is hereby granted, free of charge, to any person (the
+ * "User") obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ * 
+ * 1.  The above copyright notices and this permission notice (which
+ * includes the disclaimer below) shall be included in all copies or
+ * substantial portions of the Software.
+ * 
+ * 2.  The name of a copyright holder shall not be used to endorse or
+ * promote products derived from the Software without specific prior
+ * written permission.
+ * 
+ * THIS DISCLAIMER OF WARRANTY CONSTITUTES AN ESSENTIAL PART OF THIS
+ * LICENSE.  NO USE OF THE SOFTWARE IS AUTHORIZED HEREUNDER EXCEPT UNDER
+ * THIS DISCLAIMER.  THE SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS
+ * "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT OF THIRD PARTY RIGHTS.  IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, OR ANY SPECIAL
+ * INDIRECT OR CONSEQUENTIAL DAMAGES, OR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION
+ * WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.  NO ASSURANCES ARE
+ * PROVIDED BY THE COPYRIGHT HOLDERS THAT THE SOFTWARE DOES NOT INFRINGE
+ * THE PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS OF ANY OTHER ENTITY.
+ * EACH COPYRIGHT HOLDER DISCLAIMS ANY LIABILITY TO THE USER FOR CLAIMS
+ * BROUGHT BY ANY OTHER ENTITY BASED ON INFRINGEMENT OF INTELLECTUAL
+ * PROPERTY RIGHTS OR OTHERWISE.  AS A CONDITION TO EXERCISING THE RIGHTS
+ * GRANTED HEREUNDER, EACH USER HEREBY ASSUMES SOLE RESPONSIBILITY TO SECURE
+ * ANY OTHER INTELLECTUAL PROPERTY RIGHTS NEEDED, IF ANY.  THE SOFTWARE
+ * IS NOT FAULT-TOLERANT AND IS NOT INTENDED FOR USE IN MISSION-CRITICAL
+ * SYSTEMS, SUCH AS THOSE USED IN THE OPERATION OF NUCLEAR FACILITIES,
+ * AIRCRAFT NAVIGATION OR COMMUNICATION SYSTEMS, AIR TRAFFIC CONTROL
+ * SYSTEMS, DIRECT LIFE SUPPORT MACHINES, OR WEAPONS SYSTEMS, IN WHICH
+ * THE FAILURE OF THE SOFTWARE OR SYSTEM COULD LEAD DIRECTLY TO DEATH,
+ * PERSONAL INJURY, OR SEVERE PHYSICAL OR ENVIRONMENTAL DAMAGE ("HIGH
+ * RISK ACTIVITIES").  THE COPYRIGHT HOLDERS SPECIFICALLY DISCLAIM ANY
+ * EXPRESS OR IMPLIED WARRANTY OF FITNESS FOR HIGH RISK ACTIVITIES.
+ * 
+ * __END_OF_JASPER_LICENSE__
+ */
+
+/*
+ * Threads
+ *
+ * $Id$
+ */
+
+/******************************************************************************\
+* Includes.
+\******************************************************************************/
+
+#include "jasper/jas_config.h"
+
+#if defined(HAVE_WINDOWS_H)
+#include <windows.h>
+#define	JAS_THREAD_WIN32
+#elif defined(HAVE_UNISTD_H)
+#include <pthread.h>
+#include <unistd.h>
+#define	JAS_THREAD_PTHREAD
+#endif
+
+#include "jasper/jas_types.h"
+#include "jasper/jas_math.h"
+#include "jasper/jas_thread.h"
+
+#if defined(JAS_THREAD_WIN32) || defined(JAS_THREAD_PTHREAD)
+
+/******************************************************************************\
+* Synchronization primitives.
+\******************************************************************************/
+
+#if defined(JAS_THREAD_WIN32)
+
+typedef SRWLOCK jas_thread_mutex_t;
+typedef CONDITION_VARIABLE jas_thread_cond_t;
+
+#define	JAS_THREAD_MUTEX_INIT	SRWLOCK_INIT
+#define	JAS_THREAD_COND_INIT	CONDITION_VARIABLE_INIT
+#define	jas_thread_lock(mutex)	AcquireSRWLockExclusive(mutex)
+#define	jas_thread_unlock(mutex)	ReleaseSRWLockExclusive(mutex)
+#define	jas_thread_wait(cond, mutex) \
+	SleepConditionVariableSRW((cond), (mutex), INFINITE, 0)
+#define	jas_thread_broadcast(cond)	WakeAllConditionVariable(cond)
+
+#else
+
+typedef pthread_mutex_t jas_thread_mutex_t;
+typedef pthread_cond_t jas_thread_cond_t;
+
+#define	JAS_THREAD_MUTEX_INIT	PTHREAD_MUTEX_INITIALIZER
+#define	JAS_THREAD_COND_INIT	PTHREAD_COND_INITIALIZER
+#define	jas_thread_lock(mutex)	pthread_mutex_lock(mutex)
+#define	jas_thread_unlock(mutex)	pthread_mutex_unlock(mutex)
+#define	jas_thread_wait(cond, mutex)	pthread_cond_wait((cond), (mutex))
+#define	jas_thread_broadcast(cond)	pthread_cond_broadcast(cond)
+
+#endif
+
+/******************************************************************************\
+* Types.
+\******************************************************************************/
+
+/* A loop being performed by jas_thread_parfor. */
+typedef struct jas_thread_loop_s {
+
+	/* The function that performs a run of iterations, and its argument. */
+	jas_thread_loopfunc_t func;
+	void *arg;
+
+	/* The number of iterations. */
+	int n;
+
+	/* The number of iterations handed out at a time. */
+	int runsize;
+
+	/* The first iteration not yet handed out. */
+	int next;
+
+	/* The number of iterations done. */
+	int numdone;
+
+	/* The number of worker threads performing iterations of the loop, and
+	  the largest number allowed to. */
+	int numhelpers;
+	int maxhelpers;
+
+	/* The return value of the loop. */
+	int ret;
+
+	/* The next loop with iterations not yet handed out. */
+	struct jas_thread_loop_s *link;
+
+} jas_thread_loop_t;
+
+/******************************************************************************\
+* Local data.
+\******************************************************************************/
+
+/* The mutex that protects all of the data below and the loops. */
+static jas_thread_mutex_t jas_thread_mutex = JAS_THREAD_MUTEX_INIT;
+
+/* Signalled when there are iterations to hand out. */
+static jas_thread_cond_t jas_thread_workcond = JAS_THREAD_COND_INIT;
+
+/* Signalled when a loop is done. */
+static jas_thread_cond_t jas_thread_donecond = JAS_THREAD_COND_INIT;
+
+/* The loops with iterations not yet handed out. */
+static jas_thread_loop_t *jas_thread_loops = 0;
+
+/* The number of worker threads.  Once started, they run for the life of
+  the process. */
+static int jas_thread_numworkers = 0;
+
+/* The number of threads that may work on a loop (or zero for one per
+  processor). */
+static int jas_thread_maxthreads = 0;
+
+/* Have the worker threads been started? */
+static bool jas_thread_started = false;
+
+/* The mutex held while a jas_thread_once function is called. */
+static jas_thread_mutex_t jas_thread_oncemutex = JAS_THREAD_MUTEX_INIT;
+
+/* The mutex that serializes jas_init and jas_cleanup. */
+static jas_thread_mutex_t jas_thread_initmutex = JAS_THREAD_MUTEX_INIT;
+
+/* The mutex that serializes the calls made back to the application. */
+static jas_thread_mutex_t jas_thread_callbackmutex = JAS_THREAD_MUTEX_INIT;
+
+/******************************************************************************\
+* Worker threads.
+\******************************************************************************/
+
+/* Remove a loop from the list of loops with iterations not yet handed out.
+  The mutex must be held. */
+static void jas_thread_unlinkloop(jas_thread_loop_t *loop)
+{
+	jas_thread_loop_t **prevlink;
+
+	for (prevlink = &jas_thread_loops; *prevlink != loop;
+	  prevlink = &(*prevlink)->link) {
+	}
+	*prevlink = loop->link;
+}
+
+/* Perform iterations of the loops as they are started. */
+static void jas_thread_work(void)
+{
+	jas_thread_loop_t *loop;
+	jas_thread_loop_t **prevlink;
+	int start;
+	int end;
+	int ret;
+
+	jas_thread_lock(&jas_thread_mutex);
+	for (;;) {
+		for (prevlink = &jas_thread_loops; *prevlink &&
+		  (*prevlink)->numhelpers >= (*prevlink)->maxhelpers;
+		  prevlink = &(*prevlink)->link) {
+		}
+		if (!(loop = *prevlink)) {
+			jas_thread_wait(&jas_thread_workcond, &jas_thread_mutex);
+			continue;
+		}
+		start = loop->next;
+		end = JAS_MIN(start + loop->runsize, loop->n);
+		loop->next = end;
+		if (end == loop->n) {
+			*prevlink = loop->link;
+		}
+		++loop->numhelpers;
+		jas_thread_unlock(&jas_thread_mutex);
+		ret = (*loop->func)(loop->arg, start, end);
+		jas_thread_lock(&jas_thread_mutex);
+		--loop->numhelpers;
+		if (ret) {
+			loop->ret = ret;
+		}
+		/* The loop may be gone as soon as the mutex is released. */
+		if ((loop->numdone += end - start) == loop->n) {
+			jas_thread_broadcast(&jas_thread_donecond);
+		}
+	}
+}
+
+#if defined(JAS_THREAD_WIN32)
+
+static DWORD WINAPI jas_thread_main(LPVOID arg)
+{
+	/* Eliminate compiler warnings about unused variables. */
+	(void) arg;
+
+	jas_thread_work();
+	return 0;
+}
+
+#else
+
+static void *jas_thread_main(void *arg)
+{
+	/* Eliminate compiler warnings about unused variables. */
+	(void) arg;
+
+	jas_thread_work();
+	return 0;
+}
+
+#endif
+
+/* Get the number of processors. */
+static int jas_thread_getnumprocs(void)
+{
+#if defined(JAS_THREAD_WIN32)
+	SYSTEM_INFO info;
+
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors;
+#elif defined(_SC_NPROCESSORS_ONLN)
+	return sysconf(_SC_NPROCESSORS_ONLN);
+#else
+	return 1;
+#endif
+}
+
+/* Start the worker threads.  The mutex must be held. */
+static void jas_thread_startworkers(void)
+{
+	int numworkers;
+#if defined(JAS_THREAD_WIN32)
+	HANDLE thread;
+#else
+	pthread_t thread;
+#endif
+
+	jas_thread_started = true;
+	numworkers = (jas_thread_maxthreads > 0 ? jas_thread_maxthreads :
+	  jas_thread_getnumprocs()) - 1;
+	/* Make do with the threads that can be started.  Nothing waits for
+	  them to end, so they are detached straight away. */
+	while (jas_thread_numworkers < numworkers) {
+#if defined(JAS_THREAD_WIN32)
+		if (!(thread = CreateThread(0, 0, jas_thread_main, 0, 0, 0))) {
+			break;
+		}
+		CloseHandle(thread);
+#else
+		if (pthread_create(&thread, 0, jas_thread_main, 0)) {
+			break;
+		}
+		pthread_detach(thread);
+#endif
+		++jas_thread_numworkers;
+	}
+}
+
+/******************************************************************************\
+* Code.
+\******************************************************************************/
+
+int jas_thread_parfor(int n, int grainsize, jas_thread_loopfunc_t func,
+  void *arg)
+{
+	jas_thread_loop_t loop;
+	int numthreads;
+	int start;
+	int end;
+	int ret;
+
+	grainsize = JAS_MAX(grainsize, 1);
+	if (n <= grainsize) {
+		return (n > 0) ? (*func)(arg, 0, n) : 0;
+	}
+
+	jas_thread_lock(&jas_thread_mutex);
+	if (!jas_thread_started) {
+		jas_thread_startworkers();
+	}
+	numthreads = jas_thread_numworkers + 1;
+	if (jas_thread_maxthreads > 0) {
+		numthreads = JAS_MIN(numthreads, jas_thread_maxthreads);
+	}
+	if (numthreads <= 1) {
+		jas_thread_unlock(&jas_thread_mutex);
+		return (*func)(arg, 0, n);
+	}
+
+	/* Hand out a few runs per thread, so that the threads finish at about
+	  the same time even if some iterations take longer than others. */
+	loop.func = func;
+	loop.arg = arg;
+	loop.n = n;
+	loop.runsize = JAS_MAX(grainsize, (n + 4 * numthreads - 1) /
+	  (4 * numthreads));
+	loop.next = 0;
+	loop.numdone = 0;
+	loop.numhelpers = 0;
+	loop.maxhelpers = numthreads - 1;
+	loop.ret = 0;
+	loop.link = jas_thread_loops;
+	jas_thread_loops = &loop;
+	jas_thread_broadcast(&jas_thread_workcond);
+
+	/* The calling thread hands out runs to itself as well, so the loop is
+	  done even if all of the worker threads are busy with other loops. */
+	while (loop.next < n) {
+		start = loop.next;
+		end = JAS_MIN(start + loop.runsize, n);
+		loop.next = end;
+		if (end == n) {
+			jas_thread_unlinkloop(&loop);
+		}
+		jas_thread_unlock(&jas_thread_mutex);
+		ret = (*func)(arg, start, end);
+		jas_thread_lock(&jas_thread_mutex);
+		if (ret) {
+			loop.ret = ret;
+		}
+		loop.numdone += end - start;
+	}
+	while (loop.numdone < n) {
+		jas_thread_wait(&jas_thread_donecond, &jas_thread_mutex);
+	}
+	jas_thread_unlock(&jas_thread_mutex);
+
+	return loop.ret;
+}
+
+void jas_thread_setmaxthreads(int maxthreads)
+{
+	jas_thread_lock(&jas_thread_mutex);
+	jas_thread_maxthreads = JAS_MAX(maxthreads, 0);
+	jas_thread_unlock(&jas_thread_mutex);
+}
+
+void jas_thread_once(int *done, void (*func)(void))
+{
+	jas_thread_lock(&jas_thread_oncemutex);
+	if (!*done) {
+		(*func)();
+		*done = 1;
+	}
+	jas_thread_unlock(&jas_thread_oncemutex);
+}
+
+void jas_thread_lockinit(void)
+{
+	jas_thread_lock(&jas_thread_initmutex);
+}
+
+void jas_thread_unlockinit(void)
+{
+	jas_thread_unlock(&jas_thread_initmutex);
+}
+
+void jas_thread_lockcallback(void)
+{
+	jas_thread_lock(&jas_thread_callbackmutex);
+}
+
+void jas_thread_unlockcallback(void)
+{
+	jas_thread_unlock(&jas_thread_callbackmutex);
+}
+
+#else
+
+/* Without thread support, loops are simply performed by the calling
+  thread. */
+
+int jas_thread_parfor(int n, int grainsize, jas_thread_loopfunc_t func,
+  void *arg)
+{
+	/* Eliminate compiler warnings about unused variables. */
+	(void) grainsize;
+
+	return (n > 0) ? (*func)(arg, 0, n) : 0;
+}
+
+void jas_thread_setmaxthreads(int maxthreads)
+{
+	/* Eliminate compiler warnings about unused variables. */
+	(void) maxthreads;
+}
+
+void jas_thread_once(int *done, void (*func)(void))
+{
+	if (!*done) {
+		(*func)();
+		*done = 1;
+	}
+}
+
+void jas_thread_lockinit(void)
+{
+}
+
+void jas_thread_unlockinit(void)
+{
+}
+
+void jas_thread_lockcallback(void)
+{
+}
+
+void jas_thread_unlockcallback(void)
+{
+}
+
+#endif
@@ -95,6 +95,14 @@ extern "C" {
 /* The threshold at which image data is no longer stored in memory. */
 #define JAS_IMAGE_INMEMTHRESH	(80 * 1024 * 1024) // increase the memory threshold to 80 MB from 16 MB  
 
+/* The approximate size of the pages in which the data of an image above the
+  threshold is stored. */
+#define JAS_IMAGE_PAGESIZE	(1024 * 1024)
+
+/* The default amount of memory that the resident pages of such an image may
+  use (see jas_image_setpagebudget). */
+#define JAS_IMAGE_PAGEBUDGET	(64 * 1024 * 1024)
+
 /*
  * Component types
  */
@@ -113,6 +121,15 @@ extern "C" {
 
 #define	JAS_IMAGE_CT_GRAY_Y	0
 
+/*
+ * Types of component sample data held in memory
+ */
+
+#define	JAS_IMAGE_DATA_NONE	0 /* the samples are held in a stream */
+#define	JAS_IMAGE_DATA_UINT8	1 /* unsigned, at most 8 bits */
+#define	JAS_IMAGE_DATA_UINT16	2 /* unsigned, at most 16 bits */
+#define	JAS_IMAGE_DATA_INT32	3 /* any other precision below 32 bits */
+
 /******************************************************************************\
 * Simple types.
 \******************************************************************************/
@@ -133,6 +150,9 @@ typedef int_fast16_t jas_image_smpltype_t;
 * Image class and supporting classes.
 \******************************************************************************/
 
+/* The pages of a component whose data is too large to be held in memory. */
+typedef struct jas_image_pager_s jas_image_pager_t;
+
 /* Image component class. */
 
 typedef struct {
@@ -168,16 +188,71 @@ typedef struct {
 #endif
 
 	jas_stream_t *stream_;
-	/* The stream containing the component data. */
+	/* The stream containing the component data (or null if the data is
+	  held in memory or in pages). */
 
 	int cps_;
 	/* The number of characters per sample in the stream. */
 
+	void *data_;
+	/* The component data, if it is held in memory.  The samples are
+	  stored row by row without any padding, and are already sign
+	  extended (or masked) to the precision of the component. */
+
+	int datatype_;
+	/* The type of the samples in data_ or in the pages (one of
+	  JAS_IMAGE_DATA_*). */
+
+	jas_image_pager_t *pager_;
+	/* The pages holding the component data, if it is too large to be held
+	  in memory.  The pages are bands of rows laid out like data_, and only
+	  the most recently used of them are resident. */
+
+	int loadno_;
+	/* The number by which the loader of the image knows this component
+	  (or -1 if the component is not produced by the loader). */
+
 	jas_image_cmpttype_t type_;
 	/* The type of component (e.g., opacity, red, green, blue, luma). */
 
 } jas_image_cmpt_t;
 
+/* Image source object. */
+
+typedef void jas_image_srcobj_t;
+
+/* Image source operations. */
+
+typedef struct {
+
+	int (*readcmpt_)(jas_image_srcobj_t *obj, int cmptno, jas_image_coord_t x,
+	  jas_image_coord_t y, jas_image_coord_t width, jas_image_coord_t height,
+	  jas_matrix_t *data);
+	/* Read a rectangular region of a component.  Unlike jas_image_readcmpt,
+	  the samples of unsigned components must already be level shifted
+	  (i.e., have 2^(prec - 1) subtracted from them). */
+
+} jas_image_srcops_t;
+
+/* Image loader object. */
+
+typedef void jas_image_loadobj_t;
+
+/* Image loader operations. */
+
+typedef struct {
+
+	int (*load_)(jas_image_loadobj_t *obj, int loadno, jas_image_coord_t x,
+	  jas_image_coord_t y, jas_image_coord_t width, jas_image_coord_t height);
+	/* Make sure that the samples of a rectangular region of a component
+	  have been written to the image.  The component is identified by its
+	  load number. */
+
+	void (*destroy_)(jas_image_loadobj_t *obj);
+	/* Release the loader object. */
+
+} jas_image_loadops_t;
+
 typedef struct {
 	// verticla resolution
 	uint_fast32_t vNumerator;
@@ -225,6 +300,21 @@ typedef struct {
 
 	bool inmem_;
 
+	jas_image_srcops_t *srcops_;
+	/* The operations used to obtain the sample data for an image whose
+	  components have no storage of their own (or null if they do). */
+
+	jas_image_srcobj_t *srcobj_;
+	/* The object passed to the source operations. */
+
+	jas_image_loadops_t *loadops_;
+	/* The operations used to produce the sample data of an image whose
+	  samples are only written when they are first read (or null if they
+	  are all present). */
+
+	jas_image_loadobj_t *loadobj_;
+	/* The object passed to the loader operations. */
+
 } jas_image_t;
 
 /* Component parameters class. */
@@ -314,6 +404,13 @@ typedef struct {
 jas_image_t *jas_image_create(int numcmpts,
   jas_image_cmptparm_t *cmptparms, jas_clrspc_t clrspc);
 
+/* Create an image whose sample data is obtained on demand from a source
+  instead of being stored in the image components.  Such an image can only
+  be encoded, and only by the JPEG-2000 code stream encoder. */
+jas_image_t *jas_image_createfromsrc(int numcmpts,
+  jas_image_cmptparm_t *cmptparms, jas_clrspc_t clrspc,
+  jas_image_srcops_t *srcops, jas_image_srcobj_t *srcobj);
+
 /* Create an "empty" image. */
 jas_image_t *jas_image_create0(void);
 
@@ -351,6 +448,10 @@ void jas_image_destroy(jas_image_t *image);
 #define jas_image_bry(image) \
 	((image)->bry_)
 
+/* Does the sample data for an image come from a source? */
+#define	jas_image_hassrc(image) \
+	((image)->srcops_ != 0)
+
 /* Get the number of image components. */
 #define	jas_image_numcmpts(image) \
 	((image)->numcmpts_)
@@ -412,6 +513,22 @@ void jas_image_destroy(jas_image_t *image);
 	((image)->cmpts_[cmptno]->tly_ + (image)->cmpts_[cmptno]->height_ * \
 	  (image)->cmpts_[cmptno]->vstep_)
 
+/* Get the type of the in-memory or paged sample data of a component (or
+  JAS_IMAGE_DATA_NONE if the component data is held in a stream). */
+#define	jas_image_cmptdatatype(image, cmptno) \
+	((image)->cmpts_[cmptno]->datatype_)
+
+/* Get a pointer to the first sample of a row of a component whose data is
+  held in memory or in pages (or a null pointer if it is not).  The samples
+  in the row are contiguous and of the type given by jas_image_cmptdatatype.
+  For a paged component, the pointer is only valid until the component is
+  next accessed. */
+void *jas_image_cmptrow(jas_image_t *image, int cmptno, jas_image_coord_t y);
+
+/* Set the amount of memory that the resident pages of each image created
+  afterwards may use.  This should be done before any images are created. */
+void jas_image_setpagebudget(size_t budget);
+
 /* Get the raw size of an image (i.e., the nominal size of the image without
   any compression. */
 uint_fast32_t jas_image_rawsize(jas_image_t *image);
@@ -463,6 +580,21 @@ void jas_image_writecmptsample(jas_image_t *image, int cmptno, int x, int y,
 
 int jas_image_getcmptbytype(jas_image_t *image, int ctype);
 
+/* Attach a loader to an image, which then owns the loader object.  The
+  current components of the image are the ones produced by the loader, and
+  their load numbers are their current component numbers. */
+void jas_image_setloader(jas_image_t *image, jas_image_loadops_t *loadops,
+  jas_image_loadobj_t *loadobj);
+
+/* Get the number of the component with the specified load number (or -1
+  if there is no such component). */
+int jas_image_getcmptbyloadno(jas_image_t *image, int loadno);
+
+/* Produce all of the samples of an image that has a loader, and release
+  the loader.  After this, the image no longer depends on the source of
+  the loader (e.g., an input stream). */
+int jas_image_load(jas_image_t *image);
+
 /******************************************************************************\
 * Image format-related operations.
 \******************************************************************************/
@@ -549,17 +681,85 @@ int bmp_encode(jas_image_t *image, jas_stream_t *out, char *optstr);
 int bmp_validate(jas_stream_t *in);
 #endif
 
+/* Image information that can be read from the headers of a file without
+  decoding any of the image data. */
+typedef struct {
+
+	jas_image_coord_t width;
+	jas_image_coord_t height;
+	/* The size of the image area on the reference grid. */
+
+	int numcmpts;
+	/* The number of components (after any palette mapping). */
+
+	int prec;
+	bool sgnd;
+	/* The precision and signedness of the first component. */
+
+	jas_clrspc_t clrspc;
+	/* The color space. */
+
+	jas_image_coord_t tilewidth;
+	jas_image_coord_t tileheight;
+	int numhtiles;
+	int numvtiles;
+	/* The tile grid. */
+
+	int numrlvls;
+	/* The number of resolution levels (from the default coding style). */
+
+	int numlyrs;
+	/* The number of quality layers. */
+
+	jas_image_resolution_t captureRes;
+	/* The capture resolution (zero if not specified). */
+
+} jas_image_info_t;
+
+/* A callback for reporting the progress of an encoder or decoder.  The
+  function is called with the fraction of the work that has been done
+  (from zero to one), and returns a nonzero value to abort the operation.
+  It may be called from a thread other than the one that started the
+  operation, but never from two threads at once. */
+typedef struct {
+	int (*func)(void *arg, double done);
+	void *arg;
+} jas_progress_t;
+
+#if !defined(EXCLUDE_JPC_SUPPORT)
+/* JPEG-2000 decoder context.  This holds state, such as scratch storage,
+  that can be reused when decoding many code streams.  A context must not
+  be used by more than one decoder at a time. */
+typedef struct jpc_dec_ctx_s jpc_dec_ctx_t;
+
+/* Create a decoder context. */
+jpc_dec_ctx_t *jpc_dec_ctx_create(void);
+
+/* Destroy a decoder context. */
+void jpc_dec_ctx_destroy(jpc_dec_ctx_t *ctx);
+#endif
+
 #if !defined(EXCLUDE_JP2_SUPPORT)
 /* Format-dependent operations for JP2 support. */
 jas_image_t *jp2_decode(jas_stream_t *in, char *optstr);
+jas_image_t *jp2_decode2(jas_stream_t *in, char *optstr, jpc_dec_ctx_t *ctx,
+  jas_progress_t *progress);
+int jp2_probe(jas_stream_t *in, jas_image_info_t *info);
 int jp2_encode(jas_image_t *image, jas_stream_t *out, char *optstr);
+int jp2_encode2(jas_image_t *image, jas_stream_t *out, char *optstr,
+  jas_progress_t *progress);
 int jp2_validate(jas_stream_t *in);
 #endif
 
 #if !defined(EXCLUDE_JPC_SUPPORT)
 /* Format-dependent operations for JPEG-2000 code stream support. */
 jas_image_t *jpc_decode(jas_stream_t *in, char *optstr);
+jas_image_t *jpc_decode2(jas_stream_t *in, char *optstr, jpc_dec_ctx_t *ctx,
+  jas_progress_t *progress);
+int jpc_probe(jas_stream_t *in, jas_image_info_t *info);
 int jpc_encode(jas_image_t *image, jas_stream_t *out, char *optstr);
+int jpc_encode2(jas_image_t *image, jas_stream_t *out, char *optstr,
+  jas_progress_t *progress);
 int jpc_validate(jas_stream_t *in);
 #endif
 
@@ -90,15 +90,24 @@ extern "C" {
 /* This matrix is a reference to another matrix. */
 #define JAS_MATRIX_REF	0x0001
 
+/* The alignment (in bytes) of the data of a matrix, and of the start of each
+  row of a matrix with more than one row.  Rows are padded to a multiple of
+  this size where that costs little memory, so that vector kernels find
+  most rows aligned.  Narrow matrices (e.g., a single column) are not
+  padded, so kernels must not rely on the alignment of a row. */
+#define	JAS_MATRIX_ALIGN	64
+
 /******************************************************************************\
 * Types.
 \******************************************************************************/
 
-/* An element in a sequence. */
-typedef int_fast32_t jas_seqent_t;
+/* An element in a sequence.  This is exactly 32 bits wide (rather than
+  int_fast32_t, which is 64 bits on some platforms), so that sample data
+  takes no more memory or bandwidth than it needs. */
+typedef int_least32_t jas_seqent_t;
 
 /* An element in a matrix. */
-typedef int_fast32_t jas_matent_t;
+typedef int_least32_t jas_matent_t;
 
 /* Matrix. */
 
@@ -125,16 +134,21 @@ typedef struct {
 	/* The number of columns in the matrix. */
 	int_fast32_t numcols_;
 
-	/* Pointers to the start of each row. */
-	jas_seqent_t **rows_;
-
-	/* The allocated size of the rows array. */
+	/* The number of rows that the data buffer was allocated for. */
 	int_fast32_t maxrows_;
 
-	/* The matrix data buffer. */
+	/* The first element of the matrix (or null if the matrix is empty).
+	  For a matrix that owns its data, this is aligned to JAS_MATRIX_ALIGN
+	  bytes within the allocated block. */
 	jas_seqent_t *data_;
 
-	/* The allocated size of the data array. */
+	/* The spacing between the starts of consecutive rows (in elements). */
+	int_fast32_t rowstep_;
+
+	/* The allocated block holding the data (or null for a reference). */
+	void *block_;
+
+	/* The number of elements in the data buffer. */
 	int_fast32_t datasize_;
 
 } jas_matrix_t;
@@ -156,25 +170,35 @@ typedef jas_matrix_t jas_seq_t;
 
 /* Get a matrix element. */
 #define jas_matrix_get(matrix, i, j) \
-	((matrix)->rows_[i][j])
+	((matrix)->data_[(i) * (matrix)->rowstep_ + (j)])
 
 /* Set a matrix element. */
 #define jas_matrix_set(matrix, i, j, v) \
-	((matrix)->rows_[i][j] = (v))
+	((matrix)->data_[(i) * (matrix)->rowstep_ + (j)] = (v))
 
 /* Get an element from a matrix that is known to be a row or column vector. */
 #define jas_matrix_getv(matrix, i) \
-	(((matrix)->numrows_ == 1) ? ((matrix)->rows_[0][i]) : \
-	  ((matrix)->rows_[i][0]))
+	(((matrix)->numrows_ == 1) ? ((matrix)->data_[i]) : \
+	  ((matrix)->data_[(i) * (matrix)->rowstep_]))
 
 /* Set an element in a matrix that is known to be a row or column vector. */
 #define jas_matrix_setv(matrix, i, v) \
-	(((matrix)->numrows_ == 1) ? ((matrix)->rows_[0][i] = (v)) : \
-	  ((matrix)->rows_[i][0] = (v)))
+	(((matrix)->numrows_ == 1) ? ((matrix)->data_[i] = (v)) : \
+	  ((matrix)->data_[(i) * (matrix)->rowstep_] = (v)))
 
 /* Get the address of an element in a matrix. */
 #define	jas_matrix_getref(matrix, i, j) \
-	(&(matrix)->rows_[i][j])
+	(&(matrix)->data_[(i) * (matrix)->rowstep_ + (j)])
+
+/* Get the first element of a matrix as a flat array, in which element
+  (i, j) is at index i * jas_matrix_stride(matrix) + j. */
+#define	jas_matrix_data(matrix) \
+	((matrix)->data_)
+
+/* The spacing between the starts of rows in the flat array (in elements).
+  Unlike jas_matrix_rowstep, this is meaningful for a single row too. */
+#define	jas_matrix_stride(matrix) \
+	((matrix)->rowstep_)
 
 #define	jas_matrix_getvref(matrix, i) \
 	(((matrix)->numrows_ > 1) ? jas_matrix_getref(matrix, i, 0) : jas_matrix_getref(matrix, 0, i))
@@ -223,7 +247,7 @@ void jas_matrix_setall(jas_matrix_t *matrix, jas_seqent_t val);
 
 /* The spacing between rows of a matrix. */
 #define	jas_matrix_rowstep(matrix) \
-	(((matrix)->numrows_ > 1) ? ((matrix)->rows_[1] - (matrix)->rows_[0]) : (0))
+	(((matrix)->numrows_ > 1) ? ((matrix)->rowstep_) : (0))
 
 /* The spacing between columns of a matrix. */
 #define	jas_matrix_step(matrix) \
@@ -284,11 +308,11 @@ void jas_seq2d_bindsub(jas_matrix_t *s, jas_matrix_t *s1, int xstart,
 	(jas_seq2d_destroy(seq))
 
 #define jas_seq_set(seq, i, v) \
-	((seq)->rows_[0][(i) - (seq)->xstart_] = (v))
+	((seq)->data_[(i) - (seq)->xstart_] = (v))
 #define	jas_seq_getref(seq, i) \
-	(&(seq)->rows_[0][(i) - (seq)->xstart_])
+	(&(seq)->data_[(i) - (seq)->xstart_])
 #define	jas_seq_get(seq, i) \
-	((seq)->rows_[0][(i) - (seq)->xstart_])
+	((seq)->data_[(i) - (seq)->xstart_])
 #define	jas_seq_start(seq) \
 	((seq)->xstart_)
 #define	jas_seq_end(seq) \
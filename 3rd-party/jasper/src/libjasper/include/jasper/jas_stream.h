@@ -135,6 +135,9 @@ extern "C" {
 #define JAS_STREAM_RDBUF	0x0010
 /* The buffer is currently being used for writing. */
 #define JAS_STREAM_WRBUF	0x0020
+/* The buffer is a read-only view of the entire stream data, which is
+  owned by the caller. */
+#define JAS_STREAM_VIEWBUF	0x0040
 
 /*
  * Stream error flags.
@@ -162,6 +165,9 @@ extern "C" {
 /* The maximum number of characters that can always be put back on a stream. */
 #define	JAS_STREAM_MAXPUTBACK	16
 
+/* The default chunk size for chunked memory streams. */
+#define	JAS_STREAM_CHUNKSIZE	65536
+
 /******************************************************************************\
 * Types.
 \******************************************************************************/
@@ -283,6 +289,46 @@ typedef struct {
 
 } jas_stream_memobj_t;
 
+/*
+ * Chunked memory file object.
+ */
+
+typedef struct {
+
+	/* The chunks holding the file data. */
+	uchar **chunks_;
+
+	/* The number of chunks allocated. */
+	int numchunks_;
+
+	/* The number of entries in the chunk table. */
+	int maxchunks_;
+
+	/* The size of each chunk. */
+	int chunksize_;
+
+	/* The length of the file. */
+	int_fast32_t len_;
+
+	/* The seek position. */
+	int_fast32_t pos_;
+
+} jas_stream_chunkobj_t;
+
+/*
+ * Memory-mapped file object.
+ */
+
+typedef struct {
+
+	/* The start of the mapped file data. */
+	uchar *base_;
+
+	/* The length of the file. */
+	int len_;
+
+} jas_stream_mmapobj_t;
+
 /******************************************************************************\
 * Macros/functions for opening and closing streams.
 \******************************************************************************/
@@ -296,6 +342,25 @@ jas_stream_t *jas_stream_fopen(const wchar_t *filename, const char *mode);
 /* Open a memory buffer as a stream. */
 jas_stream_t *jas_stream_memopen(unsigned char *buf, int bufsize);
 
+/* Open a growable memory stream whose data is held in a list of fixed-size
+  chunks rather than in a single buffer.  The stream never has to move its
+  data as it grows, and jas_stream_copy passes the chunks straight to the
+  output stream.  If chunksize is nonpositive, JAS_STREAM_CHUNKSIZE is used. */
+jas_stream_t *jas_stream_chunkopen(int chunksize);
+
+/* Open a read-only view of a memory buffer as a stream.  The data is read
+  in place (i.e., without being copied), so the buffer must remain valid
+  until the stream is closed. */
+jas_stream_t *jas_stream_memview(const unsigned char *buf, int bufsize);
+
+/* Open a file as a read-only view of its memory-mapped data.  The file
+  must not be larger than INT_MAX bytes. */
+jas_stream_t *jas_stream_mmapopen(const wchar_t *filename);
+
+/* Take ownership of the buffer of a stream opened with jas_stream_memopen.
+  The buffer must be freed with jas_free. */
+unsigned char *jas_stream_memrelease(jas_stream_t *stream, long *len);
+
 /* Open a file descriptor as a stream. */
 jas_stream_t *jas_stream_fdopen(int fd, const char *mode);
 
@@ -380,6 +445,17 @@ char *jas_stream_gets(jas_stream_t *stream, char *buf, int bufsize);
 /* Put a character back on a stream. */
 int jas_stream_ungetc(jas_stream_t *stream, int c);
 
+/* Is this stream a read-only view of memory (i.e., opened with
+  jas_stream_memview or jas_stream_mmapopen)? */
+#define	jas_stream_isview(stream) \
+	(((stream)->bufmode_ & JAS_STREAM_VIEWBUF) != 0)
+
+/* Get a pointer to the next cnt characters of a view and skip over them.
+  The characters remain valid until the view is closed.  If the stream is
+  not a view or fewer than cnt characters remain, a null pointer is
+  returned and the position is not changed. */
+const uchar *jas_stream_getview(jas_stream_t *stream, int cnt);
+
 /******************************************************************************\
 * Macros/functions for getting/setting the stream position.
 \******************************************************************************/
@@ -0,0 +1,125 @@
+/* __START_OF_JASPER_LICENSE__
+ * 
+ * JasPer License Version 2.0
+ * 
+ * Copyright (c) 2001-2006 Michael David Adams
+ * Copyright (c) 1999-2000 Image Power, Inc.
+ * Copyright (c) 1999-2000 The University of British Columbia
+ * 
+ * All rights reserved.
+ * 
+ * Permission is hereby granted, free of charge, to any person (the
+ * "User") obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge,
+ * publish, distribute, and/or sell copies of the Software, and to permit
+ * persons to whom the Software is furnished to do so, subject to the
+ * following conditions:
+ * 
+ * 1.  The above copyright notices and this permission notice (which
+ * includes the disclaimer below) shall be included in all copies or
+ * substantial portions of the Software.
+ * 
+ * 2.  The name of a copyright holder shall not be used to endorse or
+ * promote products derived from the Software without specific prior
+ * written permission.
+ * 
+ * THIS DISCLAIMER OF WARRANTY CONSTITUTES AN ESSENTIAL PART OF THIS
+ * LICENSE.  NO USE OF THE SOFTWARE IS AUTHORIZED HEREUNDER EXCEPT UNDER
+ * THIS DISCLAIMER.  THE SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS
+ * "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING
+ * BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A
+ * PARTICULAR PURPOSE AND NONINFRINGEMENT OF THIRD PARTY RIGHTS.  IN NO
+ * EVENT SHALL THE COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, OR ANY SPECIAL
+ * INDIRECT OR CONSEQUENTIAL DAMAGES, OR ANY DAMAGES WHATSOEVER RESULTING
+ * FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN ACTION OF CONTRACT,
+ * NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION
+ * WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.  NO ASSURANCES ARE
+ * PROVIDED BY THE COPYRIGHT HOLDERS THAT THE SOFTWARE DOES NOT INFRINGE
+ * THE PATENT OR OTHER INTELLECTUAL PROPERTY RIGHTS OF ANY OTHER ENTITY.
+ * EACH COPYRIGHT HOLDER DISCLAIMS ANY LIABILITY TO THE USER FOR CLAIMS
+ * BROUGHT BY ANY OTHER ENTITY BASED ON INFRINGEMENT OF INTELLECTUAL
+ * PROPERTY RIGHTS OR OTHERWISE.  AS A CONDITION TO EXERCISING THE RIGHTS
+ * GRANTED HEREUNDER, EACH USER HEREBY ASSUMES SOLE RESPONSIBILITY TO SECURE
+ * ANY OTHER INTELLECTUAL PROPERTY RIGHTS NEEDED, IF ANY.  THE SOFTWARE
+ * IS NOT FAULT-TOLERANT AND IS NOT INTENDED FOR USE IN MISSION-CRITICAL
+ * SYSTEMS, SUCH AS THOSE USED IN THE OPERATION OF NUCLEAR FACILITIES,
+ * AIRCRAFT NAVIGATION OR COMMUNICATION SYSTEMS, AIR TRAFFIC CONTROL
+ * SYSTEMS, DIRECT LIFE SUPPORT MACHINES, OR WEAPONS SYSTEMS, IN WHICH
+ * THE FAILURE OF THE SOFTWARE OR SYSTEM COULD LEAD DIRECTLY TO DEATH,
+ * PERSONAL INJURY, OR SEVERE PHYSICAL OR ENVIRONMENTAL DAMAGE ("HIGH
+ * RISK ACTIVITIES").  THE COPYRIGHT HOLDERS SPECIFICALLY DISCLAIM ANY
+ * EXPRESS OR IMPLIED WARRANTY OF FITNESS FOR HIGH RISK ACTIVITIES.
+ * 
+ * __END_OF_JASPER_LICENSE__
+ */
+
+/*
+ * Threads
+ *
+ * $Id$
+ */
+
+#ifndef JAS_THREAD_H
+#define JAS_THREAD_H
+
+/******************************************************************************\
+* Includes.
+\******************************************************************************/
+
+#include <jasper/jas_config.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************\
+* Types.
+\******************************************************************************/
+
+/* A function that performs the iterations start to end - 1 of a loop.  A
+  nonzero return value indicates failure. */
+typedef int (*jas_thread_loopfunc_t)(void *arg, int start, int end);
+
+/******************************************************************************\
+* Functions.
+\******************************************************************************/
+
+/* Perform the iterations 0 to n - 1 of a loop whose iterations are
+  independent, spread over the worker threads and the calling thread.  The
+  iterations are handed out in runs of at least grainsize, so a loop of at
+  most grainsize iterations is performed entirely by the calling thread.
+  This returns once all of the iterations are done, with zero if every call
+  of func succeeded.  Loops may be nested (i.e., func may itself call this
+  function). */
+int jas_thread_parfor(int n, int grainsize, jas_thread_loopfunc_t func,
+  void *arg);
+
+/* Set the number of threads (including the calling thread) that may work
+  on a loop.  Zero means one per processor, and one means that loops are
+  not spread over threads at all.  The number of worker threads is fixed
+  when they are started (by the first loop that can use them), so this
+  can only lower the number of threads used by later loops.  The worker
+  threads then run for the life of the process. */
+void jas_thread_setmaxthreads(int maxthreads);
+
+/* Call func, unless it has already been called by this function with the
+  same flag, so that data shared by all threads (e.g., lookup tables) is set
+  up exactly once.  The flag must initially be zero.  Any other caller with
+  the same flag waits until func has returned. */
+void jas_thread_once(int *done, void (*func)(void));
+
+/* Acquire and release the lock that serializes jas_init and jas_cleanup. */
+void jas_thread_lockinit(void);
+void jas_thread_unlockinit(void);
+
+/* Acquire and release the lock that serializes the calls made back to the
+  application (e.g., progress reports) from within a loop. */
+void jas_thread_lockcallback(void);
+void jas_thread_unlockcallback(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
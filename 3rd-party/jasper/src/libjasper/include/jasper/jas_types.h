@@ -178,6 +178,18 @@ typedef unsigned int uint_fast32_t;
 #define UINT_FAST32_MAX	UINT_MAX
 #endif
 /**********/
+#if !defined(INT_LEAST16_MIN)
+typedef short int_least16_t;
+#define INT_LEAST16_MIN	SHRT_MIN
+#define INT_LEAST16_MAX	SHRT_MAX
+#endif
+/**********/
+#if !defined(INT_LEAST32_MIN)
+typedef int int_least32_t;
+#define INT_LEAST32_MIN	INT_MIN
+#define INT_LEAST32_MAX	INT_MAX
+#endif
+/**********/
 #if !defined(INT_FAST64_MIN)
 typedef longlong int_fast64_t;
 #define INT_FAST64_MIN	LLONG_MIN
@@ -189,6 +201,11 @@ typedef ulonglong uint_fast64_t;
 #define UINT_FAST64_MAX	ULLONG_MAX
 #endif
 /**********/
+#if !defined(UINTPTR_MAX) && !defined(_UINTPTR_T_DEFINED)
+typedef size_t uintptr_t;
+#define UINTPTR_MAX	((size_t) -1)
+#endif
+/**********/
 #endif
 
 /* Hopefully, these macro definitions will fix more problems than they cause. */
@@ -79,6 +79,7 @@
 #include <jasper/jas_seq.h>
 #include <jasper/jas_stream.h>
 #include <jasper/jas_string.h>
+#include <jasper/jas_thread.h>
 #include <jasper/jas_tmr.h>
 #include <jasper/jas_tvp.h>
 
@@ -515,12 +515,28 @@ int jp2_box_put(jp2_box_t *box, jas_stream_t *out)
 	jas_stream_t *tmpstream;
 	bool extlen;
 	bool dataflag;
+	long pos;
 
 	tmpstream = 0;
 
 	dataflag = !(box->info->flags & (JP2_BOX_SUPER | JP2_BOX_NODATA));
 
+	if (dataflag && jas_stream_isseekable(out)) {
+		/* Output the box data directly, and fill in the length afterwards. */
+		if ((pos = jp2_box_puthdr(box, out)) < 0) {
+			goto error;
+		}
+		if (box->ops->putdata) {
+			if ((*box->ops->putdata)(box, out)) {
+				goto error;
+			}
+		}
+		return jp2_box_patchlen(box, out, pos);
+	}
+
 	if (dataflag) {
+		/* The output is not seekable, so the box data must be generated
+		  before the header. */
 		tmpstream = jas_stream_memopen(0, 0);
 		if (box->ops->putdata) {
 			if ((*box->ops->putdata)(box, tmpstream)) {
@@ -561,6 +577,46 @@ error:
 	return -1;
 }
 
+long jp2_box_puthdr(jp2_box_t *box, jas_stream_t *out)
+{
+	long pos;
+
+	if ((pos = jas_stream_tell(out)) < 0) {
+		return -1;
+	}
+	/* The length is zero until it has been patched. */
+	if (jp2_putuint32(out, 0) || jp2_putuint32(out, box->type)) {
+		return -1;
+	}
+	return pos;
+}
+
+int jp2_box_patchlen(jp2_box_t *box, jas_stream_t *out, long pos)
+{
+	long endpos;
+	long rwcnt;
+
+	if ((endpos = jas_stream_tell(out)) < 0) {
+		return -1;
+	}
+	box->len = endpos - pos;
+	if (box->len >= (((uint_fast64_t)1) << 32)) {
+		/* There is no room for an extended length, but a zero length is
+		  still valid for the last box in the file. */
+		return (box->type == JP2_BOX_JP2C) ? 0 : (-1);
+	}
+
+	/* Patching the length does not count as output. */
+	rwcnt = jas_stream_getrwcount(out);
+	if (jas_stream_seek(out, pos, SEEK_SET) < 0 ||
+	  jp2_putuint32(out, box->len) ||
+	  jas_stream_seek(out, endpos, SEEK_SET) < 0) {
+		return -1;
+	}
+	jas_stream_setrwcount(out, rwcnt);
+	return 0;
+}
+
 static int jp2_jp_putdata(jp2_box_t *box, jas_stream_t *out)
 {
 	jp2_jp_t *jp = &box->data.jp;
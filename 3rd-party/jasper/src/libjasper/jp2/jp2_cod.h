@@ -312,6 +312,12 @@ void jp2_box_destroy(jp2_box_t *box);
 jp2_box_t *jp2_box_get(jas_stream_t *in);
 int jp2_box_put(jp2_box_t *box, jas_stream_t *out);
 
+/* Output the header of a box whose length is not known yet, and get the
+  position of the box.  Once the box contents have been output, the length
+  is filled in with jp2_box_patchlen.  The stream must be seekable. */
+long jp2_box_puthdr(jp2_box_t *box, jas_stream_t *out);
+int jp2_box_patchlen(jp2_box_t *box, jas_stream_t *out, long pos);
+
 #define JP2_DTYPETOBPC(dtype) \
   ((JAS_IMAGE_CDT_GETSGND(dtype) << 7) | (JAS_IMAGE_CDT_GETPREC(dtype) - 1))
 #define	JP2_BPCTODTYPE(bpc) \
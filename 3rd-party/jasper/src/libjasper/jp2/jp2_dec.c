@@ -85,6 +85,7 @@
 
 static jp2_dec_t *jp2_dec_create(void);
 static void jp2_dec_destroy(jp2_dec_t *dec);
+static int jp2_dec_getboxes(jp2_dec_t *dec, jas_stream_t *in);
 static int jp2_getcs(jp2_colr_t *colr);
 static int fromiccpcs(int cs);
 static int jp2_getct(int colorspace, int type, int assoc);
@@ -95,8 +96,12 @@ static int jp2_getct(int colorspace, int type, int assoc);
 
 jas_image_t *jp2_decode(jas_stream_t *in, char *optstr)
 {
-	jp2_box_t *box;
-	int found;
+	return jp2_decode2(in, optstr, 0, 0);
+}
+
+jas_image_t *jp2_decode2(jas_stream_t *in, char *optstr, jpc_dec_ctx_t *ctx,
+  jas_progress_t *progress)
+{
 	jas_image_t *image;
 	jp2_dec_t *dec;
 	bool samedtype;
@@ -117,108 +122,18 @@ jas_image_t *jp2_decode(jas_stream_t *in, char *optstr)
 	jas_iccprof_t *iccprof;
 
 	dec = 0;
-	box = 0;
 	image = 0;
 
 	if (!(dec = jp2_dec_create())) {
 		goto error;
 	}
 
-	/* Get the first box.  This should be a JP box. */
-	if (!(box = jp2_box_get(in))) {
-		jas_eprintf("error: cannot get box\n");
-		goto error;
-	}
-	if (box->type != JP2_BOX_JP) {
-		jas_eprintf("error: expecting signature box\n");
-		goto error;
-	}
-	if (box->data.jp.magic != JP2_JP_MAGIC) {
-		jas_eprintf("incorrect magic number\n");
-		goto error;
-	}
-	jp2_box_destroy(box);
-	box = 0;
-
-	/* Get the second box.  This should be a FTYP box. */
-	if (!(box = jp2_box_get(in))) {
-		goto error;
-	}
-	if (box->type != JP2_BOX_FTYP) {
-		jas_eprintf("expecting file type box\n");
-		goto error;
-	}
-	jp2_box_destroy(box);
-	box = 0;
-
-	/* Get more boxes... */
-	found = 0;
-	while ((box = jp2_box_get(in))) {
-		if (jas_getdbglevel() >= 1) {
-			jas_eprintf("box type %s\n", box->info->name);
-		}
-		switch (box->type) {
-		case JP2_BOX_JP2C:
-			found = 1;
-			break;
-		case JP2_BOX_IHDR:
-			if (!dec->ihdr) {
-				dec->ihdr = box;
-				box = 0;
-			}
-			break;
-		case JP2_BOX_BPCC:
-			if (!dec->bpcc) {
-				dec->bpcc = box;
-				box = 0;
-			}
-			break;
-		case JP2_BOX_CDEF:
-			if (!dec->cdef) {
-				dec->cdef = box;
-				box = 0;
-			}
-			break;
-		case JP2_BOX_PCLR:
-			if (!dec->pclr) {
-				dec->pclr = box;
-				box = 0;
-			}
-			break;
-		case JP2_BOX_CMAP:
-			if (!dec->cmap) {
-				dec->cmap = box;
-				box = 0;
-			}
-			break;
-		case JP2_BOX_COLR:
-			if (!dec->colr) {
-				dec->colr = box;
-				box = 0;
-			}
-			break;
-		case JP2_BOX_RESC:
-			if (!dec->resc) {
-				dec->resc = box;
-				box = 0;
-			}
-			break;
-		}
-		if (box) {
-			jp2_box_destroy(box);
-			box = 0;
-		}
-		if (found) {
-			break;
-		}
-	}
-
-	if (!found) {
-		jas_eprintf("error: no code stream found\n");
+	/* Get the boxes that precede the code stream. */
+	if (jp2_dec_getboxes(dec, in)) {
 		goto error;
 	}
 
-	if (!(dec->image = jpc_decode(in, optstr))) {
+	if (!(dec->image = jpc_decode2(in, optstr, ctx, progress))) {
 		jas_eprintf("error: cannot decode code stream\n");
 		goto error;
 	}
@@ -450,13 +365,195 @@ jas_eprintf("no of components is %d\n", jas_image_numcmpts(dec->image));
 	return image;
 
 error:
-	if (box) {
-		jp2_box_destroy(box);
+	if (dec) {
+		jp2_dec_destroy(dec);
+	}
+	return 0;
+}
+
+int jp2_probe(jas_stream_t *in, jas_image_info_t *info)
+{
+	jp2_dec_t *dec;
+	jp2_cmapent_t *cmapent;
+	jas_icchdr_t icchdr;
+	jas_iccprof_t *iccprof;
+	int dtype;
+
+	if (!(dec = jp2_dec_create())) {
+		goto error;
+	}
+
+	/* Get the boxes that precede the code stream. */
+	if (jp2_dec_getboxes(dec, in)) {
+		goto error;
+	}
+
+	/* Only the main header of the code stream is read. */
+	if (jpc_probe(in, info)) {
+		goto error;
+	}
+
+	/* IHDR and COLR boxes must be present. */
+	if (!dec->ihdr || !dec->colr) {
+		goto error;
+	}
+
+	switch (dec->colr->data.colr.method) {
+	case JP2_COLR_ENUM:
+		info->clrspc = jp2_getcs(&dec->colr->data.colr);
+		break;
+	case JP2_COLR_ICC:
+		if (!(iccprof = jas_iccprof_createfrombuf(dec->colr->data.colr.iccp,
+		  dec->colr->data.colr.iccplen))) {
+			goto error;
+		}
+		jas_iccprof_gethdr(iccprof, &icchdr);
+		info->clrspc = fromiccpcs(icchdr.colorspc);
+		jas_iccprof_destroy(iccprof);
+		break;
+	}
+
+	/* The number of channels is given by the CMAP box if a palette is
+	  used. */
+	if (dec->cmap && dec->pclr && dec->cmap->data.cmap.numchans > 0) {
+		info->numcmpts = dec->cmap->data.cmap.numchans;
+		cmapent = &dec->cmap->data.cmap.ents[0];
+		if (cmapent->map == JP2_CMAP_PALETTE &&
+		  cmapent->pcol < dec->pclr->data.pclr.numchans) {
+			dtype = JP2_BPCTODTYPE(dec->pclr->data.pclr.bpc[cmapent->pcol]);
+			info->prec = JAS_IMAGE_CDT_GETPREC(dtype);
+			info->sgnd = JAS_IMAGE_CDT_GETSGND(dtype) != 0;
+		}
+	}
+
+	if (dec->resc) {
+		info->captureRes.hNumerator = dec->resc->data.resc.HRcN;
+		info->captureRes.hDenomerator = dec->resc->data.resc.HRcD;
+		info->captureRes.hExponent = dec->resc->data.resc.HRcE;
+		info->captureRes.vNumerator = dec->resc->data.resc.VRcN;
+		info->captureRes.vDenomerator = dec->resc->data.resc.VRcD;
+		info->captureRes.vExponent = dec->resc->data.resc.VRcE;
 	}
+
+	jp2_dec_destroy(dec);
+
+	return 0;
+
+error:
 	if (dec) {
 		jp2_dec_destroy(dec);
 	}
+	return -1;
+}
+
+static int jp2_dec_getboxes(jp2_dec_t *dec, jas_stream_t *in)
+{
+	jp2_box_t *box;
+	int found;
+
+	box = 0;
+
+	/* Get the first box.  This should be a JP box. */
+	if (!(box = jp2_box_get(in))) {
+		jas_eprintf("error: cannot get box\n");
+		goto error;
+	}
+	if (box->type != JP2_BOX_JP) {
+		jas_eprintf("error: expecting signature box\n");
+		goto error;
+	}
+	if (box->data.jp.magic != JP2_JP_MAGIC) {
+		jas_eprintf("incorrect magic number\n");
+		goto error;
+	}
+	jp2_box_destroy(box);
+	box = 0;
+
+	/* Get the second box.  This should be a FTYP box. */
+	if (!(box = jp2_box_get(in))) {
+		goto error;
+	}
+	if (box->type != JP2_BOX_FTYP) {
+		jas_eprintf("expecting file type box\n");
+		goto error;
+	}
+	jp2_box_destroy(box);
+	box = 0;
+
+	/* Get more boxes... */
+	found = 0;
+	while ((box = jp2_box_get(in))) {
+		if (jas_getdbglevel() >= 1) {
+			jas_eprintf("box type %s\n", box->info->name);
+		}
+		switch (box->type) {
+		case JP2_BOX_JP2C:
+			found = 1;
+			break;
+		case JP2_BOX_IHDR:
+			if (!dec->ihdr) {
+				dec->ihdr = box;
+				box = 0;
+			}
+			break;
+		case JP2_BOX_BPCC:
+			if (!dec->bpcc) {
+				dec->bpcc = box;
+				box = 0;
+			}
+			break;
+		case JP2_BOX_CDEF:
+			if (!dec->cdef) {
+				dec->cdef = box;
+				box = 0;
+			}
+			break;
+		case JP2_BOX_PCLR:
+			if (!dec->pclr) {
+				dec->pclr = box;
+				box = 0;
+			}
+			break;
+		case JP2_BOX_CMAP:
+			if (!dec->cmap) {
+				dec->cmap = box;
+				box = 0;
+			}
+			break;
+		case JP2_BOX_COLR:
+			if (!dec->colr) {
+				dec->colr = box;
+				box = 0;
+			}
+			break;
+		case JP2_BOX_RESC:
+			if (!dec->resc) {
+				dec->resc = box;
+				box = 0;
+			}
+			break;
+		}
+		if (box) {
+			jp2_box_destroy(box);
+			box = 0;
+		}
+		if (found) {
+			break;
+		}
+	}
+
+	if (!found) {
+		jas_eprintf("error: no code stream found\n");
+		goto error;
+	}
+
 	return 0;
+
+error:
+	if (box) {
+		jp2_box_destroy(box);
+	}
+	return -1;
 }
 
 int jp2_validate(jas_stream_t *in)
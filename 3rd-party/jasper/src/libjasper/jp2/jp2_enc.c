@@ -87,11 +87,21 @@ static int clrspctojp2(jas_clrspc_t clrspc);
 \******************************************************************************/
 
 int jp2_encode(jas_image_t *image, jas_stream_t *out, char *optstr)
+{
+	return jp2_encode2(image, out, optstr, 0);
+}
+
+int jp2_encode2(jas_image_t *image, jas_stream_t *out, char *optstr,
+  jas_progress_t *progress)
 {
 	jp2_box_t *box;
+	jp2_box_t *hdrbox;
 	jp2_ftyp_t *ftyp;
 	jp2_ihdr_t *ihdr;
 	jas_stream_t *tmpstream;
+	jas_stream_t *hdrstream;
+	int seekable;
+	long boxpos;
 	int allcmptssame;
 	jp2_bpcc_t *bpcc;
 	long len;
@@ -112,7 +122,9 @@ int sgnd;
 jp2_resc_t *resc; 
 
 	box = 0;
+	hdrbox = 0;
 	tmpstream = 0;
+	boxpos = -1;
 
 	allcmptssame = 1;
 	sgnd = jas_image_cmptsgnd(image, 0);
@@ -154,15 +166,29 @@ jp2_resc_t *resc;
 	box = 0;
 
 	/*
-	 * Generate the data portion of the JP2 header box.
-	 * We cannot simply output the header for this box
-	 * since we do not yet know the correct value for the length
-	 * field.
+	 * Output the JP2 header box and all of the boxes which it contains.
+	 * The correct value for the length field of the JP2 header box is not
+	 * known until its contents have been generated.  If the output is
+	 * seekable, the contents are output directly and the length is
+	 * filled in afterwards.  Otherwise, the contents are generated in a
+	 * temporary stream first.
 	 */
 
-	if (!(tmpstream = jas_stream_memopen(0, 0))) {
+	if (!(hdrbox = jp2_box_create(JP2_BOX_JP2H))) {
 		goto error;
 	}
+	seekable = jas_stream_isseekable(out);
+	if (seekable) {
+		if ((boxpos = jp2_box_puthdr(hdrbox, out)) < 0) {
+			goto error;
+		}
+		hdrstream = out;
+	} else {
+		if (!(tmpstream = jas_stream_chunkopen(0))) {
+			goto error;
+		}
+		hdrstream = tmpstream;
+	}
 
 	/* Generate image header box. */
 
@@ -178,7 +204,7 @@ jp2_resc_t *resc;
 	ihdr->comptype = JP2_IHDR_COMPTYPE;
 	ihdr->csunk = 0;
 	ihdr->ipr = 0;
-	if (jp2_box_put(box, tmpstream)) {
+	if (jp2_box_put(box, hdrstream)) {
 		goto error;
 	}
 	jp2_box_destroy(box);
@@ -200,7 +226,7 @@ jp2_resc_t *resc;
 			bpcc->bpcs[cmptno] = JP2_SPTOBPC(jas_image_cmptsgnd(image,
 			  cmptno), jas_image_cmptprec(image, cmptno));
 		}
-		if (jp2_box_put(box, tmpstream)) {
+		if (jp2_box_put(box, hdrstream)) {
 			goto error;
 		}
 		jp2_box_destroy(box);
@@ -244,7 +270,7 @@ jp2_resc_t *resc;
 		jas_iccprof_destroy(iccprof);
 		break;
 	}
-	if (jp2_box_put(box, tmpstream)) {
+	if (jp2_box_put(box, hdrstream)) {
 		goto error;
 	}
 	jp2_box_destroy(box);
@@ -298,7 +324,7 @@ jp2_resc_t *resc;
 			cdefchanent->type = typeasoc >> 16;
 			cdefchanent->assoc = typeasoc & 0x7fff;
 		}
-		if (jp2_box_put(box, tmpstream)) {
+		if (jp2_box_put(box, hdrstream)) {
 			goto error;
 		}
 		jp2_box_destroy(box);
@@ -313,7 +339,7 @@ jp2_resc_t *resc;
 
 		box->len = JP2_BOX_HDRLEN(true) + sizeof(jp2_resc_t);
 
-		if (jp2_box_put(box, tmpstream)) {
+		if (jp2_box_put(box, hdrstream)) {
 			goto error;
 		}
 		jp2_box_destroy(box);
@@ -333,52 +359,51 @@ jp2_resc_t *resc;
 		resc->HRcD = image->captureRes.hDenomerator;
 		resc->HRcE = image->captureRes.hExponent;
 
-		if (jp2_box_put(box, tmpstream)) {
+		if (jp2_box_put(box, hdrstream)) {
 			goto error;
 		}
 		jp2_box_destroy(box);
 		box = 0;
 	}
 
-	/* Determine the total length of the JP2 header box. */
-
-	len = jas_stream_tell(tmpstream);
-	jas_stream_rewind(tmpstream);
-
-	/*
-	 * Output the JP2 header box and all of the boxes which it contains.
-	 */
-
-	if (!(box = jp2_box_create(JP2_BOX_JP2H))) {
-		goto error;
-	}
-	box->len = len + JP2_BOX_HDRLEN(false);
-	if (jp2_box_put(box, out)) {
-		goto error;
-	}
-	jp2_box_destroy(box);
-	box = 0;
-
-	if (jas_stream_copy(out, tmpstream, len)) {
-		goto error;
+	if (!seekable) {
+		/* Output the JP2 header box followed by the generated contents. */
+		len = jas_stream_tell(tmpstream);
+		jas_stream_rewind(tmpstream);
+		hdrbox->len = len + JP2_BOX_HDRLEN(false);
+		if (jp2_box_put(hdrbox, out)) {
+			goto error;
+		}
+		if (jas_stream_copy(out, tmpstream, len)) {
+			goto error;
+		}
+		jas_stream_close(tmpstream);
+		tmpstream = 0;
+	} else {
+		if (boxpos < 0 || jp2_box_patchlen(hdrbox, out, boxpos)) {
+			goto error;
+		}
 	}
-
-	jas_stream_close(tmpstream);
-	tmpstream = 0;
+	jp2_box_destroy(hdrbox);
+	hdrbox = 0;
 
 	/*
-	 * Output the contiguous code stream box.
+	 * Output the contiguous code stream box.  If the output is not
+	 * seekable, the length is left as zero (i.e., the box extends to the
+	 * end of the file).
 	 */
 
 	if (!(box = jp2_box_create(JP2_BOX_JP2C))) {
 		goto error;
 	}
 	box->len = 0;
-	if (jp2_box_put(box, out)) {
+	if (seekable) {
+		if ((boxpos = jp2_box_puthdr(box, out)) < 0) {
+			goto error;
+		}
+	} else if (jp2_box_put(box, out)) {
 		goto error;
 	}
-	jp2_box_destroy(box);
-	box = 0;
 
 	/* Output the JPEG-2000 code stream. */
 
@@ -386,10 +411,18 @@ jp2_resc_t *resc;
 	sprintf(buf, "%s\n_jp2overhead=%lu\n", (optstr ? optstr : ""),
 	  (unsigned long) overhead);
 
-	if (jpc_encode(image, out, buf)) {
+	if (jpc_encode2(image, out, buf, progress)) {
 		goto error;
 	}
 
+	if (seekable) {
+		if (boxpos < 0 || jp2_box_patchlen(box, out, boxpos)) {
+			goto error;
+		}
+	}
+	jp2_box_destroy(box);
+	box = 0;
+
 	return 0;
 	abort();
 
@@ -398,6 +431,9 @@ error:
 	if (box) {
 		jp2_box_destroy(box);
 	}
+	if (hdrbox) {
+		jp2_box_destroy(hdrbox);
+	}
 	if (tmpstream) {
 		jas_stream_close(tmpstream);
 	}
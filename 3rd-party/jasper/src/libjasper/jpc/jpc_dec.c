@@ -72,12 +72,15 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <string.h>
+#include <math.h>
 
 #include "jasper/jas_types.h"
 #include "jasper/jas_math.h"
 #include "jasper/jas_tvp.h"
 #include "jasper/jas_malloc.h"
 #include "jasper/jas_debug.h"
+#include "jasper/jas_thread.h"
 
 #include "jpc_fix.h"
 #include "jpc_dec.h"
@@ -118,6 +121,47 @@ typedef struct {
 
 } jpc_dec_mstabent_t;
 
+typedef struct {
+
+	jpc_dec_t *dec;
+	/* The decoder. */
+
+	jpc_dec_tile_t *tile;
+	/* The tile whose components are synthesized. */
+
+	int_least16_t **bufs;
+	/* The 16-bit samples of the components (if any). */
+
+	int cancelled;
+	/* Has the application cancelled the decoding? */
+
+} jpc_dec_cmptloop_t;
+
+typedef struct {
+
+	jpc_dec_t *dec;
+	/* The decoder. */
+
+	jpc_dec_tile_t *tile;
+	/* The tile being decoded a row at a time. */
+
+	jpc_dec_tcomp_t *tcomp;
+	/* The tile-component. */
+
+	jpc_tsfb_lines_t *lines;
+	/* The state of the synthesis of the tile-component (if any). */
+
+	jas_matrix_t *data;
+	/* The current row of the tile-component. */
+
+	jas_matrix_t *win;
+	/* A window into the band data. */
+
+	int cmptno;
+	/* The image component to which the rows are written. */
+
+} jpc_dec_cmptlines_t;
+
 /******************************************************************************\
 *
 \******************************************************************************/
@@ -131,6 +175,10 @@ typedef struct {
 /* QCD/QCC parameters set from a QCC marker segment. */
 #define	JPC_QCC	0x0008
 
+/* The size (in bytes) of the coefficients of a tile above which the tile
+  is decoded a row at a time. */
+#define	JPC_DEC_LINETHRESH	(64 * 1024 * 1024)
+
 /******************************************************************************\
 * Local function prototypes.
 \******************************************************************************/
@@ -173,17 +221,35 @@ static int jpc_dec_cp_setfrompoc(jpc_dec_cp_t *cp, jpc_poc_t *poc, int reset);
 static int jpc_pi_addpchgfrompoc(jpc_pi_t *pi, jpc_poc_t *poc);
 
 static int jpc_dec_decode(jpc_dec_t *dec);
-static jpc_dec_t *jpc_dec_create(jpc_dec_importopts_t *impopts, jas_stream_t *in);
+static jpc_dec_t *jpc_dec_create(jpc_dec_importopts_t *impopts, jas_stream_t *in,
+  jpc_dec_ctx_t *ctx, jas_progress_t *progress);
 static void jpc_dec_destroy(jpc_dec_t *dec);
 static void jpc_dequantize(jas_matrix_t *x, jpc_fix_t absstepsize);
+static void jpc_dequantize_flt(jas_matrix_t *x, float absstepsize);
 static void jpc_undo_roi(jas_matrix_t *x, int roishift, int bgshift, int numbps);
 static jpc_fix_t jpc_calcabsstepsize(int stepsize, int numbits);
+static float jpc_calcabsstepsizeflt(int stepsize, int numbits);
 static int jpc_dec_tiledecode(jpc_dec_t *dec, jpc_dec_tile_t *tile);
+static int jpc_dec_tiledecode16(jpc_dec_t *dec, jpc_dec_tile_t *tile);
+static int jpc_dec_tiledecodelines(jpc_dec_t *dec, jpc_dec_tile_t *tile);
+static int jpc_dec_getbandrow(void *arg, int bandno, int y, jpc_fix_t *buf);
+static void jpc_dec_convertcmpt(jpc_dec_tile_t *tile, jpc_dec_cmpt_t *cmpt,
+  jas_matrix_t *data);
+static int jpc_dec_synthesizecmpts(void *arg, int start, int end);
+static int jpc_dec_synthesizecmpts16(void *arg, int start, int end);
+static int jpc_dec_tilewrite(jpc_dec_t *dec, jpc_dec_tile_t *tile);
 static int jpc_dec_tileinit(jpc_dec_t *dec, jpc_dec_tile_t *tile);
 static int jpc_dec_tilefini(jpc_dec_t *dec, jpc_dec_tile_t *tile);
 static int jpc_dec_process_soc(jpc_dec_t *dec, jpc_ms_t *ms);
 static int jpc_dec_process_sot(jpc_dec_t *dec, jpc_ms_t *ms);
 static int jpc_dec_process_sod(jpc_dec_t *dec, jpc_ms_t *ms);
+static int jpc_dec_skiptilepart(jpc_dec_t *dec, jpc_dec_tile_t *tile);
+static int jpc_dec_indextileparts(jpc_dec_t *dec, jpc_ms_t *ms);
+static int jpc_dec_loadtile(jpc_dec_t *dec, jpc_dec_tile_t *tile);
+static int jpc_dec_load(jas_image_loadobj_t *obj, int loadno,
+  jas_image_coord_t x, jas_image_coord_t y, jas_image_coord_t width,
+  jas_image_coord_t height);
+static void jpc_dec_unload(jas_image_loadobj_t *obj);
 static int jpc_dec_process_eoc(jpc_dec_t *dec, jpc_ms_t *ms);
 static int jpc_dec_process_siz(jpc_dec_t *dec, jpc_ms_t *ms);
 static int jpc_dec_process_cod(jpc_dec_t *dec, jpc_ms_t *ms);
@@ -228,11 +294,23 @@ jpc_dec_mstabent_t jpc_dec_mstab[] = {
 	{0, JPC_MH | JPC_TPH, jpc_dec_process_unk}
 };
 
+/* The operations for decoding the tiles of an image on demand. */
+static jas_image_loadops_t jpc_dec_loadops = {
+	jpc_dec_load,
+	jpc_dec_unload
+};
+
 /******************************************************************************\
 * The main entry point for the JPEG-2000 decoder.
 \******************************************************************************/
 
 jas_image_t *jpc_decode(jas_stream_t *in, char *optstr)
+{
+	return jpc_decode2(in, optstr, 0, 0);
+}
+
+jas_image_t *jpc_decode2(jas_stream_t *in, char *optstr, jpc_dec_ctx_t *ctx,
+  jas_progress_t *progress)
 {
 	jpc_dec_importopts_t opts;
 	jpc_dec_t *dec;
@@ -246,7 +324,7 @@ jas_image_t *jpc_decode(jas_stream_t *in, char *optstr)
 
 	jpc_initluts();
 
-	if (!(dec = jpc_dec_create(&opts, in))) {
+	if (!(dec = jpc_dec_create(&opts, in, ctx, progress))) {
 		goto error;
 	}
 
@@ -272,6 +350,16 @@ jas_image_t *jpc_decode(jas_stream_t *in, char *optstr)
 	/* Save the return value. */
 	image = dec->image;
 
+	if (dec->lazy) {
+		/* The decoder lives on with the image, and decodes each tile
+		  when its samples are first needed.  The context and progress
+		  callback belong to the caller, and are only good for this call. */
+		dec->ctx = 0;
+		dec->progress = 0;
+		jas_image_setloader(image, &jpc_dec_loadops, dec);
+		return image;
+	}
+
 	/* Stop the image from being discarded. */
 	dec->image = 0;
 
@@ -290,12 +378,22 @@ error:
 typedef enum {
 	OPT_MAXLYRS,
 	OPT_MAXPKTS,
+	OPT_REDUCE,
+	OPT_REGION,
+	OPT_LAZY,
+	OPT_FLOAT,
+	OPT_LOWMEM,
 	OPT_DEBUG
 } optid_t;
 
 jas_taginfo_t decopts[] = {
 	{OPT_MAXLYRS, "maxlyrs"},
 	{OPT_MAXPKTS, "maxpkts"},
+	{OPT_REDUCE, "reduce"},
+	{OPT_REGION, "region"},
+	{OPT_LAZY, "lazy"},
+	{OPT_FLOAT, "float"},
+	{OPT_LOWMEM, "lowmem"},
 	{OPT_DEBUG, "debug"},
 	{-1, 0}
 };
@@ -303,10 +401,19 @@ jas_taginfo_t decopts[] = {
 static int jpc_dec_parseopts(char *optstr, jpc_dec_importopts_t *opts)
 {
 	jas_tvparser_t *tvp;
+	unsigned long win[4];
 
 	opts->debug = 0;
 	opts->maxlyrs = JPC_MAXLYRS;
 	opts->maxpkts = -1;
+	opts->reduce = 0;
+	opts->winxstart = 0;
+	opts->winystart = 0;
+	opts->winxend = ~JAS_CAST(uint_fast32_t, 0);
+	opts->winyend = ~JAS_CAST(uint_fast32_t, 0);
+	opts->lazy = 0;
+	opts->fltmode = 0;
+	opts->lowmem = 0;
 
 	if (!(tvp = jas_tvparser_create(optstr ? optstr : ""))) {
 		return -1;
@@ -324,6 +431,37 @@ static int jpc_dec_parseopts(char *optstr, jpc_dec_importopts_t *opts)
 		case OPT_MAXPKTS:
 			opts->maxpkts = atoi(jas_tvparser_getval(tvp));
 			break;
+		case OPT_REDUCE:
+			if ((opts->reduce = atoi(jas_tvparser_getval(tvp))) < 0) {
+				jas_eprintf("invalid number of resolution levels to discard\n");
+				jas_tvparser_destroy(tvp);
+				return -1;
+			}
+			break;
+		case OPT_REGION:
+			/* The window is given as xstart,ystart,xend,yend on the
+			  reference grid. */
+			if (sscanf(jas_tvparser_getval(tvp), "%lu,%lu,%lu,%lu", &win[0],
+			  &win[1], &win[2], &win[3]) != 4 || win[0] >= win[2] ||
+			  win[1] >= win[3]) {
+				jas_eprintf("invalid region\n");
+				jas_tvparser_destroy(tvp);
+				return -1;
+			}
+			opts->winxstart = win[0];
+			opts->winystart = win[1];
+			opts->winxend = win[2];
+			opts->winyend = win[3];
+			break;
+		case OPT_LAZY:
+			opts->lazy = 1;
+			break;
+		case OPT_FLOAT:
+			opts->fltmode = 1;
+			break;
+		case OPT_LOWMEM:
+			opts->lowmem = 1;
+			break;
 		default:
 			jas_eprintf("warning: ignoring invalid option %s\n",
 			  jas_tvparser_gettag(tvp));
@@ -336,6 +474,114 @@ static int jpc_dec_parseopts(char *optstr, jpc_dec_importopts_t *opts)
 	return 0;
 }
 
+/******************************************************************************\
+* Code for probing the main header of a code stream.
+\******************************************************************************/
+
+/* Get the image information from the main header of a code stream.  The
+  marker segments are read up to (and including) the first SOT marker
+  segment, so no tile data is ever read or allocated. */
+
+int jpc_probe(jas_stream_t *in, jas_image_info_t *info)
+{
+	jpc_cstate_t *cstate;
+	jpc_ms_t *ms;
+	jpc_siz_t *siz;
+	jpc_cod_t *cod;
+	int state;
+	int done;
+
+	ms = 0;
+
+	if (!(cstate = jpc_cstate_create())) {
+		return -1;
+	}
+
+	/* Initially, we should expect to encounter a SOC marker segment. */
+	state = JPC_MHSOC;
+	done = 0;
+	info->numrlvls = 0;
+	info->numlyrs = 0;
+	memset(&info->captureRes, 0, sizeof(jas_image_resolution_t));
+
+	while (!done) {
+		if (!(ms = jpc_getms(in, cstate))) {
+			jas_eprintf("cannot get marker segment\n");
+			goto error;
+		}
+
+		switch (state) {
+		case JPC_MHSOC:
+			if (ms->id != JPC_MS_SOC) {
+				goto error;
+			}
+			state = JPC_MHSIZ;
+			break;
+		case JPC_MHSIZ:
+			if (ms->id != JPC_MS_SIZ) {
+				goto error;
+			}
+			siz = &ms->parms.siz;
+			if (!siz->numcomps || !siz->tilewidth || !siz->tileheight) {
+				goto error;
+			}
+			info->width = siz->width - siz->xoff;
+			info->height = siz->height - siz->yoff;
+			info->numcmpts = siz->numcomps;
+			info->prec = siz->comps[0].prec;
+			info->sgnd = siz->comps[0].sgnd != 0;
+			info->clrspc = (siz->numcomps >= 3) ? JAS_CLRSPC_SRGB :
+			  JAS_CLRSPC_SGRAY;
+			info->tilewidth = siz->tilewidth;
+			info->tileheight = siz->tileheight;
+			info->numhtiles = JPC_CEILDIV(siz->width - siz->tilexoff,
+			  siz->tilewidth);
+			info->numvtiles = JPC_CEILDIV(siz->height - siz->tileyoff,
+			  siz->tileheight);
+			state = JPC_MH;
+			break;
+		default:
+			switch (ms->id) {
+			case JPC_MS_COD:
+				cod = &ms->parms.cod;
+				info->numrlvls = cod->compparms.numdlvls + 1;
+				info->numlyrs = cod->numlyrs;
+				break;
+			case JPC_MS_SOT:
+			case JPC_MS_EOC:
+				/* The main header is complete. */
+				done = 1;
+				break;
+			case JPC_MS_SOC:
+			case JPC_MS_SIZ:
+			case JPC_MS_SOD:
+				jas_eprintf("unexpected marker segment type\n");
+				goto error;
+			}
+			break;
+		}
+
+		jpc_ms_destroy(ms);
+		ms = 0;
+	}
+
+	/* A COD marker segment must be present in the main header. */
+	if (!info->numrlvls) {
+		goto error;
+	}
+
+	jpc_cstate_destroy(cstate);
+
+	return 0;
+
+error:
+	if (ms) {
+		jpc_ms_destroy(ms);
+	}
+	jpc_cstate_destroy(cstate);
+	return -1;
+}
+
 /******************************************************************************\
 * Code for table-driven code stream decoder.
 \******************************************************************************/
@@ -358,13 +604,17 @@ static int jpc_dec_decode(jpc_dec_t *dec)
 	int ret;
 	jpc_cstate_t *cstate;
 
-	if (!(cstate = jpc_cstate_create())) {
-		return -1;
-	}
-	dec->cstate = cstate;
+	/* When tiles are decoded on demand, this is called again for each
+	  tile-part, with the state for the SOT marker segment. */
+	if (!(cstate = dec->cstate)) {
+		if (!(cstate = jpc_cstate_create())) {
+			return -1;
+		}
+		dec->cstate = cstate;
 
-	/* Initially, we should expect to encounter a SOC marker segment. */
-	dec->state = JPC_MHSOC;
+		/* Initially, we should expect to encounter a SOC marker segment. */
+		dec->state = JPC_MHSOC;
+	}
 
 	for (;;) {
 
@@ -449,6 +699,39 @@ static int jpc_dec_process_sot(jpc_dec_t *dec, jpc_ms_t *ms)
 
 	if (dec->state == JPC_MH) {
 
+		/* Only the part of the decode window inside the image area is
+		  decoded. */
+		dec->winxstart = JAS_MAX(dec->winxstart, dec->xstart);
+		dec->winystart = JAS_MAX(dec->winystart, dec->ystart);
+		dec->winxend = JAS_MIN(dec->winxend, dec->xend);
+		dec->winyend = JAS_MIN(dec->winyend, dec->yend);
+		if (dec->winxstart >= dec->winxend || dec->winystart >= dec->winyend) {
+			jas_eprintf("the decode region is outside of the image area\n");
+			return -1;
+		}
+		dec->numwintiles = (JPC_CEILDIV(dec->winxend - dec->tilexoff,
+		  dec->tilewidth) - (dec->winxstart - dec->tilexoff) /
+		  dec->tilewidth) * (JPC_CEILDIV(dec->winyend - dec->tileyoff,
+		  dec->tileheight) - (dec->winystart - dec->tileyoff) /
+		  dec->tileheight);
+
+		/* We cannot discard more resolution levels than any component
+		  has (in the main header), nor so many that the image vanishes. */
+		for (cmptno = 0, cmpt = dec->cmpts; cmptno < dec->numcomps;
+		  ++cmptno, ++cmpt) {
+			if (dec->reduce > dec->cp->ccps[cmptno].numrlvls - 1) {
+				dec->reduce = dec->cp->ccps[cmptno].numrlvls - 1;
+			}
+			while (dec->reduce > 0 && (JPC_CEILDIVPOW2(JPC_CEILDIV(
+			  dec->winxend, cmpt->hstep), dec->reduce) == JPC_CEILDIVPOW2(
+			  JPC_CEILDIV(dec->winxstart, cmpt->hstep), dec->reduce) ||
+			  JPC_CEILDIVPOW2(JPC_CEILDIV(dec->winyend, cmpt->vstep),
+			  dec->reduce) == JPC_CEILDIVPOW2(JPC_CEILDIV(dec->winystart,
+			  cmpt->vstep), dec->reduce))) {
+				--dec->reduce;
+			}
+		}
+
 		compinfos = jas_malloc(dec->numcomps * sizeof(jas_image_cmptparm_t));
 		assert(compinfos);
 		for (cmptno = 0, cmpt = dec->cmpts, compinfo = compinfos;
@@ -457,8 +740,12 @@ static int jpc_dec_process_sot(jpc_dec_t *dec, jpc_ms_t *ms)
 			compinfo->tly = 0;
 			compinfo->prec = cmpt->prec;
 			compinfo->sgnd = cmpt->sgnd;
-			compinfo->width = cmpt->width;
-			compinfo->height = cmpt->height;
+			compinfo->width = JPC_CEILDIVPOW2(JPC_CEILDIV(dec->winxend,
+			  cmpt->hstep), dec->reduce) - JPC_CEILDIVPOW2(JPC_CEILDIV(
+			  dec->winxstart, cmpt->hstep), dec->reduce);
+			compinfo->height = JPC_CEILDIVPOW2(JPC_CEILDIV(dec->winyend,
+			  cmpt->vstep), dec->reduce) - JPC_CEILDIVPOW2(JPC_CEILDIV(
+			  dec->winystart, cmpt->vstep), dec->reduce);
 			compinfo->hstep = cmpt->hstep;
 			compinfo->vstep = cmpt->vstep;
 		}
@@ -480,6 +767,17 @@ static int jpc_dec_process_sot(jpc_dec_t *dec, jpc_ms_t *ms)
 			jpc_ppxstab_destroy(dec->ppmstab);
 			dec->ppmstab = 0;
 		}
+
+		/* Tiles can only be decoded on demand if the tile-parts can be
+		  revisited, and if decoding a tile does not depend on what came
+		  before it in the code stream. */
+		if (dec->lazy) {
+			if (jas_stream_isseekable(dec->in) && !dec->pkthdrstreams &&
+			  dec->maxpkts < 0) {
+				return jpc_dec_indextileparts(dec, ms);
+			}
+			dec->lazy = 0;
+		}
 	}
 
 	if (sot->len > 0) {
@@ -509,6 +807,18 @@ static int jpc_dec_process_sot(jpc_dec_t *dec, jpc_ms_t *ms)
 
 	tile->pptstab = 0;
 
+	/* Skip any tile-part of a tile that does not intersect the decode
+	  window. */
+	if (tile->xstart >= dec->winxend || tile->xend <= dec->winxstart ||
+	  tile->ystart >= dec->winyend || tile->yend <= dec->winystart) {
+		if (dec->curtileendoff > 0) {
+			return jpc_dec_skiptilepart(dec, tile);
+		}
+		/* The tile-part extends to the end of the code stream, so
+		  there is nothing more of interest. */
+		return jpc_dec_process_eoc(dec, ms);
+	}
+
 	switch (tile->state) {
 	case JPC_TILE_INIT:
 		/* This is the first tile-part for this tile. */
@@ -536,6 +846,71 @@ static int jpc_dec_process_sot(jpc_dec_t *dec, jpc_ms_t *ms)
 	return 0;
 }
 
+int jpc_dec_skiptiledata(jpc_dec_t *dec)
+{
+	long n;
+
+	/* Seek past the remainder of the tile-part, if possible. */
+	n = dec->curtileendoff - jas_stream_getrwcount(dec->in);
+	if (n < 0) {
+		return -1;
+	}
+	if (jas_stream_isseekable(dec->in)) {
+		if (jas_stream_seek(dec->in, n, SEEK_CUR) < 0) {
+			return -1;
+		}
+		jas_stream_setrwcount(dec->in, dec->curtileendoff);
+	} else if (jas_stream_gobble(dec->in, n) != n) {
+		return -1;
+	}
+	return 0;
+}
+
+int jpc_dec_step(jpc_dec_t *dec, jpc_dec_tile_t *tile)
+{
+	double done;
+
+	if (!dec->progress) {
+		return 0;
+	}
+	done = (dec->numdonetiles + JAS_CAST(double, tile->stepno) /
+	  tile->numsteps) / dec->numwintiles;
+	++tile->stepno;
+	if ((*dec->progress->func)(dec->progress->arg, JAS_MIN(done, 1.0))) {
+		jas_eprintf("decoding aborted\n");
+		return -1;
+	}
+	return 0;
+}
+
+static int jpc_dec_skiptilepart(jpc_dec_t *dec, jpc_dec_tile_t *tile)
+{
+	jas_stream_t *pkthdrstream;
+
+	if (jpc_dec_skiptiledata(dec)) {
+		return -1;
+	}
+
+	/* Discard the packet headers for this tile-part from the main
+	  header (if any). */
+	if (dec->pkthdrstreams) {
+		if (!(pkthdrstream = jpc_streamlist_remove(dec->pkthdrstreams, 0))) {
+			return -1;
+		}
+		jas_stream_close(pkthdrstream);
+	}
+
+	dec->curtile = 0;
+
+	/* Increment the expected tile-part number. */
+	++tile->partno;
+
+	/* We should expect to encounter a SOT marker segment next. */
+	dec->state = JPC_TPHSOT;
+
+	return 0;
+}
+
 static int jpc_dec_process_sod(jpc_dec_t *dec, jpc_ms_t *ms)
 {
 	jpc_dec_tile_t *tile;
@@ -616,8 +991,10 @@ static int jpc_dec_process_sod(jpc_dec_t *dec, jpc_ms_t *ms)
 
 	}
 
-	if (tile->numparts > 0 && tile->partno == tile->numparts - 1) {
+	if (!dec->lazy && tile->numparts > 0 &&
+	  tile->partno == tile->numparts - 1) {
 		if (jpc_dec_tiledecode(dec, tile)) {
+			jpc_dec_tilefini(dec, tile);
 			return -1;
 		}
 		jpc_dec_tilefini(dec, tile);
@@ -631,9 +1008,216 @@ static int jpc_dec_process_sod(jpc_dec_t *dec, jpc_ms_t *ms)
 	/* We should expect to encounter a SOT marker segment next. */
 	dec->state = JPC_TPHSOT;
 
+	/* When tiles are decoded on demand, each tile-part is processed on
+	  its own. */
+	return dec->lazy ? 1 : 0;
+}
+
+/* Record where each tile-part of the tiles in the decode window is, and
+  stop processing the code stream, so that the tiles can be decoded on
+  demand. */
+
+static int jpc_dec_indextileparts(jpc_dec_t *dec, jpc_ms_t *ms)
+{
+	jpc_sot_t *sot;
+	jpc_dec_tile_t *tile;
+	jpc_dec_tpindexent_t *ent;
+	jpc_dec_tpindexent_t *newtpindex;
+	jpc_ms_t *nextms;
+	long pos;
+	long rwcount;
+	int entno;
+
+	nextms = 0;
+	sot = &ms->parms.sot;
+	pos = jas_stream_tell(dec->in) - ms->len - 4;
+	rwcount = jas_stream_getrwcount(dec->in) - ms->len - 4;
+
+	for (;;) {
+		if (JAS_CAST(int, sot->tileno) >= dec->numtiles) {
+			jas_eprintf("invalid tile number in SOT marker segment\n");
+			goto error;
+		}
+		tile = &dec->tiles[sot->tileno];
+
+		if (tile->xstart < dec->winxend && tile->xend > dec->winxstart &&
+		  tile->ystart < dec->winyend && tile->yend > dec->winystart) {
+			if (dec->numtpindexents >= dec->maxtpindexents) {
+				if (!(newtpindex = jas_realloc(dec->tpindex,
+				  (dec->maxtpindexents + 64) *
+				  sizeof(jpc_dec_tpindexent_t)))) {
+					goto error;
+				}
+				dec->tpindex = newtpindex;
+				dec->maxtpindexents += 64;
+			}
+			ent = &dec->tpindex[dec->numtpindexents];
+			ent->pos = pos;
+			ent->rwcount = rwcount;
+			ent->next = -1;
+			/* The tile-parts of a tile are kept in code stream order. */
+			if (tile->tpindexno < 0) {
+				tile->tpindexno = dec->numtpindexents;
+			} else {
+				for (entno = tile->tpindexno; dec->tpindex[entno].next >= 0;
+				  entno = dec->tpindex[entno].next) {
+				}
+				dec->tpindex[entno].next = dec->numtpindexents;
+			}
+			++dec->numtpindexents;
+		}
+
+		if (!sot->len) {
+			/* The tile-part extends to the end of the code stream. */
+			break;
+		}
+		if (jas_stream_seek(dec->in, pos + sot->len, SEEK_SET) < 0) {
+			goto error;
+		}
+		jas_stream_setrwcount(dec->in, rwcount + sot->len);
+
+		if (nextms) {
+			jpc_ms_destroy(nextms);
+		}
+		if (!(nextms = jpc_getms(dec->in, dec->cstate))) {
+			jas_eprintf("cannot get marker segment\n");
+			goto error;
+		}
+		if (nextms->id == JPC_MS_EOC) {
+			break;
+		}
+		if (nextms->id != JPC_MS_SOT) {
+			jas_eprintf("unexpected marker segment type\n");
+			goto error;
+		}
+		sot = &nextms->parms.sot;
+		pos = jas_stream_tell(dec->in) - nextms->len - 4;
+		rwcount = jas_stream_getrwcount(dec->in) - nextms->len - 4;
+	}
+
+	if (nextms) {
+		jpc_ms_destroy(nextms);
+	}
+
+	/* We are done processing the code stream for now. */
+	dec->state = JPC_MT;
+
+	return 1;
+
+error:
+	if (nextms) {
+		jpc_ms_destroy(nextms);
+	}
+	return -1;
+}
+
+/* Decode a tile from the tile-parts recorded in the index. */
+
+static int jpc_dec_loadtile(jpc_dec_t *dec, jpc_dec_tile_t *tile)
+{
+	jpc_dec_tpindexent_t *ent;
+	int entno;
+
+	for (entno = tile->tpindexno; entno >= 0; entno = ent->next) {
+		ent = &dec->tpindex[entno];
+		if (jas_stream_seek(dec->in, ent->pos, SEEK_SET) < 0) {
+			goto error;
+		}
+		jas_stream_setrwcount(dec->in, ent->rwcount);
+		dec->state = JPC_TPHSOT;
+		if (jpc_dec_decode(dec)) {
+			goto error;
+		}
+	}
+
+	if (tile->state == JPC_TILE_ACTIVE || tile->state == JPC_TILE_ACTIVELAST) {
+		if (jpc_dec_tiledecode(dec, tile)) {
+			goto error;
+		}
+	}
+	jpc_dec_tilefini(dec, tile);
+
+	dec->state = JPC_MT;
+
+	return 0;
+
+error:
+	/* The decoder is left in a state in which nothing more is decoded. */
+	jpc_dec_tilefini(dec, tile);
+	dec->state = JPC_TPHSOT;
+	return -1;
+}
+
+/* Decode the tiles holding a region of a component of the image, if they
+  have not been decoded already. */
+
+static int jpc_dec_load(jas_image_loadobj_t *obj, int loadno,
+  jas_image_coord_t x, jas_image_coord_t y, jas_image_coord_t width,
+  jas_image_coord_t height)
+{
+	jpc_dec_t *dec;
+	jpc_dec_cmpt_t *cmpt;
+	jpc_dec_tile_t *tile;
+	uint_fast32_t hstep;
+	uint_fast32_t vstep;
+	uint_fast32_t xoff;
+	uint_fast32_t yoff;
+	int htileno;
+	int vtileno;
+	int htilestart;
+	int vtilestart;
+	int htileend;
+	int vtileend;
+
+	dec = obj;
+	if (dec->state != JPC_MT) {
+		return -1;
+	}
+	if (x < 0 || y < 0 || width <= 0 || height <= 0) {
+		return 0;
+	}
+	cmpt = &dec->cmpts[loadno];
+
+	/* A sample of the component lies at a multiple of these steps on the
+	  reference grid (for the resolution being decoded). */
+	hstep = cmpt->hstep << dec->reduce;
+	vstep = cmpt->vstep << dec->reduce;
+	xoff = JPC_CEILDIV(dec->winxstart, hstep);
+	yoff = JPC_CEILDIV(dec->winystart, vstep);
+
+	htilestart = ((x + xoff) * hstep - dec->tilexoff) / dec->tilewidth;
+	vtilestart = ((y + yoff) * vstep - dec->tileyoff) / dec->tileheight;
+	htileend = JAS_MIN(JAS_CAST(int, ((x + width - 1 + xoff) * hstep -
+	  dec->tilexoff) / dec->tilewidth), dec->numhtiles - 1);
+	vtileend = JAS_MIN(JAS_CAST(int, ((y + height - 1 + yoff) * vstep -
+	  dec->tileyoff) / dec->tileheight), dec->numvtiles - 1);
+
+	for (vtileno = vtilestart; vtileno <= vtileend; ++vtileno) {
+		for (htileno = htilestart; htileno <= htileend; ++htileno) {
+			tile = &dec->tiles[vtileno * dec->numhtiles + htileno];
+			if (tile->state != JPC_TILE_DONE) {
+				if (jpc_dec_loadtile(dec, tile)) {
+					return -1;
+				}
+			}
+		}
+	}
+
 	return 0;
 }
 
+static void jpc_dec_unload(jas_image_loadobj_t *obj)
+{
+	jpc_dec_t *dec;
+
+	dec = obj;
+
+	/* The image is being destroyed (or does not need the decoder any
+	  more), so it is not the decoder's to discard. */
+	dec->image = 0;
+	jpc_dec_destroy(dec);
+}
+
 static int jpc_dec_tileinit(jpc_dec_t *dec, jpc_dec_tile_t *tile)
 {
 	jpc_dec_tcomp_t *tcomp;
@@ -675,9 +1259,11 @@ static int jpc_dec_tileinit(jpc_dec_t *dec, jpc_dec_tile_t *tile)
 	uint_fast32_t tmpyend;
 	jpc_dec_cp_t *cp;
 	jpc_tsfb_band_t bnds[64];
+	jpc_tsfb_band_t wins[64];
 	jpc_pchg_t *pchg;
 	int pchgno;
 	jpc_dec_cmpt_t *cmpt;
+	double size;
 
 	cp = tile->cp;
 	tile->realmode = 0;
@@ -685,6 +1271,34 @@ static int jpc_dec_tileinit(jpc_dec_t *dec, jpc_dec_tile_t *tile)
 		tile->realmode = 1;
 	}
 
+	/* Floating-point arithmetic is only used if every component uses the
+	  9/7 transform, so that the ICT (if any) sees samples of one kind. */
+	tile->fltmode = dec->fltmode && cp->mctid != JPC_MCT_RCT;
+	for (compno = 0; compno < dec->numcomps; ++compno) {
+		if (cp->ccps[compno].qmfbid != JPC_COX_INS) {
+			tile->fltmode = 0;
+		}
+	}
+
+	/* Reversible tiles with components of at most 8 bits can be
+	  reconstructed with 16-bit samples, unless only part of the tile is
+	  decoded. */
+	tile->int16mode = !dec->reduce && (cp->mctid == JPC_MCT_NONE ||
+	  cp->mctid == JPC_MCT_RCT);
+
+	/* A large tile is decoded a row at a time, rather than holding all of
+	  its coefficients at once. */
+	size = 0.0;
+	for (compno = 0, tcomp = tile->tcomps; compno < dec->numcomps;
+	  ++compno, ++tcomp) {
+		size += (double) (tcomp->xend - tcomp->xstart) *
+		  (tcomp->yend - tcomp->ystart) * sizeof(jpc_fix_t);
+	}
+	tile->linemode = dec->lowmem || size > JPC_DEC_LINETHRESH;
+	if (tile->linemode) {
+		tile->int16mode = 0;
+	}
+
 	for (compno = 0, tcomp = tile->tcomps, cmpt = dec->cmpts; compno <
 	  dec->numcomps; ++compno, ++tcomp, ++cmpt) {
 		ccp = &tile->cp->ccps[compno];
@@ -692,23 +1306,55 @@ static int jpc_dec_tileinit(jpc_dec_t *dec, jpc_dec_tile_t *tile)
 			tile->realmode = 1;
 		}
 		tcomp->numrlvls = ccp->numrlvls;
+		if (dec->reduce > tcomp->numrlvls - 1) {
+			jas_eprintf("cannot discard %d resolution levels of a tile-component with only %d\n",
+			  dec->reduce, tcomp->numrlvls);
+			return -1;
+		}
 		if (!(tcomp->rlvls = jas_malloc(tcomp->numrlvls *
 		  sizeof(jpc_dec_rlvl_t)))) {
 			return -1;
 		}
-		if (!(tcomp->data = jas_seq2d_create(JPC_CEILDIV(tile->xstart,
-		  cmpt->hstep), JPC_CEILDIV(tile->ystart, cmpt->vstep),
-		  JPC_CEILDIV(tile->xend, cmpt->hstep), JPC_CEILDIV(tile->yend,
-		  cmpt->vstep)))) {
+		if (!tile->linemode && !(tcomp->data = jas_seq2d_create(
+		  tcomp->xstart, tcomp->ystart, tcomp->xend, tcomp->yend))) {
 			return -1;
 		}
 		if (!(tcomp->tsfb = jpc_cod_gettsfb(ccp->qmfbid,
 		  tcomp->numrlvls - 1))) {
 			return -1;
 		}
-{
-	jpc_tsfb_getbands(tcomp->tsfb, jas_seq2d_xstart(tcomp->data), jas_seq2d_ystart(tcomp->data), jas_seq2d_xend(tcomp->data), jas_seq2d_yend(tcomp->data), bnds);
-}
+		if (tile->fltmode) {
+			jpc_tsfb_setfltmode(tcomp->tsfb);
+		}
+{
+	jpc_tsfb_getbands(tcomp->tsfb, tcomp->xstart, tcomp->ystart, tcomp->xend, tcomp->yend, bnds);
+}
+
+		/* Determine the part of the tile-component that is in the decode
+		  window (at the resolution being decoded), and the part of each
+		  band that is needed to reconstruct it. */
+		tcomp->winxstart = JPC_CEILDIVPOW2(JAS_MAX(tcomp->xstart,
+		  JPC_CEILDIV(dec->winxstart, cmpt->hstep)), dec->reduce);
+		tcomp->winystart = JPC_CEILDIVPOW2(JAS_MAX(tcomp->ystart,
+		  JPC_CEILDIV(dec->winystart, cmpt->vstep)), dec->reduce);
+		tcomp->winxend = JAS_MAX(tcomp->winxstart, JPC_CEILDIVPOW2(
+		  JAS_MIN(tcomp->xend, JPC_CEILDIV(dec->winxend, cmpt->hstep)),
+		  dec->reduce));
+		tcomp->winyend = JAS_MAX(tcomp->winystart, JPC_CEILDIVPOW2(
+		  JAS_MIN(tcomp->yend, JPC_CEILDIV(dec->winyend, cmpt->vstep)),
+		  dec->reduce));
+		if (ccp->qmfbid != JPC_COX_RFT || cmpt->prec > 8 ||
+		  tcomp->winxstart != tcomp->xstart ||
+		  tcomp->winystart != tcomp->ystart ||
+		  tcomp->winxend != tcomp->xend || tcomp->winyend != tcomp->yend) {
+			tile->int16mode = 0;
+		}
+		jpc_tsfb_getbandwins(tcomp->tsfb, tcomp->numrlvls - 1 - dec->reduce,
+		  JPC_CEILDIVPOW2(tcomp->xstart, dec->reduce),
+		  JPC_CEILDIVPOW2(tcomp->ystart, dec->reduce),
+		  JPC_CEILDIVPOW2(tcomp->xend, dec->reduce),
+		  JPC_CEILDIVPOW2(tcomp->yend, dec->reduce), tcomp->winxstart,
+		  tcomp->winystart, tcomp->winxend, tcomp->winyend, wins);
 		for (rlvlno = 0, rlvl = tcomp->rlvls; rlvlno < tcomp->numrlvls;
 		  ++rlvlno, ++rlvl) {
 rlvl->bands = 0;
@@ -780,20 +1426,54 @@ rlvl->bands = 0;
 				  tcomp->numrlvls - 1, rlvlno, band->orient);
 				band->absstepsize = jpc_calcabsstepsize(band->stepsize,
 				  cmpt->prec + band->analgain);
+				band->absstepsizeflt = jpc_calcabsstepsizeflt(
+				  band->stepsize, cmpt->prec + band->analgain);
 				band->numbps = ccp->numguardbits +
 				  JPC_QCX_GETEXPN(band->stepsize) - 1;
 				band->roishift = (ccp->roishift + band->numbps >= JPC_PREC) ?
 				  (JPC_PREC - 1 - band->numbps) : ccp->roishift;
+				if (rlvlno < tcomp->numrlvls - dec->reduce) {
+					band->winxstart = wins[bndno].xstart;
+					band->winystart = wins[bndno].ystart;
+					band->winxend = wins[bndno].xend;
+					band->winyend = wins[bndno].yend;
+				} else {
+					/* Nothing is needed from a discarded resolution level. */
+					band->winxstart = bnd->xstart;
+					band->winystart = bnd->ystart;
+					band->winxend = bnd->xstart;
+					band->winyend = bnd->ystart;
+				}
 				band->data = 0;
 				band->prcs = 0;
 				if (bnd->xstart == bnd->xend || bnd->ystart == bnd->yend) {
 					continue;
 				}
-				if (!(band->data = jas_seq2d_create(0, 0, 0, 0))) {
-					return -1;
+				band->stripeystart = bnd->ystart;
+				band->stripeyend = bnd->ystart;
+				if (!tile->linemode) {
+					if (!(band->data = jas_seq2d_create(0, 0, 0, 0))) {
+						return -1;
+					}
+					jas_seq2d_bindsub(band->data, tcomp->data, bnd->locxstart, bnd->locystart, bnd->locxend, bnd->locyend);
+					jas_seq2d_setshift(band->data, bnd->xstart, bnd->ystart);
+				} else if (band->winxstart < band->winxend &&
+				  band->winystart < band->winyend) {
+					/* The band data holds a row of code blocks at a
+					  time. */
+					if (!(band->data = jas_seq2d_create(bnd->xstart,
+					  bnd->ystart, bnd->xend, bnd->ystart + JAS_MIN(
+					  JAS_CAST(uint_fast32_t, 1) << rlvl->cblkheightexpn,
+					  bnd->yend - bnd->ystart)))) {
+						return -1;
+					}
+				} else {
+					/* Nothing is needed from the band, but it is still
+					  there as far as the packets are concerned. */
+					if (!(band->data = jas_seq2d_create(0, 0, 0, 0))) {
+						return -1;
+					}
 				}
-				jas_seq2d_bindsub(band->data, tcomp->data, bnd->locxstart, bnd->locystart, bnd->locxend, bnd->locyend);
-				jas_seq2d_setshift(band->data, bnd->xstart, bnd->ystart);
 
 				assert(rlvl->numprcs);
 
@@ -808,10 +1488,10 @@ rlvl->bands = 0;
 	  prccnt > 0; --prccnt, ++prc) {
 		cbgxend = cbgxstart + (1 << rlvl->cbgwidthexpn);
 		cbgyend = cbgystart + (1 << rlvl->cbgheightexpn);
-		prc->xstart = JAS_MAX(cbgxstart, JAS_CAST(uint_fast32_t, jas_seq2d_xstart(band->data)));
-		prc->ystart = JAS_MAX(cbgystart, JAS_CAST(uint_fast32_t, jas_seq2d_ystart(band->data)));
-		prc->xend = JAS_MIN(cbgxend, JAS_CAST(uint_fast32_t, jas_seq2d_xend(band->data)));
-		prc->yend = JAS_MIN(cbgyend, JAS_CAST(uint_fast32_t, jas_seq2d_yend(band->data)));
+		prc->xstart = JAS_MAX(cbgxstart, JAS_CAST(uint_fast32_t, bnd->xstart));
+		prc->ystart = JAS_MAX(cbgystart, JAS_CAST(uint_fast32_t, bnd->ystart));
+		prc->xend = JAS_MIN(cbgxend, JAS_CAST(uint_fast32_t, bnd->xend));
+		prc->yend = JAS_MIN(cbgyend, JAS_CAST(uint_fast32_t, bnd->yend));
 		if (prc->xend > prc->xstart && prc->yend > prc->ystart) {
 			tlcblkxstart = JPC_FLOORDIVPOW2(prc->xstart,
 			  rlvl->cblkwidthexpn) << rlvl->cblkwidthexpn;
@@ -859,10 +1539,19 @@ rlvl->bands = 0;
 					cblk->numimsbs = 0;
 					cblk->numlenbits = 3;
 					cblk->flags = 0;
-					if (!(cblk->data = jas_seq2d_create(0, 0, 0, 0))) {
-						return -1;
+					cblk->xstart = tmpxstart;
+					cblk->ystart = tmpystart;
+					cblk->xend = tmpxend;
+					cblk->yend = tmpyend;
+					cblk->data = 0;
+					/* In line mode, the data is bound to the band data
+					  only while the code block is decoded. */
+					if (!tile->linemode) {
+						if (!(cblk->data = jas_seq2d_create(0, 0, 0, 0))) {
+							return -1;
+						}
+						jas_seq2d_bindsub(cblk->data, band->data, tmpxstart, tmpystart, tmpxend, tmpyend);
 					}
-					jas_seq2d_bindsub(cblk->data, band->data, tmpxstart, tmpystart, tmpxend, tmpyend);
 					++cblk;
 					--cblkcnt;
 				}
@@ -943,7 +1632,9 @@ if (!prc->cblks) {
 		jpc_seglist_remove(&cblk->segs, seg);
 		jpc_seg_destroy(seg);
 	}
-	jas_matrix_destroy(cblk->data);
+	if (cblk->data) {
+		jas_matrix_destroy(cblk->data);
+	}
 	if (cblk->mqdec) {
 		jpc_mqdec_destroy(cblk->mqdec);
 	}
@@ -1015,54 +1706,91 @@ if (!prc->cblks) {
 
 static int jpc_dec_tiledecode(jpc_dec_t *dec, jpc_dec_tile_t *tile)
 {
-	int i;
-	int j;
 	jpc_dec_tcomp_t *tcomp;
 	jpc_dec_rlvl_t *rlvl;
 	jpc_dec_band_t *band;
 	int compno;
 	int rlvlno;
 	int bandno;
-	int adjust;
-	int v;
 	jpc_dec_ccp_t *ccp;
 	jpc_dec_cmpt_t *cmpt;
+	jas_matrix_t *win;
+	jpc_dec_cmptloop_t cmptloop;
+	int ret;
+
+	/* A tile decoded a row at a time has its code blocks decoded as the
+	  rows are needed. */
+	if (tile->linemode) {
+		return jpc_dec_tiledecodelines(dec, tile);
+	}
+
+	/* Progress is reported as each resolution level of each component
+	  is decoded and as each component is synthesized. */
+	tile->numsteps = 0;
+	tile->stepno = 0;
+	for (compno = 0, tcomp = tile->tcomps; compno < dec->numcomps;
+	  ++compno, ++tcomp) {
+		tile->numsteps += tcomp->numrlvls - dec->reduce + 1;
+	}
 
 	if (jpc_dec_decodecblks(dec, tile)) {
 		jas_eprintf("jpc_dec_decodecblks failed\n");
 		return -1;
 	}
 
+	if (!(win = jas_seq2d_create(0, 0, 0, 0))) {
+		return -1;
+	}
+
 	/* Perform dequantization. */
 	for (compno = 0, tcomp = tile->tcomps; compno < dec->numcomps;
 	  ++compno, ++tcomp) {
 		ccp = &tile->cp->ccps[compno];
-		for (rlvlno = 0, rlvl = tcomp->rlvls; rlvlno < tcomp->numrlvls;
-		  ++rlvlno, ++rlvl) {
+		for (rlvlno = 0, rlvl = tcomp->rlvls; rlvlno < tcomp->numrlvls -
+		  dec->reduce; ++rlvlno, ++rlvl) {
 			if (!rlvl->bands) {
 				continue;
 			}
 			for (bandno = 0, band = rlvl->bands;
 			  bandno < rlvl->numbands; ++bandno, ++band) {
-				if (!band->data) {
+				if (!band->data || band->winxstart >= band->winxend ||
+				  band->winystart >= band->winyend) {
 					continue;
 				}
-				jpc_undo_roi(band->data, band->roishift, ccp->roishift -
+				/* Only the part of the band in the window is of interest. */
+				jas_seq2d_bindsub(win, band->data, band->winxstart,
+				  band->winystart, band->winxend, band->winyend);
+				jpc_undo_roi(win, band->roishift, ccp->roishift -
 				  band->roishift, band->numbps);
-				if (tile->realmode) {
-					jas_matrix_asl(band->data, JPC_FIX_FRACBITS);
-					jpc_dequantize(band->data, band->absstepsize);
+				if (tile->fltmode) {
+					jpc_dequantize_flt(win,
+					  band->absstepsizeflt);
+				} else if (tile->realmode) {
+					jas_matrix_asl(win, JPC_FIX_FRACBITS);
+					jpc_dequantize(win, band->absstepsize);
 				}
 
 			}
 		}
 	}
+	jas_matrix_destroy(win);
 
-	/* Apply an inverse wavelet transform if necessary. */
-	for (compno = 0, tcomp = tile->tcomps; compno < dec->numcomps;
-	  ++compno, ++tcomp) {
-		ccp = &tile->cp->ccps[compno];
-		jpc_tsfb_synthesize(tcomp->tsfb, tcomp->data);
+	/* An 8-bit reversible tile is reconstructed with 16-bit samples if the
+	  coefficients allow it. */
+	if (tile->int16mode && (ret = jpc_dec_tiledecode16(dec, tile))) {
+		return (ret < 0) ? (-1) : jpc_dec_tilewrite(dec, tile);
+	}
+
+	/* Apply an inverse wavelet transform if necessary.  The components are
+	  independent of each other, so they are synthesized concurrently (with
+	  the progress reported as each one is done). */
+	cmptloop.dec = dec;
+	cmptloop.tile = tile;
+	cmptloop.bufs = 0;
+	cmptloop.cancelled = 0;
+	if (jas_thread_parfor(dec->numcomps, 1, jpc_dec_synthesizecmpts,
+	  &cmptloop)) {
+		return -1;
 	}
 
 
@@ -1075,61 +1803,561 @@ static int jpc_dec_tiledecode(jpc_dec_t *dec, jpc_dec_tile_t *tile)
 		break;
 	case JPC_MCT_ICT:
 		assert(dec->numcomps == 3);
-		jpc_iict(tile->tcomps[0].data, tile->tcomps[1].data,
-		  tile->tcomps[2].data);
+		if (tile->fltmode) {
+			jpc_iict_flt(tile->tcomps[0].data, tile->tcomps[1].data,
+			  tile->tcomps[2].data);
+		} else {
+			jpc_iict(tile->tcomps[0].data, tile->tcomps[1].data,
+			  tile->tcomps[2].data);
+		}
 		break;
 	}
 
+	/* Perform rounding, level shift, and clipping. */
+	for (compno = 0, tcomp = tile->tcomps, cmpt = dec->cmpts; compno <
+	  dec->numcomps; ++compno, ++tcomp, ++cmpt) {
+		jpc_dec_convertcmpt(tile, cmpt, tcomp->data);
+	}
+
+	/* XXX need to free tsfb struct */
+
+	return jpc_dec_tilewrite(dec, tile);
+}
+
+/* Perform rounding, level shift, and clipping of the samples of a
+  component of a tile. */
+static void jpc_dec_convertcmpt(jpc_dec_tile_t *tile, jpc_dec_cmpt_t *cmpt,
+  jas_matrix_t *data)
+{
+	int i;
+	int j;
+	int adjust;
+	int v;
+	jpc_fix_t mn;
+	jpc_fix_t mx;
+	const jpc_qmfb_kernops_t *ops;
+
+	adjust = cmpt->sgnd ? 0 : (1 << (cmpt->prec - 1));
+	mn = cmpt->sgnd ? (-(1 << (cmpt->prec - 1))) : (0);
+	mx = cmpt->sgnd ? ((1 << (cmpt->prec - 1)) - 1) : ((1 <<
+	  cmpt->prec) - 1);
+
+	/* The floating-point samples are done in one pass. */
+	if (tile->fltmode) {
+		ops = jpc_qmfb_getkernops();
+		for (i = 0; i < jas_matrix_numrows(data); ++i) {
+			(*ops->flttoint)(jas_matrix_getref(data, i, 0),
+			  jas_matrix_numcols(data), (float) adjust + 0.5f, (float) mn,
+			  (float) mx);
+		}
+		return;
+	}
+
 	/* Perform rounding and convert to integer values. */
 	if (tile->realmode) {
-		for (compno = 0, tcomp = tile->tcomps; compno < dec->numcomps;
-		  ++compno, ++tcomp) {
-			for (i = 0; i < jas_matrix_numrows(tcomp->data); ++i) {
-				for (j = 0; j < jas_matrix_numcols(tcomp->data); ++j) {
-					v = jas_matrix_get(tcomp->data, i, j);
-					v = jpc_fix_round(v);
-					jas_matrix_set(tcomp->data, i, j, jpc_fixtoint(v));
-				}
+		for (i = 0; i < jas_matrix_numrows(data); ++i) {
+			for (j = 0; j < jas_matrix_numcols(data); ++j) {
+				v = jas_matrix_get(data, i, j);
+				v = jpc_fix_round(v);
+				jas_matrix_set(data, i, j, jpc_fixtoint(v));
 			}
 		}
 	}
 
 	/* Perform level shift. */
-	for (compno = 0, tcomp = tile->tcomps, cmpt = dec->cmpts; compno <
-	  dec->numcomps; ++compno, ++tcomp, ++cmpt) {
-		adjust = cmpt->sgnd ? 0 : (1 << (cmpt->prec - 1));
-		for (i = 0; i < jas_matrix_numrows(tcomp->data); ++i) {
-			for (j = 0; j < jas_matrix_numcols(tcomp->data); ++j) {
-				*jas_matrix_getref(tcomp->data, i, j) += adjust;
-			}
+	for (i = 0; i < jas_matrix_numrows(data); ++i) {
+		for (j = 0; j < jas_matrix_numcols(data); ++j) {
+			*jas_matrix_getref(data, i, j) += adjust;
 		}
 	}
 
 	/* Perform clipping. */
+	jas_matrix_clip(data, mn, mx);
+}
+
+/* Decode a tile a row at a time.  The rows of each component come out of
+  the synthesis one at a time, and each band is decoded a row of code
+  blocks at a time as its rows are needed, so only a stripe of each band
+  and a few rows of each level of the transform are held at once. */
+static int jpc_dec_tiledecodelines(jpc_dec_t *dec, jpc_dec_tile_t *tile)
+{
+	jpc_dec_tcomp_t *tcomp;
+	jpc_dec_cmpt_t *cmpt;
+	jpc_dec_cmptlines_t *cmptlines;
+	jpc_dec_cmptlines_t *cl;
+	jas_matrix_t *win;
+	jpc_fix_t *row;
+	int compno;
+	int numrows;
+	int ret;
+	int i;
+
+	ret = -1;
+	win = 0;
+	if (!(cmptlines = jas_malloc(dec->numcomps *
+	  sizeof(jpc_dec_cmptlines_t)))) {
+		return -1;
+	}
+	for (compno = 0, cl = cmptlines; compno < dec->numcomps; ++compno,
+	  ++cl) {
+		cl->lines = 0;
+		cl->data = 0;
+	}
+	if (!(win = jas_seq2d_create(0, 0, 0, 0))) {
+		goto done;
+	}
+
+	numrows = 0;
+	for (compno = 0, tcomp = tile->tcomps, cmpt = dec->cmpts,
+	  cl = cmptlines; compno < dec->numcomps; ++compno, ++tcomp, ++cmpt,
+	  ++cl) {
+		cl->dec = dec;
+		cl->tile = tile;
+		cl->tcomp = tcomp;
+		cl->win = win;
+		/* When tiles are decoded on demand, the components of the image
+		  may have been reordered or deleted in the meantime. */
+		cl->cmptno = dec->lazy ? jas_image_getcmptbyloadno(dec->image,
+		  compno) : compno;
+		if (tcomp->winxstart >= tcomp->winxend ||
+		  tcomp->winystart >= tcomp->winyend) {
+			/* A small tile can vanish at a reduced resolution (or be
+			  outside of the decode window). */
+			continue;
+		}
+		if (!(cl->lines = jpc_tsfb_synthesizelines(tcomp->tsfb,
+		  tcomp->numrlvls - 1 - dec->reduce,
+		  JPC_CEILDIVPOW2(tcomp->xstart, dec->reduce),
+		  JPC_CEILDIVPOW2(tcomp->ystart, dec->reduce),
+		  JPC_CEILDIVPOW2(tcomp->xend, dec->reduce),
+		  JPC_CEILDIVPOW2(tcomp->yend, dec->reduce), tcomp->winxstart,
+		  tcomp->winystart, tcomp->winxend, tcomp->winyend,
+		  jpc_dec_getbandrow, cl))) {
+			goto done;
+		}
+		if (!(cl->data = jas_matrix_create(1, tcomp->winxend -
+		  tcomp->winxstart))) {
+			goto done;
+		}
+		numrows = JAS_MAX(numrows, JAS_CAST(int, tcomp->winyend -
+		  tcomp->winystart));
+	}
+
+	/* Progress is reported as each row is decoded. */
+	tile->numsteps = numrows + 1;
+	tile->stepno = 0;
+
+	for (i = 0; i < numrows; ++i) {
+		if (jpc_dec_step(dec, tile)) {
+			goto done;
+		}
+		for (compno = 0, tcomp = tile->tcomps, cl = cmptlines; compno <
+		  dec->numcomps; ++compno, ++tcomp, ++cl) {
+			if (!cl->lines || i >= JAS_CAST(int, tcomp->winyend -
+			  tcomp->winystart)) {
+				continue;
+			}
+			if (jpc_tsfb_getline(cl->lines, &row)) {
+				goto done;
+			}
+			memcpy(jas_matrix_getref(cl->data, 0, 0), row,
+			  jas_matrix_numcols(cl->data) * sizeof(jpc_fix_t));
+		}
+
+		/* Apply an inverse intercomponent transform if necessary. */
+		switch (tile->cp->mctid) {
+		case JPC_MCT_RCT:
+			assert(dec->numcomps == 3);
+			jpc_irct(cmptlines[0].data, cmptlines[1].data,
+			  cmptlines[2].data);
+			break;
+		case JPC_MCT_ICT:
+			assert(dec->numcomps == 3);
+			if (tile->fltmode) {
+				jpc_iict_flt(cmptlines[0].data, cmptlines[1].data,
+				  cmptlines[2].data);
+			} else {
+				jpc_iict(cmptlines[0].data, cmptlines[1].data,
+				  cmptlines[2].data);
+			}
+			break;
+		}
+
+		for (compno = 0, tcomp = tile->tcomps, cmpt = dec->cmpts,
+		  cl = cmptlines; compno < dec->numcomps; ++compno, ++tcomp,
+		  ++cmpt, ++cl) {
+			if (!cl->lines || i >= JAS_CAST(int, tcomp->winyend -
+			  tcomp->winystart) || cl->cmptno < 0) {
+				continue;
+			}
+			jpc_dec_convertcmpt(tile, cmpt, cl->data);
+			if (jas_image_writecmpt(dec->image, cl->cmptno,
+			  tcomp->winxstart - JPC_CEILDIVPOW2(JPC_CEILDIV(
+			  dec->winxstart, cmpt->hstep), dec->reduce),
+			  tcomp->winystart + i - JPC_CEILDIVPOW2(JPC_CEILDIV(
+			  dec->winystart, cmpt->vstep), dec->reduce),
+			  jas_matrix_numcols(cl->data), 1, cl->data)) {
+				jas_eprintf("write component failed\n");
+				goto done;
+			}
+		}
+	}
+
+	if (jpc_dec_step(dec, tile)) {
+		goto done;
+	}
+	++dec->numdonetiles;
+	ret = 0;
+
+done:
+	for (compno = 0, cl = cmptlines; compno < dec->numcomps; ++compno,
+	  ++cl) {
+		if (cl->lines) {
+			jpc_tsfb_lines_destroy(cl->lines);
+		}
+		if (cl->data) {
+			jas_matrix_destroy(cl->data);
+		}
+	}
+	if (win) {
+		jas_matrix_destroy(win);
+	}
+	jas_free(cmptlines);
+	return ret;
+}
+
+/* Get a row of the part of a band that is needed for the decode window,
+  decoding the next row of code blocks of the band when it is reached. */
+static int jpc_dec_getbandrow(void *arg, int bandno, int y, jpc_fix_t *buf)
+{
+	jpc_dec_cmptlines_t *cl = arg;
+	jpc_dec_tile_t *tile = cl->tile;
+	jpc_dec_tcomp_t *tcomp = cl->tcomp;
+	jpc_dec_rlvl_t *rlvl;
+	jpc_dec_band_t *band;
+	jpc_dec_ccp_t *ccp;
+	uint_fast32_t ystart;
+	uint_fast32_t yend;
+
+	rlvl = &tcomp->rlvls[(bandno + 2) / 3];
+	band = &rlvl->bands[bandno ? ((bandno - 1) % 3) : 0];
+	if (JAS_CAST(uint_fast32_t, y) >= band->stripeyend) {
+		/* Decode the row of code blocks that the row is in. */
+		ystart = JAS_MAX(band->stripeyend, JPC_FLOORDIVPOW2(y,
+		  rlvl->cblkheightexpn) << rlvl->cblkheightexpn);
+		yend = JAS_MIN(band->winyend, (JPC_FLOORDIVPOW2(y,
+		  rlvl->cblkheightexpn) + 1) << rlvl->cblkheightexpn);
+		jas_seq2d_setshift(band->data, jas_seq2d_xstart(band->data),
+		  ystart);
+		jas_matrix_setall(band->data, 0);
+		if (jpc_dec_decodecblkrows(cl->dec, tile, tcomp, rlvl, band, ystart,
+		  yend)) {
+			jas_eprintf("jpc_dec_decodecblkrows failed\n");
+			return -1;
+		}
+		band->stripeystart = ystart;
+		band->stripeyend = yend;
+
+		/* Perform dequantization. */
+		ccp = &tile->cp->ccps[tcomp - tile->tcomps];
+		jas_seq2d_bindsub(cl->win, band->data, band->winxstart, ystart,
+		  band->winxend, yend);
+		jpc_undo_roi(cl->win, band->roishift, ccp->roishift -
+		  band->roishift, band->numbps);
+		if (tile->fltmode) {
+			jpc_dequantize_flt(cl->win, band->absstepsizeflt);
+		} else if (tile->realmode) {
+			jas_matrix_asl(cl->win, JPC_FIX_FRACBITS);
+			jpc_dequantize(cl->win, band->absstepsize);
+		}
+	}
+	memcpy(buf, jas_seq2d_getref(band->data, band->winxstart, y),
+	  (band->winxend - band->winxstart) * sizeof(jpc_fix_t));
+	return 0;
+}
+
+/* Check whether the decoding has been cancelled before a component is
+  synthesized, or report the progress once it is done (done is nonzero).
+  The components are synthesized by several threads, so the progress is
+  reported by one thread at a time. */
+static int jpc_dec_cmptstep(jpc_dec_cmptloop_t *cmptloop, int done)
+{
+	int ret;
+
+	jas_thread_lockcallback();
+	if (done && !cmptloop->cancelled &&
+	  jpc_dec_step(cmptloop->dec, cmptloop->tile)) {
+		cmptloop->cancelled = 1;
+	}
+	ret = cmptloop->cancelled ? (-1) : 0;
+	jas_thread_unlockcallback();
+	return ret;
+}
+
+/* Synthesize the components start to end - 1 of a tile, leaving just the
+  samples in the decode window. */
+static int jpc_dec_synthesizecmpts(void *arg, int start, int end)
+{
+	jpc_dec_cmptloop_t *cmptloop = arg;
+	jpc_dec_t *dec = cmptloop->dec;
+	jpc_dec_tcomp_t *tcomp;
+	jpc_dec_rlvl_t *rlvl;
+	jas_matrix_t *data;
+	int i;
+	int j;
+
+	for (; start < end; ++start) {
+		if (jpc_dec_cmptstep(cmptloop, 0)) {
+			return -1;
+		}
+		tcomp = &cmptloop->tile->tcomps[start];
+		rlvl = &tcomp->rlvls[tcomp->numrlvls - 1 - dec->reduce];
+		if (tcomp->winxstart == rlvl->xstart &&
+		  tcomp->winystart == rlvl->ystart && tcomp->winxend == rlvl->xend &&
+		  tcomp->winyend == rlvl->yend) {
+			if (!dec->reduce) {
+				jpc_tsfb_synthesize(tcomp->tsfb, tcomp->data);
+				if (jpc_dec_cmptstep(cmptloop, 1)) {
+					return -1;
+				}
+				continue;
+			}
+			/* Only synthesize the levels that are kept. */
+			jpc_tsfb_synthesizelvls(tcomp->tsfb, tcomp->data,
+			  tcomp->numrlvls - 1 - dec->reduce);
+		} else {
+			/* Only synthesize what is needed for the decode window. */
+			if (jpc_tsfb_synthesizewin(tcomp->tsfb, tcomp->data,
+			  tcomp->numrlvls - 1 - dec->reduce, tcomp->winxstart,
+			  tcomp->winystart, tcomp->winxend, tcomp->winyend)) {
+				return -1;
+			}
+		}
+
+		/* The result is left where a synthesis of the entire tile-component
+		  (at this resolution) would have put it, in the top-left corner of
+		  the tile-component data.  Replace the data with just the window.
+		  (The band and code block data are no longer used at this point.) */
+		if (!(data = jas_seq2d_create(tcomp->winxstart, tcomp->winystart,
+		  tcomp->winxend, tcomp->winyend))) {
+			return -1;
+		}
+		for (i = 0; i < jas_matrix_numrows(data); ++i) {
+			for (j = 0; j < jas_matrix_numcols(data); ++j) {
+				jas_matrix_set(data, i, j, jas_matrix_get(tcomp->data,
+				  tcomp->winystart - rlvl->ystart + i,
+				  tcomp->winxstart - rlvl->xstart + j));
+			}
+		}
+		jas_matrix_destroy(tcomp->data);
+		tcomp->data = data;
+		if (jpc_dec_cmptstep(cmptloop, 1)) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/* Synthesize the 16-bit samples of the components start to end - 1 of a
+  tile. */
+static int jpc_dec_synthesizecmpts16(void *arg, int start, int end)
+{
+	jpc_dec_cmptloop_t *cmptloop = arg;
+	jpc_dec_tcomp_t *tcomp;
+	int numcols;
+
+	for (; start < end; ++start) {
+		if (jpc_dec_cmptstep(cmptloop, 0)) {
+			return -1;
+		}
+		tcomp = &cmptloop->tile->tcomps[start];
+		numcols = jas_matrix_numcols(tcomp->data);
+		if (jpc_tsfb_synthesize16(tcomp->tsfb, cmptloop->bufs[start],
+		  jas_seq2d_xstart(tcomp->data), jas_seq2d_ystart(tcomp->data),
+		  numcols, jas_matrix_numrows(tcomp->data), numcols) ||
+		  jpc_dec_cmptstep(cmptloop, 1)) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/* Perform synthesis, the inverse RCT (if any), level shift and clipping
+  with 16-bit samples.  Zero is returned (with the tile left as it was) if
+  the coefficients are too large for the samples to stay within 16 bits. */
+static int jpc_dec_tiledecode16(jpc_dec_t *dec, jpc_dec_tile_t *tile)
+{
+	jpc_dec_tcomp_t *tcomp;
+	jpc_dec_rlvl_t *rlvl;
+	jpc_dec_band_t *band;
+	jpc_dec_cmpt_t *cmpt;
+	jpc_dec_cmptloop_t cmptloop;
+	int_least16_t **bufs;
+	int_least16_t *buf;
+	long maxmags[JPC_MAXRLVLS];
+	long bounds[3];
+	long bound;
+	int compno;
+	int rlvlno;
+	int bandno;
+	int numrows;
+	int numcols;
+	long off;
+	int xoff;
+	int yoff;
+	int adjust;
+	int mn;
+	int mx;
+	int ret;
+	int i;
+	const jpc_qmfb_kernops_t *ops;
+
+	ops = jpc_qmfb_getkernops();
+	ret = -1;
+	bounds[0] = bounds[1] = bounds[2] = 0;
+	if (!(bufs = jas_malloc(dec->numcomps * sizeof(int_least16_t *)))) {
+		return -1;
+	}
+	for (compno = 0; compno < dec->numcomps; ++compno) {
+		bufs[compno] = 0;
+	}
+
+	/* Convert the coefficients band by band, so as to find the largest
+	  magnitude at each resolution level. */
+	for (compno = 0, tcomp = tile->tcomps; compno < dec->numcomps;
+	  ++compno, ++tcomp) {
+		numrows = jas_matrix_numrows(tcomp->data);
+		numcols = jas_matrix_numcols(tcomp->data);
+		if (!(buf = bufs[compno] = jas_malloc(JAS_MAX(numrows * numcols, 1) *
+		  sizeof(int_least16_t)))) {
+			goto done;
+		}
+		for (rlvlno = 0, rlvl = tcomp->rlvls; rlvlno < tcomp->numrlvls;
+		  ++rlvlno, ++rlvl) {
+			maxmags[rlvlno] = 0;
+			if (!rlvl->bands) {
+				continue;
+			}
+			for (bandno = 0, band = rlvl->bands; bandno < rlvl->numbands;
+			  ++bandno, ++band) {
+				if (!band->data) {
+					continue;
+				}
+				/* The band data is a submatrix of the tile-component data
+				  (with shifted coordinates), so its position follows from
+				  the offset of its first element. */
+				off = jas_matrix_getref(band->data, 0, 0) -
+				  jas_matrix_getref(tcomp->data, 0, 0);
+				xoff = off % jas_matrix_stride(tcomp->data);
+				yoff = off / jas_matrix_stride(tcomp->data);
+				for (i = 0; i < jas_matrix_numrows(band->data); ++i) {
+					maxmags[rlvlno] = JAS_MAX(maxmags[rlvlno],
+					  (*ops->pack16)(jas_matrix_getref(band->data, i, 0),
+					  &buf[(yoff + i) * numcols + xoff],
+					  jas_matrix_numcols(band->data), 0));
+				}
+			}
+		}
+		if ((bound = jpc_tsfb_synthesize16bound(tcomp->tsfb,
+		  maxmags)) < 0) {
+			ret = 0;
+			goto done;
+		}
+		if (compno < 3) {
+			bounds[compno] = bound;
+		}
+	}
+
+	/* The inverse RCT gives samples of magnitude at most
+	  |y| + (|u| + |v|) / 4 + 1 + max(|u|, |v|). */
+	if (tile->cp->mctid == JPC_MCT_RCT && bounds[0] + (bounds[1] +
+	  bounds[2]) / 4 + 1 + JAS_MAX(bounds[1], bounds[2]) > JPC_QMFB_MAX16) {
+		ret = 0;
+		goto done;
+	}
+
+	cmptloop.dec = dec;
+	cmptloop.tile = tile;
+	cmptloop.bufs = bufs;
+	cmptloop.cancelled = 0;
+	if (jas_thread_parfor(dec->numcomps, 1, jpc_dec_synthesizecmpts16,
+	  &cmptloop)) {
+		goto done;
+	}
+
+	if (tile->cp->mctid == JPC_MCT_RCT) {
+		assert(dec->numcomps == 3);
+		jpc_irct16(bufs[0], bufs[1], bufs[2],
+		  jas_matrix_numrows(tile->tcomps[0].data) *
+		  jas_matrix_numcols(tile->tcomps[0].data));
+	}
+
+	/* Perform level shift and clipping as the samples are converted
+	  back. */
 	for (compno = 0, tcomp = tile->tcomps, cmpt = dec->cmpts; compno <
 	  dec->numcomps; ++compno, ++tcomp, ++cmpt) {
-		jpc_fix_t mn;
-		jpc_fix_t mx;
+		numrows = jas_matrix_numrows(tcomp->data);
+		numcols = jas_matrix_numcols(tcomp->data);
+		adjust = cmpt->sgnd ? 0 : (1 << (cmpt->prec - 1));
 		mn = cmpt->sgnd ? (-(1 << (cmpt->prec - 1))) : (0);
 		mx = cmpt->sgnd ? ((1 << (cmpt->prec - 1)) - 1) : ((1 <<
 		  cmpt->prec) - 1);
-		jas_matrix_clip(tcomp->data, mn, mx);
+		for (i = 0; i < numrows; ++i) {
+			(*ops->unpack16)(&bufs[compno][i * numcols],
+			  jas_matrix_getref(tcomp->data, i, 0), numcols, adjust, mn, mx);
+		}
 	}
+	ret = 1;
 
-	/* XXX need to free tsfb struct */
+done:
+	for (compno = 0; compno < dec->numcomps; ++compno) {
+		if (bufs[compno]) {
+			jas_free(bufs[compno]);
+		}
+	}
+	jas_free(bufs);
+	return ret;
+}
+
+/* Write the data for each component of a decoded tile to the image. */
+static int jpc_dec_tilewrite(jpc_dec_t *dec, jpc_dec_tile_t *tile)
+{
+	jpc_dec_tcomp_t *tcomp;
+	jpc_dec_cmpt_t *cmpt;
+	int compno;
+	int cmptno;
 
-	/* Write the data for each component of the image. */
 	for (compno = 0, tcomp = tile->tcomps, cmpt = dec->cmpts; compno <
 	  dec->numcomps; ++compno, ++tcomp, ++cmpt) {
-		if (jas_image_writecmpt(dec->image, compno, tcomp->xstart -
-		  JPC_CEILDIV(dec->xstart, cmpt->hstep), tcomp->ystart -
-		  JPC_CEILDIV(dec->ystart, cmpt->vstep), jas_matrix_numcols(
-		  tcomp->data), jas_matrix_numrows(tcomp->data), tcomp->data)) {
+		if (!jas_matrix_numrows(tcomp->data) ||
+		  !jas_matrix_numcols(tcomp->data)) {
+			/* A small tile can vanish at a reduced resolution (or be
+			  outside of the decode window). */
+			continue;
+		}
+		/* When tiles are decoded on demand, the components of the image
+		  may have been reordered or deleted in the meantime. */
+		if ((cmptno = dec->lazy ? jas_image_getcmptbyloadno(dec->image,
+		  compno) : compno) < 0) {
+			continue;
+		}
+		if (jas_image_writecmpt(dec->image, cmptno, jas_seq2d_xstart(
+		  tcomp->data) - JPC_CEILDIVPOW2(JPC_CEILDIV(dec->winxstart,
+		  cmpt->hstep), dec->reduce), jas_seq2d_ystart(tcomp->data) -
+		  JPC_CEILDIVPOW2(JPC_CEILDIV(dec->winystart, cmpt->vstep),
+		  dec->reduce), jas_matrix_numcols(tcomp->data),
+		  jas_matrix_numrows(tcomp->data), tcomp->data)) {
 			jas_eprintf("write component failed\n");
 			return -4;
 		}
 	}
 
+	if (jpc_dec_step(dec, tile)) {
+		return -1;
+	}
+	++dec->numdonetiles;
+
 	return 0;
 }
 
@@ -1145,6 +2373,7 @@ static int jpc_dec_process_eoc(jpc_dec_t *dec, jpc_ms_t *ms)
 	  ++tile) {
 		if (tile->state == JPC_TILE_ACTIVE) {
 			if (jpc_dec_tiledecode(dec, tile)) {
+				jpc_dec_tilefini(dec, tile);
 				return -1;
 			}
 		}
@@ -1213,6 +2442,8 @@ static int jpc_dec_process_siz(jpc_dec_t *dec, jpc_ms_t *ms)
 		htileno = tileno % dec->numhtiles;
 		vtileno = tileno / dec->numhtiles;
 		tile->realmode = 0;
+		tile->fltmode = 0;
+		tile->int16mode = 0;
 		tile->state = JPC_TILE_INIT;
 		tile->xstart = JAS_MAX(dec->tilexoff + htileno * dec->tilewidth,
 		  dec->xstart);
@@ -1224,16 +2455,19 @@ static int jpc_dec_process_siz(jpc_dec_t *dec, jpc_ms_t *ms)
 		  dec->tileheight, dec->yend);
 		tile->numparts = 0;
 		tile->partno = 0;
+		tile->tpindexno = -1;
 		tile->pkthdrstream = 0;
 		tile->pkthdrstreampos = 0;
 		tile->pptstab = 0;
 		tile->cp = 0;
+		tile->pi = 0;
 		if (!(tile->tcomps = jas_malloc(dec->numcomps *
 		  sizeof(jpc_dec_tcomp_t)))) {
 			return -1;
 		}
 		for (compno = 0, cmpt = dec->cmpts, tcomp = tile->tcomps;
 		  compno < dec->numcomps; ++compno, ++cmpt, ++tcomp) {
+			tcomp->numrlvls = 0;
 			tcomp->rlvls = 0;
 			tcomp->data = 0;
 			tcomp->xstart = JPC_CEILDIV(tile->xstart, cmpt->hstep);
@@ -1756,16 +2990,43 @@ static int jpc_dec_cp_setfrompoc(jpc_dec_cp_t *cp, jpc_poc_t *poc, int reset)
 
 static jpc_fix_t jpc_calcabsstepsize(int stepsize, int numbits)
 {
-	jpc_fix_t absstepsize;
+	int_fast64_t absstepsize;
 	int n;
 
 	absstepsize = jpc_inttofix(1);
 	n = JPC_FIX_FRACBITS - 11;
 	absstepsize |= (n >= 0) ? (JPC_QCX_GETMANT(stepsize) << n) :
 	  (JPC_QCX_GETMANT(stepsize) >> (-n));
+	/* The step size of a band of a high-precision component (e.g., in a
+	  16-bit reversible code stream, for which it is not used) need not fit
+	  in a jpc_fix_t, so it is computed in 64 bits and clamped. */
 	n = numbits - JPC_QCX_GETEXPN(stepsize);
-	absstepsize = (n >= 0) ? (absstepsize << n) : (absstepsize >> (-n));
-	return absstepsize;
+	if (n >= 0) {
+		absstepsize = (n < 32) ? (absstepsize << n) : INT_LEAST32_MAX;
+	} else {
+		absstepsize = (-n < 32) ? (absstepsize >> (-n)) : 0;
+	}
+	return JAS_MIN(absstepsize, INT_LEAST32_MAX);
+}
+
+/* Compute the step size exactly, rather than in fixed point. */
+static float jpc_calcabsstepsizeflt(int stepsize, int numbits)
+{
+	return (float) ldexp(1.0 + JPC_QCX_GETMANT(stepsize) / 2048.0,
+	  numbits - JPC_QCX_GETEXPN(stepsize));
+}
+
+/* Dequantize the (integer) samples to floating-point values. */
+static void jpc_dequantize_flt(jas_matrix_t *x, float absstepsize)
+{
+	int i;
+	const jpc_qmfb_kernops_t *ops;
+
+	ops = jpc_qmfb_getkernops();
+	for (i = 0; i < jas_matrix_numrows(x); ++i) {
+		(*ops->inttoflt)(jas_matrix_getref(x, i, 0),
+		  jas_matrix_numcols(x), absstepsize);
+	}
 }
 
 static void jpc_dequantize(jas_matrix_t *x, jpc_fix_t absstepsize)
@@ -1840,7 +3101,8 @@ static void jpc_undo_roi(jas_matrix_t *x, int roishift, int bgshift, int numbps)
 	}
 }
 
-static jpc_dec_t *jpc_dec_create(jpc_dec_importopts_t *impopts, jas_stream_t *in)
+static jpc_dec_t *jpc_dec_create(jpc_dec_importopts_t *impopts, jas_stream_t *in,
+  jpc_dec_ctx_t *ctx, jas_progress_t *progress)
 {
 	jpc_dec_t *dec;
 
@@ -1867,6 +3129,11 @@ static jpc_dec_t *jpc_dec_create(jpc_dec_importopts_t *impopts, jas_stream_t *in
 	dec->cp = 0;
 	dec->maxlyrs = impopts->maxlyrs;
 	dec->maxpkts = impopts->maxpkts;
+	dec->reduce = impopts->reduce;
+	dec->winxstart = impopts->winxstart;
+	dec->winystart = impopts->winystart;
+	dec->winxend = impopts->winxend;
+	dec->winyend = impopts->winyend;
 dec->numpkts = 0;
 	dec->ppmseqno = 0;
 	dec->state = 0;
@@ -1874,12 +3141,26 @@ dec->numpkts = 0;
 	dec->pkthdrstreams = 0;
 	dec->ppmstab = 0;
 	dec->curtileendoff = 0;
+	dec->ctx = ctx;
+	dec->progress = progress;
+	dec->numwintiles = 0;
+	dec->numdonetiles = 0;
+	dec->cstate = 0;
+	dec->lazy = impopts->lazy;
+	dec->fltmode = impopts->fltmode;
+	dec->lowmem = impopts->lowmem;
+	dec->tpindex = 0;
+	dec->numtpindexents = 0;
+	dec->maxtpindexents = 0;
 
 	return dec;
 }
 
 static void jpc_dec_destroy(jpc_dec_t *dec)
 {
+	jpc_dec_tile_t *tile;
+	int tileno;
+
 	if (dec->cstate) {
 		jpc_cstate_destroy(dec->cstate);
 	}
@@ -1899,12 +3180,92 @@ static void jpc_dec_destroy(jpc_dec_t *dec)
 	}
 
 	if (dec->tiles) {
+		/* Release the tiles that were never reached, for example because
+		  decoding was aborted. */
+		for (tileno = 0, tile = dec->tiles; tileno < dec->numtiles; ++tileno,
+		  ++tile) {
+			if (tile->state == JPC_TILE_INIT) {
+				jpc_dec_tilefini(dec, tile);
+			}
+		}
 		jas_free(dec->tiles);
 	}
 
+	if (dec->tpindex) {
+		jas_free(dec->tpindex);
+	}
+
 	jas_free(dec);
 }
 
+/******************************************************************************\
+* Code for decoder contexts.
+\******************************************************************************/
+
+jpc_dec_ctx_t *jpc_dec_ctx_create()
+{
+	jpc_dec_ctx_t *ctx;
+
+	if (!(ctx = jas_malloc(sizeof(jpc_dec_ctx_t)))) {
+		return 0;
+	}
+	ctx->flags = 0;
+	ctx->mqdec = 0;
+
+	/* Ensure that the lookup tables are ready before they are needed. */
+	jpc_initluts();
+
+	return ctx;
+}
+
+void jpc_dec_ctx_destroy(jpc_dec_ctx_t *ctx)
+{
+	if (ctx->flags) {
+		jas_matrix_destroy(ctx->flags);
+	}
+	if (ctx->mqdec) {
+		jpc_mqdec_destroy(ctx->mqdec);
+	}
+	jas_free(ctx);
+}
+
+jas_matrix_t *jpc_dec_ctx_getflags(jpc_dec_ctx_t *ctx, int numrows,
+  int numcols)
+{
+	int maxrows;
+	int maxcols;
+
+	if (ctx->flags && !jas_matrix_resize(ctx->flags, numrows, numcols)) {
+		jas_matrix_setall(ctx->flags, 0);
+		return ctx->flags;
+	}
+
+	/* Only ever grow the matrix, so that it quickly reaches the size of
+	  the largest code block. */
+	maxrows = numrows;
+	maxcols = numcols;
+	if (ctx->flags) {
+		maxrows = JAS_MAX(maxrows, ctx->flags->maxrows_);
+		maxcols = JAS_MAX(maxcols, ctx->flags->datasize_ /
+		  ctx->flags->maxrows_);
+		jas_matrix_destroy(ctx->flags);
+	}
+	/* Note: a new matrix is already zeroed */
+	if (!(ctx->flags = jas_matrix_create(maxrows, maxcols))) {
+		return 0;
+	}
+	jas_matrix_resize(ctx->flags, numrows, numcols);
+	return ctx->flags;
+}
+
+jpc_mqdec_t *jpc_dec_ctx_getmqdec(jpc_dec_ctx_t *ctx)
+{
+	if (!ctx->mqdec) {
+		ctx->mqdec = jpc_mqdec_create(JPC_NUMCTXS, 0);
+	}
+	return ctx->mqdec;
+}
+
 /******************************************************************************\
 *
 \******************************************************************************/
@@ -2025,9 +3386,9 @@ fprintf(out, "xs =%d, ys = %d, xe = %d, ye = %d, w = %d, h = %d\n",
 						  ++cblk) {
 fprintf(out, "CODE BLOCK %d\n", cblkno);
 fprintf(out, "xs =%d, ys = %d, xe = %d, ye = %d, w = %d, h = %d\n",
-  jas_seq2d_xstart(cblk->data), jas_seq2d_ystart(cblk->data), jas_seq2d_xend(cblk->data),
-  jas_seq2d_yend(cblk->data), jas_seq2d_xend(cblk->data) - jas_seq2d_xstart(cblk->data),
-  jas_seq2d_yend(cblk->data) - jas_seq2d_ystart(cblk->data));
+  (int) cblk->xstart, (int) cblk->ystart, (int) cblk->xend,
+  (int) cblk->yend, (int) (cblk->xend - cblk->xstart),
+  (int) (cblk->yend - cblk->ystart));
 						}
 					}
 				}
@@ -306,6 +306,20 @@ typedef struct {
 	/* The sample data associated with this code block. */
 	jas_matrix_t *data;
 
+	/* The x-coordinate of the top-left corner of the code block. */
+	uint_fast32_t xstart;
+
+	/* The y-coordinate of the top-left corner of the code block. */
+	uint_fast32_t ystart;
+
+	/* The x-coordinate of the bottom-right corner of the code block
+	  (plus one). */
+	uint_fast32_t xend;
+
+	/* The y-coordinate of the bottom-right corner of the code block
+	  (plus one). */
+	uint_fast32_t yend;
+
 } jpc_dec_cblk_t;
 
 /* Decoder per-code-block-group state information. */
@@ -367,6 +381,9 @@ typedef struct {
 	/* The absolute quantizer step size. */
 	jpc_fix_t absstepsize;
 
+	/* The absolute quantizer step size (for floating-point arithmetic). */
+	float absstepsizeflt;
+
 	/* The number of bit planes for this band. */
 	int numbps;
 
@@ -376,6 +393,18 @@ typedef struct {
 	/* The ROI shift value for this band. */
 	int roishift;
 
+	/* The part of this band that is needed to reconstruct the decode
+	  window (in the same coordinate system as the band data). */
+	uint_fast32_t winxstart;
+	uint_fast32_t winystart;
+	uint_fast32_t winxend;
+	uint_fast32_t winyend;
+
+	/* The rows of the band that are in the band data (when the tile is
+	  decoded a row at a time). */
+	uint_fast32_t stripeystart;
+	uint_fast32_t stripeyend;
+
 } jpc_dec_band_t;
 
 /* Decoder per-resolution-level state information. */
@@ -471,6 +500,13 @@ typedef struct {
 	/* The TSFB. */
 	jpc_tsfb_t *tsfb;
 
+	/* The part of the tile-component that is in the decode window
+	  (at the resolution being decoded). */
+	uint_fast32_t winxstart;
+	uint_fast32_t winystart;
+	uint_fast32_t winxend;
+	uint_fast32_t winyend;
+
 } jpc_dec_tcomp_t;
 
 /*
@@ -529,11 +565,47 @@ typedef struct {
 	/* The coding mode. */
 	int realmode;
 
+	/* Is the (real-mode) tile decoded with floating-point arithmetic? */
+	int fltmode;
+
+	/* Is the (integer-mode) tile decoded with 16-bit samples where
+	  possible? */
+	int int16mode;
+
+	/* Is the tile decoded a row at a time (so that only a stripe of each
+	  band and a few rows of each level of the transform are held)? */
+	int linemode;
+
 	/* The packet iterator for this tile. */
 	jpc_pi_t *pi;
 
+	/* The number of steps in decoding this tile, and the number of them
+	  started so far (for reporting progress). */
+	int numsteps;
+	int stepno;
+
+	/* The first entry in the tile-part index for this tile (or -1). */
+	int tpindexno;
+
 } jpc_dec_tile_t;
 
+/* The location of a tile-part in the code stream (for decoding tiles on
+  demand). */
+
+typedef struct {
+
+	/* The position of the SOT marker segment in the input stream. */
+	long pos;
+
+	/* The value of the read/write count of the input stream at the SOT
+	  marker segment. */
+	long rwcount;
+
+	/* The next entry for the same tile (or -1). */
+	int next;
+
+} jpc_dec_tpindexent_t;
+
 /* Decoder per-component state information. */
 
 typedef struct {
@@ -564,6 +636,18 @@ typedef struct {
 
 } jpc_dec_cmpt_t;
 
+/* Decoder context. */
+
+struct jpc_dec_ctx_s {
+
+	/* The significance state matrix shared by all code blocks. */
+	jas_matrix_t *flags;
+
+	/* The MQ decoder shared by all code blocks. */
+	jpc_mqdec_t *mqdec;
+
+};
+
 /* Decoder state information. */
 
 typedef struct {
@@ -633,6 +717,15 @@ typedef struct {
 	/* The maximum number of packets that may be decoded. */
 	int maxpkts;
 
+	/* The number of (highest) resolution levels to discard. */
+	int reduce;
+
+	/* The window of the reference grid to decode. */
+	uint_fast32_t winxstart;
+	uint_fast32_t winystart;
+	uint_fast32_t winxend;
+	uint_fast32_t winyend;
+
 	/* The number of packets decoded so far in the processing of the entire
 	  code stream. */
 	int numpkts;
@@ -659,6 +752,33 @@ typedef struct {
 	/* This is required by the tier-2 decoder. */
 	jpc_cstate_t *cstate;
 
+	/* The context providing reusable scratch storage (or null). */
+	jpc_dec_ctx_t *ctx;
+
+	/* The progress callback (or null). */
+	jas_progress_t *progress;
+
+	/* The number of tiles that intersect the decode window. */
+	int numwintiles;
+
+	/* The number of tiles decoded so far. */
+	int numdonetiles;
+
+	/* Are tiles decoded only when their samples are first needed? */
+	int lazy;
+
+	/* Should floating-point arithmetic be used for the 9/7 transform? */
+	int fltmode;
+
+	/* Should every tile be decoded a row at a time? */
+	int lowmem;
+
+	/* The index of the tile-parts in the code stream (when decoding tiles
+	  on demand). */
+	jpc_dec_tpindexent_t *tpindex;
+	int numtpindexents;
+	int maxtpindexents;
+
 } jpc_dec_t;
 
 /* Decoder options. */
@@ -674,6 +794,24 @@ typedef struct {
 	/* The maximum number of packets to decode. */
 	int maxpkts;
 
+	/* The number of (highest) resolution levels to discard. */
+	int reduce;
+
+	/* The window of the reference grid to decode. */
+	uint_fast32_t winxstart;
+	uint_fast32_t winystart;
+	uint_fast32_t winxend;
+	uint_fast32_t winyend;
+
+	/* Should tiles be decoded only when their samples are first needed? */
+	int lazy;
+
+	/* Should floating-point arithmetic be used for the 9/7 transform? */
+	int fltmode;
+
+	/* Should every tile be decoded a row at a time? */
+	int lowmem;
+
 } jpc_dec_importopts_t;
 
 /******************************************************************************\
@@ -693,4 +831,20 @@ void jpc_seglist_remove(jpc_dec_seglist_t *list, jpc_dec_seg_t *node);
 void jpc_seglist_insert(jpc_dec_seglist_t *list, jpc_dec_seg_t *ins,
   jpc_dec_seg_t *node);
 
+/* Skip the remainder of the data for the current tile-part. */
+int jpc_dec_skiptiledata(jpc_dec_t *dec);
+
+/* Report the progress of decoding at the start of the next step in
+  decoding a tile (or once the tile is done).  A nonzero value is returned
+  if decoding should be aborted. */
+int jpc_dec_step(jpc_dec_t *dec, jpc_dec_tile_t *tile);
+
+/* Get the zeroed significance state matrix of a decoder context, resized
+  to the specified dimensions. */
+jas_matrix_t *jpc_dec_ctx_getflags(jpc_dec_ctx_t *ctx, int numrows,
+  int numcols);
+
+/* Get the MQ decoder of a decoder context. */
+jpc_mqdec_t *jpc_dec_ctx_getmqdec(jpc_dec_ctx_t *ctx);
+
 #endif
@@ -84,6 +84,7 @@
 #include "jasper/jas_version.h"
 #include "jasper/jas_math.h"
 #include "jasper/jas_debug.h"
+#include "jasper/jas_thread.h"
 
 #include "jpc_flt.h"
 #include "jpc_fix.h"
@@ -119,6 +120,41 @@
 #define	JPC_POW2(n)	\
   (1 << (n))
 
+/* The number of bytes of coefficients in a tile above which the tile is
+  coded a row at a time. */
+#define	JPC_ENC_LINETHRESH	(64 * 1024 * 1024)
+
+/* The components of a tile to be analyzed (see jpc_enc_analyzecmpts16). */
+typedef struct {
+
+	jpc_enc_tile_t *tile;
+
+	/* The 16-bit samples of the components. */
+	int_least16_t **bufs;
+
+} jpc_enc_cmptloop_t;
+
+/* A component of a tile that is coded a row at a time (see
+  jpc_enc_tileencodelines). */
+typedef struct {
+
+	/* The encoder. */
+	jpc_enc_t *enc;
+
+	/* The tile-component. */
+	jpc_enc_tcmpt_t *tcmpt;
+
+	/* The state of the analysis of the tile-component (if any). */
+	jpc_tsfb_lines_t *lines;
+
+	/* The current row of the tile-component. */
+	jas_matrix_t *data;
+
+	/* A window into the band data. */
+	jas_matrix_t *win;
+
+} jpc_enc_cmptlines_t;
+
 jpc_enc_tile_t *jpc_enc_tile_create(jpc_enc_cp_t *cp, jas_image_t *image, int tileno);
 void jpc_enc_tile_destroy(jpc_enc_tile_t *tile);
 
@@ -151,6 +187,15 @@ void dump_layeringinfo(jpc_enc_t *enc);
 static int jpc_calcssexp(jpc_fix_t stepsize);
 static int jpc_calcssmant(jpc_fix_t stepsize);
 void jpc_quantize(jas_matrix_t *data, jpc_fix_t stepsize);
+static void jpc_quantize_flt(jas_matrix_t *data, jpc_fix_t stepsize);
+static jpc_fix_t jpc_mxmag_flt(jas_matrix_t *data);
+static jpc_fix_t jpc_mxmag(jas_matrix_t *data);
+static void jpc_enc_tileanalyze(jpc_enc_t *enc, jpc_enc_tile_t *tile);
+static int jpc_enc_tileanalyze16(jpc_enc_t *enc, jpc_enc_tile_t *tile);
+static int jpc_enc_analyzecmpts(void *arg, int start, int end);
+static int jpc_enc_analyzecmpts16(void *arg, int start, int end);
+static int jpc_enc_tileencodelines(jpc_enc_t *enc, jpc_enc_tile_t *tile);
+static int jpc_enc_putbandrow(void *arg, int bandno, int y, jpc_fix_t *buf);
 static int jpc_enc_encodemainhdr(jpc_enc_t *enc);
 static int jpc_enc_encodemainbody(jpc_enc_t *enc);
 int jpc_enc_encodetiledata(jpc_enc_t *enc);
@@ -213,6 +258,8 @@ typedef enum {
 	OPT_NUMGBITS,
 	OPT_RATE,
 	OPT_ILYRRATES,
+	OPT_FLOAT,
+	OPT_LOWMEM,
 	OPT_JP2OVERHEAD
 } optid_t;
 
@@ -243,6 +290,8 @@ jas_taginfo_t encopts[] = {
 	{OPT_NUMGBITS, "numgbits"},
 	{OPT_RATE, "rate"},
 	{OPT_ILYRRATES, "ilyrrates"},
+	{OPT_FLOAT, "float"},
+	{OPT_LOWMEM, "lowmem"},
 	{OPT_JP2OVERHEAD, "_jp2overhead"},
 	{-1, 0}
 };
@@ -278,6 +327,12 @@ jas_taginfo_t modetab[] = {
 \******************************************************************************/
 
 int jpc_encode(jas_image_t *image, jas_stream_t *out, char *optstr)
+{
+	return jpc_encode2(image, out, optstr, 0);
+}
+
+int jpc_encode2(jas_image_t *image, jas_stream_t *out, char *optstr,
+  jas_progress_t *progress)
 {
 	jpc_enc_t *enc;
 	jpc_enc_cp_t *cp;
@@ -296,6 +351,7 @@ int jpc_encode(jas_image_t *image, jas_stream_t *out, char *optstr)
 		goto error;
 	}
 	cp = 0;
+	enc->progress = progress;
 
 	/* Encode the main header. */
 	if (jpc_enc_encodemainhdr(enc)) {
@@ -425,6 +481,8 @@ static jpc_enc_cp_t *cp_create(char *optstr, jas_image_t *image)
 	tcp = &cp->tcp;
 	tcp->csty = 0;
 	tcp->intmode = true;
+	tcp->fltmode = false;
+	tcp->lowmem = false;
 	tcp->prg = JPC_COD_LRCPPRG;
 	tcp->numlyrs = 1;
 	tcp->ilyrrates = 0;
@@ -544,6 +602,12 @@ static jpc_enc_cp_t *cp_create(char *optstr, jas_image_t *image)
 				  jas_tvparser_getval(tvp));
 			}
 			break;
+		case OPT_FLOAT:
+			tcp->fltmode = true;
+			break;
+		case OPT_LOWMEM:
+			tcp->lowmem = true;
+			break;
 
 		case OPT_JP2OVERHEAD:
 			jp2overhead = atoi(jas_tvparser_getval(tvp));
@@ -821,6 +885,7 @@ jpc_enc_t *jpc_enc_create(jpc_enc_cp_t *cp, jas_stream_t *out, jas_image_t *imag
 	enc->tmpstream = 0;
 	enc->mrk = 0;
 	enc->curtile = 0;
+	enc->progress = 0;
 
 	if (!(enc->cstate = jpc_cstate_create())) {
 		goto error;
@@ -1109,8 +1174,6 @@ static int jpc_enc_encodemainbody(jpc_enc_t *enc)
 	int rlvlno;
 	jpc_qcc_t *qcc;
 	jpc_cod_t *cod;
-	int adjust;
-	int j;
 	int absbandno;
 	long numbytes;
 	long tilehdrlen;
@@ -1124,13 +1187,11 @@ static int jpc_enc_encodemainbody(jpc_enc_t *enc)
 	jpc_enc_ccp_t *ccps;
 	jpc_enc_tccp_t *tccp;
 int bandno;
-uint_fast32_t x;
-uint_fast32_t y;
 int mingbits;
 int actualnumbps;
-jpc_fix_t mxmag;
-jpc_fix_t mag;
 int numgbits;
+int numrows;
+int ret;
 
 	cp = enc->cp;
 
@@ -1147,48 +1208,38 @@ int numgbits;
 
 		tile = enc->curtile;
 
-		if (jas_getdbglevel() >= 10) {
-			jpc_enc_dump(enc);
-		}
-
-		endcomps = &tile->tcmpts[tile->numtcmpts];
-		for (cmptno = 0, comp = tile->tcmpts; cmptno < tile->numtcmpts; ++cmptno, ++comp) {
-			if (!cp->ccps[cmptno].sgnd) {
-				adjust = 1 << (cp->ccps[cmptno].prec - 1);
-				for (i = 0; i < jas_matrix_numrows(comp->data); ++i) {
-					for (j = 0; j < jas_matrix_numcols(comp->data); ++j) {
-						*jas_matrix_getref(comp->data, i, j) -= adjust;
-					}
-				}
+		/* Progress is reported as each resolution level of each component
+		  (or, in line mode, each row of the tile) is coded and as each layer
+		  is formed. */
+		tile->numsteps = tile->numlyrs;
+		tile->stepno = 0;
+		numrows = 0;
+		for (cmptno = 0, comp = tile->tcmpts; cmptno < tile->numtcmpts;
+		  ++cmptno, ++comp) {
+			if (!tile->linemode) {
+				tile->numsteps += comp->numrlvls;
+			} else if (JAS_CAST(int, comp->bry - comp->tly) > numrows) {
+				numrows = comp->bry - comp->tly;
 			}
 		}
-
-		if (!tile->intmode) {
-				endcomps = &tile->tcmpts[tile->numtcmpts];
-				for (comp = tile->tcmpts; comp != endcomps; ++comp) {
-					jas_matrix_asl(comp->data, JPC_FIX_FRACBITS);
-				}
+		if (tile->linemode) {
+			tile->numsteps += numrows;
 		}
 
-		switch (tile->mctid) {
-		case JPC_MCT_RCT:
-assert(jas_image_numcmpts(enc->image) == 3);
-			jpc_rct(tile->tcmpts[0].data, tile->tcmpts[1].data,
-			  tile->tcmpts[2].data);
-			break;
-		case JPC_MCT_ICT:
-assert(jas_image_numcmpts(enc->image) == 3);
-			jpc_ict(tile->tcmpts[0].data, tile->tcmpts[1].data,
-			  tile->tcmpts[2].data);
-			break;
-		default:
-			break;
+		if (jas_getdbglevel() >= 10) {
+			jpc_enc_dump(enc);
 		}
 
-		for (i = 0; i < jas_image_numcmpts(enc->image); ++i) {
-			comp = &tile->tcmpts[i];
-			jpc_tsfb_analyze(comp->tsfb, comp->data);
-
+		/* In 16-bit mode, the samples are level shifted as they are
+		  converted to 16 bits.  In line mode, analysis is done as the
+		  tile is coded (below). */
+		if (tile->linemode) {
+			/* Nothing to do here. */
+		} else if (!tile->int16mode ||
+		  !(ret = jpc_enc_tileanalyze16(enc, tile))) {
+			jpc_enc_tileanalyze(enc, tile);
+		} else if (ret < 0) {
+			return -1;
 		}
 
 
@@ -1212,29 +1263,6 @@ assert(jas_image_numcmpts(enc->image) == 3);
 						++absbandno;
 						continue;
 					}
-					actualnumbps = 0;
-					mxmag = 0;
-					for (y = 0; y < JAS_CAST(uint_fast32_t, jas_matrix_numrows(band->data)); ++y) {
-						for (x = 0; x < JAS_CAST(uint_fast32_t, jas_matrix_numcols(band->data)); ++x) {
-							mag = abs(jas_matrix_get(band->data, y, x));
-							if (mag > mxmag) {
-								mxmag = mag;
-							}
-						}
-					}
-					if (tile->intmode) {
-						actualnumbps = jpc_firstone(mxmag) + 1;
-					} else {
-						actualnumbps = jpc_firstone(mxmag) + 1 - JPC_FIX_FRACBITS;
-					}
-					numgbits = actualnumbps - (cp->ccps[cmptno].prec - 1 +
-					  band->analgain);
-#if 0
-jas_eprintf("%d %d mag=%d actual=%d numgbits=%d\n", cp->ccps[cmptno].prec, band->analgain, mxmag, actualnumbps, numgbits);
-#endif
-					if (numgbits > mingbits) {
-						mingbits = numgbits;
-					}
 					if (!tile->intmode) {
 						band->absstepsize = jpc_fix_div(jpc_inttofix(1
 						  << (band->analgain + 1)),
@@ -1248,8 +1276,20 @@ jas_eprintf("%d %d mag=%d actual=%d numgbits=%d\n", cp->ccps[cmptno].prec, band-
 					band->numbps = cp->tccp.numgbits +
 					  JPC_QCX_GETEXPN(band->stepsize) - 1;
 
-					if ((!tile->intmode) && band->data) {
-						jpc_quantize(band->data, band->absstepsize);
+					/* In line mode, each stripe of the band is quantized
+					  as it is coded (see jpc_enc_putbandrow). */
+					if (tile->linemode) {
+						/* Nothing to do here. */
+					} else if (tile->fltmode) {
+						band->mxmag = jpc_mxmag_flt(band->data);
+						/* This also leaves JPC_NUMEXTRABITS fractional
+						  bits. */
+						jpc_quantize_flt(band->data, band->absstepsize);
+					} else {
+						band->mxmag = jpc_mxmag(band->data);
+						if (!tile->intmode) {
+							jpc_quantize(band->data, band->absstepsize);
+						}
 					}
 
 					comp->stepsizes[absbandno] = band->stepsize;
@@ -1258,11 +1298,48 @@ jas_eprintf("%d %d mag=%d actual=%d numgbits=%d\n", cp->ccps[cmptno].prec, band-
 			}
 
 			assert(JPC_FIX_FRACBITS >= JPC_NUMEXTRABITS);
-			if (!tile->intmode) {
+			if (tile->fltmode || tile->linemode) {
+				/* The samples were quantized to this precision above (or
+				  are quantized as they are coded). */
+			} else if (!tile->intmode) {
 				jas_matrix_divpow2(comp->data, JPC_FIX_FRACBITS - JPC_NUMEXTRABITS);
 			} else {
 				jas_matrix_asl(comp->data, JPC_NUMEXTRABITS);
 			}
+		}
+
+		/* In line mode, the tile is transformed, quantized, and coded a row
+		  at a time, which gives the largest magnitudes of the bands. */
+		if (tile->linemode && jpc_enc_tileencodelines(enc, tile)) {
+			return -1;
+		}
+
+		for (cmptno = 0, comp = tile->tcmpts; comp != endcomps; ++cmptno, ++comp) {
+			mingbits = 0;
+			for (rlvlno = 0, lvl = comp->rlvls; rlvlno < comp->numrlvls; ++rlvlno, ++lvl) {
+				if (!lvl->bands) {
+					continue;
+				}
+				endbands = &lvl->bands[lvl->numbands];
+				for (band = lvl->bands; band != endbands; ++band) {
+					if (!band->data) {
+						continue;
+					}
+					if (tile->intmode) {
+						actualnumbps = jpc_firstone(band->mxmag) + 1;
+					} else {
+						actualnumbps = jpc_firstone(band->mxmag) + 1 - JPC_FIX_FRACBITS;
+					}
+					numgbits = actualnumbps - (cp->ccps[cmptno].prec - 1 +
+					  band->analgain);
+#if 0
+jas_eprintf("%d %d mag=%d actual=%d numgbits=%d\n", cp->ccps[cmptno].prec, band->analgain, band->mxmag, actualnumbps, numgbits);
+#endif
+					if (numgbits > mingbits) {
+						mingbits = numgbits;
+					}
+				}
+			}
 
 #if 0
 jas_eprintf("mingbits %d\n", mingbits);
@@ -1274,7 +1351,7 @@ jas_eprintf("mingbits %d\n", mingbits);
 			}
 		}
 
-		if (!(enc->tmpstream = jas_stream_memopen(0, 0))) {
+		if (!(enc->tmpstream = jas_stream_chunkopen(0))) {
 			jas_eprintf("cannot open tmp file\n");
 			return -1;
 		}
@@ -1380,8 +1457,7 @@ tilehdrlen = jas_stream_getrwcount(enc->tmpstream);
 /************************************************************************/
 /************************************************************************/
 
-if (jpc_enc_enccblks(enc)) {
-	abort();
+if (!tile->linemode && jpc_enc_enccblks(enc)) {
 	return -1;
 }
 
@@ -1445,6 +1521,10 @@ jas_eprintf("ENCODE TILE DATA\n");
 		jas_stream_close(enc->tmpstream);
 		enc->tmpstream = 0;
 
+		if (jpc_enc_step(enc)) {
+			return -1;
+		}
+
 		jpc_enc_tile_destroy(enc->curtile);
 		enc->curtile = 0;
 
@@ -1453,6 +1533,25 @@ jas_eprintf("ENCODE TILE DATA\n");
 	return 0;
 }
 
+int jpc_enc_step(jpc_enc_t *enc)
+{
+	jpc_enc_tile_t *tile;
+	double done;
+
+	if (!enc->progress) {
+		return 0;
+	}
+	tile = enc->curtile;
+	done = (tile->tileno + JAS_CAST(double, tile->stepno) /
+	  tile->numsteps) / enc->cp->numtiles;
+	++tile->stepno;
+	if ((*enc->progress->func)(enc->progress->arg, JAS_MIN(done, 1.0))) {
+		jas_eprintf("encoding aborted\n");
+		return -1;
+	}
+	return 0;
+}
+
 int jpc_enc_encodetiledata(jpc_enc_t *enc)
 {
 assert(enc->tmpstream);
@@ -1510,6 +1609,466 @@ void jpc_quantize(jas_matrix_t *data, jpc_fix_t stepsize)
 	}
 }
 
+/* Quantize floating-point samples, leaving JPC_NUMEXTRABITS fractional
+  bits in the integer result. */
+static void jpc_quantize_flt(jas_matrix_t *data, jpc_fix_t stepsize)
+{
+	int i;
+	float scale;
+	const jpc_qmfb_kernops_t *ops;
+
+	ops = jpc_qmfb_getkernops();
+	scale = (float) ((1 << JPC_NUMEXTRABITS) / jpc_fixtodbl(stepsize));
+	for (i = 0; i < jas_matrix_numrows(data); ++i) {
+		(*ops->quantflt)(jas_matrix_getref(data, i, 0),
+		  jas_matrix_numcols(data), scale);
+	}
+}
+
+/* Get the largest magnitude of the floating-point samples (as a fixed-point
+  value). */
+static jpc_fix_t jpc_mxmag_flt(jas_matrix_t *data)
+{
+	int i;
+	int j;
+	float *p;
+	float mag;
+	float mxmag;
+
+	mxmag = 0;
+	for (i = 0; i < jas_matrix_numrows(data); ++i) {
+		p = (float *) jas_matrix_getref(data, i, 0);
+		for (j = 0; j < jas_matrix_numcols(data); ++j) {
+			mag = JAS_ABS(p[j]);
+			if (mag > mxmag) {
+				mxmag = mag;
+			}
+		}
+	}
+	return jpc_dbltofix(mxmag);
+}
+
+/* Get the largest magnitude of the samples. */
+static jpc_fix_t jpc_mxmag(jas_matrix_t *data)
+{
+	int i;
+	int j;
+	jpc_fix_t mag;
+	jpc_fix_t mxmag;
+
+	mxmag = 0;
+	for (i = 0; i < jas_matrix_numrows(data); ++i) {
+		for (j = 0; j < jas_matrix_numcols(data); ++j) {
+			mag = abs(jas_matrix_get(data, i, j));
+			if (mag > mxmag) {
+				mxmag = mag;
+			}
+		}
+	}
+	return mxmag;
+}
+
+/* Level shift the samples of a tile, apply the multicomponent transform (if
+  any), and perform analysis. */
+static void jpc_enc_tileanalyze(jpc_enc_t *enc, jpc_enc_tile_t *tile)
+{
+	jpc_enc_cp_t *cp;
+	jpc_enc_tcmpt_t *comp;
+	jpc_enc_tcmpt_t *endcomps;
+	int cmptno;
+	int adjust;
+	int i;
+	int j;
+	const jpc_qmfb_kernops_t *ops;
+
+	cp = enc->cp;
+
+	for (cmptno = 0, comp = tile->tcmpts; cmptno < tile->numtcmpts;
+	  ++cmptno, ++comp) {
+		/* Samples read from an image source are already level shifted. */
+		if (!cp->ccps[cmptno].sgnd && !jas_image_hassrc(enc->image)) {
+			adjust = 1 << (cp->ccps[cmptno].prec - 1);
+			for (i = 0; i < jas_matrix_numrows(comp->data); ++i) {
+				for (j = 0; j < jas_matrix_numcols(comp->data); ++j) {
+					*jas_matrix_getref(comp->data, i, j) -= adjust;
+				}
+			}
+		}
+	}
+
+	if (tile->fltmode) {
+		/* Convert the samples to floating point. */
+		ops = jpc_qmfb_getkernops();
+		endcomps = &tile->tcmpts[tile->numtcmpts];
+		for (comp = tile->tcmpts; comp != endcomps; ++comp) {
+			for (i = 0; i < jas_matrix_numrows(comp->data); ++i) {
+				(*ops->inttoflt)(jas_matrix_getref(comp->data, i, 0),
+				  jas_matrix_numcols(comp->data), 1.0f);
+			}
+		}
+	} else if (!tile->intmode) {
+		endcomps = &tile->tcmpts[tile->numtcmpts];
+		for (comp = tile->tcmpts; comp != endcomps; ++comp) {
+			jas_matrix_asl(comp->data, JPC_FIX_FRACBITS);
+		}
+	}
+
+	switch (tile->mctid) {
+	case JPC_MCT_RCT:
+		assert(jas_image_numcmpts(enc->image) == 3);
+		jpc_rct(tile->tcmpts[0].data, tile->tcmpts[1].data,
+		  tile->tcmpts[2].data);
+		break;
+	case JPC_MCT_ICT:
+		assert(jas_image_numcmpts(enc->image) == 3);
+		if (tile->fltmode) {
+			jpc_ict_flt(tile->tcmpts[0].data, tile->tcmpts[1].data,
+			  tile->tcmpts[2].data);
+		} else {
+			jpc_ict(tile->tcmpts[0].data, tile->tcmpts[1].data,
+			  tile->tcmpts[2].data);
+		}
+		break;
+	default:
+		break;
+	}
+
+	/* The components are independent of each other, so they are analyzed
+	  concurrently. */
+	jas_thread_parfor(tile->numtcmpts, 1, jpc_enc_analyzecmpts, tile);
+}
+
+/* Perform analysis of the components start to end - 1 of a tile. */
+static int jpc_enc_analyzecmpts(void *arg, int start, int end)
+{
+	jpc_enc_tile_t *tile = arg;
+	jpc_enc_tcmpt_t *comp;
+
+	for (; start < end; ++start) {
+		comp = &tile->tcmpts[start];
+		jpc_tsfb_analyze(comp->tsfb, comp->data);
+	}
+	return 0;
+}
+
+/* Perform analysis of the 16-bit samples of the components start to
+  end - 1 of a tile. */
+static int jpc_enc_analyzecmpts16(void *arg, int start, int end)
+{
+	jpc_enc_cmptloop_t *cmptloop = arg;
+	jpc_enc_tcmpt_t *comp;
+	int numcols;
+
+	for (; start < end; ++start) {
+		comp = &cmptloop->tile->tcmpts[start];
+		numcols = jas_matrix_numcols(comp->data);
+		if (jpc_tsfb_analyze16(comp->tsfb, cmptloop->bufs[start],
+		  jas_seq2d_xstart(comp->data), jas_seq2d_ystart(comp->data),
+		  numcols, jas_matrix_numrows(comp->data), numcols)) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/* Level shift the samples of a tile, apply the RCT (if any), and perform
+  analysis, all with 16-bit samples.  Zero is returned (with the tile left
+  as it was) if the samples are not in the range assumed by the bound
+  checked in jpc_enc_tile_create. */
+static int jpc_enc_tileanalyze16(jpc_enc_t *enc, jpc_enc_tile_t *tile)
+{
+	jpc_enc_cp_t *cp;
+	jpc_enc_tcmpt_t *comp;
+	jpc_enc_cmptloop_t cmptloop;
+	int_least16_t **bufs;
+	int numrows;
+	int numcols;
+	int cmptno;
+	int adjust;
+	int maxmag;
+	int ret;
+	int i;
+	const jpc_qmfb_kernops_t *ops;
+
+	cp = enc->cp;
+	ops = jpc_qmfb_getkernops();
+	ret = -1;
+	if (!(bufs = jas_malloc(tile->numtcmpts * sizeof(int_least16_t *)))) {
+		return -1;
+	}
+	for (cmptno = 0; cmptno < tile->numtcmpts; ++cmptno) {
+		bufs[cmptno] = 0;
+	}
+
+	/* The samples are level shifted as they are converted. */
+	for (cmptno = 0, comp = tile->tcmpts; cmptno < tile->numtcmpts;
+	  ++cmptno, ++comp) {
+		numrows = jas_matrix_numrows(comp->data);
+		numcols = jas_matrix_numcols(comp->data);
+		if (!(bufs[cmptno] = jas_malloc(JAS_MAX(numrows * numcols, 1) *
+		  sizeof(int_least16_t)))) {
+			goto done;
+		}
+		/* Samples read from an image source are already level shifted. */
+		adjust = (!cp->ccps[cmptno].sgnd && !jas_image_hassrc(enc->image)) ?
+		  (-(1 << (cp->ccps[cmptno].prec - 1))) : 0;
+		maxmag = 0;
+		for (i = 0; i < numrows; ++i) {
+			maxmag = JAS_MAX(maxmag, (*ops->pack16)(jas_matrix_getref(
+			  comp->data, i, 0), &bufs[cmptno][i * numcols], numcols,
+			  adjust));
+		}
+		if (maxmag > (1 << (cp->ccps[cmptno].prec - 1))) {
+			ret = 0;
+			goto done;
+		}
+	}
+
+	if (tile->mctid == JPC_MCT_RCT) {
+		jpc_rct16(bufs[0], bufs[1], bufs[2],
+		  jas_matrix_numrows(tile->tcmpts[0].data) *
+		  jas_matrix_numcols(tile->tcmpts[0].data));
+	}
+
+	cmptloop.tile = tile;
+	cmptloop.bufs = bufs;
+	if (jas_thread_parfor(tile->numtcmpts, 1, jpc_enc_analyzecmpts16,
+	  &cmptloop)) {
+		goto done;
+	}
+
+	for (cmptno = 0, comp = tile->tcmpts; cmptno < tile->numtcmpts;
+	  ++cmptno, ++comp) {
+		numrows = jas_matrix_numrows(comp->data);
+		numcols = jas_matrix_numcols(comp->data);
+		for (i = 0; i < numrows; ++i) {
+			(*ops->unpack16)(&bufs[cmptno][i * numcols], jas_matrix_getref(
+			  comp->data, i, 0), numcols, 0, -JPC_QMFB_MAX16 - 1,
+			  JPC_QMFB_MAX16);
+		}
+	}
+	ret = 1;
+
+done:
+	for (cmptno = 0; cmptno < tile->numtcmpts; ++cmptno) {
+		if (bufs[cmptno]) {
+			jas_free(bufs[cmptno]);
+		}
+	}
+	jas_free(bufs);
+	return ret;
+}
+
+/* Level shift the samples of a tile, apply the multicomponent transform (if
+  any), perform analysis, and quantize and code the code blocks, all a row
+  at a time.  Only a stripe of code blocks of each band and a few rows of
+  each level of the transform are held at once. */
+static int jpc_enc_tileencodelines(jpc_enc_t *enc, jpc_enc_tile_t *tile)
+{
+	jpc_enc_cp_t *cp;
+	jpc_enc_ccp_t *ccp;
+	jpc_enc_tcmpt_t *comp;
+	jpc_enc_cmptlines_t *cmptlines;
+	jpc_enc_cmptlines_t *cl;
+	jas_matrix_t *win;
+	jas_seqent_t *p;
+	int cmptno;
+	int numrows;
+	int numcols;
+	int adjust;
+	int ret;
+	int i;
+	int j;
+	const jpc_qmfb_kernops_t *ops;
+
+	cp = enc->cp;
+	ops = jpc_qmfb_getkernops();
+	ret = -1;
+	win = 0;
+	if (!(cmptlines = jas_malloc(tile->numtcmpts *
+	  sizeof(jpc_enc_cmptlines_t)))) {
+		return -1;
+	}
+	for (cmptno = 0, cl = cmptlines; cmptno < tile->numtcmpts; ++cmptno,
+	  ++cl) {
+		cl->lines = 0;
+		cl->data = 0;
+	}
+	if (!(win = jas_seq2d_create(0, 0, 0, 0))) {
+		goto done;
+	}
+
+	numrows = 0;
+	for (cmptno = 0, comp = tile->tcmpts, cl = cmptlines; cmptno <
+	  tile->numtcmpts; ++cmptno, ++comp, ++cl) {
+		cl->enc = enc;
+		cl->tcmpt = comp;
+		cl->win = win;
+		if (comp->tlx >= comp->brx || comp->tly >= comp->bry) {
+			continue;
+		}
+		if (!(cl->lines = jpc_tsfb_analyzelines(comp->tsfb, comp->tlx,
+		  comp->tly, comp->brx, comp->bry, jpc_enc_putbandrow, cl))) {
+			goto done;
+		}
+		if (!(cl->data = jas_matrix_create(1, comp->brx - comp->tlx))) {
+			goto done;
+		}
+		numrows = JAS_MAX(numrows, JAS_CAST(int, comp->bry - comp->tly));
+	}
+
+	for (i = 0; i < numrows; ++i) {
+		if (jpc_enc_step(enc)) {
+			goto done;
+		}
+		for (cmptno = 0, comp = tile->tcmpts, cl = cmptlines; cmptno <
+		  tile->numtcmpts; ++cmptno, ++comp, ++cl) {
+			if (!cl->lines || i >= JAS_CAST(int, comp->bry - comp->tly)) {
+				continue;
+			}
+			ccp = &cp->ccps[cmptno];
+			numcols = jas_matrix_numcols(cl->data);
+			if (jas_image_hassrc(enc->image)) {
+				/* The source also performs the level shift. */
+				if ((*enc->image->srcops_->readcmpt_)(enc->image->srcobj_,
+				  cmptno, comp->tlx - JPC_CEILDIV(cp->imgareatlx,
+				  ccp->sampgrdstepx), comp->tly + i -
+				  JPC_CEILDIV(cp->imgareatly, ccp->sampgrdstepy), numcols, 1,
+				  cl->data)) {
+					goto done;
+				}
+			} else {
+				if (jas_image_readcmpt(enc->image, cmptno, comp->tlx -
+				  JPC_CEILDIV(cp->imgareatlx, ccp->sampgrdstepx), comp->tly +
+				  i - JPC_CEILDIV(cp->imgareatly, ccp->sampgrdstepy), numcols,
+				  1, cl->data)) {
+					goto done;
+				}
+				if (!ccp->sgnd) {
+					adjust = 1 << (ccp->prec - 1);
+					p = jas_matrix_getref(cl->data, 0, 0);
+					for (j = 0; j < numcols; ++j) {
+						p[j] -= adjust;
+					}
+				}
+			}
+			if (tile->fltmode) {
+				(*ops->inttoflt)(jas_matrix_getref(cl->data, 0, 0), numcols,
+				  1.0f);
+			} else if (!tile->intmode) {
+				jas_matrix_asl(cl->data, JPC_FIX_FRACBITS);
+			}
+		}
+
+		switch (tile->mctid) {
+		case JPC_MCT_RCT:
+			assert(jas_image_numcmpts(enc->image) == 3);
+			jpc_rct(cmptlines[0].data, cmptlines[1].data,
+			  cmptlines[2].data);
+			break;
+		case JPC_MCT_ICT:
+			assert(jas_image_numcmpts(enc->image) == 3);
+			if (tile->fltmode) {
+				jpc_ict_flt(cmptlines[0].data, cmptlines[1].data,
+				  cmptlines[2].data);
+			} else {
+				jpc_ict(cmptlines[0].data, cmptlines[1].data,
+				  cmptlines[2].data);
+			}
+			break;
+		default:
+			break;
+		}
+
+		for (cmptno = 0, comp = tile->tcmpts, cl = cmptlines; cmptno <
+		  tile->numtcmpts; ++cmptno, ++comp, ++cl) {
+			if (!cl->lines || i >= JAS_CAST(int, comp->bry - comp->tly)) {
+				continue;
+			}
+			if (jpc_tsfb_putline(cl->lines, jas_matrix_getref(cl->data, 0,
+			  0))) {
+				goto done;
+			}
+		}
+	}
+	ret = 0;
+
+done:
+	for (cmptno = 0, cl = cmptlines; cmptno < tile->numtcmpts; ++cmptno,
+	  ++cl) {
+		if (cl->lines) {
+			jpc_tsfb_lines_destroy(cl->lines);
+		}
+		if (cl->data) {
+			jas_matrix_destroy(cl->data);
+		}
+	}
+	if (win) {
+		jas_matrix_destroy(win);
+	}
+	jas_free(cmptlines);
+	return ret;
+}
+
+/* Put row y of a band of a component of a tile that is coded a row at a
+  time.  Once the last row of a stripe of code blocks of the band is put,
+  the stripe is quantized and coded. */
+static int jpc_enc_putbandrow(void *arg, int bandno, int y, jpc_fix_t *buf)
+{
+	jpc_enc_cmptlines_t *cl;
+	jpc_enc_tile_t *tile;
+	jpc_enc_rlvl_t *rlvl;
+	jpc_enc_band_t *band;
+	jas_matrix_t *win;
+	jpc_fix_t mxmag;
+	uint_fast32_t tly;
+	uint_fast32_t bry;
+
+	cl = arg;
+	tile = cl->tcmpt->tile;
+	rlvl = &cl->tcmpt->rlvls[(bandno + 2) / 3];
+	band = &rlvl->bands[bandno ? ((bandno - 1) % 3) : 0];
+	if (!band->data) {
+		return 0;
+	}
+
+	/* Find the stripe of code blocks that contains the row. */
+	tly = JAS_MAX(band->tly, JPC_FLOORTOMULTPOW2(JAS_CAST(uint_fast32_t, y),
+	  rlvl->cblkheightexpn));
+	bry = JAS_MIN(band->bry, JPC_CEILTOMULTPOW2(JAS_CAST(uint_fast32_t, y) +
+	  1, rlvl->cblkheightexpn));
+	if (JAS_CAST(uint_fast32_t, y) == tly) {
+		jas_seq2d_setshift(band->data, band->tlx, tly);
+	}
+	memcpy(jas_seq2d_getref(band->data, band->tlx, y), buf,
+	  (band->brx - band->tlx) * sizeof(jpc_fix_t));
+	if (JAS_CAST(uint_fast32_t, y) + 1 < bry) {
+		return 0;
+	}
+
+	win = cl->win;
+	jas_seq2d_bindsub(win, band->data, band->tlx, tly, band->brx, bry);
+	if (tile->fltmode) {
+		mxmag = jpc_mxmag_flt(win);
+	} else {
+		mxmag = jpc_mxmag(win);
+	}
+	band->mxmag = JAS_MAX(band->mxmag, mxmag);
+
+	assert(JPC_FIX_FRACBITS >= JPC_NUMEXTRABITS);
+	if (tile->fltmode) {
+		/* This also leaves JPC_NUMEXTRABITS fractional bits. */
+		jpc_quantize_flt(win, band->absstepsize);
+	} else if (!tile->intmode) {
+		jpc_quantize(win, band->absstepsize);
+		jas_matrix_divpow2(win, JPC_FIX_FRACBITS - JPC_NUMEXTRABITS);
+	} else {
+		jas_matrix_asl(win, JPC_NUMEXTRABITS);
+	}
+
+	return jpc_enc_enccblkrows(cl->enc, cl->tcmpt, band, tly, bry);
+}
+
 void calcrdslopes(jpc_enc_cblk_t *cblk)
 {
 	jpc_enc_pass_t *endpasses;
@@ -1665,7 +2224,7 @@ int rateallocate(jpc_enc_t *enc, int numlyrs, uint_fast32_t *cumlens)
 		}
 	}
 
-	if (!(out = jas_stream_memopen(0, 0))) {
+	if (!(out = jas_stream_chunkopen(0))) {
 		return -1;
 	}
 
@@ -1716,6 +2275,11 @@ if (jas_getdbglevel()) {
 
 	for (lyrno = 0; lyrno < numlyrs; ++lyrno) {
 
+		if (jpc_enc_step(enc)) {
+			jas_stream_close(out);
+			return -1;
+		}
+
 		lo = mnrdslope;
 		hi = mxrdslope;
 
@@ -1922,6 +2486,8 @@ jpc_enc_tile_t *jpc_enc_tile_create(jpc_enc_cp_t *cp, jas_image_t *image, int ti
 	uint_fast16_t lyrno;
 	uint_fast16_t cmptno;
 	jpc_enc_tcmpt_t *tcmpt;
+	jpc_enc_ccp_t *ccp;
+	double size;
 
 	if (!(tile = jas_malloc(sizeof(jpc_enc_tile_t)))) {
 		goto error;
@@ -1950,10 +2516,22 @@ jpc_enc_tile_t *jpc_enc_tile_create(jpc_enc_cp_t *cp, jas_image_t *image, int ti
 
 	/* Initialize some tile coding parameters. */
 	tile->intmode = cp->tcp.intmode;
+	tile->fltmode = cp->tcp.fltmode && !cp->tcp.intmode;
 	tile->csty = cp->tcp.csty;
 	tile->prg = cp->tcp.prg;
 	tile->mctid = cp->tcp.mctid;
 
+	/* A tile whose coefficients would take too much memory is transformed
+	  and coded a row at a time. */
+	size = 0.0;
+	for (cmptno = 0, ccp = cp->ccps; cmptno < cp->numcmpts; ++cmptno, ++ccp) {
+		size += (double) (JPC_CEILDIV(tile->brx, ccp->sampgrdstepx) -
+		  JPC_CEILDIV(tile->tlx, ccp->sampgrdstepx)) *
+		  (JPC_CEILDIV(tile->bry, ccp->sampgrdstepy) -
+		  JPC_CEILDIV(tile->tly, ccp->sampgrdstepy)) * sizeof(jpc_fix_t);
+	}
+	tile->linemode = cp->tcp.lowmem || size > JPC_ENC_LINETHRESH;
+
 	tile->numlyrs = cp->tcp.numlyrs;
 	if (!(tile->lyrsizes = jas_malloc(tile->numlyrs *
 	  sizeof(uint_fast32_t)))) {
@@ -2003,6 +2581,21 @@ jpc_enc_tile_t *jpc_enc_tile_create(jpc_enc_cp_t *cp, jas_image_t *image, int ti
 		break;
 	}
 
+	/* In integer mode, the samples of a tile with components of at most 8
+	  bits can be transformed with 16-bit samples, if the bound on the
+	  samples during analysis allows it.  After the RCT, the magnitude of
+	  the samples can be twice as large. */
+	tile->int16mode = tile->intmode && !tile->linemode &&
+	  (tile->mctid == JPC_MCT_NONE || tile->mctid == JPC_MCT_RCT);
+	for (cmptno = 0, tcmpt = tile->tcmpts; cmptno < cp->numcmpts;
+	  ++cmptno, ++tcmpt) {
+		if (cp->ccps[cmptno].prec > 8 ||
+		  jpc_tsfb_analyze16bound(tcmpt->tsfb, (tile->mctid ==
+		  JPC_MCT_RCT) ? 256 : (1 << (cp->ccps[cmptno].prec - 1))) < 0) {
+			tile->int16mode = false;
+		}
+	}
+
 	if (!(tile->pi = jpc_enc_pi_create(cp, tile))) {
 		goto error;
 	}
@@ -2069,18 +2662,33 @@ static jpc_enc_tcmpt_t *tcmpt_create(jpc_enc_tcmpt_t *tcmpt, jpc_enc_cp_t *cp,
 	tly = JPC_CEILDIV(tile->tly, ccp->sampgrdstepy);
 	brx = JPC_CEILDIV(tile->brx, ccp->sampgrdstepx);
 	bry = JPC_CEILDIV(tile->bry, ccp->sampgrdstepy);
+	tcmpt->tlx = tlx;
+	tcmpt->tly = tly;
+	tcmpt->brx = brx;
+	tcmpt->bry = bry;
+
+	/* In line mode, the image data is read a row at a time while the
+	  tile is coded (see jpc_enc_tileencodelines). */
+	if (!tile->linemode) {
+		/* Create a sequence to hold the tile-component sample data. */
+		if (!(tcmpt->data = jas_seq2d_create(tlx, tly, brx, bry))) {
+			goto error;
+		}
 
-	/* Create a sequence to hold the tile-component sample data. */
-	if (!(tcmpt->data = jas_seq2d_create(tlx, tly, brx, bry))) {
-		goto error;
-	}
-
-	/* Get the image data associated with this tile-component. */
-	cmpttlx = JPC_CEILDIV(cp->imgareatlx, ccp->sampgrdstepx);
-	cmpttly = JPC_CEILDIV(cp->imgareatly, ccp->sampgrdstepy);
-	if (jas_image_readcmpt(image, cmptno, tlx - cmpttlx, tly - cmpttly,
-	  brx - tlx, bry - tly, tcmpt->data)) {
-		goto error;
+		/* Get the image data associated with this tile-component. */
+		cmpttlx = JPC_CEILDIV(cp->imgareatlx, ccp->sampgrdstepx);
+		cmpttly = JPC_CEILDIV(cp->imgareatly, ccp->sampgrdstepy);
+		if (jas_image_hassrc(image)) {
+			/* The source also performs the level shift. */
+			if ((*image->srcops_->readcmpt_)(image->srcobj_, cmptno,
+			  tlx - cmpttlx, tly - cmpttly, brx - tlx, bry - tly,
+			  tcmpt->data)) {
+				goto error;
+			}
+		} else if (jas_image_readcmpt(image, cmptno, tlx - cmpttlx,
+		  tly - cmpttly, brx - tlx, bry - tly, tcmpt->data)) {
+			goto error;
+		}
 	}
 
 	tcmpt->synweight = 0;
@@ -2090,6 +2698,9 @@ static jpc_enc_tcmpt_t *tcmpt_create(jpc_enc_tcmpt_t *tcmpt, jpc_enc_cp_t *cp,
 	if (!(tcmpt->tsfb = jpc_cod_gettsfb(tcmpt->qmfbid, tcmpt->numrlvls - 1))) {
 		goto error;
 	}
+	if (tile->fltmode) {
+		jpc_tsfb_setfltmode(tcmpt->tsfb);
+	}
 
 	for (rlvlno = 0; rlvlno < tcmpt->numrlvls; ++rlvlno) {
 		tcmpt->prcwidthexpns[rlvlno] = cp->tccp.prcwidthexpns[rlvlno];
@@ -2106,9 +2717,8 @@ static jpc_enc_tcmpt_t *tcmpt_create(jpc_enc_tcmpt_t *tcmpt, jpc_enc_cp_t *cp,
 	  sizeof(uint_fast16_t)));
 
 	/* Retrieve information about the various bands. */
-	jpc_tsfb_getbands(tcmpt->tsfb, jas_seq2d_xstart(tcmpt->data),
-	  jas_seq2d_ystart(tcmpt->data), jas_seq2d_xend(tcmpt->data),
-	  jas_seq2d_yend(tcmpt->data), bandinfos);
+	jpc_tsfb_getbands(tcmpt->tsfb, tcmpt->tlx, tcmpt->tly, tcmpt->brx,
+	  tcmpt->bry, bandinfos);
 
 	if (!(tcmpt->rlvls = jas_malloc(tcmpt->numrlvls * sizeof(jpc_enc_rlvl_t)))) {
 		goto error;
@@ -2175,14 +2785,10 @@ static jpc_enc_rlvl_t *rlvl_create(jpc_enc_rlvl_t *rlvl, jpc_enc_cp_t *cp,
 
 	/* Compute the coordinates of the top-left and bottom-right
 	  corners of the tile-component at this resolution. */
-	rlvl->tlx = JPC_CEILDIVPOW2(jas_seq2d_xstart(tcmpt->data), tcmpt->numrlvls -
-	  1 - rlvlno);
-	rlvl->tly = JPC_CEILDIVPOW2(jas_seq2d_ystart(tcmpt->data), tcmpt->numrlvls -
-	  1 - rlvlno);
-	rlvl->brx = JPC_CEILDIVPOW2(jas_seq2d_xend(tcmpt->data), tcmpt->numrlvls -
-	  1 - rlvlno);
-	rlvl->bry = JPC_CEILDIVPOW2(jas_seq2d_yend(tcmpt->data), tcmpt->numrlvls -
-	  1 - rlvlno);
+	rlvl->tlx = JPC_CEILDIVPOW2(tcmpt->tlx, tcmpt->numrlvls - 1 - rlvlno);
+	rlvl->tly = JPC_CEILDIVPOW2(tcmpt->tly, tcmpt->numrlvls - 1 - rlvlno);
+	rlvl->brx = JPC_CEILDIVPOW2(tcmpt->brx, tcmpt->numrlvls - 1 - rlvlno);
+	rlvl->bry = JPC_CEILDIVPOW2(tcmpt->bry, tcmpt->numrlvls - 1 - rlvlno);
 
 	if (rlvl->tlx >= rlvl->brx || rlvl->tly >= rlvl->bry) {
 		rlvl->numhprcs = 0;
@@ -2272,14 +2878,29 @@ static jpc_enc_band_t *band_create(jpc_enc_band_t *band, jpc_enc_cp_t *cp,
 	gblbandno = (!rlvlno) ? 0 : (3 * (rlvlno - 1) + bandno + 1);
 
 	bandinfo = &bandinfos[gblbandno];
+	band->tlx = bandinfo->xstart;
+	band->tly = bandinfo->ystart;
+	band->brx = bandinfo->xend;
+	band->bry = bandinfo->yend;
+	band->mxmag = 0;
 
 if (bandinfo->xstart != bandinfo->xend && bandinfo->ystart != bandinfo->yend) {
-	if (!(band->data = jas_seq2d_create(0, 0, 0, 0))) {
-		goto error;
+	if (tcmpt->tile->linemode) {
+		/* Only a stripe of code blocks of the band is held at once. */
+		if (!(band->data = jas_seq2d_create(bandinfo->xstart,
+		  bandinfo->ystart, bandinfo->xend, bandinfo->ystart +
+		  JAS_MIN(1 << rlvl->cblkheightexpn, bandinfo->yend -
+		  bandinfo->ystart)))) {
+			goto error;
+		}
+	} else {
+		if (!(band->data = jas_seq2d_create(0, 0, 0, 0))) {
+			goto error;
+		}
+		jas_seq2d_bindsub(band->data, tcmpt->data, bandinfo->locxstart,
+		  bandinfo->locystart, bandinfo->locxend, bandinfo->locyend);
+		jas_seq2d_setshift(band->data, bandinfo->xstart, bandinfo->ystart);
 	}
-	jas_seq2d_bindsub(band->data, tcmpt->data, bandinfo->locxstart,
-	  bandinfo->locystart, bandinfo->locxend, bandinfo->locyend);
-	jas_seq2d_setshift(band->data, bandinfo->xstart, bandinfo->ystart);
 }
 	band->orient = bandinfo->orient;
 	band->analgain = JPC_NOMINALGAIN(cp->tccp.qmfbid, tcmpt->numrlvls, rlvlno,
@@ -2385,12 +3006,10 @@ if (!rlvlno) {
 	  corners of the precinct. */
 	cbgtlx = tlcbgtlx + (prcxind << rlvl->cbgwidthexpn);
 	cbgtly = tlcbgtly + (prcyind << rlvl->cbgheightexpn);
-	prc->tlx = JAS_MAX(jas_seq2d_xstart(band->data), cbgtlx);
-	prc->tly = JAS_MAX(jas_seq2d_ystart(band->data), cbgtly);
-	prc->brx = JAS_MIN(jas_seq2d_xend(band->data), cbgtlx +
-	  (1 << rlvl->cbgwidthexpn));
-	prc->bry = JAS_MIN(jas_seq2d_yend(band->data), cbgtly +
-	  (1 << rlvl->cbgheightexpn));
+	prc->tlx = JAS_MAX(band->tlx, cbgtlx);
+	prc->tly = JAS_MAX(band->tly, cbgtly);
+	prc->brx = JAS_MIN(band->brx, cbgtlx + (1 << rlvl->cbgwidthexpn));
+	prc->bry = JAS_MIN(band->bry, cbgtly + (1 << rlvl->cbgheightexpn));
 
 	if (prc->tlx < prc->brx && prc->tly < prc->bry) {
 		/* The precinct contains at least one code block. */
@@ -2533,10 +3152,19 @@ static jpc_enc_cblk_t *cblk_create(jpc_enc_cblk_t *cblk, jpc_enc_cp_t *cp, jpc_e
 	  prc->bry);
 
 	assert(cblktlx < cblkbrx && cblktly < cblkbry);
-	if (!(cblk->data = jas_seq2d_create(0, 0, 0, 0))) {
-		goto error;
+	cblk->tlx = cblktlx;
+	cblk->tly = cblktly;
+	cblk->brx = cblkbrx;
+	cblk->bry = cblkbry;
+	/* In line mode, the data is bound when the stripe of the code block
+	  is coded (see jpc_enc_enccblkrows). */
+	if (!rlvl->tcmpt->tile->linemode) {
+		if (!(cblk->data = jas_seq2d_create(0, 0, 0, 0))) {
+			goto error;
+		}
+		jas_seq2d_bindsub(cblk->data, band->data, cblktlx, cblktly,
+		  cblkbrx, cblkbry);
 	}
-	jas_seq2d_bindsub(cblk->data, band->data, cblktlx, cblktly, cblkbrx, cblkbry);
 
 	return cblk;
 
@@ -2593,7 +3221,7 @@ void jpc_enc_dump(jpc_enc_t *enc)
 
 	for (cmptno = 0, tcmpt = tile->tcmpts; cmptno < tile->numtcmpts; ++cmptno,
 	  ++tcmpt) {
-		jas_eprintf("  tcmpt %5d %5d %5d %5d\n", jas_seq2d_xstart(tcmpt->data), jas_seq2d_ystart(tcmpt->data), jas_seq2d_xend(tcmpt->data), jas_seq2d_yend(tcmpt->data));
+		jas_eprintf("  tcmpt %5d %5d %5d %5d\n", (int) tcmpt->tlx, (int) tcmpt->tly, (int) tcmpt->brx, (int) tcmpt->bry);
 		for (rlvlno = 0, rlvl = tcmpt->rlvls; rlvlno < tcmpt->numrlvls;
 		  ++rlvlno, ++rlvl) {
 			jas_eprintf("    rlvl %5d %5d %5d %5d\n", rlvl->tlx, rlvl->tly, rlvl->brx, rlvl->bry);
@@ -2602,7 +3230,7 @@ void jpc_enc_dump(jpc_enc_t *enc)
 				if (!band->data) {
 					continue;
 				}
-				jas_eprintf("      band %5d %5d %5d %5d\n", jas_seq2d_xstart(band->data), jas_seq2d_ystart(band->data), jas_seq2d_xend(band->data), jas_seq2d_yend(band->data));
+				jas_eprintf("      band %5d %5d %5d %5d\n", (int) band->tlx, (int) band->tly, (int) band->brx, (int) band->bry);
 				for (prcno = 0, prc = band->prcs; prcno < rlvl->numprcs;
 				  ++prcno, ++prc) {
 					jas_eprintf("        prc %5d %5d %5d %5d (%5d %5d)\n", prc->tlx, prc->tly, prc->brx, prc->bry, prc->brx - prc->tlx, prc->bry - prc->tly);
@@ -2611,7 +3239,7 @@ void jpc_enc_dump(jpc_enc_t *enc)
 					}
 					for (cblkno = 0, cblk = prc->cblks; cblkno < prc->numcblks;
 					  ++cblkno, ++cblk) {
-						jas_eprintf("         cblk %5d %5d %5d %5d\n", jas_seq2d_xstart(cblk->data), jas_seq2d_ystart(cblk->data), jas_seq2d_xend(cblk->data), jas_seq2d_yend(cblk->data));
+						jas_eprintf("         cblk %5d %5d %5d %5d\n", (int) cblk->tlx, (int) cblk->tly, (int) cblk->brx, (int) cblk->bry);
 					}
 				}
 			}
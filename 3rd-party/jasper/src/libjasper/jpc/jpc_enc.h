@@ -73,6 +73,7 @@
 \******************************************************************************/
 
 #include "jasper/jas_seq.h"
+#include "jasper/jas_image.h"
 
 #include "jpc_t2cod.h"
 #include "jpc_mqenc.h"
@@ -133,6 +134,12 @@ typedef struct {
 	/* The coding mode. */
 	bool intmode;
 
+	/* Should floating-point arithmetic be used in real mode? */
+	bool fltmode;
+
+	/* Should every tile be coded a row at a time? */
+	bool lowmem;
+
 	/* The coding style (i.e., SOP, EPH). */
 	uint_fast8_t csty;
 
@@ -345,6 +352,20 @@ typedef struct {
 	/* This is used by the rate control code. */
 	int savednumencpasses;
 
+	/* The x-coordinate of the top-left corner of the code block. */
+	uint_fast32_t tlx;
+
+	/* The y-coordinate of the top-left corner of the code block. */
+	uint_fast32_t tly;
+
+	/* The x-coordinate of the bottom-right corner of the code block
+	  (plus one). */
+	uint_fast32_t brx;
+
+	/* The y-coordinate of the bottom-right corner of the code block
+	  (plus one). */
+	uint_fast32_t bry;
+
 } jpc_enc_cblk_t;
 
 /* Encoder per-code-block-group state information. */
@@ -430,6 +451,24 @@ typedef struct jpc_enc_band_s {
 	/* The per-resolution-level information. */
 	struct jpc_enc_rlvl_s *rlvl;
 
+	/* The x-coordinate of the top-left corner of the band. */
+	uint_fast32_t tlx;
+
+	/* The y-coordinate of the top-left corner of the band. */
+	uint_fast32_t tly;
+
+	/* The x-coordinate of the bottom-right corner of the band (plus
+	  one). */
+	uint_fast32_t brx;
+
+	/* The y-coordinate of the bottom-right corner of the band (plus
+	  one). */
+	uint_fast32_t bry;
+
+	/* The largest magnitude of the coefficients of the band (before
+	  quantization). */
+	jpc_fix_t mxmag;
+
 } jpc_enc_band_t;
 
 /* Encoder per-resolution-level state information. */
@@ -511,6 +550,20 @@ typedef struct jpc_enc_tcmpt_s {
 	/* The tile-component data. */
 	jas_matrix_t *data;
 
+	/* The x-coordinate of the top-left corner of the tile-component. */
+	uint_fast32_t tlx;
+
+	/* The y-coordinate of the top-left corner of the tile-component. */
+	uint_fast32_t tly;
+
+	/* The x-coordinate of the bottom-right corner of the tile-component
+	  (plus one). */
+	uint_fast32_t brx;
+
+	/* The y-coordinate of the bottom-right corner of the tile-component
+	  (plus one). */
+	uint_fast32_t bry;
+
 	/* The QMFB. */
 	int qmfbid;
 
@@ -594,6 +647,17 @@ typedef struct jpc_enc_tile_s {
 	/* The coding mode (i.e., integer or real). */
 	bool intmode;
 
+	/* Is floating-point arithmetic used (in real mode)? */
+	bool fltmode;
+
+	/* Are the level shift, MCT and wavelet transform done with 16-bit
+	  samples (in integer mode)? */
+	bool int16mode;
+
+	/* Is the tile coded a row at a time (so that only a stripe of each
+	  band and a few rows of each level of the transform are held)? */
+	bool linemode;
+
 	/* The number of bytes to allocate to the various layers. */
 	uint_fast32_t *lyrsizes;
 
@@ -606,6 +670,11 @@ typedef struct jpc_enc_tile_s {
 	/* The raw (i.e., uncompressed) size of this tile. */
 	uint_fast32_t rawsize;
 
+	/* The number of steps in encoding this tile, and the number of them
+	  started so far (for reporting progress). */
+	int numsteps;
+	int stepno;
+
 } jpc_enc_tile_t;
 
 /* Encoder class. */
@@ -641,6 +710,18 @@ typedef struct jpc_enc_s {
 	/* The stream used to temporarily hold tile-part data. */
 	jas_stream_t *tmpstream;
 
+	/* The progress callback (or null). */
+	jas_progress_t *progress;
+
 } jpc_enc_t;
 
+/******************************************************************************\
+* Functions.
+\******************************************************************************/
+
+/* Report the progress of encoding at the start of the next step in
+  encoding the current tile (or once the tile is done).  A nonzero value
+  is returned if encoding should be aborted. */
+int jpc_enc_step(jpc_enc_t *enc);
+
 #endif
@@ -83,8 +83,9 @@
 
 /* The integral type used to represent a fixed-point number.  This
   type must be capable of representing values from -(2^31) to 2^31-1
-  (inclusive). */
-typedef int_fast32_t jpc_fix_t;
+  (inclusive).  It must also be the same as jas_seqent_t, since the
+  tile-component, band and code block data are held in matrices. */
+typedef int_least32_t jpc_fix_t;
 
 /* The integral type used to respresent higher-precision intermediate results.
   This type should be capable of representing values from -(2^63) to 2^63-1
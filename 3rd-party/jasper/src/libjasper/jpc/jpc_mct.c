@@ -77,6 +77,7 @@
 
 #include "jpc_fix.h"
 #include "jpc_mct.h"
+#include "jpc_qmfb.h"
 
 /******************************************************************************\
 * Code.
@@ -248,6 +249,56 @@ void jpc_iict(jas_matrix_t *c0, jas_matrix_t *c1, jas_matrix_t *c2)
 	}
 }
 
+void jpc_ict_flt(jas_matrix_t *c0, jas_matrix_t *c1, jas_matrix_t *c2)
+{
+	int numrows;
+	int numcols;
+	int i;
+	const jpc_qmfb_kernops_t *ops;
+
+	numrows = jas_matrix_numrows(c0);
+	assert(jas_matrix_numrows(c1) == numrows && jas_matrix_numrows(c2) == numrows);
+	numcols = jas_matrix_numcols(c0);
+	assert(jas_matrix_numcols(c1) == numcols && jas_matrix_numcols(c2) == numcols);
+	ops = jpc_qmfb_getkernops();
+	for (i = 0; i < numrows; ++i) {
+		(*ops->ictflt)((float *) jas_matrix_getref(c0, i, 0),
+		  (float *) jas_matrix_getref(c1, i, 0),
+		  (float *) jas_matrix_getref(c2, i, 0), numcols);
+	}
+}
+
+void jpc_iict_flt(jas_matrix_t *c0, jas_matrix_t *c1, jas_matrix_t *c2)
+{
+	int numrows;
+	int numcols;
+	int i;
+	const jpc_qmfb_kernops_t *ops;
+
+	numrows = jas_matrix_numrows(c0);
+	assert(jas_matrix_numrows(c1) == numrows && jas_matrix_numrows(c2) == numrows);
+	numcols = jas_matrix_numcols(c0);
+	assert(jas_matrix_numcols(c1) == numcols && jas_matrix_numcols(c2) == numcols);
+	ops = jpc_qmfb_getkernops();
+	for (i = 0; i < numrows; ++i) {
+		(*ops->iictflt)((float *) jas_matrix_getref(c0, i, 0),
+		  (float *) jas_matrix_getref(c1, i, 0),
+		  (float *) jas_matrix_getref(c2, i, 0), numcols);
+	}
+}
+
+void jpc_rct16(int_least16_t *c0, int_least16_t *c1, int_least16_t *c2,
+  int n)
+{
+	(*jpc_qmfb_getkernops()->rct16)(c0, c1, c2, n);
+}
+
+void jpc_irct16(int_least16_t *c0, int_least16_t *c1, int_least16_t *c2,
+  int n)
+{
+	(*jpc_qmfb_getkernops()->irct16)(c0, c1, c2, n);
+}
+
 jpc_fix_t jpc_mct_getsynweight(int mctid, int cmptno)
 {
 	jpc_fix_t synweight;
@@ -105,6 +105,21 @@ void jpc_ict(jas_matrix_t *c0, jas_matrix_t *c1, jas_matrix_t *c2);
 /* Calculate the inverse ICT. */
 void jpc_iict(jas_matrix_t *c0, jas_matrix_t *c1, jas_matrix_t *c2);
 
+/* Calculate the forward ICT of floating-point samples (stored in the place
+  of the integer samples). */
+void jpc_ict_flt(jas_matrix_t *c0, jas_matrix_t *c1, jas_matrix_t *c2);
+
+/* Calculate the inverse ICT of floating-point samples. */
+void jpc_iict_flt(jas_matrix_t *c0, jas_matrix_t *c1, jas_matrix_t *c2);
+
+/* Calculate the forward RCT of n 16-bit samples of each component. */
+void jpc_rct16(int_least16_t *c0, int_least16_t *c1, int_least16_t *c2,
+  int n);
+
+/* Calculate the inverse RCT of n 16-bit samples of each component. */
+void jpc_irct16(int_least16_t *c0, int_least16_t *c1, int_least16_t *c2,
+  int n);
+
 /* Get the synthesis weight associated with a particular component. */
 jpc_fix_t jpc_mct_getsynweight(int mctid, int cmptno);
 
@@ -74,14 +74,35 @@
 #undef WT_LENONE /* This is not needed due to normalization. */
 #define WT_DOSCALE
 
+/* Vectorized kernels are built for x86 processors unless JPC_QMFB_NOSIMD is
+  defined.  The kernel for each instruction set is compiled for that
+  instruction set alone, and the one to use is chosen at run time. */
+#if !defined(JPC_QMFB_NOSIMD)
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#define	JPC_QMFB_X86
+#define	JPC_QMFB_TARGET(isa)	__attribute__((target(isa)))
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#define	JPC_QMFB_X86
+#define	JPC_QMFB_TARGET(isa)
+#endif
+#endif
+
 /******************************************************************************\
 * Includes.
 \******************************************************************************/
 
 #include <assert.h>
+#include <string.h>
+#if defined(JPC_QMFB_X86)
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
 #include "jasper/jas_fix.h"
 #include "jasper/jas_malloc.h"
 #include "jasper/jas_math.h"
+#include "jasper/jas_thread.h"
 
 #include "jpc_qmfb.h"
 #include "jpc_tsfb.h"
@@ -94,16 +115,149 @@
 #define QMFB_SPLITBUFSIZE	4096
 #define	QMFB_JOINBUFSIZE	4096
 
+/* The instruction sets for which there are kernels. */
+#define	JPC_QMFB_SIMD_NONE	0
+#define	JPC_QMFB_SIMD_SSE2	1
+#define	JPC_QMFB_SIMD_AVX2	2
+
+/* The number of columns grouped together by the 16-bit transform.  This
+  gives rows of the same size in bytes as for the 32-bit transforms. */
+#define	JPC_QMFB_COLGRPSIZE16	(2 * JPC_QMFB_COLGRPSIZE)
+
+/* The least number of samples for which a pass of a 2-D transform is worth
+  spreading over several threads. */
+#define	JPC_QMFB_PARGRAIN	16384
+
+/* A pass of a 2-D transform over the rows or column groups of an array,
+  which may be spread over several threads (see jpc_qmfb_parfor). */
+typedef struct {
+
+	/* The kernels used. */
+	const jpc_qmfb_kernops_t *ops;
+
+	/* The array. */
+	void *a;
+	int numrows;
+	int numcols;
+	int stride;
+
+	/* The parity of the rows or columns. */
+	int parity;
+
+} jpc_qmfb_pass_t;
+
+static void jpc_qmfb_initpass(jpc_qmfb_pass_t *pass,
+  const jpc_qmfb_kernops_t *ops, void *a, int numrows, int numcols,
+  int stride, int parity);
+static void jpc_qmfb_parfor(jpc_qmfb_pass_t *pass, jas_thread_loopfunc_t func,
+  int n, long size);
+static int jpc_ft_fwdcolgrps(void *arg, int start, int end);
+static int jpc_ft_fwdrows(void *arg, int start, int end);
+static int jpc_ft_invrows(void *arg, int start, int end);
+static int jpc_ft_invcolgrps(void *arg, int start, int end);
+static int jpc_ft_fwdcolgrps16(void *arg, int start, int end);
+static int jpc_ft_fwdrows16(void *arg, int start, int end);
+static int jpc_ft_invrows16(void *arg, int start, int end);
+static int jpc_ft_invcolgrps16(void *arg, int start, int end);
+static int jpc_ns_fwdcolgrps(void *arg, int start, int end);
+static int jpc_ns_fwdrows(void *arg, int start, int end);
+static int jpc_ns_invrows(void *arg, int start, int end);
+static int jpc_ns_invcolgrps(void *arg, int start, int end);
+static int jpc_nsflt_fwdcolgrps(void *arg, int start, int end);
+static int jpc_nsflt_fwdrows(void *arg, int start, int end);
+static int jpc_nsflt_invrows(void *arg, int start, int end);
+static int jpc_nsflt_invcolgrps(void *arg, int start, int end);
+
+static void jpc_qmfb_split_row_simd(const jpc_qmfb_kernops_t *ops,
+  jpc_fix_t *a, int numcols, int parity);
+static void jpc_qmfb_join_row_simd(const jpc_qmfb_kernops_t *ops,
+  jpc_fix_t *a, int numcols, int parity);
+static void jpc_qmfb_split_cols(jpc_fix_t *a, int numrows, int numcols,
+  int stride, int parity);
+static void jpc_qmfb_join_cols(jpc_fix_t *a, int numrows, int numcols,
+  int stride, int parity);
+#if defined(JPC_QMFB_X86)
+static int jpc_ft_analyze_simd(const jpc_qmfb_kernops_t *ops, jpc_fix_t *a,
+  int xstart, int ystart, int width, int height, int stride);
+static int jpc_ft_synthesize_simd(const jpc_qmfb_kernops_t *ops, jpc_fix_t *a,
+  int xstart, int ystart, int width, int height, int stride);
+static void jpc_ft_fwdlift_row_simd(const jpc_qmfb_kernops_t *ops,
+  jpc_fix_t *a, int numcols, int parity);
+static void jpc_ft_invlift_row_simd(const jpc_qmfb_kernops_t *ops,
+  jpc_fix_t *a, int numcols, int parity);
+static void jpc_ft_fwdlift_cols_simd(const jpc_qmfb_kernops_t *ops,
+  jpc_fix_t *a, int numrows, int numcols, int stride, int parity);
+static void jpc_ft_invlift_cols_simd(const jpc_qmfb_kernops_t *ops,
+  jpc_fix_t *a, int numrows, int numcols, int stride, int parity);
+static int jpc_ft_fwdcolgrps_simd(void *arg, int start, int end);
+static int jpc_ft_fwdrows_simd(void *arg, int start, int end);
+static int jpc_ft_invrows_simd(void *arg, int start, int end);
+static int jpc_ft_invcolgrps_simd(void *arg, int start, int end);
+#endif
+static void jpc_qmfb_split_row16(const jpc_qmfb_kernops_t *ops,
+  int_least16_t *a, int numcols, int parity);
+static void jpc_qmfb_join_row16(const jpc_qmfb_kernops_t *ops,
+  int_least16_t *a, int numcols, int parity);
+static void jpc_qmfb_split_cols16(int_least16_t *a, int numrows, int numcols,
+  int stride, int parity);
+static void jpc_qmfb_join_cols16(int_least16_t *a, int numrows, int numcols,
+  int stride, int parity);
+static void jpc_ft_fwdlift_row16(const jpc_qmfb_kernops_t *ops,
+  int_least16_t *a, int numcols, int parity);
+static void jpc_ft_invlift_row16(const jpc_qmfb_kernops_t *ops,
+  int_least16_t *a, int numcols, int parity);
+static void jpc_ft_fwdlift_cols16(const jpc_qmfb_kernops_t *ops,
+  int_least16_t *a, int numrows, int numcols, int stride, int parity);
+static void jpc_ft_invlift_cols16(const jpc_qmfb_kernops_t *ops,
+  int_least16_t *a, int numrows, int numcols, int stride, int parity);
+static void jpc_nsflt_fwdlift(const jpc_qmfb_kernops_t *ops, float *a,
+  int len, int numcols, int stride, int parity);
+static void jpc_nsflt_invlift(const jpc_qmfb_kernops_t *ops, float *a,
+  int len, int numcols, int stride, int parity);
+static void jpc_nsflt_liftstep(const jpc_qmfb_kernops_t *ops, float *a,
+  int len, int numcols, int stride, int parity, int lowpass, float c);
+static void jpc_nsflt_lift(const jpc_qmfb_kernops_t *ops, float *d,
+  float *s, int off, int n, int numcols, int stride, float c);
+static void jpc_nsflt_scale(const jpc_qmfb_kernops_t *ops, float *a, int n,
+  int numcols, int stride, float c);
+static int jpc_ft_analyzerow(jpc_fix_t *a, int xstart, int width);
+static int jpc_ft_synthesizerow(jpc_fix_t *a, int xstart, int width);
+static void jpc_ft_liftrow(const jpc_qmfb_kernops_t *ops, int inverse,
+  int stepno, jpc_fix_t *d, jpc_fix_t *s0, jpc_fix_t *s1, int numcols);
+static void jpc_ft_scalerow(const jpc_qmfb_kernops_t *ops, int inverse,
+  int lowpass, int numrows, jpc_fix_t *a, int numcols);
+static int jpc_ns_analyzerow(jpc_fix_t *a, int xstart, int width);
+static int jpc_ns_synthesizerow(jpc_fix_t *a, int xstart, int width);
+static void jpc_ns_liftrow(const jpc_qmfb_kernops_t *ops, int inverse,
+  int stepno, jpc_fix_t *d, jpc_fix_t *s0, jpc_fix_t *s1, int numcols);
+static void jpc_ns_scalerow(const jpc_qmfb_kernops_t *ops, int inverse,
+  int lowpass, int numrows, jpc_fix_t *a, int numcols);
+static int jpc_nsflt_analyzerow(jpc_fix_t *a, int xstart, int width);
+static int jpc_nsflt_synthesizerow(jpc_fix_t *a, int xstart, int width);
+static void jpc_nsflt_liftrow(const jpc_qmfb_kernops_t *ops, int inverse,
+  int stepno, jpc_fix_t *d, jpc_fix_t *s0, jpc_fix_t *s1, int numcols);
+static void jpc_nsflt_scalerow(const jpc_qmfb_kernops_t *ops, int inverse,
+  int lowpass, int numrows, jpc_fix_t *a, int numcols);
+
 int jpc_ft_analyze(jpc_fix_t *a, int xstart, int ystart, int width, int height,
   int stride);
 int jpc_ft_synthesize(int *a, int xstart, int ystart, int width, int height,
   int stride);
+int jpc_ft_analyze16(int_least16_t *a, int xstart, int ystart, int width,
+  int height, int stride);
+int jpc_ft_synthesize16(int_least16_t *a, int xstart, int ystart, int width,
+  int height, int stride);
 
 int jpc_ns_analyze(jpc_fix_t *a, int xstart, int ystart, int width, int height,
   int stride);
 int jpc_ns_synthesize(jpc_fix_t *a, int xstart, int ystart, int width,
   int height, int stride);
 
+int jpc_nsflt_analyze(jpc_fix_t *a, int xstart, int ystart, int width,
+  int height, int stride);
+int jpc_nsflt_synthesize(jpc_fix_t *a, int xstart, int ystart, int width,
+  int height, int stride);
+
 void jpc_ft_fwdlift_row(jpc_fix_t *a, int numcols, int parity);
 void jpc_ft_fwdlift_col(jpc_fix_t *a, int numrows, int stride,
   int parity);
@@ -288,14 +442,42 @@ jpc_qmfb2d_t jpc_ft_qmfb2d = {
 	jpc_ft_analyze,
 	jpc_ft_synthesize,
 	jpc_ft_lpenergywts,
-	jpc_ft_hpenergywts
+	jpc_ft_hpenergywts,
+	jpc_ft_analyze16,
+	jpc_ft_synthesize16,
+	jpc_ft_analyzerow,
+	jpc_ft_synthesizerow,
+	2,
+	jpc_ft_liftrow,
+	jpc_ft_scalerow
 };
 
 jpc_qmfb2d_t jpc_ns_qmfb2d = {
 	jpc_ns_analyze,
 	jpc_ns_synthesize,
 	jpc_ns_lpenergywts,
-	jpc_ns_hpenergywts
+	jpc_ns_hpenergywts,
+	0,
+	0,
+	jpc_ns_analyzerow,
+	jpc_ns_synthesizerow,
+	4,
+	jpc_ns_liftrow,
+	jpc_ns_scalerow
+};
+
+jpc_qmfb2d_t jpc_nsflt_qmfb2d = {
+	jpc_nsflt_analyze,
+	jpc_nsflt_synthesize,
+	jpc_ns_lpenergywts,
+	jpc_ns_hpenergywts,
+	0,
+	0,
+	jpc_nsflt_analyzerow,
+	jpc_nsflt_synthesizerow,
+	4,
+	jpc_nsflt_liftrow,
+	jpc_nsflt_scalerow
 };
 
 /******************************************************************************\
@@ -917,220 +1099,2903 @@ void jpc_qmfb_join_colres(jpc_fix_t *a, int numrows, int numcols,
 }
 
 /******************************************************************************\
-* 5/3 transform
+* Kernels
 \******************************************************************************/
 
-void jpc_ft_fwdlift_row(jpc_fix_t *a, int numcols, int parity)
-{
+/* Portable C */
 
-	register jpc_fix_t *lptr;
-	register jpc_fix_t *hptr;
-	register int n;
-	int llen;
+static void jpc_qmfb_liftadd_c(jpc_fix_t *d, jpc_fix_t *s, int off,
+  int numrows, int numcols, int stride, int round, int shift)
+{
+	int i;
 
-	llen = (numcols + 1 - parity) >> 1;
+	for (; numrows > 0; --numrows) {
+		for (i = 0; i < numcols; ++i) {
+			d[i] += (s[i] + s[i + off] + round) >> shift;
+		}
+		d += stride;
+		s += stride;
+	}
+}
 
-	if (numcols > 1) {
+static void jpc_qmfb_liftsub_c(jpc_fix_t *d, jpc_fix_t *s, int off,
+  int numrows, int numcols, int stride, int round, int shift)
+{
+	int i;
 
-		/* Apply the first lifting step. */
-		lptr = &a[0];
-		hptr = &a[llen];
-		if (parity) {
-			hptr[0] -= lptr[0];
-			++hptr;
-		}
-		n = numcols - llen - parity - (parity == (numcols & 1));
-		while (n-- > 0) {
-			hptr[0] -= (lptr[0] + lptr[1]) >> 1;
-			++hptr;
-			++lptr;
-		}
-		if (parity == (numcols & 1)) {
-			hptr[0] -= lptr[0];
+	for (; numrows > 0; --numrows) {
+		for (i = 0; i < numcols; ++i) {
+			d[i] -= (s[i] + s[i + off] + round) >> shift;
 		}
+		d += stride;
+		s += stride;
+	}
+}
 
-		/* Apply the second lifting step. */
-		lptr = &a[0];
-		hptr = &a[llen];
-		if (!parity) {
-			lptr[0] += (hptr[0] + 1) >> 1;
-			++lptr;
-		}
-		n = llen - (!parity) - (parity != (numcols & 1));
-		while (n-- > 0) {
-			lptr[0] += (hptr[0] + hptr[1] + 2) >> 2;
-			++lptr;
-			++hptr;
+static void jpc_qmfb_deinterleave_c(jpc_fix_t *a, jpc_fix_t *e,
+  jpc_fix_t *o, int n)
+{
+	jpc_fix_t t0;
+	jpc_fix_t t1;
+	int k;
+
+	for (k = 0; k < n; ++k) {
+		t0 = a[2 * k];
+		t1 = a[2 * k + 1];
+		e[k] = t0;
+		o[k] = t1;
+	}
+}
+
+static void jpc_qmfb_interleave_c(jpc_fix_t *a, jpc_fix_t *e,
+  jpc_fix_t *o, int n)
+{
+	jpc_fix_t t0;
+	jpc_fix_t t1;
+	int k;
+
+	for (k = 0; k < n; ++k) {
+		t0 = e[k];
+		t1 = o[k];
+		a[2 * k] = t0;
+		a[2 * k + 1] = t1;
+	}
+}
+
+static void jpc_qmfb_liftflt_c(float *d, float *s, int off, int numrows,
+  int numcols, int stride, float c)
+{
+	int i;
+
+	for (; numrows > 0; --numrows) {
+		for (i = 0; i < numcols; ++i) {
+			d[i] += c * (s[i] + s[i + off]);
 		}
-		if (parity != (numcols & 1)) {
-			lptr[0] += (hptr[0] + 1) >> 1;
+		d += stride;
+		s += stride;
+	}
+}
+
+static void jpc_qmfb_scaleflt_c(float *d, int numrows, int numcols,
+  int stride, float c)
+{
+	int i;
+
+	for (; numrows > 0; --numrows) {
+		for (i = 0; i < numcols; ++i) {
+			d[i] *= c;
 		}
+		d += stride;
+	}
+}
 
-	} else {
+static void jpc_qmfb_inttoflt_c(jpc_fix_t *a, int n, float scale)
+{
+	float *f = (float *) a;
+	int i;
 
-		if (parity) {
-			lptr = &a[0];
-			lptr[0] <<= 1;
+	for (i = 0; i < n; ++i) {
+		f[i] = (float) a[i] * scale;
+	}
+}
+
+/* Round toward minus infinity.  The vectorized kernels do the same. */
+static jpc_fix_t jpc_qmfb_floorflt(float x)
+{
+	jpc_fix_t t;
+
+	t = (jpc_fix_t) x;
+	if ((float) t > x) {
+		--t;
+	}
+	return t;
+}
+
+static void jpc_qmfb_flttoint_c(jpc_fix_t *a, int n, float offset,
+  float minval, float maxval)
+{
+	float *f = (float *) a;
+	float x;
+	int i;
+
+	for (i = 0; i < n; ++i) {
+		x = f[i] + offset;
+		if (x < minval) {
+			x = minval;
+		} else if (x > maxval) {
+			x = maxval;
 		}
+		a[i] = jpc_qmfb_floorflt(x);
+	}
+}
+
+static void jpc_qmfb_quantflt_c(jpc_fix_t *a, int n, float scale)
+{
+	float *f = (float *) a;
+	int i;
 
+	for (i = 0; i < n; ++i) {
+		a[i] = (jpc_fix_t) (f[i] * scale);
 	}
+}
+
+/* The color transforms use the same coefficients as jpc_ict and jpc_iict,
+  and all versions of them evaluate the terms in the same order. */
+
+static void jpc_qmfb_ictflt_c(float *c0, float *c1, float *c2, int n)
+{
+	float r;
+	float g;
+	float b;
+	int i;
 
+	for (i = 0; i < n; ++i) {
+		r = c0[i];
+		g = c1[i];
+		b = c2[i];
+		c0[i] = 0.299f * r + 0.587f * g + 0.114f * b;
+		c1[i] = -0.16875f * r + -0.33126f * g + 0.5f * b;
+		c2[i] = 0.5f * r + -0.41869f * g + -0.08131f * b;
+	}
 }
 
-void jpc_ft_fwdlift_col(jpc_fix_t *a, int numrows, int stride, int parity)
+static void jpc_qmfb_iictflt_c(float *c0, float *c1, float *c2, int n)
 {
+	float y;
+	float u;
+	float v;
+	int i;
 
-	jpc_fix_t *lptr;
-	jpc_fix_t *hptr;
-#if 0
-	register jpc_fix_t *lptr2;
-	register jpc_fix_t *hptr2;
-	register int i;
-#endif
-	register int n;
-	int llen;
+	for (i = 0; i < n; ++i) {
+		y = c0[i];
+		u = c1[i];
+		v = c2[i];
+		c0[i] = y + 1.402f * v;
+		c1[i] = y + -0.34413f * u + -0.71414f * v;
+		c2[i] = y + 1.772f * u;
+	}
+}
 
-	llen = (numrows + 1 - parity) >> 1;
+/* The 16-bit kernels form their sums in int, and so cannot overflow. */
 
-	if (numrows > 1) {
+static void jpc_qmfb_liftadd16_c(int_least16_t *d, int_least16_t *s,
+  int off, int numrows, int numcols, int stride, int round, int shift)
+{
+	int i;
 
-		/* Apply the first lifting step. */
-		lptr = &a[0];
-		hptr = &a[llen * stride];
-		if (parity) {
-			hptr[0] -= lptr[0];
-			hptr += stride;
-		}
-		n = numrows - llen - parity - (parity == (numrows & 1));
-		while (n-- > 0) {
-			hptr[0] -= (lptr[0] + lptr[stride]) >> 1;
-			hptr += stride;
-			lptr += stride;
-		}
-		if (parity == (numrows & 1)) {
-			hptr[0] -= lptr[0];
+	for (; numrows > 0; --numrows) {
+		for (i = 0; i < numcols; ++i) {
+			d[i] += (s[i] + s[i + off] + round) >> shift;
 		}
+		d += stride;
+		s += stride;
+	}
+}
 
-		/* Apply the second lifting step. */
-		lptr = &a[0];
-		hptr = &a[llen * stride];
-		if (!parity) {
-			lptr[0] += (hptr[0] + 1) >> 1;
-			lptr += stride;
+static void jpc_qmfb_liftsub16_c(int_least16_t *d, int_least16_t *s,
+  int off, int numrows, int numcols, int stride, int round, int shift)
+{
+	int i;
+
+	for (; numrows > 0; --numrows) {
+		for (i = 0; i < numcols; ++i) {
+			d[i] -= (s[i] + s[i + off] + round) >> shift;
 		}
-		n = llen - (!parity) - (parity != (numrows & 1));
-		while (n-- > 0) {
-			lptr[0] += (hptr[0] + hptr[stride] + 2) >> 2;
-			lptr += stride;
-			hptr += stride;
+		d += stride;
+		s += stride;
+	}
+}
+
+static void jpc_qmfb_deinterleave16_c(int_least16_t *a, int_least16_t *e,
+  int_least16_t *o, int n)
+{
+	int_least16_t t0;
+	int_least16_t t1;
+	int k;
+
+	for (k = 0; k < n; ++k) {
+		t0 = a[2 * k];
+		t1 = a[2 * k + 1];
+		e[k] = t0;
+		o[k] = t1;
+	}
+}
+
+static void jpc_qmfb_interleave16_c(int_least16_t *a, int_least16_t *e,
+  int_least16_t *o, int n)
+{
+	int_least16_t t0;
+	int_least16_t t1;
+	int k;
+
+	for (k = 0; k < n; ++k) {
+		t0 = e[k];
+		t1 = o[k];
+		a[2 * k] = t0;
+		a[2 * k + 1] = t1;
+	}
+}
+
+static int jpc_qmfb_pack16_c(jpc_fix_t *a, int_least16_t *b, int n,
+  int adjust)
+{
+	int maxmag;
+	int v;
+	int i;
+
+	maxmag = 0;
+	for (i = 0; i < n; ++i) {
+		v = a[i] + adjust;
+		if (v < -JPC_QMFB_MAX16 - 1) {
+			v = -JPC_QMFB_MAX16 - 1;
+		} else if (v > JPC_QMFB_MAX16) {
+			v = JPC_QMFB_MAX16;
 		}
-		if (parity != (numrows & 1)) {
-			lptr[0] += (hptr[0] + 1) >> 1;
+		b[i] = v;
+		if (JAS_ABS(v) > maxmag) {
+			maxmag = JAS_ABS(v);
 		}
+	}
+	return maxmag;
+}
 
-	} else {
+static void jpc_qmfb_unpack16_c(int_least16_t *b, jpc_fix_t *a, int n,
+  int adjust, int minval, int maxval)
+{
+	int v;
+	int i;
 
-		if (parity) {
-			lptr = &a[0];
-			lptr[0] <<= 1;
+	for (i = 0; i < n; ++i) {
+		v = b[i] + adjust;
+		if (v < minval) {
+			v = minval;
+		} else if (v > maxval) {
+			v = maxval;
 		}
-
+		a[i] = v;
 	}
+}
+
+/* The color transforms compute the same values as jpc_rct and jpc_irct. */
+
+static void jpc_qmfb_rct16_c(int_least16_t *c0, int_least16_t *c1,
+  int_least16_t *c2, int n)
+{
+	int r;
+	int g;
+	int b;
+	int i;
 
+	for (i = 0; i < n; ++i) {
+		r = c0[i];
+		g = c1[i];
+		b = c2[i];
+		c0[i] = (r + (g << 1) + b) >> 2;
+		c1[i] = b - g;
+		c2[i] = r - g;
+	}
 }
 
-void jpc_ft_fwdlift_colgrp(jpc_fix_t *a, int numrows, int stride, int parity)
+static void jpc_qmfb_irct16_c(int_least16_t *c0, int_least16_t *c1,
+  int_least16_t *c2, int n)
 {
+	int y;
+	int u;
+	int v;
+	int g;
+	int i;
 
-	jpc_fix_t *lptr;
-	jpc_fix_t *hptr;
-	register jpc_fix_t *lptr2;
-	register jpc_fix_t *hptr2;
-	register int n;
-	register int i;
-	int llen;
+	for (i = 0; i < n; ++i) {
+		y = c0[i];
+		u = c1[i];
+		v = c2[i];
+		g = y - ((u + v) >> 2);
+		c0[i] = v + g;
+		c1[i] = g;
+		c2[i] = u + g;
+	}
+}
 
-	llen = (numrows + 1 - parity) >> 1;
+static const jpc_qmfb_kernops_t jpc_qmfb_genericops = {
+	jpc_qmfb_liftadd_c,
+	jpc_qmfb_liftsub_c,
+	jpc_qmfb_deinterleave_c,
+	jpc_qmfb_interleave_c,
+	jpc_qmfb_liftflt_c,
+	jpc_qmfb_scaleflt_c,
+	jpc_qmfb_inttoflt_c,
+	jpc_qmfb_flttoint_c,
+	jpc_qmfb_quantflt_c,
+	jpc_qmfb_ictflt_c,
+	jpc_qmfb_iictflt_c,
+	jpc_qmfb_liftadd16_c,
+	jpc_qmfb_liftsub16_c,
+	jpc_qmfb_deinterleave16_c,
+	jpc_qmfb_interleave16_c,
+	jpc_qmfb_pack16_c,
+	jpc_qmfb_unpack16_c,
+	jpc_qmfb_rct16_c,
+	jpc_qmfb_irct16_c
+};
 
-	if (numrows > 1) {
+#if defined(JPC_QMFB_X86)
 
-		/* Apply the first lifting step. */
-		lptr = &a[0];
-		hptr = &a[llen * stride];
-		if (parity) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
-				hptr2[0] -= lptr2[0];
-				++hptr2;
-				++lptr2;
-			}
-			hptr += stride;
-		}
-		n = numrows - llen - parity - (parity == (numrows & 1));
-		while (n-- > 0) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
-				hptr2[0] -= (lptr2[0] + lptr2[stride]) >> 1;
-				++lptr2;
-				++hptr2;
-			}
-			hptr += stride;
-			lptr += stride;
-		}
-		if (parity == (numrows & 1)) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
-				hptr2[0] -= lptr2[0];
-				++lptr2;
-				++hptr2;
-			}
-		}
+/* SSE2 */
 
-		/* Apply the second lifting step. */
+JPC_QMFB_TARGET("sse2")
+static void jpc_qmfb_liftadd_sse2(jpc_fix_t *d, jpc_fix_t *s, int off,
+  int numrows, int numcols, int stride, int round, int shift)
+{
+	__m128i vround;
+	__m128i vshift;
+	__m128i x;
+	int i;
+
+	vround = _mm_set1_epi32(round);
+	vshift = _mm_cvtsi32_si128(shift);
+	for (; numrows > 0; --numrows) {
+		for (i = 0; i + 4 <= numcols; i += 4) {
+			x = _mm_add_epi32(_mm_loadu_si128((__m128i *) &s[i]),
+			  _mm_loadu_si128((__m128i *) &s[i + off]));
+			x = _mm_sra_epi32(_mm_add_epi32(x, vround), vshift);
+			_mm_storeu_si128((__m128i *) &d[i],
+			  _mm_add_epi32(_mm_loadu_si128((__m128i *) &d[i]), x));
+		}
+		for (; i < numcols; ++i) {
+			d[i] += (s[i] + s[i + off] + round) >> shift;
+		}
+		d += stride;
+		s += stride;
+	}
+}
+
+JPC_QMFB_TARGET("sse2")
+static void jpc_qmfb_liftsub_sse2(jpc_fix_t *d, jpc_fix_t *s, int off,
+  int numrows, int numcols, int stride, int round, int shift)
+{
+	__m128i vround;
+	__m128i vshift;
+	__m128i x;
+	int i;
+
+	vround = _mm_set1_epi32(round);
+	vshift = _mm_cvtsi32_si128(shift);
+	for (; numrows > 0; --numrows) {
+		for (i = 0; i + 4 <= numcols; i += 4) {
+			x = _mm_add_epi32(_mm_loadu_si128((__m128i *) &s[i]),
+			  _mm_loadu_si128((__m128i *) &s[i + off]));
+			x = _mm_sra_epi32(_mm_add_epi32(x, vround), vshift);
+			_mm_storeu_si128((__m128i *) &d[i],
+			  _mm_sub_epi32(_mm_loadu_si128((__m128i *) &d[i]), x));
+		}
+		for (; i < numcols; ++i) {
+			d[i] -= (s[i] + s[i + off] + round) >> shift;
+		}
+		d += stride;
+		s += stride;
+	}
+}
+
+JPC_QMFB_TARGET("sse2")
+static void jpc_qmfb_deinterleave_sse2(jpc_fix_t *a, jpc_fix_t *e,
+  jpc_fix_t *o, int n)
+{
+	__m128 x0;
+	__m128 x1;
+	jpc_fix_t t0;
+	jpc_fix_t t1;
+	int k;
+
+	for (k = 0; k + 4 <= n; k += 4) {
+		x0 = _mm_castsi128_ps(_mm_loadu_si128((__m128i *) &a[2 * k]));
+		x1 = _mm_castsi128_ps(_mm_loadu_si128((__m128i *) &a[2 * k + 4]));
+		_mm_storeu_si128((__m128i *) &e[k], _mm_castps_si128(
+		  _mm_shuffle_ps(x0, x1, _MM_SHUFFLE(2, 0, 2, 0))));
+		_mm_storeu_si128((__m128i *) &o[k], _mm_castps_si128(
+		  _mm_shuffle_ps(x0, x1, _MM_SHUFFLE(3, 1, 3, 1))));
+	}
+	for (; k < n; ++k) {
+		t0 = a[2 * k];
+		t1 = a[2 * k + 1];
+		e[k] = t0;
+		o[k] = t1;
+	}
+}
+
+JPC_QMFB_TARGET("sse2")
+static void jpc_qmfb_interleave_sse2(jpc_fix_t *a, jpc_fix_t *e,
+  jpc_fix_t *o, int n)
+{
+	__m128i x0;
+	__m128i x1;
+	jpc_fix_t t0;
+	jpc_fix_t t1;
+	int k;
+
+	for (k = 0; k + 4 <= n; k += 4) {
+		x0 = _mm_loadu_si128((__m128i *) &e[k]);
+		x1 = _mm_loadu_si128((__m128i *) &o[k]);
+		_mm_storeu_si128((__m128i *) &a[2 * k], _mm_unpacklo_epi32(x0, x1));
+		_mm_storeu_si128((__m128i *) &a[2 * k + 4],
+		  _mm_unpackhi_epi32(x0, x1));
+	}
+	for (; k < n; ++k) {
+		t0 = e[k];
+		t1 = o[k];
+		a[2 * k] = t0;
+		a[2 * k + 1] = t1;
+	}
+}
+
+JPC_QMFB_TARGET("sse2")
+static void jpc_qmfb_liftflt_sse2(float *d, float *s, int off, int numrows,
+  int numcols, int stride, float c)
+{
+	__m128 vc;
+	__m128 x;
+	int i;
+
+	vc = _mm_set1_ps(c);
+	for (; numrows > 0; --numrows) {
+		for (i = 0; i + 4 <= numcols; i += 4) {
+			x = _mm_add_ps(_mm_loadu_ps(&s[i]), _mm_loadu_ps(&s[i + off]));
+			_mm_storeu_ps(&d[i], _mm_add_ps(_mm_loadu_ps(&d[i]),
+			  _mm_mul_ps(vc, x)));
+		}
+		for (; i < numcols; ++i) {
+			d[i] += c * (s[i] + s[i + off]);
+		}
+		d += stride;
+		s += stride;
+	}
+}
+
+JPC_QMFB_TARGET("sse2")
+static void jpc_qmfb_scaleflt_sse2(float *d, int numrows, int numcols,
+  int stride, float c)
+{
+	__m128 vc;
+	int i;
+
+	vc = _mm_set1_ps(c);
+	for (; numrows > 0; --numrows) {
+		for (i = 0; i + 4 <= numcols; i += 4) {
+			_mm_storeu_ps(&d[i], _mm_mul_ps(_mm_loadu_ps(&d[i]), vc));
+		}
+		for (; i < numcols; ++i) {
+			d[i] *= c;
+		}
+		d += stride;
+	}
+}
+
+JPC_QMFB_TARGET("sse2")
+static void jpc_qmfb_inttoflt_sse2(jpc_fix_t *a, int n, float scale)
+{
+	float *f = (float *) a;
+	__m128 vscale;
+	int i;
+
+	vscale = _mm_set1_ps(scale);
+	for (i = 0; i + 4 <= n; i += 4) {
+		_mm_storeu_ps(&f[i], _mm_mul_ps(_mm_cvtepi32_ps(
+		  _mm_loadu_si128((__m128i *) &a[i])), vscale));
+	}
+	for (; i < n; ++i) {
+		f[i] = (float) a[i] * scale;
+	}
+}
+
+JPC_QMFB_TARGET("sse2")
+static void jpc_qmfb_flttoint_sse2(jpc_fix_t *a, int n, float offset,
+  float minval, float maxval)
+{
+	float *f = (float *) a;
+	__m128 voffset;
+	__m128 vminval;
+	__m128 vmaxval;
+	__m128 x;
+	__m128i t;
+	float y;
+	int i;
+
+	voffset = _mm_set1_ps(offset);
+	vminval = _mm_set1_ps(minval);
+	vmaxval = _mm_set1_ps(maxval);
+	for (i = 0; i + 4 <= n; i += 4) {
+		x = _mm_add_ps(_mm_loadu_ps(&f[i]), voffset);
+		x = _mm_min_ps(_mm_max_ps(x, vminval), vmaxval);
+		/* Truncate, and then correct the negative values that were rounded
+		  up. */
+		t = _mm_cvttps_epi32(x);
+		t = _mm_add_epi32(t, _mm_castps_si128(_mm_cmpgt_ps(
+		  _mm_cvtepi32_ps(t), x)));
+		_mm_storeu_si128((__m128i *) &a[i], t);
+	}
+	for (; i < n; ++i) {
+		y = f[i] + offset;
+		if (y < minval) {
+			y = minval;
+		} else if (y > maxval) {
+			y = maxval;
+		}
+		a[i] = jpc_qmfb_floorflt(y);
+	}
+}
+
+JPC_QMFB_TARGET("sse2")
+static void jpc_qmfb_quantflt_sse2(jpc_fix_t *a, int n, float scale)
+{
+	float *f = (float *) a;
+	__m128 vscale;
+	int i;
+
+	vscale = _mm_set1_ps(scale);
+	for (i = 0; i + 4 <= n; i += 4) {
+		_mm_storeu_si128((__m128i *) &a[i], _mm_cvttps_epi32(
+		  _mm_mul_ps(_mm_loadu_ps(&f[i]), vscale)));
+	}
+	for (; i < n; ++i) {
+		a[i] = (jpc_fix_t) (f[i] * scale);
+	}
+}
+
+JPC_QMFB_TARGET("sse2")
+static void jpc_qmfb_ictflt_sse2(float *c0, float *c1, float *c2, int n)
+{
+	__m128 r;
+	__m128 g;
+	__m128 b;
+	int i;
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		r = _mm_loadu_ps(&c0[i]);
+		g = _mm_loadu_ps(&c1[i]);
+		b = _mm_loadu_ps(&c2[i]);
+		_mm_storeu_ps(&c0[i], _mm_add_ps(_mm_add_ps(
+		  _mm_mul_ps(_mm_set1_ps(0.299f), r),
+		  _mm_mul_ps(_mm_set1_ps(0.587f), g)),
+		  _mm_mul_ps(_mm_set1_ps(0.114f), b)));
+		_mm_storeu_ps(&c1[i], _mm_add_ps(_mm_add_ps(
+		  _mm_mul_ps(_mm_set1_ps(-0.16875f), r),
+		  _mm_mul_ps(_mm_set1_ps(-0.33126f), g)),
+		  _mm_mul_ps(_mm_set1_ps(0.5f), b)));
+		_mm_storeu_ps(&c2[i], _mm_add_ps(_mm_add_ps(
+		  _mm_mul_ps(_mm_set1_ps(0.5f), r),
+		  _mm_mul_ps(_mm_set1_ps(-0.41869f), g)),
+		  _mm_mul_ps(_mm_set1_ps(-0.08131f), b)));
+	}
+	if (i < n) {
+		jpc_qmfb_ictflt_c(&c0[i], &c1[i], &c2[i], n - i);
+	}
+}
+
+JPC_QMFB_TARGET("sse2")
+static void jpc_qmfb_iictflt_sse2(float *c0, float *c1, float *c2, int n)
+{
+	__m128 y;
+	__m128 u;
+	__m128 v;
+	int i;
+
+	for (i = 0; i + 4 <= n; i += 4) {
+		y = _mm_loadu_ps(&c0[i]);
+		u = _mm_loadu_ps(&c1[i]);
+		v = _mm_loadu_ps(&c2[i]);
+		_mm_storeu_ps(&c0[i], _mm_add_ps(y,
+		  _mm_mul_ps(_mm_set1_ps(1.402f), v)));
+		_mm_storeu_ps(&c1[i], _mm_add_ps(_mm_add_ps(y,
+		  _mm_mul_ps(_mm_set1_ps(-0.34413f), u)),
+		  _mm_mul_ps(_mm_set1_ps(-0.71414f), v)));
+		_mm_storeu_ps(&c2[i], _mm_add_ps(y,
+		  _mm_mul_ps(_mm_set1_ps(1.772f), u)));
+	}
+	if (i < n) {
+		jpc_qmfb_iictflt_c(&c0[i], &c1[i], &c2[i], n - i);
+	}
+}
+
+/* Compute floor((a + b) / 2) for 16-bit samples without overflow.  The
+  unsigned average of the biased samples rounds up, so odd sums are then
+  corrected. */
+JPC_QMFB_TARGET("sse2")
+static __m128i jpc_qmfb_avg16_sse2(__m128i a, __m128i b)
+{
+	__m128i bias;
+
+	bias = _mm_set1_epi16(-0x8000);
+	return _mm_sub_epi16(_mm_xor_si128(_mm_avg_epu16(_mm_xor_si128(a, bias),
+	  _mm_xor_si128(b, bias)), bias), _mm_and_si128(_mm_xor_si128(a, b),
+	  _mm_set1_epi16(1)));
+}
+
+/* Compute (s0 + s1 + round) >> shift for either step of the 5/3 transform.
+  For the second step, this is floor((floor((s0 + s1) / 2) + 1) / 2). */
+JPC_QMFB_TARGET("sse2")
+static __m128i jpc_qmfb_liftterm16_sse2(__m128i s0, __m128i s1, int shift)
+{
+	__m128i x;
+
+	x = jpc_qmfb_avg16_sse2(s0, s1);
+	if (shift > 1) {
+		x = _mm_add_epi16(_mm_srai_epi16(x, 1), _mm_and_si128(x,
+		  _mm_set1_epi16(1)));
+	}
+	return x;
+}
+
+JPC_QMFB_TARGET("sse2")
+static void jpc_qmfb_liftadd16_sse2(int_least16_t *d, int_least16_t *s,
+  int off, int numrows, int numcols, int stride, int round, int shift)
+{
+	__m128i x;
+	int i;
+
+	for (; numrows > 0; --numrows) {
+		for (i = 0; i + 8 <= numcols; i += 8) {
+			x = jpc_qmfb_liftterm16_sse2(_mm_loadu_si128((__m128i *) &s[i]),
+			  _mm_loadu_si128((__m128i *) &s[i + off]), shift);
+			_mm_storeu_si128((__m128i *) &d[i],
+			  _mm_add_epi16(_mm_loadu_si128((__m128i *) &d[i]), x));
+		}
+		for (; i < numcols; ++i) {
+			d[i] += (s[i] + s[i + off] + round) >> shift;
+		}
+		d += stride;
+		s += stride;
+	}
+}
+
+JPC_QMFB_TARGET("sse2")
+static void jpc_qmfb_liftsub16_sse2(int_least16_t *d, int_least16_t *s,
+  int off, int numrows, int numcols, int stride, int round, int shift)
+{
+	__m128i x;
+	int i;
+
+	for (; numrows > 0; --numrows) {
+		for (i = 0; i + 8 <= numcols; i += 8) {
+			x = jpc_qmfb_liftterm16_sse2(_mm_loadu_si128((__m128i *) &s[i]),
+			  _mm_loadu_si128((__m128i *) &s[i + off]), shift);
+			_mm_storeu_si128((__m128i *) &d[i],
+			  _mm_sub_epi16(_mm_loadu_si128((__m128i *) &d[i]), x));
+		}
+		for (; i < numcols; ++i) {
+			d[i] -= (s[i] + s[i + off] + round) >> shift;
+		}
+		d += stride;
+		s += stride;
+	}
+}
+
+JPC_QMFB_TARGET("sse2")
+static void jpc_qmfb_deinterleave16_sse2(int_least16_t *a, int_least16_t *e,
+  int_least16_t *o, int n)
+{
+	__m128i x0;
+	__m128i x1;
+	int_least16_t t0;
+	int_least16_t t1;
+	int k;
+
+	for (k = 0; k + 8 <= n; k += 8) {
+		x0 = _mm_loadu_si128((__m128i *) &a[2 * k]);
+		x1 = _mm_loadu_si128((__m128i *) &a[2 * k + 8]);
+		/* Each pair of samples is a 32-bit lane.  The samples are sign
+		  extended in their lanes, so that packing cannot saturate. */
+		_mm_storeu_si128((__m128i *) &e[k], _mm_packs_epi32(
+		  _mm_srai_epi32(_mm_slli_epi32(x0, 16), 16),
+		  _mm_srai_epi32(_mm_slli_epi32(x1, 16), 16)));
+		_mm_storeu_si128((__m128i *) &o[k], _mm_packs_epi32(
+		  _mm_srai_epi32(x0, 16), _mm_srai_epi32(x1, 16)));
+	}
+	for (; k < n; ++k) {
+		t0 = a[2 * k];
+		t1 = a[2 * k + 1];
+		e[k] = t0;
+		o[k] = t1;
+	}
+}
+
+JPC_QMFB_TARGET("sse2")
+static void jpc_qmfb_interleave16_sse2(int_least16_t *a, int_least16_t *e,
+  int_least16_t *o, int n)
+{
+	__m128i x0;
+	__m128i x1;
+	int_least16_t t0;
+	int_least16_t t1;
+	int k;
+
+	for (k = 0; k + 8 <= n; k += 8) {
+		x0 = _mm_loadu_si128((__m128i *) &e[k]);
+		x1 = _mm_loadu_si128((__m128i *) &o[k]);
+		_mm_storeu_si128((__m128i *) &a[2 * k], _mm_unpacklo_epi16(x0, x1));
+		_mm_storeu_si128((__m128i *) &a[2 * k + 8],
+		  _mm_unpackhi_epi16(x0, x1));
+	}
+	for (; k < n; ++k) {
+		t0 = e[k];
+		t1 = o[k];
+		a[2 * k] = t0;
+		a[2 * k + 1] = t1;
+	}
+}
+
+JPC_QMFB_TARGET("sse2")
+static int jpc_qmfb_pack16_sse2(jpc_fix_t *a, int_least16_t *b, int n,
+  int adjust)
+{
+	__m128i vadjust;
+	__m128i vmin;
+	__m128i vmax;
+	__m128i x;
+	int_least16_t t[8];
+	int maxmag;
+	int i;
+
+	vadjust = _mm_set1_epi32(adjust);
+	vmin = _mm_setzero_si128();
+	vmax = _mm_setzero_si128();
+	for (i = 0; i + 8 <= n; i += 8) {
+		x = _mm_packs_epi32(_mm_add_epi32(_mm_loadu_si128((__m128i *) &a[i]),
+		  vadjust), _mm_add_epi32(_mm_loadu_si128((__m128i *) &a[i + 4]),
+		  vadjust));
+		_mm_storeu_si128((__m128i *) &b[i], x);
+		vmin = _mm_min_epi16(vmin, x);
+		vmax = _mm_max_epi16(vmax, x);
+	}
+	maxmag = jpc_qmfb_pack16_c(&a[i], &b[i], n - i, adjust);
+	_mm_storeu_si128((__m128i *) t, vmax);
+	for (i = 0; i < 8; ++i) {
+		maxmag = JAS_MAX(maxmag, t[i]);
+	}
+	_mm_storeu_si128((__m128i *) t, vmin);
+	for (i = 0; i < 8; ++i) {
+		maxmag = JAS_MAX(maxmag, -t[i]);
+	}
+	return maxmag;
+}
+
+JPC_QMFB_TARGET("sse2")
+static void jpc_qmfb_unpack16_sse2(int_least16_t *b, jpc_fix_t *a, int n,
+  int adjust, int minval, int maxval)
+{
+	__m128i vadjust;
+	__m128i vmin;
+	__m128i vmax;
+	__m128i x;
+	int i;
+
+	/* Clip before the level shift, while the samples are still 16 bits
+	  wide. */
+	vadjust = _mm_set1_epi32(adjust);
+	vmin = _mm_set1_epi16(JAS_MIN(JAS_MAX(minval - adjust,
+	  -JPC_QMFB_MAX16 - 1), JPC_QMFB_MAX16));
+	vmax = _mm_set1_epi16(JAS_MIN(JAS_MAX(maxval - adjust,
+	  -JPC_QMFB_MAX16 - 1), JPC_QMFB_MAX16));
+	for (i = 0; i + 8 <= n; i += 8) {
+		x = _mm_min_epi16(_mm_max_epi16(_mm_loadu_si128((__m128i *) &b[i]),
+		  vmin), vmax);
+		_mm_storeu_si128((__m128i *) &a[i], _mm_add_epi32(_mm_srai_epi32(
+		  _mm_unpacklo_epi16(x, x), 16), vadjust));
+		_mm_storeu_si128((__m128i *) &a[i + 4], _mm_add_epi32(
+		  _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16), vadjust));
+	}
+	jpc_qmfb_unpack16_c(&b[i], &a[i], n - i, adjust, minval, maxval);
+}
+
+JPC_QMFB_TARGET("sse2")
+static void jpc_qmfb_rct16_sse2(int_least16_t *c0, int_least16_t *c1,
+  int_least16_t *c2, int n)
+{
+	__m128i r;
+	__m128i g;
+	__m128i b;
+	int i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		r = _mm_loadu_si128((__m128i *) &c0[i]);
+		g = _mm_loadu_si128((__m128i *) &c1[i]);
+		b = _mm_loadu_si128((__m128i *) &c2[i]);
+		/* (r + 2g + b) >> 2 is the average of g and the average of r and
+		  b. */
+		_mm_storeu_si128((__m128i *) &c0[i], jpc_qmfb_avg16_sse2(
+		  jpc_qmfb_avg16_sse2(r, b), g));
+		_mm_storeu_si128((__m128i *) &c1[i], _mm_sub_epi16(b, g));
+		_mm_storeu_si128((__m128i *) &c2[i], _mm_sub_epi16(r, g));
+	}
+	jpc_qmfb_rct16_c(&c0[i], &c1[i], &c2[i], n - i);
+}
+
+JPC_QMFB_TARGET("sse2")
+static void jpc_qmfb_irct16_sse2(int_least16_t *c0, int_least16_t *c1,
+  int_least16_t *c2, int n)
+{
+	__m128i u;
+	__m128i v;
+	__m128i g;
+	int i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		u = _mm_loadu_si128((__m128i *) &c1[i]);
+		v = _mm_loadu_si128((__m128i *) &c2[i]);
+		g = _mm_sub_epi16(_mm_loadu_si128((__m128i *) &c0[i]),
+		  _mm_srai_epi16(jpc_qmfb_avg16_sse2(u, v), 1));
+		_mm_storeu_si128((__m128i *) &c0[i], _mm_add_epi16(v, g));
+		_mm_storeu_si128((__m128i *) &c1[i], g);
+		_mm_storeu_si128((__m128i *) &c2[i], _mm_add_epi16(u, g));
+	}
+	jpc_qmfb_irct16_c(&c0[i], &c1[i], &c2[i], n - i);
+}
+
+static const jpc_qmfb_kernops_t jpc_qmfb_sse2ops = {
+	jpc_qmfb_liftadd_sse2,
+	jpc_qmfb_liftsub_sse2,
+	jpc_qmfb_deinterleave_sse2,
+	jpc_qmfb_interleave_sse2,
+	jpc_qmfb_liftflt_sse2,
+	jpc_qmfb_scaleflt_sse2,
+	jpc_qmfb_inttoflt_sse2,
+	jpc_qmfb_flttoint_sse2,
+	jpc_qmfb_quantflt_sse2,
+	jpc_qmfb_ictflt_sse2,
+	jpc_qmfb_iictflt_sse2,
+	jpc_qmfb_liftadd16_sse2,
+	jpc_qmfb_liftsub16_sse2,
+	jpc_qmfb_deinterleave16_sse2,
+	jpc_qmfb_interleave16_sse2,
+	jpc_qmfb_pack16_sse2,
+	jpc_qmfb_unpack16_sse2,
+	jpc_qmfb_rct16_sse2,
+	jpc_qmfb_irct16_sse2
+};
+
+/* AVX2 */
+
+JPC_QMFB_TARGET("avx2")
+static void jpc_qmfb_liftadd_avx2(jpc_fix_t *d, jpc_fix_t *s, int off,
+  int numrows, int numcols, int stride, int round, int shift)
+{
+	__m256i vround;
+	__m128i vshift;
+	__m256i x;
+	int i;
+
+	vround = _mm256_set1_epi32(round);
+	vshift = _mm_cvtsi32_si128(shift);
+	for (; numrows > 0; --numrows) {
+		for (i = 0; i + 8 <= numcols; i += 8) {
+			x = _mm256_add_epi32(_mm256_loadu_si256((__m256i *) &s[i]),
+			  _mm256_loadu_si256((__m256i *) &s[i + off]));
+			x = _mm256_sra_epi32(_mm256_add_epi32(x, vround), vshift);
+			_mm256_storeu_si256((__m256i *) &d[i], _mm256_add_epi32(
+			  _mm256_loadu_si256((__m256i *) &d[i]), x));
+		}
+		for (; i < numcols; ++i) {
+			d[i] += (s[i] + s[i + off] + round) >> shift;
+		}
+		d += stride;
+		s += stride;
+	}
+}
+
+JPC_QMFB_TARGET("avx2")
+static void jpc_qmfb_liftsub_avx2(jpc_fix_t *d, jpc_fix_t *s, int off,
+  int numrows, int numcols, int stride, int round, int shift)
+{
+	__m256i vround;
+	__m128i vshift;
+	__m256i x;
+	int i;
+
+	vround = _mm256_set1_epi32(round);
+	vshift = _mm_cvtsi32_si128(shift);
+	for (; numrows > 0; --numrows) {
+		for (i = 0; i + 8 <= numcols; i += 8) {
+			x = _mm256_add_epi32(_mm256_loadu_si256((__m256i *) &s[i]),
+			  _mm256_loadu_si256((__m256i *) &s[i + off]));
+			x = _mm256_sra_epi32(_mm256_add_epi32(x, vround), vshift);
+			_mm256_storeu_si256((__m256i *) &d[i], _mm256_sub_epi32(
+			  _mm256_loadu_si256((__m256i *) &d[i]), x));
+		}
+		for (; i < numcols; ++i) {
+			d[i] -= (s[i] + s[i + off] + round) >> shift;
+		}
+		d += stride;
+		s += stride;
+	}
+}
+
+JPC_QMFB_TARGET("avx2")
+static void jpc_qmfb_deinterleave_avx2(jpc_fix_t *a, jpc_fix_t *e,
+  jpc_fix_t *o, int n)
+{
+	__m256 x0;
+	__m256 x1;
+	jpc_fix_t t0;
+	jpc_fix_t t1;
+	int k;
+
+	for (k = 0; k + 8 <= n; k += 8) {
+		x0 = _mm256_castsi256_ps(_mm256_loadu_si256((__m256i *) &a[2 * k]));
+		x1 = _mm256_castsi256_ps(_mm256_loadu_si256(
+		  (__m256i *) &a[2 * k + 8]));
+		/* The shuffles work within 128-bit lanes, so the 64-bit halves
+		  of the lanes need to be put back in order. */
+		_mm256_storeu_si256((__m256i *) &e[k], _mm256_permute4x64_epi64(
+		  _mm256_castps_si256(_mm256_shuffle_ps(x0, x1,
+		  _MM_SHUFFLE(2, 0, 2, 0))), _MM_SHUFFLE(3, 1, 2, 0)));
+		_mm256_storeu_si256((__m256i *) &o[k], _mm256_permute4x64_epi64(
+		  _mm256_castps_si256(_mm256_shuffle_ps(x0, x1,
+		  _MM_SHUFFLE(3, 1, 3, 1))), _MM_SHUFFLE(3, 1, 2, 0)));
+	}
+	for (; k < n; ++k) {
+		t0 = a[2 * k];
+		t1 = a[2 * k + 1];
+		e[k] = t0;
+		o[k] = t1;
+	}
+}
+
+JPC_QMFB_TARGET("avx2")
+static void jpc_qmfb_interleave_avx2(jpc_fix_t *a, jpc_fix_t *e,
+  jpc_fix_t *o, int n)
+{
+	__m256i x0;
+	__m256i x1;
+	__m256i lo;
+	__m256i hi;
+	jpc_fix_t t0;
+	jpc_fix_t t1;
+	int k;
+
+	for (k = 0; k + 8 <= n; k += 8) {
+		x0 = _mm256_loadu_si256((__m256i *) &e[k]);
+		x1 = _mm256_loadu_si256((__m256i *) &o[k]);
+		lo = _mm256_unpacklo_epi32(x0, x1);
+		hi = _mm256_unpackhi_epi32(x0, x1);
+		_mm256_storeu_si256((__m256i *) &a[2 * k],
+		  _mm256_permute2x128_si256(lo, hi, 0x20));
+		_mm256_storeu_si256((__m256i *) &a[2 * k + 8],
+		  _mm256_permute2x128_si256(lo, hi, 0x31));
+	}
+	for (; k < n; ++k) {
+		t0 = e[k];
+		t1 = o[k];
+		a[2 * k] = t0;
+		a[2 * k + 1] = t1;
+	}
+}
+
+JPC_QMFB_TARGET("avx2")
+static void jpc_qmfb_liftflt_avx2(float *d, float *s, int off, int numrows,
+  int numcols, int stride, float c)
+{
+	__m256 vc;
+	__m256 x;
+	int i;
+
+	vc = _mm256_set1_ps(c);
+	for (; numrows > 0; --numrows) {
+		for (i = 0; i + 8 <= numcols; i += 8) {
+			x = _mm256_add_ps(_mm256_loadu_ps(&s[i]), _mm256_loadu_ps(&s[i + off]));
+			_mm256_storeu_ps(&d[i], _mm256_add_ps(_mm256_loadu_ps(&d[i]),
+			  _mm256_mul_ps(vc, x)));
+		}
+		for (; i < numcols; ++i) {
+			d[i] += c * (s[i] + s[i + off]);
+		}
+		d += stride;
+		s += stride;
+	}
+}
+
+JPC_QMFB_TARGET("avx2")
+static void jpc_qmfb_scaleflt_avx2(float *d, int numrows, int numcols,
+  int stride, float c)
+{
+	__m256 vc;
+	int i;
+
+	vc = _mm256_set1_ps(c);
+	for (; numrows > 0; --numrows) {
+		for (i = 0; i + 8 <= numcols; i += 8) {
+			_mm256_storeu_ps(&d[i], _mm256_mul_ps(_mm256_loadu_ps(&d[i]), vc));
+		}
+		for (; i < numcols; ++i) {
+			d[i] *= c;
+		}
+		d += stride;
+	}
+}
+
+JPC_QMFB_TARGET("avx2")
+static void jpc_qmfb_inttoflt_avx2(jpc_fix_t *a, int n, float scale)
+{
+	float *f = (float *) a;
+	__m256 vscale;
+	int i;
+
+	vscale = _mm256_set1_ps(scale);
+	for (i = 0; i + 8 <= n; i += 8) {
+		_mm256_storeu_ps(&f[i], _mm256_mul_ps(_mm256_cvtepi32_ps(
+		  _mm256_loadu_si256((__m256i *) &a[i])), vscale));
+	}
+	for (; i < n; ++i) {
+		f[i] = (float) a[i] * scale;
+	}
+}
+
+JPC_QMFB_TARGET("avx2")
+static void jpc_qmfb_flttoint_avx2(jpc_fix_t *a, int n, float offset,
+  float minval, float maxval)
+{
+	float *f = (float *) a;
+	__m256 voffset;
+	__m256 vminval;
+	__m256 vmaxval;
+	__m256 x;
+	__m256i t;
+	float y;
+	int i;
+
+	voffset = _mm256_set1_ps(offset);
+	vminval = _mm256_set1_ps(minval);
+	vmaxval = _mm256_set1_ps(maxval);
+	for (i = 0; i + 8 <= n; i += 8) {
+		x = _mm256_add_ps(_mm256_loadu_ps(&f[i]), voffset);
+		x = _mm256_min_ps(_mm256_max_ps(x, vminval), vmaxval);
+		/* Truncate, and then correct the negative values that were rounded
+		  up. */
+		t = _mm256_cvttps_epi32(x);
+		t = _mm256_add_epi32(t, _mm256_castps_si256(_mm256_cmp_ps(
+		  _mm256_cvtepi32_ps(t), x, _CMP_GT_OQ)));
+		_mm256_storeu_si256((__m256i *) &a[i], t);
+	}
+	for (; i < n; ++i) {
+		y = f[i] + offset;
+		if (y < minval) {
+			y = minval;
+		} else if (y > maxval) {
+			y = maxval;
+		}
+		a[i] = jpc_qmfb_floorflt(y);
+	}
+}
+
+JPC_QMFB_TARGET("avx2")
+static void jpc_qmfb_quantflt_avx2(jpc_fix_t *a, int n, float scale)
+{
+	float *f = (float *) a;
+	__m256 vscale;
+	int i;
+
+	vscale = _mm256_set1_ps(scale);
+	for (i = 0; i + 8 <= n; i += 8) {
+		_mm256_storeu_si256((__m256i *) &a[i], _mm256_cvttps_epi32(
+		  _mm256_mul_ps(_mm256_loadu_ps(&f[i]), vscale)));
+	}
+	for (; i < n; ++i) {
+		a[i] = (jpc_fix_t) (f[i] * scale);
+	}
+}
+
+JPC_QMFB_TARGET("avx2")
+static void jpc_qmfb_ictflt_avx2(float *c0, float *c1, float *c2, int n)
+{
+	__m256 r;
+	__m256 g;
+	__m256 b;
+	int i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		r = _mm256_loadu_ps(&c0[i]);
+		g = _mm256_loadu_ps(&c1[i]);
+		b = _mm256_loadu_ps(&c2[i]);
+		_mm256_storeu_ps(&c0[i], _mm256_add_ps(_mm256_add_ps(
+		  _mm256_mul_ps(_mm256_set1_ps(0.299f), r),
+		  _mm256_mul_ps(_mm256_set1_ps(0.587f), g)),
+		  _mm256_mul_ps(_mm256_set1_ps(0.114f), b)));
+		_mm256_storeu_ps(&c1[i], _mm256_add_ps(_mm256_add_ps(
+		  _mm256_mul_ps(_mm256_set1_ps(-0.16875f), r),
+		  _mm256_mul_ps(_mm256_set1_ps(-0.33126f), g)),
+		  _mm256_mul_ps(_mm256_set1_ps(0.5f), b)));
+		_mm256_storeu_ps(&c2[i], _mm256_add_ps(_mm256_add_ps(
+		  _mm256_mul_ps(_mm256_set1_ps(0.5f), r),
+		  _mm256_mul_ps(_mm256_set1_ps(-0.41869f), g)),
+		  _mm256_mul_ps(_mm256_set1_ps(-0.08131f), b)));
+	}
+	if (i < n) {
+		jpc_qmfb_ictflt_c(&c0[i], &c1[i], &c2[i], n - i);
+	}
+}
+
+JPC_QMFB_TARGET("avx2")
+static void jpc_qmfb_iictflt_avx2(float *c0, float *c1, float *c2, int n)
+{
+	__m256 y;
+	__m256 u;
+	__m256 v;
+	int i;
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		y = _mm256_loadu_ps(&c0[i]);
+		u = _mm256_loadu_ps(&c1[i]);
+		v = _mm256_loadu_ps(&c2[i]);
+		_mm256_storeu_ps(&c0[i], _mm256_add_ps(y,
+		  _mm256_mul_ps(_mm256_set1_ps(1.402f), v)));
+		_mm256_storeu_ps(&c1[i], _mm256_add_ps(_mm256_add_ps(y,
+		  _mm256_mul_ps(_mm256_set1_ps(-0.34413f), u)),
+		  _mm256_mul_ps(_mm256_set1_ps(-0.71414f), v)));
+		_mm256_storeu_ps(&c2[i], _mm256_add_ps(y,
+		  _mm256_mul_ps(_mm256_set1_ps(1.772f), u)));
+	}
+	if (i < n) {
+		jpc_qmfb_iictflt_c(&c0[i], &c1[i], &c2[i], n - i);
+	}
+}
+
+/* As jpc_qmfb_avg16_sse2. */
+JPC_QMFB_TARGET("avx2")
+static __m256i jpc_qmfb_avg16_avx2(__m256i a, __m256i b)
+{
+	__m256i bias;
+
+	bias = _mm256_set1_epi16(-0x8000);
+	return _mm256_sub_epi16(_mm256_xor_si256(_mm256_avg_epu16(
+	  _mm256_xor_si256(a, bias), _mm256_xor_si256(b, bias)), bias),
+	  _mm256_and_si256(_mm256_xor_si256(a, b), _mm256_set1_epi16(1)));
+}
+
+/* As jpc_qmfb_liftterm16_sse2. */
+JPC_QMFB_TARGET("avx2")
+static __m256i jpc_qmfb_liftterm16_avx2(__m256i s0, __m256i s1, int shift)
+{
+	__m256i x;
+
+	x = jpc_qmfb_avg16_avx2(s0, s1);
+	if (shift > 1) {
+		x = _mm256_add_epi16(_mm256_srai_epi16(x, 1), _mm256_and_si256(x,
+		  _mm256_set1_epi16(1)));
+	}
+	return x;
+}
+
+JPC_QMFB_TARGET("avx2")
+static void jpc_qmfb_liftadd16_avx2(int_least16_t *d, int_least16_t *s,
+  int off, int numrows, int numcols, int stride, int round, int shift)
+{
+	__m256i x;
+	int i;
+
+	for (; numrows > 0; --numrows) {
+		for (i = 0; i + 16 <= numcols; i += 16) {
+			x = jpc_qmfb_liftterm16_avx2(_mm256_loadu_si256((__m256i *) &s[i]),
+			  _mm256_loadu_si256((__m256i *) &s[i + off]), shift);
+			_mm256_storeu_si256((__m256i *) &d[i],
+			  _mm256_add_epi16(_mm256_loadu_si256((__m256i *) &d[i]), x));
+		}
+		for (; i < numcols; ++i) {
+			d[i] += (s[i] + s[i + off] + round) >> shift;
+		}
+		d += stride;
+		s += stride;
+	}
+}
+
+JPC_QMFB_TARGET("avx2")
+static void jpc_qmfb_liftsub16_avx2(int_least16_t *d, int_least16_t *s,
+  int off, int numrows, int numcols, int stride, int round, int shift)
+{
+	__m256i x;
+	int i;
+
+	for (; numrows > 0; --numrows) {
+		for (i = 0; i + 16 <= numcols; i += 16) {
+			x = jpc_qmfb_liftterm16_avx2(_mm256_loadu_si256((__m256i *) &s[i]),
+			  _mm256_loadu_si256((__m256i *) &s[i + off]), shift);
+			_mm256_storeu_si256((__m256i *) &d[i],
+			  _mm256_sub_epi16(_mm256_loadu_si256((__m256i *) &d[i]), x));
+		}
+		for (; i < numcols; ++i) {
+			d[i] -= (s[i] + s[i + off] + round) >> shift;
+		}
+		d += stride;
+		s += stride;
+	}
+}
+
+JPC_QMFB_TARGET("avx2")
+static void jpc_qmfb_deinterleave16_avx2(int_least16_t *a, int_least16_t *e,
+  int_least16_t *o, int n)
+{
+	__m256i x0;
+	__m256i x1;
+	int_least16_t t0;
+	int_least16_t t1;
+	int k;
+
+	for (k = 0; k + 16 <= n; k += 16) {
+		x0 = _mm256_loadu_si256((__m256i *) &a[2 * k]);
+		x1 = _mm256_loadu_si256((__m256i *) &a[2 * k + 16]);
+		/* Each pair of samples is a 32-bit lane.  The samples are sign
+		  extended in their lanes, so that packing cannot saturate.  The
+		  packing works within 128-bit lanes, so the 64-bit halves of the
+		  lanes need to be put back in order. */
+		_mm256_storeu_si256((__m256i *) &e[k], _mm256_permute4x64_epi64(
+		  _mm256_packs_epi32(_mm256_srai_epi32(_mm256_slli_epi32(x0, 16),
+		  16), _mm256_srai_epi32(_mm256_slli_epi32(x1, 16), 16)),
+		  _MM_SHUFFLE(3, 1, 2, 0)));
+		_mm256_storeu_si256((__m256i *) &o[k], _mm256_permute4x64_epi64(
+		  _mm256_packs_epi32(_mm256_srai_epi32(x0, 16),
+		  _mm256_srai_epi32(x1, 16)), _MM_SHUFFLE(3, 1, 2, 0)));
+	}
+	for (; k < n; ++k) {
+		t0 = a[2 * k];
+		t1 = a[2 * k + 1];
+		e[k] = t0;
+		o[k] = t1;
+	}
+}
+
+JPC_QMFB_TARGET("avx2")
+static void jpc_qmfb_interleave16_avx2(int_least16_t *a, int_least16_t *e,
+  int_least16_t *o, int n)
+{
+	__m256i x0;
+	__m256i x1;
+	__m256i y0;
+	__m256i y1;
+	int_least16_t t0;
+	int_least16_t t1;
+	int k;
+
+	for (k = 0; k + 16 <= n; k += 16) {
+		x0 = _mm256_loadu_si256((__m256i *) &e[k]);
+		x1 = _mm256_loadu_si256((__m256i *) &o[k]);
+		/* The unpacking works within 128-bit lanes, so the lanes of the
+		  results need to be exchanged. */
+		y0 = _mm256_unpacklo_epi16(x0, x1);
+		y1 = _mm256_unpackhi_epi16(x0, x1);
+		_mm256_storeu_si256((__m256i *) &a[2 * k],
+		  _mm256_permute2x128_si256(y0, y1, 0x20));
+		_mm256_storeu_si256((__m256i *) &a[2 * k + 16],
+		  _mm256_permute2x128_si256(y0, y1, 0x31));
+	}
+	for (; k < n; ++k) {
+		t0 = e[k];
+		t1 = o[k];
+		a[2 * k] = t0;
+		a[2 * k + 1] = t1;
+	}
+}
+
+JPC_QMFB_TARGET("avx2")
+static int jpc_qmfb_pack16_avx2(jpc_fix_t *a, int_least16_t *b, int n,
+  int adjust)
+{
+	__m256i vadjust;
+	__m256i vmin;
+	__m256i vmax;
+	__m256i x;
+	int_least16_t t[16];
+	int maxmag;
+	int i;
+
+	vadjust = _mm256_set1_epi32(adjust);
+	vmin = _mm256_setzero_si256();
+	vmax = _mm256_setzero_si256();
+	for (i = 0; i + 16 <= n; i += 16) {
+		x = _mm256_permute4x64_epi64(_mm256_packs_epi32(_mm256_add_epi32(
+		  _mm256_loadu_si256((__m256i *) &a[i]), vadjust), _mm256_add_epi32(
+		  _mm256_loadu_si256((__m256i *) &a[i + 8]), vadjust)),
+		  _MM_SHUFFLE(3, 1, 2, 0));
+		_mm256_storeu_si256((__m256i *) &b[i], x);
+		vmin = _mm256_min_epi16(vmin, x);
+		vmax = _mm256_max_epi16(vmax, x);
+	}
+	maxmag = jpc_qmfb_pack16_c(&a[i], &b[i], n - i, adjust);
+	_mm256_storeu_si256((__m256i *) t, vmax);
+	for (i = 0; i < 16; ++i) {
+		maxmag = JAS_MAX(maxmag, t[i]);
+	}
+	_mm256_storeu_si256((__m256i *) t, vmin);
+	for (i = 0; i < 16; ++i) {
+		maxmag = JAS_MAX(maxmag, -t[i]);
+	}
+	return maxmag;
+}
+
+JPC_QMFB_TARGET("avx2")
+static void jpc_qmfb_unpack16_avx2(int_least16_t *b, jpc_fix_t *a, int n,
+  int adjust, int minval, int maxval)
+{
+	__m256i vadjust;
+	__m256i vmin;
+	__m256i vmax;
+	__m256i x;
+	int i;
+
+	/* Clip before the level shift, while the samples are still 16 bits
+	  wide. */
+	vadjust = _mm256_set1_epi32(adjust);
+	vmin = _mm256_set1_epi16(JAS_MIN(JAS_MAX(minval - adjust,
+	  -JPC_QMFB_MAX16 - 1), JPC_QMFB_MAX16));
+	vmax = _mm256_set1_epi16(JAS_MIN(JAS_MAX(maxval - adjust,
+	  -JPC_QMFB_MAX16 - 1), JPC_QMFB_MAX16));
+	for (i = 0; i + 16 <= n; i += 16) {
+		x = _mm256_min_epi16(_mm256_max_epi16(_mm256_loadu_si256(
+		  (__m256i *) &b[i]), vmin), vmax);
+		_mm256_storeu_si256((__m256i *) &a[i], _mm256_add_epi32(
+		  _mm256_cvtepi16_epi32(_mm256_castsi256_si128(x)), vadjust));
+		_mm256_storeu_si256((__m256i *) &a[i + 8], _mm256_add_epi32(
+		  _mm256_cvtepi16_epi32(_mm256_extracti128_si256(x, 1)), vadjust));
+	}
+	jpc_qmfb_unpack16_c(&b[i], &a[i], n - i, adjust, minval, maxval);
+}
+
+JPC_QMFB_TARGET("avx2")
+static void jpc_qmfb_rct16_avx2(int_least16_t *c0, int_least16_t *c1,
+  int_least16_t *c2, int n)
+{
+	__m256i r;
+	__m256i g;
+	__m256i b;
+	int i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		r = _mm256_loadu_si256((__m256i *) &c0[i]);
+		g = _mm256_loadu_si256((__m256i *) &c1[i]);
+		b = _mm256_loadu_si256((__m256i *) &c2[i]);
+		_mm256_storeu_si256((__m256i *) &c0[i], jpc_qmfb_avg16_avx2(
+		  jpc_qmfb_avg16_avx2(r, b), g));
+		_mm256_storeu_si256((__m256i *) &c1[i], _mm256_sub_epi16(b, g));
+		_mm256_storeu_si256((__m256i *) &c2[i], _mm256_sub_epi16(r, g));
+	}
+	jpc_qmfb_rct16_c(&c0[i], &c1[i], &c2[i], n - i);
+}
+
+JPC_QMFB_TARGET("avx2")
+static void jpc_qmfb_irct16_avx2(int_least16_t *c0, int_least16_t *c1,
+  int_least16_t *c2, int n)
+{
+	__m256i u;
+	__m256i v;
+	__m256i g;
+	int i;
+
+	for (i = 0; i + 16 <= n; i += 16) {
+		u = _mm256_loadu_si256((__m256i *) &c1[i]);
+		v = _mm256_loadu_si256((__m256i *) &c2[i]);
+		g = _mm256_sub_epi16(_mm256_loadu_si256((__m256i *) &c0[i]),
+		  _mm256_srai_epi16(jpc_qmfb_avg16_avx2(u, v), 1));
+		_mm256_storeu_si256((__m256i *) &c0[i], _mm256_add_epi16(v, g));
+		_mm256_storeu_si256((__m256i *) &c1[i], g);
+		_mm256_storeu_si256((__m256i *) &c2[i], _mm256_add_epi16(u, g));
+	}
+	jpc_qmfb_irct16_c(&c0[i], &c1[i], &c2[i], n - i);
+}
+
+static const jpc_qmfb_kernops_t jpc_qmfb_avx2ops = {
+	jpc_qmfb_liftadd_avx2,
+	jpc_qmfb_liftsub_avx2,
+	jpc_qmfb_deinterleave_avx2,
+	jpc_qmfb_interleave_avx2,
+	jpc_qmfb_liftflt_avx2,
+	jpc_qmfb_scaleflt_avx2,
+	jpc_qmfb_inttoflt_avx2,
+	jpc_qmfb_flttoint_avx2,
+	jpc_qmfb_quantflt_avx2,
+	jpc_qmfb_ictflt_avx2,
+	jpc_qmfb_iictflt_avx2,
+	jpc_qmfb_liftadd16_avx2,
+	jpc_qmfb_liftsub16_avx2,
+	jpc_qmfb_deinterleave16_avx2,
+	jpc_qmfb_interleave16_avx2,
+	jpc_qmfb_pack16_avx2,
+	jpc_qmfb_unpack16_avx2,
+	jpc_qmfb_rct16_avx2,
+	jpc_qmfb_irct16_avx2
+};
+
+/* Determine the best instruction set supported by the processor (and the
+  operating system) for which there are kernels. */
+static int jpc_qmfb_getcpusimd(void)
+{
+#if defined(_MSC_VER)
+	int info[4];
+	int maxid;
+
+	__cpuid(info, 0);
+	maxid = info[0];
+	__cpuid(info, 1);
+	if (maxid >= 7 && (info[2] & (1 << 27)) &&
+	  (_xgetbv(0) & 6) == 6) {
+		/* The OS saves the YMM registers, so check for AVX2. */
+		__cpuidex(info, 7, 0);
+		if (info[1] & (1 << 5)) {
+			return JPC_QMFB_SIMD_AVX2;
+		}
+	}
+	__cpuid(info, 1);
+	if (info[3] & (1 << 26)) {
+		return JPC_QMFB_SIMD_SSE2;
+	}
+	return JPC_QMFB_SIMD_NONE;
+#else
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		return JPC_QMFB_SIMD_AVX2;
+	}
+	if (__builtin_cpu_supports("sse2")) {
+		return JPC_QMFB_SIMD_SSE2;
+	}
+	return JPC_QMFB_SIMD_NONE;
+#endif
+}
+
+/* The instruction set of the kernels in use. */
+static int jpc_qmfb_simd = JPC_QMFB_SIMD_NONE;
+
+#endif
+
+void jpc_qmfb_initkernops()
+{
+#if defined(JPC_QMFB_X86)
+	jpc_qmfb_simd = jpc_qmfb_getcpusimd();
+#endif
+}
+
+const jpc_qmfb_kernops_t *jpc_qmfb_getkernops(void)
+{
+#if defined(JPC_QMFB_X86)
+	switch (jpc_qmfb_simd) {
+	case JPC_QMFB_SIMD_AVX2:
+		return &jpc_qmfb_avx2ops;
+	case JPC_QMFB_SIMD_SSE2:
+		return &jpc_qmfb_sse2ops;
+	default:
+		break;
+	}
+#endif
+	return &jpc_qmfb_genericops;
+}
+
+/* Set up a pass of a 2-D transform. */
+static void jpc_qmfb_initpass(jpc_qmfb_pass_t *pass,
+  const jpc_qmfb_kernops_t *ops, void *a, int numrows, int numcols,
+  int stride, int parity)
+{
+	pass->ops = ops;
+	pass->a = a;
+	pass->numrows = numrows;
+	pass->numcols = numcols;
+	pass->stride = stride;
+	pass->parity = parity;
+}
+
+/* Perform a pass of a 2-D transform over n rows or column groups of about
+  size samples each.  The rows (or column groups) are independent of each
+  other, so they are spread over several threads if there are enough
+  samples.  The pass is done when this returns, which keeps the row and
+  column passes (and the levels of the transform) in order. */
+static void jpc_qmfb_parfor(jpc_qmfb_pass_t *pass, jas_thread_loopfunc_t func,
+  int n, long size)
+{
+	jas_thread_parfor(n, JAS_MAX(JPC_QMFB_PARGRAIN / JAS_MAX(size, 1), 1),
+	  func, pass);
+}
+
+/* Split a row into its lowpass and highpass channels using the
+  (de)interleaving kernel. */
+static void jpc_qmfb_split_row_simd(const jpc_qmfb_kernops_t *ops,
+  jpc_fix_t *a, int numcols, int parity)
+{
+
+	int bufsize = JPC_CEILDIVPOW2(numcols, 1);
+#if !defined(HAVE_VLA)
+	jpc_fix_t splitbuf[QMFB_SPLITBUFSIZE];
+#else
+	jpc_fix_t splitbuf[bufsize];
+#endif
+	jpc_fix_t *buf = splitbuf;
+	int hstartcol;
+	int npairs;
+
+#if !defined(HAVE_VLA)
+	/* Get a buffer. */
+	if (bufsize > QMFB_SPLITBUFSIZE) {
+		if (!(buf = jas_malloc(bufsize * sizeof(jpc_fix_t)))) {
+			/* We have no choice but to commit suicide in this case. */
+			abort();
+		}
+	}
+#endif
+
+	if (numcols >= 2) {
+		hstartcol = (numcols + 1 - parity) >> 1;
+		npairs = numcols >> 1;
+		/* Compact the lowpass samples in place and save the highpass
+		  samples.  The kernel reads each block before writing it, and the
+		  lowpass samples only ever move backwards. */
+		if (parity) {
+			(*ops->deinterleave)(a, buf, a, npairs);
+		} else {
+			(*ops->deinterleave)(a, a, buf, npairs);
+		}
+		if (numcols & 1) {
+			if (parity) {
+				buf[npairs] = a[numcols - 1];
+			} else {
+				a[npairs] = a[numcols - 1];
+			}
+		}
+		/* Copy the saved samples into the highpass channel. */
+		memcpy(&a[hstartcol], buf, (numcols - hstartcol) *
+		  sizeof(jpc_fix_t));
+	}
+
+#if !defined(HAVE_VLA)
+	/* If the split buffer was allocated on the heap, free this memory. */
+	if (buf != splitbuf) {
+		jas_free(buf);
+	}
+#endif
+
+}
+
+/* Join the lowpass and highpass channels of a row using the
+  (de)interleaving kernel. */
+static void jpc_qmfb_join_row_simd(const jpc_qmfb_kernops_t *ops,
+  jpc_fix_t *a, int numcols, int parity)
+{
+
+	int bufsize = JPC_CEILDIVPOW2(numcols, 1);
+#if !defined(HAVE_VLA)
+	jpc_fix_t joinbuf[QMFB_JOINBUFSIZE];
+#else
+	jpc_fix_t joinbuf[bufsize];
+#endif
+	jpc_fix_t *buf = joinbuf;
+	int hstartcol;
+	int npairs;
+
+#if !defined(HAVE_VLA)
+	/* Allocate memory for the join buffer from the heap. */
+	if (bufsize > QMFB_JOINBUFSIZE) {
+		if (!(buf = jas_malloc(bufsize * sizeof(jpc_fix_t)))) {
+			/* We have no choice but to commit suicide. */
+			abort();
+		}
+	}
+#endif
+
+	if (numcols >= 2) {
+		hstartcol = (numcols + 1 - parity) >> 1;
+		npairs = numcols >> 1;
+		/* Save the samples from the lowpass channel. */
+		memcpy(buf, a, hstartcol * sizeof(jpc_fix_t));
+		/* Interleave the two channels.  The kernel reads each block before
+		  writing it, and the samples written never reach the highpass
+		  samples that have yet to be read. */
+		if (parity) {
+			(*ops->interleave)(a, &a[hstartcol], buf, npairs);
+		} else {
+			(*ops->interleave)(a, buf, &a[hstartcol], npairs);
+			if (numcols & 1) {
+				a[numcols - 1] = buf[npairs];
+			}
+		}
+	}
+
+#if !defined(HAVE_VLA)
+	/* If the join buffer was allocated on the heap, free this memory. */
+	if (buf != joinbuf) {
+		jas_free(buf);
+	}
+#endif
+
+}
+
+/* Split a group of columns into their lowpass and highpass channels.  This
+  copies whole runs of samples at a time, and so needs no special kernels. */
+static void jpc_qmfb_split_cols(jpc_fix_t *a, int numrows, int numcols,
+  int stride, int parity)
+{
+
+	int bufsize = JPC_CEILDIVPOW2(numrows, 1) * numcols;
+#if !defined(HAVE_VLA)
+	jpc_fix_t splitbuf[QMFB_SPLITBUFSIZE * JPC_QMFB_COLGRPSIZE];
+#else
+	jpc_fix_t splitbuf[bufsize];
+#endif
+	jpc_fix_t *buf = splitbuf;
+	jpc_fix_t *srcptr;
+	jpc_fix_t *dstptr;
+	size_t runsize;
+	int n;
+	int m;
+	int hstartcol;
+
+#if !defined(HAVE_VLA)
+	/* Get a buffer. */
+	if (bufsize > QMFB_SPLITBUFSIZE * JPC_QMFB_COLGRPSIZE) {
+		if (!(buf = jas_malloc(bufsize * sizeof(jpc_fix_t)))) {
+			/* We have no choice but to commit suicide in this case. */
+			abort();
+		}
+	}
+#endif
+
+	if (numrows >= 2) {
+		runsize = numcols * sizeof(jpc_fix_t);
+		hstartcol = (numrows + 1 - parity) >> 1;
+		m = numrows - hstartcol;
+		/* Save the samples destined for the highpass channel. */
+		n = m;
+		dstptr = buf;
+		srcptr = &a[(1 - parity) * stride];
+		while (n-- > 0) {
+			memcpy(dstptr, srcptr, runsize);
+			dstptr += numcols;
+			srcptr += stride << 1;
+		}
+		/* Copy the appropriate samples into the lowpass channel. */
+		dstptr = &a[(1 - parity) * stride];
+		srcptr = &a[(2 - parity) * stride];
+		n = hstartcol - (!parity);
+		while (n-- > 0) {
+			memcpy(dstptr, srcptr, runsize);
+			dstptr += stride;
+			srcptr += stride << 1;
+		}
+		/* Copy the saved samples into the highpass channel. */
+		dstptr = &a[hstartcol * stride];
+		srcptr = buf;
+		n = m;
+		while (n-- > 0) {
+			memcpy(dstptr, srcptr, runsize);
+			dstptr += stride;
+			srcptr += numcols;
+		}
+	}
+
+#if !defined(HAVE_VLA)
+	/* If the split buffer was allocated on the heap, free this memory. */
+	if (buf != splitbuf) {
+		jas_free(buf);
+	}
+#endif
+
+}
+
+/* Join the lowpass and highpass channels of a group of columns.  This
+  copies whole runs of samples at a time, and so needs no special kernels. */
+static void jpc_qmfb_join_cols(jpc_fix_t *a, int numrows, int numcols,
+  int stride, int parity)
+{
+
+	int bufsize = JPC_CEILDIVPOW2(numrows, 1) * numcols;
+#if !defined(HAVE_VLA)
+	jpc_fix_t joinbuf[QMFB_JOINBUFSIZE * JPC_QMFB_COLGRPSIZE];
+#else
+	jpc_fix_t joinbuf[bufsize];
+#endif
+	jpc_fix_t *buf = joinbuf;
+	jpc_fix_t *srcptr;
+	jpc_fix_t *dstptr;
+	size_t runsize;
+	int n;
+	int hstartcol;
+
+#if !defined(HAVE_VLA)
+	/* Allocate memory for the join buffer from the heap. */
+	if (bufsize > QMFB_JOINBUFSIZE * JPC_QMFB_COLGRPSIZE) {
+		if (!(buf = jas_malloc(bufsize * sizeof(jpc_fix_t)))) {
+			/* We have no choice but to commit suicide. */
+			abort();
+		}
+	}
+#endif
+
+	runsize = numcols * sizeof(jpc_fix_t);
+	hstartcol = (numrows + 1 - parity) >> 1;
+
+	/* Save the samples from the lowpass channel. */
+	n = hstartcol;
+	srcptr = &a[0];
+	dstptr = buf;
+	while (n-- > 0) {
+		memcpy(dstptr, srcptr, runsize);
+		srcptr += stride;
+		dstptr += numcols;
+	}
+	/* Copy the samples from the highpass channel into place. */
+	srcptr = &a[hstartcol * stride];
+	dstptr = &a[(1 - parity) * stride];
+	n = numrows - hstartcol;
+	while (n-- > 0) {
+		/* The last run may be copied onto itself. */
+		memmove(dstptr, srcptr, runsize);
+		dstptr += 2 * stride;
+		srcptr += stride;
+	}
+	/* Copy the samples from the lowpass channel into place. */
+	srcptr = buf;
+	dstptr = &a[parity * stride];
+	n = hstartcol;
+	while (n-- > 0) {
+		memcpy(dstptr, srcptr, runsize);
+		dstptr += 2 * stride;
+		srcptr += numcols;
+	}
+
+#if !defined(HAVE_VLA)
+	/* If the join buffer was allocated on the heap, free this memory. */
+	if (buf != joinbuf) {
+		jas_free(buf);
+	}
+#endif
+
+}
+
+/******************************************************************************\
+* 5/3 transform
+\******************************************************************************/
+
+void jpc_ft_fwdlift_row(jpc_fix_t *a, int numcols, int parity)
+{
+
+	register jpc_fix_t *lptr;
+	register jpc_fix_t *hptr;
+	register int n;
+	int llen;
+
+	llen = (numcols + 1 - parity) >> 1;
+
+	if (numcols > 1) {
+
+		/* Apply the first lifting step. */
+		lptr = &a[0];
+		hptr = &a[llen];
+		if (parity) {
+			hptr[0] -= lptr[0];
+			++hptr;
+		}
+		n = numcols - llen - parity - (parity == (numcols & 1));
+		while (n-- > 0) {
+			hptr[0] -= (lptr[0] + lptr[1]) >> 1;
+			++hptr;
+			++lptr;
+		}
+		if (parity == (numcols & 1)) {
+			hptr[0] -= lptr[0];
+		}
+
+		/* Apply the second lifting step. */
+		lptr = &a[0];
+		hptr = &a[llen];
+		if (!parity) {
+			lptr[0] += (hptr[0] + 1) >> 1;
+			++lptr;
+		}
+		n = llen - (!parity) - (parity != (numcols & 1));
+		while (n-- > 0) {
+			lptr[0] += (hptr[0] + hptr[1] + 2) >> 2;
+			++lptr;
+			++hptr;
+		}
+		if (parity != (numcols & 1)) {
+			lptr[0] += (hptr[0] + 1) >> 1;
+		}
+
+	} else {
+
+		if (parity) {
+			lptr = &a[0];
+			lptr[0] <<= 1;
+		}
+
+	}
+
+}
+
+void jpc_ft_fwdlift_col(jpc_fix_t *a, int numrows, int stride, int parity)
+{
+
+	jpc_fix_t *lptr;
+	jpc_fix_t *hptr;
+#if 0
+	register jpc_fix_t *lptr2;
+	register jpc_fix_t *hptr2;
+	register int i;
+#endif
+	register int n;
+	int llen;
+
+	llen = (numrows + 1 - parity) >> 1;
+
+	if (numrows > 1) {
+
+		/* Apply the first lifting step. */
+		lptr = &a[0];
+		hptr = &a[llen * stride];
+		if (parity) {
+			hptr[0] -= lptr[0];
+			hptr += stride;
+		}
+		n = numrows - llen - parity - (parity == (numrows & 1));
+		while (n-- > 0) {
+			hptr[0] -= (lptr[0] + lptr[stride]) >> 1;
+			hptr += stride;
+			lptr += stride;
+		}
+		if (parity == (numrows & 1)) {
+			hptr[0] -= lptr[0];
+		}
+
+		/* Apply the second lifting step. */
+		lptr = &a[0];
+		hptr = &a[llen * stride];
+		if (!parity) {
+			lptr[0] += (hptr[0] + 1) >> 1;
+			lptr += stride;
+		}
+		n = llen - (!parity) - (parity != (numrows & 1));
+		while (n-- > 0) {
+			lptr[0] += (hptr[0] + hptr[stride] + 2) >> 2;
+			lptr += stride;
+			hptr += stride;
+		}
+		if (parity != (numrows & 1)) {
+			lptr[0] += (hptr[0] + 1) >> 1;
+		}
+
+	} else {
+
+		if (parity) {
+			lptr = &a[0];
+			lptr[0] <<= 1;
+		}
+
+	}
+
+}
+
+void jpc_ft_fwdlift_colgrp(jpc_fix_t *a, int numrows, int stride, int parity)
+{
+
+	jpc_fix_t *lptr;
+	jpc_fix_t *hptr;
+	register jpc_fix_t *lptr2;
+	register jpc_fix_t *hptr2;
+	register int n;
+	register int i;
+	int llen;
+
+	llen = (numrows + 1 - parity) >> 1;
+
+	if (numrows > 1) {
+
+		/* Apply the first lifting step. */
+		lptr = &a[0];
+		hptr = &a[llen * stride];
+		if (parity) {
+			lptr2 = lptr;
+			hptr2 = hptr;
+			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
+				hptr2[0] -= lptr2[0];
+				++hptr2;
+				++lptr2;
+			}
+			hptr += stride;
+		}
+		n = numrows - llen - parity - (parity == (numrows & 1));
+		while (n-- > 0) {
+			lptr2 = lptr;
+			hptr2 = hptr;
+			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
+				hptr2[0] -= (lptr2[0] + lptr2[stride]) >> 1;
+				++lptr2;
+				++hptr2;
+			}
+			hptr += stride;
+			lptr += stride;
+		}
+		if (parity == (numrows & 1)) {
+			lptr2 = lptr;
+			hptr2 = hptr;
+			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
+				hptr2[0] -= lptr2[0];
+				++lptr2;
+				++hptr2;
+			}
+		}
+
+		/* Apply the second lifting step. */
+		lptr = &a[0];
+		hptr = &a[llen * stride];
+		if (!parity) {
+			lptr2 = lptr;
+			hptr2 = hptr;
+			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
+				lptr2[0] += (hptr2[0] + 1) >> 1;
+				++lptr2;
+				++hptr2;
+			}
+			lptr += stride;
+		}
+		n = llen - (!parity) - (parity != (numrows & 1));
+		while (n-- > 0) {
+			lptr2 = lptr;
+			hptr2 = hptr;
+			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
+				lptr2[0] += (hptr2[0] + hptr2[stride] + 2) >> 2;
+				++lptr2;
+				++hptr2;
+			}
+			lptr += stride;
+			hptr += stride;
+		}
+		if (parity != (numrows & 1)) {
+			lptr2 = lptr;
+			hptr2 = hptr;
+			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
+				lptr2[0] += (hptr2[0] + 1) >> 1;
+				++lptr2;
+				++hptr2;
+			}
+		}
+
+	} else {
+
+		if (parity) {
+			lptr2 = &a[0];
+			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
+				lptr2[0] <<= 1;
+				++lptr2;
+			}
+		}
+
+	}
+
+}
+
+void jpc_ft_fwdlift_colres(jpc_fix_t *a, int numrows, int numcols, int stride,
+  int parity)
+{
+
+	jpc_fix_t *lptr;
+	jpc_fix_t *hptr;
+	register jpc_fix_t *lptr2;
+	register jpc_fix_t *hptr2;
+	register int n;
+	register int i;
+	int llen;
+
+	llen = (numrows + 1 - parity) >> 1;
+
+	if (numrows > 1) {
+
+		/* Apply the first lifting step. */
+		lptr = &a[0];
+		hptr = &a[llen * stride];
+		if (parity) {
+			lptr2 = lptr;
+			hptr2 = hptr;
+			for (i = 0; i < numcols; ++i) {
+				hptr2[0] -= lptr2[0];
+				++hptr2;
+				++lptr2;
+			}
+			hptr += stride;
+		}
+		n = numrows - llen - parity - (parity == (numrows & 1));
+		while (n-- > 0) {
+			lptr2 = lptr;
+			hptr2 = hptr;
+			for (i = 0; i < numcols; ++i) {
+				hptr2[0] -= (lptr2[0] + lptr2[stride]) >> 1;
+				++lptr2;
+				++hptr2;
+			}
+			hptr += stride;
+			lptr += stride;
+		}
+		if (parity == (numrows & 1)) {
+			lptr2 = lptr;
+			hptr2 = hptr;
+			for (i = 0; i < numcols; ++i) {
+				hptr2[0] -= lptr2[0];
+				++lptr2;
+				++hptr2;
+			}
+		}
+
+		/* Apply the second lifting step. */
+		lptr = &a[0];
+		hptr = &a[llen * stride];
+		if (!parity) {
+			lptr2 = lptr;
+			hptr2 = hptr;
+			for (i = 0; i < numcols; ++i) {
+				lptr2[0] += (hptr2[0] + 1) >> 1;
+				++lptr2;
+				++hptr2;
+			}
+			lptr += stride;
+		}
+		n = llen - (!parity) - (parity != (numrows & 1));
+		while (n-- > 0) {
+			lptr2 = lptr;
+			hptr2 = hptr;
+			for (i = 0; i < numcols; ++i) {
+				lptr2[0] += (hptr2[0] + hptr2[stride] + 2) >> 2;
+				++lptr2;
+				++hptr2;
+			}
+			lptr += stride;
+			hptr += stride;
+		}
+		if (parity != (numrows & 1)) {
+			lptr2 = lptr;
+			hptr2 = hptr;
+			for (i = 0; i < numcols; ++i) {
+				lptr2[0] += (hptr2[0] + 1) >> 1;
+				++lptr2;
+				++hptr2;
+			}
+		}
+
+	} else {
+
+		if (parity) {
+			lptr2 = &a[0];
+			for (i = 0; i < numcols; ++i) {
+				lptr2[0] <<= 1;
+				++lptr2;
+			}
+		}
+
+	}
+
+}
+
+void jpc_ft_invlift_row(jpc_fix_t *a, int numcols, int parity)
+{
+
+	register jpc_fix_t *lptr;
+	register jpc_fix_t *hptr;
+	register int n;
+	int llen;
+
+	llen = (numcols + 1 - parity) >> 1;
+
+	if (numcols > 1) {
+
+		/* Apply the first lifting step. */
+		lptr = &a[0];
+		hptr = &a[llen];
+		if (!parity) {
+			lptr[0] -= (hptr[0] + 1) >> 1;
+			++lptr;
+		}
+		n = llen - (!parity) - (parity != (numcols & 1));
+		while (n-- > 0) {
+			lptr[0] -= (hptr[0] + hptr[1] + 2) >> 2;
+			++lptr;
+			++hptr;
+		}
+		if (parity != (numcols & 1)) {
+			lptr[0] -= (hptr[0] + 1) >> 1;
+		}
+
+		/* Apply the second lifting step. */
+		lptr = &a[0];
+		hptr = &a[llen];
+		if (parity) {
+			hptr[0] += lptr[0];
+			++hptr;
+		}
+		n = numcols - llen - parity - (parity == (numcols & 1));
+		while (n-- > 0) {
+			hptr[0] += (lptr[0] + lptr[1]) >> 1;
+			++hptr;
+			++lptr;
+		}
+		if (parity == (numcols & 1)) {
+			hptr[0] += lptr[0];
+		}
+
+	} else {
+
+		if (parity) {
+			lptr = &a[0];
+			lptr[0] >>= 1;
+		}
+
+	}
+
+}
+
+void jpc_ft_invlift_col(jpc_fix_t *a, int numrows, int stride, int parity)
+{
+
+	jpc_fix_t *lptr;
+	jpc_fix_t *hptr;
+#if 0
+	register jpc_fix_t *lptr2;
+	register jpc_fix_t *hptr2;
+	register int i;
+#endif
+	register int n;
+	int llen;
+
+	llen = (numrows + 1 - parity) >> 1;
+
+	if (numrows > 1) {
+
+		/* Apply the first lifting step. */
+		lptr = &a[0];
+		hptr = &a[llen * stride];
+		if (!parity) {
+			lptr[0] -= (hptr[0] + 1) >> 1;
+			lptr += stride;
+		}
+		n = llen - (!parity) - (parity != (numrows & 1));
+		while (n-- > 0) {
+			lptr[0] -= (hptr[0] + hptr[stride] + 2) >> 2;
+			lptr += stride;
+			hptr += stride;
+		}
+		if (parity != (numrows & 1)) {
+			lptr[0] -= (hptr[0] + 1) >> 1;
+		}
+
+		/* Apply the second lifting step. */
+		lptr = &a[0];
+		hptr = &a[llen * stride];
+		if (parity) {
+			hptr[0] += lptr[0];
+			hptr += stride;
+		}
+		n = numrows - llen - parity - (parity == (numrows & 1));
+		while (n-- > 0) {
+			hptr[0] += (lptr[0] + lptr[stride]) >> 1;
+			hptr += stride;
+			lptr += stride;
+		}
+		if (parity == (numrows & 1)) {
+			hptr[0] += lptr[0];
+		}
+
+	} else {
+
+		if (parity) {
+			lptr = &a[0];
+			lptr[0] >>= 1;
+		}
+
+	}
+
+}
+
+void jpc_ft_invlift_colgrp(jpc_fix_t *a, int numrows, int stride, int parity)
+{
+
+	jpc_fix_t *lptr;
+	jpc_fix_t *hptr;
+	register jpc_fix_t *lptr2;
+	register jpc_fix_t *hptr2;
+	register int n;
+	register int i;
+	int llen;
+
+	llen = (numrows + 1 - parity) >> 1;
+
+	if (numrows > 1) {
+
+		/* Apply the first lifting step. */
+		lptr = &a[0];
+		hptr = &a[llen * stride];
+		if (!parity) {
+			lptr2 = lptr;
+			hptr2 = hptr;
+			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
+				lptr2[0] -= (hptr2[0] + 1) >> 1;
+				++lptr2;
+				++hptr2;
+			}
+			lptr += stride;
+		}
+		n = llen - (!parity) - (parity != (numrows & 1));
+		while (n-- > 0) {
+			lptr2 = lptr;
+			hptr2 = hptr;
+			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
+				lptr2[0] -= (hptr2[0] + hptr2[stride] + 2) >> 2;
+				++lptr2;
+				++hptr2;
+			}
+			lptr += stride;
+			hptr += stride;
+		}
+		if (parity != (numrows & 1)) {
+			lptr2 = lptr;
+			hptr2 = hptr;
+			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
+				lptr2[0] -= (hptr2[0] + 1) >> 1;
+				++lptr2;
+				++hptr2;
+			}
+		}
+
+		/* Apply the second lifting step. */
+		lptr = &a[0];
+		hptr = &a[llen * stride];
+		if (parity) {
+			lptr2 = lptr;
+			hptr2 = hptr;
+			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
+				hptr2[0] += lptr2[0];
+				++hptr2;
+				++lptr2;
+			}
+			hptr += stride;
+		}
+		n = numrows - llen - parity - (parity == (numrows & 1));
+		while (n-- > 0) {
+			lptr2 = lptr;
+			hptr2 = hptr;
+			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
+				hptr2[0] += (lptr2[0] + lptr2[stride]) >> 1;
+				++lptr2;
+				++hptr2;
+			}
+			hptr += stride;
+			lptr += stride;
+		}
+		if (parity == (numrows & 1)) {
+			lptr2 = lptr;
+			hptr2 = hptr;
+			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
+				hptr2[0] += lptr2[0];
+				++lptr2;
+				++hptr2;
+			}
+		}
+
+	} else {
+
+		if (parity) {
+			lptr2 = &a[0];
+			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
+				lptr2[0] >>= 1;
+				++lptr2;
+			}
+		}
+
+	}
+
+}
+
+void jpc_ft_invlift_colres(jpc_fix_t *a, int numrows, int numcols, int stride,
+  int parity)
+{
+
+	jpc_fix_t *lptr;
+	jpc_fix_t *hptr;
+	register jpc_fix_t *lptr2;
+	register jpc_fix_t *hptr2;
+	register int n;
+	register int i;
+	int llen;
+
+	llen = (numrows + 1 - parity) >> 1;
+
+	if (numrows > 1) {
+
+		/* Apply the first lifting step. */
+		lptr = &a[0];
+		hptr = &a[llen * stride];
+		if (!parity) {
+			lptr2 = lptr;
+			hptr2 = hptr;
+			for (i = 0; i < numcols; ++i) {
+				lptr2[0] -= (hptr2[0] + 1) >> 1;
+				++lptr2;
+				++hptr2;
+			}
+			lptr += stride;
+		}
+		n = llen - (!parity) - (parity != (numrows & 1));
+		while (n-- > 0) {
+			lptr2 = lptr;
+			hptr2 = hptr;
+			for (i = 0; i < numcols; ++i) {
+				lptr2[0] -= (hptr2[0] + hptr2[stride] + 2) >> 2;
+				++lptr2;
+				++hptr2;
+			}
+			lptr += stride;
+			hptr += stride;
+		}
+		if (parity != (numrows & 1)) {
+			lptr2 = lptr;
+			hptr2 = hptr;
+			for (i = 0; i < numcols; ++i) {
+				lptr2[0] -= (hptr2[0] + 1) >> 1;
+				++lptr2;
+				++hptr2;
+			}
+		}
+
+		/* Apply the second lifting step. */
+		lptr = &a[0];
+		hptr = &a[llen * stride];
+		if (parity) {
+			lptr2 = lptr;
+			hptr2 = hptr;
+			for (i = 0; i < numcols; ++i) {
+				hptr2[0] += lptr2[0];
+				++hptr2;
+				++lptr2;
+			}
+			hptr += stride;
+		}
+		n = numrows - llen - parity - (parity == (numrows & 1));
+		while (n-- > 0) {
+			lptr2 = lptr;
+			hptr2 = hptr;
+			for (i = 0; i < numcols; ++i) {
+				hptr2[0] += (lptr2[0] + lptr2[stride]) >> 1;
+				++lptr2;
+				++hptr2;
+			}
+			hptr += stride;
+			lptr += stride;
+		}
+		if (parity == (numrows & 1)) {
+			lptr2 = lptr;
+			hptr2 = hptr;
+			for (i = 0; i < numcols; ++i) {
+				hptr2[0] += lptr2[0];
+				++lptr2;
+				++hptr2;
+			}
+		}
+
+	} else {
+
+		if (parity) {
+			lptr2 = &a[0];
+			for (i = 0; i < numcols; ++i) {
+				lptr2[0] >>= 1;
+				++lptr2;
+			}
+		}
+
+	}
+
+}
+
+/* The passes of the 5/3 transform over a range of column groups or rows. */
+
+static int jpc_ft_fwdcolgrps(void *arg, int start, int end)
+{
+	jpc_qmfb_pass_t *pass = arg;
+	jpc_fix_t *startptr;
+	int numcols;
+
+	for (; start < end; ++start) {
+		startptr = &((jpc_fix_t *) pass->a)[start * JPC_QMFB_COLGRPSIZE];
+		numcols = pass->numcols - start * JPC_QMFB_COLGRPSIZE;
+		if (numcols >= JPC_QMFB_COLGRPSIZE) {
+			jpc_qmfb_split_colgrp(startptr, pass->numrows, pass->stride,
+			  pass->parity);
+			jpc_ft_fwdlift_colgrp(startptr, pass->numrows, pass->stride,
+			  pass->parity);
+		} else {
+			jpc_qmfb_split_colres(startptr, pass->numrows, numcols,
+			  pass->stride, pass->parity);
+			jpc_ft_fwdlift_colres(startptr, pass->numrows, numcols,
+			  pass->stride, pass->parity);
+		}
+	}
+	return 0;
+}
+
+static int jpc_ft_fwdrows(void *arg, int start, int end)
+{
+	jpc_qmfb_pass_t *pass = arg;
+	jpc_fix_t *startptr;
+
+	for (; start < end; ++start) {
+		startptr = &((jpc_fix_t *) pass->a)[start * pass->stride];
+		jpc_qmfb_split_row(startptr, pass->numcols, pass->parity);
+		jpc_ft_fwdlift_row(startptr, pass->numcols, pass->parity);
+	}
+	return 0;
+}
+
+static int jpc_ft_invrows(void *arg, int start, int end)
+{
+	jpc_qmfb_pass_t *pass = arg;
+	jpc_fix_t *startptr;
+
+	for (; start < end; ++start) {
+		startptr = &((jpc_fix_t *) pass->a)[start * pass->stride];
+		jpc_ft_invlift_row(startptr, pass->numcols, pass->parity);
+		jpc_qmfb_join_row(startptr, pass->numcols, pass->parity);
+	}
+	return 0;
+}
+
+static int jpc_ft_invcolgrps(void *arg, int start, int end)
+{
+	jpc_qmfb_pass_t *pass = arg;
+	jpc_fix_t *startptr;
+	int numcols;
+
+	for (; start < end; ++start) {
+		startptr = &((jpc_fix_t *) pass->a)[start * JPC_QMFB_COLGRPSIZE];
+		numcols = pass->numcols - start * JPC_QMFB_COLGRPSIZE;
+		if (numcols >= JPC_QMFB_COLGRPSIZE) {
+			jpc_ft_invlift_colgrp(startptr, pass->numrows, pass->stride,
+			  pass->parity);
+			jpc_qmfb_join_colgrp(startptr, pass->numrows, pass->stride,
+			  pass->parity);
+		} else {
+			jpc_ft_invlift_colres(startptr, pass->numrows, numcols,
+			  pass->stride, pass->parity);
+			jpc_qmfb_join_colres(startptr, pass->numrows, numcols,
+			  pass->stride, pass->parity);
+		}
+	}
+	return 0;
+}
+
+int jpc_ft_analyze(jpc_fix_t *a, int xstart, int ystart, int width, int height,
+  int stride)
+{
+	int numrows = height;
+	int numcols = width;
+	int rowparity = ystart & 1;
+	int colparity = xstart & 1;
+	jpc_qmfb_pass_t pass;
+#if defined(JPC_QMFB_X86)
+	const jpc_qmfb_kernops_t *ops;
+
+	if ((ops = jpc_qmfb_getkernops()) != &jpc_qmfb_genericops) {
+		return jpc_ft_analyze_simd(ops, a, xstart, ystart, width, height,
+		  stride);
+	}
+#endif
+
+	jpc_qmfb_initpass(&pass, 0, a, numrows, numcols, stride, rowparity);
+	jpc_qmfb_parfor(&pass, jpc_ft_fwdcolgrps, JPC_CEILDIV(numcols,
+	  JPC_QMFB_COLGRPSIZE), numrows * JPC_QMFB_COLGRPSIZE);
+
+	pass.parity = colparity;
+	jpc_qmfb_parfor(&pass, jpc_ft_fwdrows, numrows, numcols);
+
+	return 0;
+
+}
+
+int jpc_ft_synthesize(int *a, int xstart, int ystart, int width, int height,
+  int stride)
+{
+	int numrows = height;
+	int numcols = width;
+	int rowparity = ystart & 1;
+	int colparity = xstart & 1;
+	jpc_qmfb_pass_t pass;
+#if defined(JPC_QMFB_X86)
+	const jpc_qmfb_kernops_t *ops;
+
+	if ((ops = jpc_qmfb_getkernops()) != &jpc_qmfb_genericops) {
+		return jpc_ft_synthesize_simd(ops, a, xstart, ystart, width, height,
+		  stride);
+	}
+#endif
+
+	jpc_qmfb_initpass(&pass, 0, a, numrows, numcols, stride, colparity);
+	jpc_qmfb_parfor(&pass, jpc_ft_invrows, numrows, numcols);
+
+	pass.parity = rowparity;
+	jpc_qmfb_parfor(&pass, jpc_ft_invcolgrps, JPC_CEILDIV(numcols,
+	  JPC_QMFB_COLGRPSIZE), numrows * JPC_QMFB_COLGRPSIZE);
+
+	return 0;
+
+}
+
+/* Analyze a single row, as jpc_ft_analyze does for each row. */
+static int jpc_ft_analyzerow(jpc_fix_t *a, int xstart, int width)
+{
+	jpc_qmfb_pass_t pass;
+	const jpc_qmfb_kernops_t *ops;
+
+	ops = jpc_qmfb_getkernops();
+	jpc_qmfb_initpass(&pass, ops, a, 1, width, width, xstart & 1);
+#if defined(JPC_QMFB_X86)
+	if (ops != &jpc_qmfb_genericops) {
+		return jpc_ft_fwdrows_simd(&pass, 0, 1);
+	}
+#endif
+	return jpc_ft_fwdrows(&pass, 0, 1);
+}
+
+/* Synthesize a single row, as jpc_ft_synthesize does for each row. */
+static int jpc_ft_synthesizerow(jpc_fix_t *a, int xstart, int width)
+{
+	jpc_qmfb_pass_t pass;
+	const jpc_qmfb_kernops_t *ops;
+
+	ops = jpc_qmfb_getkernops();
+	jpc_qmfb_initpass(&pass, ops, a, 1, width, width, xstart & 1);
+#if defined(JPC_QMFB_X86)
+	if (ops != &jpc_qmfb_genericops) {
+		return jpc_ft_invrows_simd(&pass, 0, 1);
+	}
+#endif
+	return jpc_ft_invrows(&pass, 0, 1);
+}
+
+/* Apply a lifting step of the transform of the columns to a row.  The
+  update at the ends of the columns, with the missing neighbour replaced by
+  its mirror image, is what the kernels compute with an offset of zero. */
+static void jpc_ft_liftrow(const jpc_qmfb_kernops_t *ops, int inverse,
+  int stepno, jpc_fix_t *d, jpc_fix_t *s0, jpc_fix_t *s1, int numcols)
+{
+	int off;
+
+	off = s1 ? (s1 - s0) : 0;
+	if (!inverse) {
+		if (!stepno) {
+			(*ops->liftsub)(d, s0, off, 1, numcols, 0, 0, 1);
+		} else {
+			(*ops->liftadd)(d, s0, off, 1, numcols, 0, 2, 2);
+		}
+	} else {
+		if (!stepno) {
+			(*ops->liftsub)(d, s0, off, 1, numcols, 0, 2, 2);
+		} else {
+			(*ops->liftadd)(d, s0, off, 1, numcols, 0, 0, 1);
+		}
+	}
+}
+
+/* Scale a row of the transform of the columns.  Only the highpass sample
+  of a column of length one is scaled. */
+static void jpc_ft_scalerow(const jpc_qmfb_kernops_t *ops, int inverse,
+  int lowpass, int numrows, jpc_fix_t *a, int numcols)
+{
+	int i;
+
+	/* Eliminate compiler warnings about unused variables. */
+	(void) ops;
+
+	if (numrows == 1 && !lowpass) {
+		for (i = 0; i < numcols; ++i) {
+			if (inverse) {
+				a[i] >>= 1;
+			} else {
+				a[i] <<= 1;
+			}
+		}
+	}
+}
+
+/******************************************************************************\
+* 5/3 transform (SIMD)
+\******************************************************************************/
+
+/*
+ * The vectorized 5/3 transform follows the same steps as the generic code
+ * above and produces bit-identical results.  The lifting and the
+ * (de)interleaving of rows are done by the kernels for the instruction set
+ * chosen at run time.  The vertical split and join steps move whole runs of
+ * contiguous samples, and so they are done with memcpy for all instruction
+ * sets.
+ */
+
+#if defined(JPC_QMFB_X86)
+
+/* The passes of the vectorized 5/3 transform over a range of column groups
+  or rows. */
+
+static int jpc_ft_fwdcolgrps_simd(void *arg, int start, int end)
+{
+	jpc_qmfb_pass_t *pass = arg;
+	jpc_fix_t *startptr;
+	int numcols;
+
+	for (; start < end; ++start) {
+		startptr = &((jpc_fix_t *) pass->a)[start * JPC_QMFB_COLGRPSIZE];
+		numcols = JAS_MIN(JPC_QMFB_COLGRPSIZE,
+		  pass->numcols - start * JPC_QMFB_COLGRPSIZE);
+		jpc_qmfb_split_cols(startptr, pass->numrows, numcols, pass->stride,
+		  pass->parity);
+		jpc_ft_fwdlift_cols_simd(pass->ops, startptr, pass->numrows,
+		  numcols, pass->stride, pass->parity);
+	}
+	return 0;
+}
+
+static int jpc_ft_fwdrows_simd(void *arg, int start, int end)
+{
+	jpc_qmfb_pass_t *pass = arg;
+	jpc_fix_t *startptr;
+
+	for (; start < end; ++start) {
+		startptr = &((jpc_fix_t *) pass->a)[start * pass->stride];
+		jpc_qmfb_split_row_simd(pass->ops, startptr, pass->numcols,
+		  pass->parity);
+		jpc_ft_fwdlift_row_simd(pass->ops, startptr, pass->numcols,
+		  pass->parity);
+	}
+	return 0;
+}
+
+static int jpc_ft_invrows_simd(void *arg, int start, int end)
+{
+	jpc_qmfb_pass_t *pass = arg;
+	jpc_fix_t *startptr;
+
+	for (; start < end; ++start) {
+		startptr = &((jpc_fix_t *) pass->a)[start * pass->stride];
+		jpc_ft_invlift_row_simd(pass->ops, startptr, pass->numcols,
+		  pass->parity);
+		jpc_qmfb_join_row_simd(pass->ops, startptr, pass->numcols,
+		  pass->parity);
+	}
+	return 0;
+}
+
+static int jpc_ft_invcolgrps_simd(void *arg, int start, int end)
+{
+	jpc_qmfb_pass_t *pass = arg;
+	jpc_fix_t *startptr;
+	int numcols;
+
+	for (; start < end; ++start) {
+		startptr = &((jpc_fix_t *) pass->a)[start * JPC_QMFB_COLGRPSIZE];
+		numcols = JAS_MIN(JPC_QMFB_COLGRPSIZE,
+		  pass->numcols - start * JPC_QMFB_COLGRPSIZE);
+		jpc_ft_invlift_cols_simd(pass->ops, startptr, pass->numrows,
+		  numcols, pass->stride, pass->parity);
+		jpc_qmfb_join_cols(startptr, pass->numrows, numcols, pass->stride,
+		  pass->parity);
+	}
+	return 0;
+}
+
+static int jpc_ft_analyze_simd(const jpc_qmfb_kernops_t *ops, jpc_fix_t *a,
+  int xstart, int ystart, int width, int height, int stride)
+{
+	int numrows = height;
+	int numcols = width;
+	int rowparity = ystart & 1;
+	int colparity = xstart & 1;
+	jpc_qmfb_pass_t pass;
+
+	jpc_qmfb_initpass(&pass, ops, a, numrows, numcols, stride, rowparity);
+	jpc_qmfb_parfor(&pass, jpc_ft_fwdcolgrps_simd, JPC_CEILDIV(numcols,
+	  JPC_QMFB_COLGRPSIZE), numrows * JPC_QMFB_COLGRPSIZE);
+
+	pass.parity = colparity;
+	jpc_qmfb_parfor(&pass, jpc_ft_fwdrows_simd, numrows, numcols);
+
+	return 0;
+
+}
+
+static int jpc_ft_synthesize_simd(const jpc_qmfb_kernops_t *ops, jpc_fix_t *a,
+  int xstart, int ystart, int width, int height, int stride)
+{
+	int numrows = height;
+	int numcols = width;
+	int rowparity = ystart & 1;
+	int colparity = xstart & 1;
+	jpc_qmfb_pass_t pass;
+
+	jpc_qmfb_initpass(&pass, ops, a, numrows, numcols, stride, colparity);
+	jpc_qmfb_parfor(&pass, jpc_ft_invrows_simd, numrows, numcols);
+
+	pass.parity = rowparity;
+	jpc_qmfb_parfor(&pass, jpc_ft_invcolgrps_simd, JPC_CEILDIV(numcols,
+	  JPC_QMFB_COLGRPSIZE), numrows * JPC_QMFB_COLGRPSIZE);
+
+	return 0;
+
+}
+
+static void jpc_ft_fwdlift_row_simd(const jpc_qmfb_kernops_t *ops,
+  jpc_fix_t *a, int numcols, int parity)
+{
+
+	jpc_fix_t *lptr;
+	jpc_fix_t *hptr;
+	int n;
+	int llen;
+
+	llen = (numcols + 1 - parity) >> 1;
+
+	if (numcols > 1) {
+
+		/* Apply the first lifting step. */
+		lptr = &a[0];
+		hptr = &a[llen];
+		if (parity) {
+			hptr[0] -= lptr[0];
+			++hptr;
+		}
+		n = numcols - llen - parity - (parity == (numcols & 1));
+		(*ops->liftsub)(hptr, lptr, 1, 1, n, 0, 0, 1);
+		hptr += n;
+		lptr += n;
+		if (parity == (numcols & 1)) {
+			hptr[0] -= lptr[0];
+		}
+
+		/* Apply the second lifting step. */
+		lptr = &a[0];
+		hptr = &a[llen];
+		if (!parity) {
+			lptr[0] += (hptr[0] + 1) >> 1;
+			++lptr;
+		}
+		n = llen - (!parity) - (parity != (numcols & 1));
+		(*ops->liftadd)(lptr, hptr, 1, 1, n, 0, 2, 2);
+		lptr += n;
+		hptr += n;
+		if (parity != (numcols & 1)) {
+			lptr[0] += (hptr[0] + 1) >> 1;
+		}
+
+	} else {
+
+		if (parity) {
+			a[0] <<= 1;
+		}
+
+	}
+
+}
+
+static void jpc_ft_invlift_row_simd(const jpc_qmfb_kernops_t *ops,
+  jpc_fix_t *a, int numcols, int parity)
+{
+
+	jpc_fix_t *lptr;
+	jpc_fix_t *hptr;
+	int n;
+	int llen;
+
+	llen = (numcols + 1 - parity) >> 1;
+
+	if (numcols > 1) {
+
+		/* Apply the first lifting step. */
+		lptr = &a[0];
+		hptr = &a[llen];
+		if (!parity) {
+			lptr[0] -= (hptr[0] + 1) >> 1;
+			++lptr;
+		}
+		n = llen - (!parity) - (parity != (numcols & 1));
+		(*ops->liftsub)(lptr, hptr, 1, 1, n, 0, 2, 2);
+		lptr += n;
+		hptr += n;
+		if (parity != (numcols & 1)) {
+			lptr[0] -= (hptr[0] + 1) >> 1;
+		}
+
+		/* Apply the second lifting step. */
+		lptr = &a[0];
+		hptr = &a[llen];
+		if (parity) {
+			hptr[0] += lptr[0];
+			++hptr;
+		}
+		n = numcols - llen - parity - (parity == (numcols & 1));
+		(*ops->liftadd)(hptr, lptr, 1, 1, n, 0, 0, 1);
+		hptr += n;
+		lptr += n;
+		if (parity == (numcols & 1)) {
+			hptr[0] += lptr[0];
+		}
+
+	} else {
+
+		if (parity) {
+			a[0] >>= 1;
+		}
+
+	}
+
+}
+
+static void jpc_ft_fwdlift_cols_simd(const jpc_qmfb_kernops_t *ops,
+  jpc_fix_t *a, int numrows, int numcols, int stride, int parity)
+{
+
+	jpc_fix_t *lptr;
+	jpc_fix_t *hptr;
+	int n;
+	int i;
+	int llen;
+
+	llen = (numrows + 1 - parity) >> 1;
+
+	if (numrows > 1) {
+
+		/* Apply the first lifting step. */
+		lptr = &a[0];
+		hptr = &a[llen * stride];
+		if (parity) {
+			for (i = 0; i < numcols; ++i) {
+				hptr[i] -= lptr[i];
+			}
+			hptr += stride;
+		}
+		n = numrows - llen - parity - (parity == (numrows & 1));
+		(*ops->liftsub)(hptr, lptr, stride, n, numcols, stride, 0, 1);
+		hptr += n * stride;
+		lptr += n * stride;
+		if (parity == (numrows & 1)) {
+			for (i = 0; i < numcols; ++i) {
+				hptr[i] -= lptr[i];
+			}
+		}
+
+		/* Apply the second lifting step. */
 		lptr = &a[0];
 		hptr = &a[llen * stride];
 		if (!parity) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
-				lptr2[0] += (hptr2[0] + 1) >> 1;
-				++lptr2;
-				++hptr2;
+			for (i = 0; i < numcols; ++i) {
+				lptr[i] += (hptr[i] + 1) >> 1;
 			}
 			lptr += stride;
 		}
 		n = llen - (!parity) - (parity != (numrows & 1));
-		while (n-- > 0) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
-				lptr2[0] += (hptr2[0] + hptr2[stride] + 2) >> 2;
-				++lptr2;
-				++hptr2;
-			}
-			lptr += stride;
-			hptr += stride;
-		}
+		(*ops->liftadd)(lptr, hptr, stride, n, numcols, stride, 2, 2);
+		lptr += n * stride;
+		hptr += n * stride;
 		if (parity != (numrows & 1)) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
-				lptr2[0] += (hptr2[0] + 1) >> 1;
-				++lptr2;
-				++hptr2;
+			for (i = 0; i < numcols; ++i) {
+				lptr[i] += (hptr[i] + 1) >> 1;
 			}
 		}
 
 	} else {
 
 		if (parity) {
-			lptr2 = &a[0];
-			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
-				lptr2[0] <<= 1;
-				++lptr2;
+			for (i = 0; i < numcols; ++i) {
+				a[i] <<= 1;
 			}
 		}
 
@@ -1138,16 +4003,14 @@ void jpc_ft_fwdlift_colgrp(jpc_fix_t *a, int numrows, int stride, int parity)
 
 }
 
-void jpc_ft_fwdlift_colres(jpc_fix_t *a, int numrows, int numcols, int stride,
-  int parity)
+static void jpc_ft_invlift_cols_simd(const jpc_qmfb_kernops_t *ops,
+  jpc_fix_t *a, int numrows, int numcols, int stride, int parity)
 {
 
 	jpc_fix_t *lptr;
 	jpc_fix_t *hptr;
-	register jpc_fix_t *lptr2;
-	register jpc_fix_t *hptr2;
-	register int n;
-	register int i;
+	int n;
+	int i;
 	int llen;
 
 	llen = (numrows + 1 - parity) >> 1;
@@ -1157,93 +4020,440 @@ void jpc_ft_fwdlift_colres(jpc_fix_t *a, int numrows, int numcols, int stride,
 		/* Apply the first lifting step. */
 		lptr = &a[0];
 		hptr = &a[llen * stride];
-		if (parity) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			for (i = 0; i < numcols; ++i) {
-				hptr2[0] -= lptr2[0];
-				++hptr2;
-				++lptr2;
-			}
-			hptr += stride;
-		}
-		n = numrows - llen - parity - (parity == (numrows & 1));
-		while (n-- > 0) {
-			lptr2 = lptr;
-			hptr2 = hptr;
+		if (!parity) {
 			for (i = 0; i < numcols; ++i) {
-				hptr2[0] -= (lptr2[0] + lptr2[stride]) >> 1;
-				++lptr2;
-				++hptr2;
+				lptr[i] -= (hptr[i] + 1) >> 1;
 			}
-			hptr += stride;
 			lptr += stride;
 		}
-		if (parity == (numrows & 1)) {
-			lptr2 = lptr;
-			hptr2 = hptr;
+		n = llen - (!parity) - (parity != (numrows & 1));
+		(*ops->liftsub)(lptr, hptr, stride, n, numcols, stride, 2, 2);
+		lptr += n * stride;
+		hptr += n * stride;
+		if (parity != (numrows & 1)) {
 			for (i = 0; i < numcols; ++i) {
-				hptr2[0] -= lptr2[0];
-				++lptr2;
-				++hptr2;
+				lptr[i] -= (hptr[i] + 1) >> 1;
 			}
 		}
 
 		/* Apply the second lifting step. */
 		lptr = &a[0];
 		hptr = &a[llen * stride];
-		if (!parity) {
-			lptr2 = lptr;
-			hptr2 = hptr;
+		if (parity) {
 			for (i = 0; i < numcols; ++i) {
-				lptr2[0] += (hptr2[0] + 1) >> 1;
-				++lptr2;
-				++hptr2;
+				hptr[i] += lptr[i];
 			}
-			lptr += stride;
+			hptr += stride;
 		}
-		n = llen - (!parity) - (parity != (numrows & 1));
-		while (n-- > 0) {
-			lptr2 = lptr;
-			hptr2 = hptr;
+		n = numrows - llen - parity - (parity == (numrows & 1));
+		(*ops->liftadd)(hptr, lptr, stride, n, numcols, stride, 0, 1);
+		hptr += n * stride;
+		lptr += n * stride;
+		if (parity == (numrows & 1)) {
 			for (i = 0; i < numcols; ++i) {
-				lptr2[0] += (hptr2[0] + hptr2[stride] + 2) >> 2;
-				++lptr2;
-				++hptr2;
+				hptr[i] += lptr[i];
 			}
-			lptr += stride;
-			hptr += stride;
 		}
-		if (parity != (numrows & 1)) {
-			lptr2 = lptr;
-			hptr2 = hptr;
+
+	} else {
+
+		if (parity) {
 			for (i = 0; i < numcols; ++i) {
-				lptr2[0] += (hptr2[0] + 1) >> 1;
-				++lptr2;
-				++hptr2;
+				a[i] >>= 1;
+			}
+		}
+
+	}
+
+}
+
+#endif
+
+/******************************************************************************\
+* 5/3 transform (16-bit)
+\******************************************************************************/
+
+/*
+ * The 16-bit 5/3 transform follows the same steps as the vectorized one,
+ * but works on 16-bit samples, of which each vector holds twice as many.
+ * The results are the same as those of the 32-bit transform, provided that
+ * every sample fits in 16 bits.  It is for the caller to make sure of this
+ * (see jpc_tsfb_analyze16 and jpc_tsfb_synthesize16).  The kernels for
+ * 16-bit samples form the sums of the lifting steps without overflow, so
+ * only the samples themselves need to be bounded.
+ */
+
+/* Split a row into its lowpass and highpass channels using the
+  (de)interleaving kernel. */
+static void jpc_qmfb_split_row16(const jpc_qmfb_kernops_t *ops,
+  int_least16_t *a, int numcols, int parity)
+{
+
+	int bufsize = JPC_CEILDIVPOW2(numcols, 1);
+#if !defined(HAVE_VLA)
+	int_least16_t splitbuf[QMFB_SPLITBUFSIZE];
+#else
+	int_least16_t splitbuf[bufsize];
+#endif
+	int_least16_t *buf = splitbuf;
+	int hstartcol;
+	int npairs;
+
+#if !defined(HAVE_VLA)
+	/* Get a buffer. */
+	if (bufsize > QMFB_SPLITBUFSIZE) {
+		if (!(buf = jas_malloc(bufsize * sizeof(int_least16_t)))) {
+			/* We have no choice but to commit suicide in this case. */
+			abort();
+		}
+	}
+#endif
+
+	if (numcols >= 2) {
+		hstartcol = (numcols + 1 - parity) >> 1;
+		npairs = numcols >> 1;
+		/* Compact the lowpass samples in place and save the highpass
+		  samples.  The kernel reads each block before writing it, and the
+		  lowpass samples only ever move backwards. */
+		if (parity) {
+			(*ops->deinterleave16)(a, buf, a, npairs);
+		} else {
+			(*ops->deinterleave16)(a, a, buf, npairs);
+		}
+		if (numcols & 1) {
+			if (parity) {
+				buf[npairs] = a[numcols - 1];
+			} else {
+				a[npairs] = a[numcols - 1];
+			}
+		}
+		/* Copy the saved samples into the highpass channel. */
+		memcpy(&a[hstartcol], buf, (numcols - hstartcol) *
+		  sizeof(int_least16_t));
+	}
+
+#if !defined(HAVE_VLA)
+	/* If the split buffer was allocated on the heap, free this memory. */
+	if (buf != splitbuf) {
+		jas_free(buf);
+	}
+#endif
+
+}
+
+/* Join the lowpass and highpass channels of a row using the
+  (de)interleaving kernel. */
+static void jpc_qmfb_join_row16(const jpc_qmfb_kernops_t *ops,
+  int_least16_t *a, int numcols, int parity)
+{
+
+	int bufsize = JPC_CEILDIVPOW2(numcols, 1);
+#if !defined(HAVE_VLA)
+	int_least16_t joinbuf[QMFB_JOINBUFSIZE];
+#else
+	int_least16_t joinbuf[bufsize];
+#endif
+	int_least16_t *buf = joinbuf;
+	int hstartcol;
+	int npairs;
+
+#if !defined(HAVE_VLA)
+	/* Allocate memory for the join buffer from the heap. */
+	if (bufsize > QMFB_JOINBUFSIZE) {
+		if (!(buf = jas_malloc(bufsize * sizeof(int_least16_t)))) {
+			/* We have no choice but to commit suicide. */
+			abort();
+		}
+	}
+#endif
+
+	if (numcols >= 2) {
+		hstartcol = (numcols + 1 - parity) >> 1;
+		npairs = numcols >> 1;
+		/* Save the samples from the lowpass channel. */
+		memcpy(buf, a, hstartcol * sizeof(int_least16_t));
+		/* Interleave the two channels.  The kernel reads each block before
+		  writing it, and the samples written never reach the highpass
+		  samples that have yet to be read. */
+		if (parity) {
+			(*ops->interleave16)(a, &a[hstartcol], buf, npairs);
+		} else {
+			(*ops->interleave16)(a, buf, &a[hstartcol], npairs);
+			if (numcols & 1) {
+				a[numcols - 1] = buf[npairs];
 			}
 		}
+	}
+
+#if !defined(HAVE_VLA)
+	/* If the join buffer was allocated on the heap, free this memory. */
+	if (buf != joinbuf) {
+		jas_free(buf);
+	}
+#endif
+
+}
+
+/* Split a group of columns into their lowpass and highpass channels.  This
+  copies whole runs of samples at a time, and so needs no special kernels. */
+static void jpc_qmfb_split_cols16(int_least16_t *a, int numrows, int numcols,
+  int stride, int parity)
+{
+
+	int bufsize = JPC_CEILDIVPOW2(numrows, 1) * numcols;
+#if !defined(HAVE_VLA)
+	int_least16_t splitbuf[QMFB_SPLITBUFSIZE * JPC_QMFB_COLGRPSIZE16];
+#else
+	int_least16_t splitbuf[bufsize];
+#endif
+	int_least16_t *buf = splitbuf;
+	int_least16_t *srcptr;
+	int_least16_t *dstptr;
+	size_t runsize;
+	int n;
+	int m;
+	int hstartcol;
+
+#if !defined(HAVE_VLA)
+	/* Get a buffer. */
+	if (bufsize > QMFB_SPLITBUFSIZE * JPC_QMFB_COLGRPSIZE16) {
+		if (!(buf = jas_malloc(bufsize * sizeof(int_least16_t)))) {
+			/* We have no choice but to commit suicide in this case. */
+			abort();
+		}
+	}
+#endif
+
+	if (numrows >= 2) {
+		runsize = numcols * sizeof(int_least16_t);
+		hstartcol = (numrows + 1 - parity) >> 1;
+		m = numrows - hstartcol;
+		/* Save the samples destined for the highpass channel. */
+		n = m;
+		dstptr = buf;
+		srcptr = &a[(1 - parity) * stride];
+		while (n-- > 0) {
+			memcpy(dstptr, srcptr, runsize);
+			dstptr += numcols;
+			srcptr += stride << 1;
+		}
+		/* Copy the appropriate samples into the lowpass channel. */
+		dstptr = &a[(1 - parity) * stride];
+		srcptr = &a[(2 - parity) * stride];
+		n = hstartcol - (!parity);
+		while (n-- > 0) {
+			memcpy(dstptr, srcptr, runsize);
+			dstptr += stride;
+			srcptr += stride << 1;
+		}
+		/* Copy the saved samples into the highpass channel. */
+		dstptr = &a[hstartcol * stride];
+		srcptr = buf;
+		n = m;
+		while (n-- > 0) {
+			memcpy(dstptr, srcptr, runsize);
+			dstptr += stride;
+			srcptr += numcols;
+		}
+	}
+
+#if !defined(HAVE_VLA)
+	/* If the split buffer was allocated on the heap, free this memory. */
+	if (buf != splitbuf) {
+		jas_free(buf);
+	}
+#endif
+
+}
+
+/* Join the lowpass and highpass channels of a group of columns.  This
+  copies whole runs of samples at a time, and so needs no special kernels. */
+static void jpc_qmfb_join_cols16(int_least16_t *a, int numrows, int numcols,
+  int stride, int parity)
+{
+
+	int bufsize = JPC_CEILDIVPOW2(numrows, 1) * numcols;
+#if !defined(HAVE_VLA)
+	int_least16_t joinbuf[QMFB_JOINBUFSIZE * JPC_QMFB_COLGRPSIZE16];
+#else
+	int_least16_t joinbuf[bufsize];
+#endif
+	int_least16_t *buf = joinbuf;
+	int_least16_t *srcptr;
+	int_least16_t *dstptr;
+	size_t runsize;
+	int n;
+	int hstartcol;
+
+#if !defined(HAVE_VLA)
+	/* Allocate memory for the join buffer from the heap. */
+	if (bufsize > QMFB_JOINBUFSIZE * JPC_QMFB_COLGRPSIZE16) {
+		if (!(buf = jas_malloc(bufsize * sizeof(int_least16_t)))) {
+			/* We have no choice but to commit suicide. */
+			abort();
+		}
+	}
+#endif
+
+	runsize = numcols * sizeof(int_least16_t);
+	hstartcol = (numrows + 1 - parity) >> 1;
+
+	/* Save the samples from the lowpass channel. */
+	n = hstartcol;
+	srcptr = &a[0];
+	dstptr = buf;
+	while (n-- > 0) {
+		memcpy(dstptr, srcptr, runsize);
+		srcptr += stride;
+		dstptr += numcols;
+	}
+	/* Copy the samples from the highpass channel into place. */
+	srcptr = &a[hstartcol * stride];
+	dstptr = &a[(1 - parity) * stride];
+	n = numrows - hstartcol;
+	while (n-- > 0) {
+		/* The last run may be copied onto itself. */
+		memmove(dstptr, srcptr, runsize);
+		dstptr += 2 * stride;
+		srcptr += stride;
+	}
+	/* Copy the samples from the lowpass channel into place. */
+	srcptr = buf;
+	dstptr = &a[parity * stride];
+	n = hstartcol;
+	while (n-- > 0) {
+		memcpy(dstptr, srcptr, runsize);
+		dstptr += 2 * stride;
+		srcptr += numcols;
+	}
 
-	} else {
+#if !defined(HAVE_VLA)
+	/* If the join buffer was allocated on the heap, free this memory. */
+	if (buf != joinbuf) {
+		jas_free(buf);
+	}
+#endif
 
-		if (parity) {
-			lptr2 = &a[0];
-			for (i = 0; i < numcols; ++i) {
-				lptr2[0] <<= 1;
-				++lptr2;
-			}
-		}
+}
 
+/* The passes of the 16-bit 5/3 transform over a range of column groups or
+  rows. */
+
+static int jpc_ft_fwdcolgrps16(void *arg, int start, int end)
+{
+	jpc_qmfb_pass_t *pass = arg;
+	int_least16_t *startptr;
+	int numcols;
+
+	for (; start < end; ++start) {
+		startptr = &((int_least16_t *) pass->a)[start * JPC_QMFB_COLGRPSIZE16];
+		numcols = JAS_MIN(JPC_QMFB_COLGRPSIZE16,
+		  pass->numcols - start * JPC_QMFB_COLGRPSIZE16);
+		jpc_qmfb_split_cols16(startptr, pass->numrows, numcols, pass->stride,
+		  pass->parity);
+		jpc_ft_fwdlift_cols16(pass->ops, startptr, pass->numrows, numcols,
+		  pass->stride, pass->parity);
 	}
+	return 0;
+}
 
+static int jpc_ft_fwdrows16(void *arg, int start, int end)
+{
+	jpc_qmfb_pass_t *pass = arg;
+	int_least16_t *startptr;
+
+	for (; start < end; ++start) {
+		startptr = &((int_least16_t *) pass->a)[start * pass->stride];
+		jpc_qmfb_split_row16(pass->ops, startptr, pass->numcols,
+		  pass->parity);
+		jpc_ft_fwdlift_row16(pass->ops, startptr, pass->numcols,
+		  pass->parity);
+	}
+	return 0;
 }
 
-void jpc_ft_invlift_row(jpc_fix_t *a, int numcols, int parity)
+static int jpc_ft_invrows16(void *arg, int start, int end)
 {
+	jpc_qmfb_pass_t *pass = arg;
+	int_least16_t *startptr;
+
+	for (; start < end; ++start) {
+		startptr = &((int_least16_t *) pass->a)[start * pass->stride];
+		jpc_ft_invlift_row16(pass->ops, startptr, pass->numcols,
+		  pass->parity);
+		jpc_qmfb_join_row16(pass->ops, startptr, pass->numcols,
+		  pass->parity);
+	}
+	return 0;
+}
 
-	register jpc_fix_t *lptr;
-	register jpc_fix_t *hptr;
-	register int n;
+static int jpc_ft_invcolgrps16(void *arg, int start, int end)
+{
+	jpc_qmfb_pass_t *pass = arg;
+	int_least16_t *startptr;
+	int numcols;
+
+	for (; start < end; ++start) {
+		startptr = &((int_least16_t *) pass->a)[start * JPC_QMFB_COLGRPSIZE16];
+		numcols = JAS_MIN(JPC_QMFB_COLGRPSIZE16,
+		  pass->numcols - start * JPC_QMFB_COLGRPSIZE16);
+		jpc_ft_invlift_cols16(pass->ops, startptr, pass->numrows, numcols,
+		  pass->stride, pass->parity);
+		jpc_qmfb_join_cols16(startptr, pass->numrows, numcols, pass->stride,
+		  pass->parity);
+	}
+	return 0;
+}
+
+int jpc_ft_analyze16(int_least16_t *a, int xstart, int ystart, int width,
+  int height, int stride)
+{
+	const jpc_qmfb_kernops_t *ops = jpc_qmfb_getkernops();
+	int numrows = height;
+	int numcols = width;
+	int rowparity = ystart & 1;
+	int colparity = xstart & 1;
+	jpc_qmfb_pass_t pass;
+
+	jpc_qmfb_initpass(&pass, ops, a, numrows, numcols, stride, rowparity);
+	jpc_qmfb_parfor(&pass, jpc_ft_fwdcolgrps16, JPC_CEILDIV(numcols,
+	  JPC_QMFB_COLGRPSIZE16), numrows * JPC_QMFB_COLGRPSIZE16);
+
+	pass.parity = colparity;
+	jpc_qmfb_parfor(&pass, jpc_ft_fwdrows16, numrows, numcols);
+
+	return 0;
+
+}
+
+int jpc_ft_synthesize16(int_least16_t *a, int xstart, int ystart, int width,
+  int height, int stride)
+{
+	const jpc_qmfb_kernops_t *ops = jpc_qmfb_getkernops();
+	int numrows = height;
+	int numcols = width;
+	int rowparity = ystart & 1;
+	int colparity = xstart & 1;
+	jpc_qmfb_pass_t pass;
+
+	jpc_qmfb_initpass(&pass, ops, a, numrows, numcols, stride, colparity);
+	jpc_qmfb_parfor(&pass, jpc_ft_invrows16, numrows, numcols);
+
+	pass.parity = rowparity;
+	jpc_qmfb_parfor(&pass, jpc_ft_invcolgrps16, JPC_CEILDIV(numcols,
+	  JPC_QMFB_COLGRPSIZE16), numrows * JPC_QMFB_COLGRPSIZE16);
+
+	return 0;
+
+}
+
+static void jpc_ft_fwdlift_row16(const jpc_qmfb_kernops_t *ops,
+  int_least16_t *a, int numcols, int parity)
+{
+
+	int_least16_t *lptr;
+	int_least16_t *hptr;
+	int n;
 	int llen;
 
 	llen = (numcols + 1 - parity) >> 1;
@@ -1253,119 +4463,104 @@ void jpc_ft_invlift_row(jpc_fix_t *a, int numcols, int parity)
 		/* Apply the first lifting step. */
 		lptr = &a[0];
 		hptr = &a[llen];
-		if (!parity) {
-			lptr[0] -= (hptr[0] + 1) >> 1;
-			++lptr;
-		}
-		n = llen - (!parity) - (parity != (numcols & 1));
-		while (n-- > 0) {
-			lptr[0] -= (hptr[0] + hptr[1] + 2) >> 2;
-			++lptr;
+		if (parity) {
+			hptr[0] -= lptr[0];
 			++hptr;
 		}
-		if (parity != (numcols & 1)) {
-			lptr[0] -= (hptr[0] + 1) >> 1;
+		n = numcols - llen - parity - (parity == (numcols & 1));
+		(*ops->liftsub16)(hptr, lptr, 1, 1, n, 0, 0, 1);
+		hptr += n;
+		lptr += n;
+		if (parity == (numcols & 1)) {
+			hptr[0] -= lptr[0];
 		}
 
 		/* Apply the second lifting step. */
 		lptr = &a[0];
 		hptr = &a[llen];
-		if (parity) {
-			hptr[0] += lptr[0];
-			++hptr;
-		}
-		n = numcols - llen - parity - (parity == (numcols & 1));
-		while (n-- > 0) {
-			hptr[0] += (lptr[0] + lptr[1]) >> 1;
-			++hptr;
+		if (!parity) {
+			lptr[0] += (hptr[0] + 1) >> 1;
 			++lptr;
 		}
-		if (parity == (numcols & 1)) {
-			hptr[0] += lptr[0];
+		n = llen - (!parity) - (parity != (numcols & 1));
+		(*ops->liftadd16)(lptr, hptr, 1, 1, n, 0, 2, 2);
+		lptr += n;
+		hptr += n;
+		if (parity != (numcols & 1)) {
+			lptr[0] += (hptr[0] + 1) >> 1;
 		}
 
 	} else {
 
 		if (parity) {
-			lptr = &a[0];
-			lptr[0] >>= 1;
+			a[0] <<= 1;
 		}
 
 	}
 
 }
 
-void jpc_ft_invlift_col(jpc_fix_t *a, int numrows, int stride, int parity)
+static void jpc_ft_invlift_row16(const jpc_qmfb_kernops_t *ops,
+  int_least16_t *a, int numcols, int parity)
 {
 
-	jpc_fix_t *lptr;
-	jpc_fix_t *hptr;
-#if 0
-	register jpc_fix_t *lptr2;
-	register jpc_fix_t *hptr2;
-	register int i;
-#endif
-	register int n;
+	int_least16_t *lptr;
+	int_least16_t *hptr;
+	int n;
 	int llen;
 
-	llen = (numrows + 1 - parity) >> 1;
+	llen = (numcols + 1 - parity) >> 1;
 
-	if (numrows > 1) {
+	if (numcols > 1) {
 
 		/* Apply the first lifting step. */
 		lptr = &a[0];
-		hptr = &a[llen * stride];
+		hptr = &a[llen];
 		if (!parity) {
 			lptr[0] -= (hptr[0] + 1) >> 1;
-			lptr += stride;
-		}
-		n = llen - (!parity) - (parity != (numrows & 1));
-		while (n-- > 0) {
-			lptr[0] -= (hptr[0] + hptr[stride] + 2) >> 2;
-			lptr += stride;
-			hptr += stride;
+			++lptr;
 		}
-		if (parity != (numrows & 1)) {
+		n = llen - (!parity) - (parity != (numcols & 1));
+		(*ops->liftsub16)(lptr, hptr, 1, 1, n, 0, 2, 2);
+		lptr += n;
+		hptr += n;
+		if (parity != (numcols & 1)) {
 			lptr[0] -= (hptr[0] + 1) >> 1;
 		}
 
 		/* Apply the second lifting step. */
 		lptr = &a[0];
-		hptr = &a[llen * stride];
+		hptr = &a[llen];
 		if (parity) {
 			hptr[0] += lptr[0];
-			hptr += stride;
-		}
-		n = numrows - llen - parity - (parity == (numrows & 1));
-		while (n-- > 0) {
-			hptr[0] += (lptr[0] + lptr[stride]) >> 1;
-			hptr += stride;
-			lptr += stride;
+			++hptr;
 		}
-		if (parity == (numrows & 1)) {
+		n = numcols - llen - parity - (parity == (numcols & 1));
+		(*ops->liftadd16)(hptr, lptr, 1, 1, n, 0, 0, 1);
+		hptr += n;
+		lptr += n;
+		if (parity == (numcols & 1)) {
 			hptr[0] += lptr[0];
 		}
 
 	} else {
 
 		if (parity) {
-			lptr = &a[0];
-			lptr[0] >>= 1;
+			a[0] >>= 1;
 		}
 
 	}
 
 }
 
-void jpc_ft_invlift_colgrp(jpc_fix_t *a, int numrows, int stride, int parity)
+static void jpc_ft_fwdlift_cols16(const jpc_qmfb_kernops_t *ops,
+  int_least16_t *a, int numrows, int numcols, int stride, int parity)
 {
 
-	jpc_fix_t *lptr;
-	jpc_fix_t *hptr;
-	register jpc_fix_t *lptr2;
-	register jpc_fix_t *hptr2;
-	register int n;
-	register int i;
+	int_least16_t *lptr;
+	int_least16_t *hptr;
+	int n;
+	int i;
 	int llen;
 
 	llen = (numrows + 1 - parity) >> 1;
@@ -1375,80 +4570,46 @@ void jpc_ft_invlift_colgrp(jpc_fix_t *a, int numrows, int stride, int parity)
 		/* Apply the first lifting step. */
 		lptr = &a[0];
 		hptr = &a[llen * stride];
-		if (!parity) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
-				lptr2[0] -= (hptr2[0] + 1) >> 1;
-				++lptr2;
-				++hptr2;
-			}
-			lptr += stride;
-		}
-		n = llen - (!parity) - (parity != (numrows & 1));
-		while (n-- > 0) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
-				lptr2[0] -= (hptr2[0] + hptr2[stride] + 2) >> 2;
-				++lptr2;
-				++hptr2;
+		if (parity) {
+			for (i = 0; i < numcols; ++i) {
+				hptr[i] -= lptr[i];
 			}
-			lptr += stride;
 			hptr += stride;
 		}
-		if (parity != (numrows & 1)) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
-				lptr2[0] -= (hptr2[0] + 1) >> 1;
-				++lptr2;
-				++hptr2;
+		n = numrows - llen - parity - (parity == (numrows & 1));
+		(*ops->liftsub16)(hptr, lptr, stride, n, numcols, stride, 0, 1);
+		hptr += n * stride;
+		lptr += n * stride;
+		if (parity == (numrows & 1)) {
+			for (i = 0; i < numcols; ++i) {
+				hptr[i] -= lptr[i];
 			}
 		}
 
 		/* Apply the second lifting step. */
 		lptr = &a[0];
 		hptr = &a[llen * stride];
-		if (parity) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
-				hptr2[0] += lptr2[0];
-				++hptr2;
-				++lptr2;
-			}
-			hptr += stride;
-		}
-		n = numrows - llen - parity - (parity == (numrows & 1));
-		while (n-- > 0) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
-				hptr2[0] += (lptr2[0] + lptr2[stride]) >> 1;
-				++lptr2;
-				++hptr2;
+		if (!parity) {
+			for (i = 0; i < numcols; ++i) {
+				lptr[i] += (hptr[i] + 1) >> 1;
 			}
-			hptr += stride;
 			lptr += stride;
 		}
-		if (parity == (numrows & 1)) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
-				hptr2[0] += lptr2[0];
-				++lptr2;
-				++hptr2;
+		n = llen - (!parity) - (parity != (numrows & 1));
+		(*ops->liftadd16)(lptr, hptr, stride, n, numcols, stride, 2, 2);
+		lptr += n * stride;
+		hptr += n * stride;
+		if (parity != (numrows & 1)) {
+			for (i = 0; i < numcols; ++i) {
+				lptr[i] += (hptr[i] + 1) >> 1;
 			}
 		}
 
 	} else {
 
 		if (parity) {
-			lptr2 = &a[0];
-			for (i = 0; i < JPC_QMFB_COLGRPSIZE; ++i) {
-				lptr2[0] >>= 1;
-				++lptr2;
+			for (i = 0; i < numcols; ++i) {
+				a[i] <<= 1;
 			}
 		}
 
@@ -1456,16 +4617,14 @@ void jpc_ft_invlift_colgrp(jpc_fix_t *a, int numrows, int stride, int parity)
 
 }
 
-void jpc_ft_invlift_colres(jpc_fix_t *a, int numrows, int numcols, int stride,
-  int parity)
+static void jpc_ft_invlift_cols16(const jpc_qmfb_kernops_t *ops,
+  int_least16_t *a, int numrows, int numcols, int stride, int parity)
 {
 
-	jpc_fix_t *lptr;
-	jpc_fix_t *hptr;
-	register jpc_fix_t *lptr2;
-	register jpc_fix_t *hptr2;
-	register int n;
-	register int i;
+	int_least16_t *lptr;
+	int_least16_t *hptr;
+	int n;
+	int i;
 	int llen;
 
 	llen = (numrows + 1 - parity) >> 1;
@@ -1475,35 +4634,19 @@ void jpc_ft_invlift_colres(jpc_fix_t *a, int numrows, int numcols, int stride,
 		/* Apply the first lifting step. */
 		lptr = &a[0];
 		hptr = &a[llen * stride];
-		if (!parity) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			for (i = 0; i < numcols; ++i) {
-				lptr2[0] -= (hptr2[0] + 1) >> 1;
-				++lptr2;
-				++hptr2;
-			}
-			lptr += stride;
-		}
-		n = llen - (!parity) - (parity != (numrows & 1));
-		while (n-- > 0) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			for (i = 0; i < numcols; ++i) {
-				lptr2[0] -= (hptr2[0] + hptr2[stride] + 2) >> 2;
-				++lptr2;
-				++hptr2;
+		if (!parity) {
+			for (i = 0; i < numcols; ++i) {
+				lptr[i] -= (hptr[i] + 1) >> 1;
 			}
 			lptr += stride;
-			hptr += stride;
 		}
+		n = llen - (!parity) - (parity != (numrows & 1));
+		(*ops->liftsub16)(lptr, hptr, stride, n, numcols, stride, 2, 2);
+		lptr += n * stride;
+		hptr += n * stride;
 		if (parity != (numrows & 1)) {
-			lptr2 = lptr;
-			hptr2 = hptr;
 			for (i = 0; i < numcols; ++i) {
-				lptr2[0] -= (hptr2[0] + 1) >> 1;
-				++lptr2;
-				++hptr2;
+				lptr[i] -= (hptr[i] + 1) >> 1;
 			}
 		}
 
@@ -1511,44 +4654,26 @@ void jpc_ft_invlift_colres(jpc_fix_t *a, int numrows, int numcols, int stride,
 		lptr = &a[0];
 		hptr = &a[llen * stride];
 		if (parity) {
-			lptr2 = lptr;
-			hptr2 = hptr;
 			for (i = 0; i < numcols; ++i) {
-				hptr2[0] += lptr2[0];
-				++hptr2;
-				++lptr2;
+				hptr[i] += lptr[i];
 			}
 			hptr += stride;
 		}
 		n = numrows - llen - parity - (parity == (numrows & 1));
-		while (n-- > 0) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			for (i = 0; i < numcols; ++i) {
-				hptr2[0] += (lptr2[0] + lptr2[stride]) >> 1;
-				++lptr2;
-				++hptr2;
-			}
-			hptr += stride;
-			lptr += stride;
-		}
+		(*ops->liftadd16)(hptr, lptr, stride, n, numcols, stride, 0, 1);
+		hptr += n * stride;
+		lptr += n * stride;
 		if (parity == (numrows & 1)) {
-			lptr2 = lptr;
-			hptr2 = hptr;
 			for (i = 0; i < numcols; ++i) {
-				hptr2[0] += lptr2[0];
-				++lptr2;
-				++hptr2;
+				hptr[i] += lptr[i];
 			}
 		}
 
 	} else {
 
 		if (parity) {
-			lptr2 = &a[0];
 			for (i = 0; i < numcols; ++i) {
-				lptr2[0] >>= 1;
-				++lptr2;
+				a[i] >>= 1;
 			}
 		}
 
@@ -1556,79 +4681,6 @@ void jpc_ft_invlift_colres(jpc_fix_t *a, int numrows, int numcols, int stride,
 
 }
 
-int jpc_ft_analyze(jpc_fix_t *a, int xstart, int ystart, int width, int height,
-  int stride)
-{
-	int numrows = height;
-	int numcols = width;
-	int rowparity = ystart & 1;
-	int colparity = xstart & 1;
-	int i;
-	jpc_fix_t *startptr;
-	int maxcols;
-
-	maxcols = (numcols / JPC_QMFB_COLGRPSIZE) * JPC_QMFB_COLGRPSIZE;
-	startptr = &a[0];
-	for (i = 0; i < maxcols; i += JPC_QMFB_COLGRPSIZE) {
-		jpc_qmfb_split_colgrp(startptr, numrows, stride, rowparity);
-		jpc_ft_fwdlift_colgrp(startptr, numrows, stride, rowparity);
-		startptr += JPC_QMFB_COLGRPSIZE;
-	}
-	if (maxcols < numcols) {
-		jpc_qmfb_split_colres(startptr, numrows, numcols - maxcols, stride,
-		  rowparity);
-		jpc_ft_fwdlift_colres(startptr, numrows, numcols - maxcols, stride,
-		  rowparity);
-	}
-
-	startptr = &a[0];
-	for (i = 0; i < numrows; ++i) {
-		jpc_qmfb_split_row(startptr, numcols, colparity);
-		jpc_ft_fwdlift_row(startptr, numcols, colparity);
-		startptr += stride;
-	}
-
-	return 0;
-
-}
-
-int jpc_ft_synthesize(int *a, int xstart, int ystart, int width, int height,
-  int stride)
-{
-	int numrows = height;
-	int numcols = width;
-	int rowparity = ystart & 1;
-	int colparity = xstart & 1;
-
-	int maxcols;
-	jpc_fix_t *startptr;
-	int i;
-
-	startptr = &a[0];
-	for (i = 0; i < numrows; ++i) {
-		jpc_ft_invlift_row(startptr, numcols, colparity);
-		jpc_qmfb_join_row(startptr, numcols, colparity);
-		startptr += stride;
-	}
-
-	maxcols = (numcols / JPC_QMFB_COLGRPSIZE) * JPC_QMFB_COLGRPSIZE;
-	startptr = &a[0];
-	for (i = 0; i < maxcols; i += JPC_QMFB_COLGRPSIZE) {
-		jpc_ft_invlift_colgrp(startptr, numrows, stride, rowparity);
-		jpc_qmfb_join_colgrp(startptr, numrows, stride, rowparity);
-		startptr += JPC_QMFB_COLGRPSIZE;
-	}
-	if (maxcols < numcols) {
-		jpc_ft_invlift_colres(startptr, numrows, numcols - maxcols, stride,
-		  rowparity);
-		jpc_qmfb_join_colres(startptr, numrows, numcols - maxcols, stride,
-		  rowparity);
-	}
-
-	return 0;
-
-}
-
 /******************************************************************************\
 * 9/7 transform
 \******************************************************************************/
@@ -2791,12 +5843,203 @@ void jpc_ns_invlift_colres(jpc_fix_t *a, int numrows, int numcols,
 		if (parity == (numrows & 1)) {
 			lptr2 = lptr;
 			hptr2 = hptr;
-			for (i = 0; i < numcols; ++i) {
-				jpc_fix_minuseq(hptr2[0], jpc_fix_mul(jpc_dbltofix(2.0 *
-				  GAMMA), lptr2[0]));
-				++lptr2;
-				++hptr2;
-			}
+			for (i = 0; i < numcols; ++i) {
+				jpc_fix_minuseq(hptr2[0], jpc_fix_mul(jpc_dbltofix(2.0 *
+				  GAMMA), lptr2[0]));
+				++lptr2;
+				++hptr2;
+			}
+		}
+
+		/* Apply the third lifting step. */
+		lptr = &a[0];
+		hptr = &a[llen * stride];
+		if (!parity) {
+			lptr2 = lptr;
+			hptr2 = hptr;
+			for (i = 0; i < numcols; ++i) {
+				jpc_fix_minuseq(lptr2[0], jpc_fix_mul(jpc_dbltofix(2.0 * BETA),
+				  hptr2[0]));
+				++lptr2;
+				++hptr2;
+			}
+			lptr += stride;
+		}
+		n = llen - (!parity) - (parity != (numrows & 1));
+		while (n-- > 0) {
+			lptr2 = lptr;
+			hptr2 = hptr;
+			for (i = 0; i < numcols; ++i) {
+				jpc_fix_minuseq(lptr2[0], jpc_fix_mul(jpc_dbltofix(BETA),
+				  jpc_fix_add(hptr2[0], hptr2[stride])));
+				++lptr2;
+				++hptr2;
+			}
+			lptr += stride;
+			hptr += stride;
+		}
+		if (parity != (numrows & 1)) {
+			lptr2 = lptr;
+			hptr2 = hptr;
+			for (i = 0; i < numcols; ++i) {
+				jpc_fix_minuseq(lptr2[0], jpc_fix_mul(jpc_dbltofix(2.0 * BETA),
+				  hptr2[0]));
+				++lptr2;
+				++hptr2;
+			}
+		}
+
+		/* Apply the fourth lifting step. */
+		lptr = &a[0];
+		hptr = &a[llen * stride];
+		if (parity) {
+			lptr2 = lptr;
+			hptr2 = hptr;
+			for (i = 0; i < numcols; ++i) {
+				jpc_fix_minuseq(hptr2[0], jpc_fix_mul(jpc_dbltofix(2.0 *
+				  ALPHA), lptr2[0]));
+				++hptr2;
+				++lptr2;
+			}
+			hptr += stride;
+		}
+		n = numrows - llen - parity - (parity == (numrows & 1));
+		while (n-- > 0) {
+			lptr2 = lptr;
+			hptr2 = hptr;
+			for (i = 0; i < numcols; ++i) {
+				jpc_fix_minuseq(hptr2[0], jpc_fix_mul(jpc_dbltofix(ALPHA),
+				  jpc_fix_add(lptr2[0], lptr2[stride])));
+				++lptr2;
+				++hptr2;
+			}
+			hptr += stride;
+			lptr += stride;
+		}
+		if (parity == (numrows & 1)) {
+			lptr2 = lptr;
+			hptr2 = hptr;
+			for (i = 0; i < numcols; ++i) {
+				jpc_fix_minuseq(hptr2[0], jpc_fix_mul(jpc_dbltofix(2.0 *
+				  ALPHA), lptr2[0]));
+				++lptr2;
+				++hptr2;
+			}
+		}
+
+	} else {
+
+#if defined(WT_LENONE)
+		if (parity) {
+			lptr2 = &a[0];
+			for (i = 0; i < numcols; ++i) {
+				lptr2[0] >>= 1;
+				++lptr2;
+			}
+		}
+#endif
+
+	}
+
+}
+
+void jpc_ns_invlift_col(jpc_fix_t *a, int numrows, int stride,
+  int parity)
+{
+
+	jpc_fix_t *lptr;
+	jpc_fix_t *hptr;
+	register jpc_fix_t *lptr2;
+	register jpc_fix_t *hptr2;
+	register int n;
+	int llen;
+
+	llen = (numrows + 1 - parity) >> 1;
+
+	if (numrows > 1) {
+
+		/* Apply the scaling step. */
+#if defined(WT_DOSCALE)
+		lptr = &a[0];
+		n = llen;
+		while (n-- > 0) {
+			lptr2 = lptr;
+			lptr2[0] = jpc_fix_mul(lptr2[0], jpc_dbltofix(1.0 / LGAIN));
+			++lptr2;
+			lptr += stride;
+		}
+		hptr = &a[llen * stride];
+		n = numrows - llen;
+		while (n-- > 0) {
+			hptr2 = hptr;
+			hptr2[0] = jpc_fix_mul(hptr2[0], jpc_dbltofix(1.0 / HGAIN));
+			++hptr2;
+			hptr += stride;
+		}
+#endif
+
+		/* Apply the first lifting step. */
+		lptr = &a[0];
+		hptr = &a[llen * stride];
+		if (!parity) {
+			lptr2 = lptr;
+			hptr2 = hptr;
+			jpc_fix_minuseq(lptr2[0], jpc_fix_mul(jpc_dbltofix(2.0 *
+			  DELTA), hptr2[0]));
+			++lptr2;
+			++hptr2;
+			lptr += stride;
+		}
+		n = llen - (!parity) - (parity != (numrows & 1));
+		while (n-- > 0) {
+			lptr2 = lptr;
+			hptr2 = hptr;
+			jpc_fix_minuseq(lptr2[0], jpc_fix_mul(jpc_dbltofix(DELTA),
+			  jpc_fix_add(hptr2[0], hptr2[stride])));
+			++lptr2;
+			++hptr2;
+			lptr += stride;
+			hptr += stride;
+		}
+		if (parity != (numrows & 1)) {
+			lptr2 = lptr;
+			hptr2 = hptr;
+			jpc_fix_minuseq(lptr2[0], jpc_fix_mul(jpc_dbltofix(2.0 *
+			  DELTA), hptr2[0]));
+			++lptr2;
+			++hptr2;
+		}
+
+		/* Apply the second lifting step. */
+		lptr = &a[0];
+		hptr = &a[llen * stride];
+		if (parity) {
+			lptr2 = lptr;
+			hptr2 = hptr;
+			jpc_fix_minuseq(hptr2[0], jpc_fix_mul(jpc_dbltofix(2.0 *
+			  GAMMA), lptr2[0]));
+			++hptr2;
+			++lptr2;
+			hptr += stride;
+		}
+		n = numrows - llen - parity - (parity == (numrows & 1));
+		while (n-- > 0) {
+			lptr2 = lptr;
+			hptr2 = hptr;
+			jpc_fix_minuseq(hptr2[0], jpc_fix_mul(jpc_dbltofix(GAMMA),
+			  jpc_fix_add(lptr2[0], lptr2[stride])));
+			++lptr2;
+			++hptr2;
+			hptr += stride;
+			lptr += stride;
+		}
+		if (parity == (numrows & 1)) {
+			lptr2 = lptr;
+			hptr2 = hptr;
+			jpc_fix_minuseq(hptr2[0], jpc_fix_mul(jpc_dbltofix(2.0 *
+			  GAMMA), lptr2[0]));
+			++lptr2;
+			++hptr2;
 		}
 
 		/* Apply the third lifting step. */
@@ -2805,36 +6048,30 @@ void jpc_ns_invlift_colres(jpc_fix_t *a, int numrows, int numcols,
 		if (!parity) {
 			lptr2 = lptr;
 			hptr2 = hptr;
-			for (i = 0; i < numcols; ++i) {
-				jpc_fix_minuseq(lptr2[0], jpc_fix_mul(jpc_dbltofix(2.0 * BETA),
-				  hptr2[0]));
-				++lptr2;
-				++hptr2;
-			}
+			jpc_fix_minuseq(lptr2[0], jpc_fix_mul(jpc_dbltofix(2.0 * BETA),
+			  hptr2[0]));
+			++lptr2;
+			++hptr2;
 			lptr += stride;
 		}
 		n = llen - (!parity) - (parity != (numrows & 1));
 		while (n-- > 0) {
 			lptr2 = lptr;
 			hptr2 = hptr;
-			for (i = 0; i < numcols; ++i) {
-				jpc_fix_minuseq(lptr2[0], jpc_fix_mul(jpc_dbltofix(BETA),
-				  jpc_fix_add(hptr2[0], hptr2[stride])));
-				++lptr2;
-				++hptr2;
-			}
+			jpc_fix_minuseq(lptr2[0], jpc_fix_mul(jpc_dbltofix(BETA),
+			  jpc_fix_add(hptr2[0], hptr2[stride])));
+			++lptr2;
+			++hptr2;
 			lptr += stride;
 			hptr += stride;
 		}
 		if (parity != (numrows & 1)) {
 			lptr2 = lptr;
 			hptr2 = hptr;
-			for (i = 0; i < numcols; ++i) {
-				jpc_fix_minuseq(lptr2[0], jpc_fix_mul(jpc_dbltofix(2.0 * BETA),
-				  hptr2[0]));
-				++lptr2;
-				++hptr2;
-			}
+			jpc_fix_minuseq(lptr2[0], jpc_fix_mul(jpc_dbltofix(2.0 * BETA),
+			  hptr2[0]));
+			++lptr2;
+			++hptr2;
 		}
 
 		/* Apply the fourth lifting step. */
@@ -2843,47 +6080,481 @@ void jpc_ns_invlift_colres(jpc_fix_t *a, int numrows, int numcols,
 		if (parity) {
 			lptr2 = lptr;
 			hptr2 = hptr;
-			for (i = 0; i < numcols; ++i) {
-				jpc_fix_minuseq(hptr2[0], jpc_fix_mul(jpc_dbltofix(2.0 *
-				  ALPHA), lptr2[0]));
-				++hptr2;
-				++lptr2;
-			}
+			jpc_fix_minuseq(hptr2[0], jpc_fix_mul(jpc_dbltofix(2.0 *
+			  ALPHA), lptr2[0]));
+			++hptr2;
+			++lptr2;
 			hptr += stride;
 		}
 		n = numrows - llen - parity - (parity == (numrows & 1));
 		while (n-- > 0) {
 			lptr2 = lptr;
 			hptr2 = hptr;
-			for (i = 0; i < numcols; ++i) {
-				jpc_fix_minuseq(hptr2[0], jpc_fix_mul(jpc_dbltofix(ALPHA),
-				  jpc_fix_add(lptr2[0], lptr2[stride])));
-				++lptr2;
-				++hptr2;
-			}
+			jpc_fix_minuseq(hptr2[0], jpc_fix_mul(jpc_dbltofix(ALPHA),
+			  jpc_fix_add(lptr2[0], lptr2[stride])));
+			++lptr2;
+			++hptr2;
 			hptr += stride;
 			lptr += stride;
 		}
-		if (parity == (numrows & 1)) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			for (i = 0; i < numcols; ++i) {
-				jpc_fix_minuseq(hptr2[0], jpc_fix_mul(jpc_dbltofix(2.0 *
-				  ALPHA), lptr2[0]));
-				++lptr2;
-				++hptr2;
-			}
+		if (parity == (numrows & 1)) {
+			lptr2 = lptr;
+			hptr2 = hptr;
+			jpc_fix_minuseq(hptr2[0], jpc_fix_mul(jpc_dbltofix(2.0 *
+			  ALPHA), lptr2[0]));
+			++lptr2;
+			++hptr2;
+		}
+
+	} else {
+
+#if defined(WT_LENONE)
+		if (parity) {
+			lptr2 = &a[0];
+			lptr2[0] >>= 1;
+			++lptr2;
+		}
+#endif
+
+	}
+
+}
+
+/* The passes of the 9/7 transform over a range of column groups or rows. */
+
+static int jpc_ns_fwdcolgrps(void *arg, int start, int end)
+{
+	jpc_qmfb_pass_t *pass = arg;
+	jpc_fix_t *startptr;
+	int numcols;
+
+	for (; start < end; ++start) {
+		startptr = &((jpc_fix_t *) pass->a)[start * JPC_QMFB_COLGRPSIZE];
+		numcols = pass->numcols - start * JPC_QMFB_COLGRPSIZE;
+		if (numcols >= JPC_QMFB_COLGRPSIZE) {
+			jpc_qmfb_split_colgrp(startptr, pass->numrows, pass->stride,
+			  pass->parity);
+			jpc_ns_fwdlift_colgrp(startptr, pass->numrows, pass->stride,
+			  pass->parity);
+		} else {
+			jpc_qmfb_split_colres(startptr, pass->numrows, numcols,
+			  pass->stride, pass->parity);
+			jpc_ns_fwdlift_colres(startptr, pass->numrows, numcols,
+			  pass->stride, pass->parity);
+		}
+	}
+	return 0;
+}
+
+static int jpc_ns_fwdrows(void *arg, int start, int end)
+{
+	jpc_qmfb_pass_t *pass = arg;
+	jpc_fix_t *startptr;
+
+	for (; start < end; ++start) {
+		startptr = &((jpc_fix_t *) pass->a)[start * pass->stride];
+		jpc_qmfb_split_row(startptr, pass->numcols, pass->parity);
+		jpc_ns_fwdlift_row(startptr, pass->numcols, pass->parity);
+	}
+	return 0;
+}
+
+static int jpc_ns_invrows(void *arg, int start, int end)
+{
+	jpc_qmfb_pass_t *pass = arg;
+	jpc_fix_t *startptr;
+
+	for (; start < end; ++start) {
+		startptr = &((jpc_fix_t *) pass->a)[start * pass->stride];
+		jpc_ns_invlift_row(startptr, pass->numcols, pass->parity);
+		jpc_qmfb_join_row(startptr, pass->numcols, pass->parity);
+	}
+	return 0;
+}
+
+static int jpc_ns_invcolgrps(void *arg, int start, int end)
+{
+	jpc_qmfb_pass_t *pass = arg;
+	jpc_fix_t *startptr;
+	int numcols;
+
+	for (; start < end; ++start) {
+		startptr = &((jpc_fix_t *) pass->a)[start * JPC_QMFB_COLGRPSIZE];
+		numcols = pass->numcols - start * JPC_QMFB_COLGRPSIZE;
+		if (numcols >= JPC_QMFB_COLGRPSIZE) {
+			jpc_ns_invlift_colgrp(startptr, pass->numrows, pass->stride,
+			  pass->parity);
+			jpc_qmfb_join_colgrp(startptr, pass->numrows, pass->stride,
+			  pass->parity);
+		} else {
+			jpc_ns_invlift_colres(startptr, pass->numrows, numcols,
+			  pass->stride, pass->parity);
+			jpc_qmfb_join_colres(startptr, pass->numrows, numcols,
+			  pass->stride, pass->parity);
+		}
+	}
+	return 0;
+}
+
+int jpc_ns_analyze(jpc_fix_t *a, int xstart, int ystart, int width, int height,
+  int stride)
+{
+
+	int numrows = height;
+	int numcols = width;
+	int rowparity = ystart & 1;
+	int colparity = xstart & 1;
+	jpc_qmfb_pass_t pass;
+
+	jpc_qmfb_initpass(&pass, 0, a, numrows, numcols, stride, rowparity);
+	jpc_qmfb_parfor(&pass, jpc_ns_fwdcolgrps, JPC_CEILDIV(numcols,
+	  JPC_QMFB_COLGRPSIZE), numrows * JPC_QMFB_COLGRPSIZE);
+
+	pass.parity = colparity;
+	jpc_qmfb_parfor(&pass, jpc_ns_fwdrows, numrows, numcols);
+
+	return 0;
+
+}
+
+int jpc_ns_synthesize(jpc_fix_t *a, int xstart, int ystart, int width,
+  int height, int stride)
+{
+
+	int numrows = height;
+	int numcols = width;
+	int rowparity = ystart & 1;
+	int colparity = xstart & 1;
+	jpc_qmfb_pass_t pass;
+
+	jpc_qmfb_initpass(&pass, 0, a, numrows, numcols, stride, colparity);
+	jpc_qmfb_parfor(&pass, jpc_ns_invrows, numrows, numcols);
+
+	pass.parity = rowparity;
+	jpc_qmfb_parfor(&pass, jpc_ns_invcolgrps, JPC_CEILDIV(numcols,
+	  JPC_QMFB_COLGRPSIZE), numrows * JPC_QMFB_COLGRPSIZE);
+
+	return 0;
+
+}
+
+/* Analyze a single row, as jpc_ns_analyze does for each row. */
+static int jpc_ns_analyzerow(jpc_fix_t *a, int xstart, int width)
+{
+	jpc_qmfb_pass_t pass;
+
+	jpc_qmfb_initpass(&pass, 0, a, 1, width, width, xstart & 1);
+	return jpc_ns_fwdrows(&pass, 0, 1);
+}
+
+/* Synthesize a single row, as jpc_ns_synthesize does for each row. */
+static int jpc_ns_synthesizerow(jpc_fix_t *a, int xstart, int width)
+{
+	jpc_qmfb_pass_t pass;
+
+	jpc_qmfb_initpass(&pass, 0, a, 1, width, width, xstart & 1);
+	return jpc_ns_invrows(&pass, 0, 1);
+}
+
+/* Apply a lifting step of the transform of the columns to a row, with the
+  same arithmetic as jpc_ns_fwdlift_colgrp and jpc_ns_invlift_colgrp.  At
+  the ends of the columns, the coefficient is doubled instead of the
+  neighbour, as there. */
+static void jpc_ns_liftrow(const jpc_qmfb_kernops_t *ops, int inverse,
+  int stepno, jpc_fix_t *d, jpc_fix_t *s0, jpc_fix_t *s1, int numcols)
+{
+	static const double coefs[] = {ALPHA, BETA, GAMMA, DELTA};
+	double coef;
+	jpc_fix_t c;
+	int i;
+
+	/* Eliminate compiler warnings about unused variables. */
+	(void) ops;
+
+	/* Synthesis undoes the steps of analysis in reverse order. */
+	coef = coefs[inverse ? (3 - stepno) : stepno];
+	if (s1) {
+		c = jpc_dbltofix(coef);
+		for (i = 0; i < numcols; ++i) {
+			if (inverse) {
+				jpc_fix_minuseq(d[i], jpc_fix_mul(c, jpc_fix_add(s0[i],
+				  s1[i])));
+			} else {
+				jpc_fix_pluseq(d[i], jpc_fix_mul(c, jpc_fix_add(s0[i],
+				  s1[i])));
+			}
+		}
+	} else {
+		c = jpc_dbltofix(2.0 * coef);
+		for (i = 0; i < numcols; ++i) {
+			if (inverse) {
+				jpc_fix_minuseq(d[i], jpc_fix_mul(c, s0[i]));
+			} else {
+				jpc_fix_pluseq(d[i], jpc_fix_mul(c, s0[i]));
+			}
+		}
+	}
+}
+
+/* Scale a row of the transform of the columns. */
+static void jpc_ns_scalerow(const jpc_qmfb_kernops_t *ops, int inverse,
+  int lowpass, int numrows, jpc_fix_t *a, int numcols)
+{
+	jpc_fix_t c;
+	int i;
+
+	/* Eliminate compiler warnings about unused variables. */
+	(void) ops;
+
+	if (numrows > 1) {
+#if defined(WT_DOSCALE)
+		if (inverse) {
+			c = lowpass ? jpc_dbltofix(1.0 / LGAIN) :
+			  jpc_dbltofix(1.0 / HGAIN);
+		} else {
+			c = lowpass ? jpc_dbltofix(LGAIN) : jpc_dbltofix(HGAIN);
+		}
+		for (i = 0; i < numcols; ++i) {
+			a[i] = jpc_fix_mul(a[i], c);
+		}
+#endif
+	} else {
+#if defined(WT_LENONE)
+		if (!lowpass) {
+			for (i = 0; i < numcols; ++i) {
+				if (inverse) {
+					a[i] >>= 1;
+				} else {
+					a[i] <<= 1;
+				}
+			}
+		}
+#endif
+	}
+}
+
+
+/******************************************************************************\
+* 9/7 transform (floating point)
+\******************************************************************************/
+
+/*
+ * The floating-point 9/7 transform follows the same steps as the fixed-point
+ * code above, but the samples are single-precision floats stored in the
+ * place of the integer samples.  The lifting is done by the kernels for the
+ * instruction set chosen at run time.  Rows are lifted along their
+ * (contiguous) samples, and columns are lifted a group at a time with one
+ * kernel call per step.
+ */
+
+/* The passes of the floating-point 9/7 transform over a range of column
+  groups or rows. */
+
+static int jpc_nsflt_fwdcolgrps(void *arg, int start, int end)
+{
+	jpc_qmfb_pass_t *pass = arg;
+	jpc_fix_t *startptr;
+	int numcols;
+
+	for (; start < end; ++start) {
+		startptr = &((jpc_fix_t *) pass->a)[start * JPC_QMFB_COLGRPSIZE];
+		numcols = JAS_MIN(JPC_QMFB_COLGRPSIZE,
+		  pass->numcols - start * JPC_QMFB_COLGRPSIZE);
+		jpc_qmfb_split_cols(startptr, pass->numrows, numcols, pass->stride,
+		  pass->parity);
+		jpc_nsflt_fwdlift(pass->ops, (float *) startptr, pass->numrows,
+		  numcols, pass->stride, pass->parity);
+	}
+	return 0;
+}
+
+static int jpc_nsflt_fwdrows(void *arg, int start, int end)
+{
+	jpc_qmfb_pass_t *pass = arg;
+	jpc_fix_t *startptr;
+
+	for (; start < end; ++start) {
+		startptr = &((jpc_fix_t *) pass->a)[start * pass->stride];
+		jpc_qmfb_split_row_simd(pass->ops, startptr, pass->numcols,
+		  pass->parity);
+		jpc_nsflt_fwdlift(pass->ops, (float *) startptr, pass->numcols, 1, 1,
+		  pass->parity);
+	}
+	return 0;
+}
+
+static int jpc_nsflt_invrows(void *arg, int start, int end)
+{
+	jpc_qmfb_pass_t *pass = arg;
+	jpc_fix_t *startptr;
+
+	for (; start < end; ++start) {
+		startptr = &((jpc_fix_t *) pass->a)[start * pass->stride];
+		jpc_nsflt_invlift(pass->ops, (float *) startptr, pass->numcols, 1, 1,
+		  pass->parity);
+		jpc_qmfb_join_row_simd(pass->ops, startptr, pass->numcols,
+		  pass->parity);
+	}
+	return 0;
+}
+
+static int jpc_nsflt_invcolgrps(void *arg, int start, int end)
+{
+	jpc_qmfb_pass_t *pass = arg;
+	jpc_fix_t *startptr;
+	int numcols;
+
+	for (; start < end; ++start) {
+		startptr = &((jpc_fix_t *) pass->a)[start * JPC_QMFB_COLGRPSIZE];
+		numcols = JAS_MIN(JPC_QMFB_COLGRPSIZE,
+		  pass->numcols - start * JPC_QMFB_COLGRPSIZE);
+		jpc_nsflt_invlift(pass->ops, (float *) startptr, pass->numrows,
+		  numcols, pass->stride, pass->parity);
+		jpc_qmfb_join_cols(startptr, pass->numrows, numcols, pass->stride,
+		  pass->parity);
+	}
+	return 0;
+}
+
+int jpc_nsflt_analyze(jpc_fix_t *a, int xstart, int ystart, int width,
+  int height, int stride)
+{
+	int numrows = height;
+	int numcols = width;
+	int rowparity = ystart & 1;
+	int colparity = xstart & 1;
+	jpc_qmfb_pass_t pass;
+	const jpc_qmfb_kernops_t *ops;
+
+	ops = jpc_qmfb_getkernops();
+
+	jpc_qmfb_initpass(&pass, ops, a, numrows, numcols, stride, rowparity);
+	jpc_qmfb_parfor(&pass, jpc_nsflt_fwdcolgrps, JPC_CEILDIV(numcols,
+	  JPC_QMFB_COLGRPSIZE), numrows * JPC_QMFB_COLGRPSIZE);
+
+	pass.parity = colparity;
+	jpc_qmfb_parfor(&pass, jpc_nsflt_fwdrows, numrows, numcols);
+
+	return 0;
+
+}
+
+int jpc_nsflt_synthesize(jpc_fix_t *a, int xstart, int ystart, int width,
+  int height, int stride)
+{
+	int numrows = height;
+	int numcols = width;
+	int rowparity = ystart & 1;
+	int colparity = xstart & 1;
+	jpc_qmfb_pass_t pass;
+	const jpc_qmfb_kernops_t *ops;
+
+	ops = jpc_qmfb_getkernops();
+
+	jpc_qmfb_initpass(&pass, ops, a, numrows, numcols, stride, colparity);
+	jpc_qmfb_parfor(&pass, jpc_nsflt_invrows, numrows, numcols);
+
+	pass.parity = rowparity;
+	jpc_qmfb_parfor(&pass, jpc_nsflt_invcolgrps, JPC_CEILDIV(numcols,
+	  JPC_QMFB_COLGRPSIZE), numrows * JPC_QMFB_COLGRPSIZE);
+
+	return 0;
+
+}
+
+/* Analyze a single row, as jpc_nsflt_analyze does for each row. */
+static int jpc_nsflt_analyzerow(jpc_fix_t *a, int xstart, int width)
+{
+	jpc_qmfb_pass_t pass;
+
+	jpc_qmfb_initpass(&pass, jpc_qmfb_getkernops(), a, 1, width, width,
+	  xstart & 1);
+	return jpc_nsflt_fwdrows(&pass, 0, 1);
+}
+
+/* Synthesize a single row, as jpc_nsflt_synthesize does for each row. */
+static int jpc_nsflt_synthesizerow(jpc_fix_t *a, int xstart, int width)
+{
+	jpc_qmfb_pass_t pass;
+
+	jpc_qmfb_initpass(&pass, jpc_qmfb_getkernops(), a, 1, width, width,
+	  xstart & 1);
+	return jpc_nsflt_invrows(&pass, 0, 1);
+}
+
+/* Apply a lifting step of the transform of the columns to a row, as
+  jpc_nsflt_liftstep does. */
+static void jpc_nsflt_liftrow(const jpc_qmfb_kernops_t *ops, int inverse,
+  int stepno, jpc_fix_t *d, jpc_fix_t *s0, jpc_fix_t *s1, int numcols)
+{
+	static const double coefs[] = {ALPHA, BETA, GAMMA, DELTA};
+
+	(*ops->liftflt)((float *) d, (float *) s0, s1 ? (s1 - s0) : 0, 1,
+	  numcols, 0, inverse ? (float) -coefs[3 - stepno] :
+	  (float) coefs[stepno]);
+}
+
+/* Scale a row of the transform of the columns, as jpc_nsflt_fwdlift and
+  jpc_nsflt_invlift do. */
+static void jpc_nsflt_scalerow(const jpc_qmfb_kernops_t *ops, int inverse,
+  int lowpass, int numrows, jpc_fix_t *a, int numcols)
+{
+	if (numrows > 1) {
+#if defined(WT_DOSCALE)
+		if (inverse) {
+			(*ops->scaleflt)((float *) a, 1, numcols, 0, lowpass ?
+			  (float) (1.0 / LGAIN) : (float) (1.0 / HGAIN));
+		} else {
+			(*ops->scaleflt)((float *) a, 1, numcols, 0, lowpass ?
+			  (float) LGAIN : (float) HGAIN);
+		}
+#endif
+	} else {
+#if defined(WT_LENONE)
+		if (!lowpass) {
+			(*ops->scaleflt)((float *) a, 1, numcols, 0, inverse ? 0.5f :
+			  2.0f);
 		}
+#endif
+	}
+}
+
+/* Apply the forward lifting steps to a sequence of len samples that has
+  already been split into its lowpass and highpass channels.  Successive
+  samples of the sequence are stride apart.  A row has a stride of one.
+  For a group of columns, numcols adjacent sequences are processed
+  together. */
+static void jpc_nsflt_fwdlift(const jpc_qmfb_kernops_t *ops, float *a,
+  int len, int numcols, int stride, int parity)
+{
+	int llen;
+
+	llen = (len + 1 - parity) >> 1;
+
+	if (len > 1) {
+
+		/* Apply the lifting steps. */
+		jpc_nsflt_liftstep(ops, a, len, numcols, stride, parity, 0,
+		  (float) ALPHA);
+		jpc_nsflt_liftstep(ops, a, len, numcols, stride, parity, 1,
+		  (float) BETA);
+		jpc_nsflt_liftstep(ops, a, len, numcols, stride, parity, 0,
+		  (float) GAMMA);
+		jpc_nsflt_liftstep(ops, a, len, numcols, stride, parity, 1,
+		  (float) DELTA);
+
+		/* Apply the scaling step. */
+#if defined(WT_DOSCALE)
+		jpc_nsflt_scale(ops, a, llen, numcols, stride, (float) LGAIN);
+		jpc_nsflt_scale(ops, &a[llen * stride], len - llen, numcols, stride,
+		  (float) HGAIN);
+#endif
 
 	} else {
 
 #if defined(WT_LENONE)
 		if (parity) {
-			lptr2 = &a[0];
-			for (i = 0; i < numcols; ++i) {
-				lptr2[0] >>= 1;
-				++lptr2;
-			}
+			jpc_nsflt_scale(ops, a, 1, numcols, stride, 2.0f);
 		}
 #endif
 
@@ -2891,254 +6562,228 @@ void jpc_ns_invlift_colres(jpc_fix_t *a, int numrows, int numcols,
 
 }
 
-void jpc_ns_invlift_col(jpc_fix_t *a, int numrows, int stride,
-  int parity)
+/* Apply the inverse lifting steps, as for jpc_nsflt_fwdlift. */
+static void jpc_nsflt_invlift(const jpc_qmfb_kernops_t *ops, float *a,
+  int len, int numcols, int stride, int parity)
 {
-
-	jpc_fix_t *lptr;
-	jpc_fix_t *hptr;
-	register jpc_fix_t *lptr2;
-	register jpc_fix_t *hptr2;
-	register int n;
 	int llen;
 
-	llen = (numrows + 1 - parity) >> 1;
+	llen = (len + 1 - parity) >> 1;
 
-	if (numrows > 1) {
+	if (len > 1) {
 
 		/* Apply the scaling step. */
 #if defined(WT_DOSCALE)
-		lptr = &a[0];
-		n = llen;
-		while (n-- > 0) {
-			lptr2 = lptr;
-			lptr2[0] = jpc_fix_mul(lptr2[0], jpc_dbltofix(1.0 / LGAIN));
-			++lptr2;
-			lptr += stride;
-		}
-		hptr = &a[llen * stride];
-		n = numrows - llen;
-		while (n-- > 0) {
-			hptr2 = hptr;
-			hptr2[0] = jpc_fix_mul(hptr2[0], jpc_dbltofix(1.0 / HGAIN));
-			++hptr2;
-			hptr += stride;
-		}
+		jpc_nsflt_scale(ops, a, llen, numcols, stride,
+		  (float) (1.0 / LGAIN));
+		jpc_nsflt_scale(ops, &a[llen * stride], len - llen, numcols, stride,
+		  (float) (1.0 / HGAIN));
 #endif
 
-		/* Apply the first lifting step. */
-		lptr = &a[0];
-		hptr = &a[llen * stride];
-		if (!parity) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			jpc_fix_minuseq(lptr2[0], jpc_fix_mul(jpc_dbltofix(2.0 *
-			  DELTA), hptr2[0]));
-			++lptr2;
-			++hptr2;
-			lptr += stride;
-		}
-		n = llen - (!parity) - (parity != (numrows & 1));
-		while (n-- > 0) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			jpc_fix_minuseq(lptr2[0], jpc_fix_mul(jpc_dbltofix(DELTA),
-			  jpc_fix_add(hptr2[0], hptr2[stride])));
-			++lptr2;
-			++hptr2;
-			lptr += stride;
-			hptr += stride;
-		}
-		if (parity != (numrows & 1)) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			jpc_fix_minuseq(lptr2[0], jpc_fix_mul(jpc_dbltofix(2.0 *
-			  DELTA), hptr2[0]));
-			++lptr2;
-			++hptr2;
-		}
+		/* Apply the lifting steps. */
+		jpc_nsflt_liftstep(ops, a, len, numcols, stride, parity, 1,
+		  (float) -DELTA);
+		jpc_nsflt_liftstep(ops, a, len, numcols, stride, parity, 0,
+		  (float) -GAMMA);
+		jpc_nsflt_liftstep(ops, a, len, numcols, stride, parity, 1,
+		  (float) -BETA);
+		jpc_nsflt_liftstep(ops, a, len, numcols, stride, parity, 0,
+		  (float) -ALPHA);
 
-		/* Apply the second lifting step. */
-		lptr = &a[0];
-		hptr = &a[llen * stride];
+	} else {
+
+#if defined(WT_LENONE)
 		if (parity) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			jpc_fix_minuseq(hptr2[0], jpc_fix_mul(jpc_dbltofix(2.0 *
-			  GAMMA), lptr2[0]));
-			++hptr2;
-			++lptr2;
-			hptr += stride;
-		}
-		n = numrows - llen - parity - (parity == (numrows & 1));
-		while (n-- > 0) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			jpc_fix_minuseq(hptr2[0], jpc_fix_mul(jpc_dbltofix(GAMMA),
-			  jpc_fix_add(lptr2[0], lptr2[stride])));
-			++lptr2;
-			++hptr2;
-			hptr += stride;
-			lptr += stride;
-		}
-		if (parity == (numrows & 1)) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			jpc_fix_minuseq(hptr2[0], jpc_fix_mul(jpc_dbltofix(2.0 *
-			  GAMMA), lptr2[0]));
-			++lptr2;
-			++hptr2;
+			jpc_nsflt_scale(ops, a, 1, numcols, stride, 0.5f);
 		}
+#endif
 
-		/* Apply the third lifting step. */
-		lptr = &a[0];
-		hptr = &a[llen * stride];
+	}
+
+}
+
+/* Apply one lifting step, updating either the lowpass or the highpass
+  channel from its neighbours in the other channel.  At the ends of the
+  sequence, the missing neighbour is replaced by its mirror image. */
+static void jpc_nsflt_liftstep(const jpc_qmfb_kernops_t *ops, float *a,
+  int len, int numcols, int stride, int parity, int lowpass, float c)
+{
+	float *lptr;
+	float *hptr;
+	int llen;
+	int n;
+
+	llen = (len + 1 - parity) >> 1;
+	lptr = &a[0];
+	hptr = &a[llen * stride];
+	if (lowpass) {
 		if (!parity) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			jpc_fix_minuseq(lptr2[0], jpc_fix_mul(jpc_dbltofix(2.0 * BETA),
-			  hptr2[0]));
-			++lptr2;
-			++hptr2;
-			lptr += stride;
-		}
-		n = llen - (!parity) - (parity != (numrows & 1));
-		while (n-- > 0) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			jpc_fix_minuseq(lptr2[0], jpc_fix_mul(jpc_dbltofix(BETA),
-			  jpc_fix_add(hptr2[0], hptr2[stride])));
-			++lptr2;
-			++hptr2;
+			jpc_nsflt_lift(ops, lptr, hptr, 0, 1, numcols, stride, c);
 			lptr += stride;
-			hptr += stride;
 		}
-		if (parity != (numrows & 1)) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			jpc_fix_minuseq(lptr2[0], jpc_fix_mul(jpc_dbltofix(2.0 * BETA),
-			  hptr2[0]));
-			++lptr2;
-			++hptr2;
+		n = llen - (!parity) - (parity != (len & 1));
+		jpc_nsflt_lift(ops, lptr, hptr, stride, n, numcols, stride, c);
+		lptr += n * stride;
+		hptr += n * stride;
+		if (parity != (len & 1)) {
+			jpc_nsflt_lift(ops, lptr, hptr, 0, 1, numcols, stride, c);
 		}
-
-		/* Apply the fourth lifting step. */
-		lptr = &a[0];
-		hptr = &a[llen * stride];
+	} else {
 		if (parity) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			jpc_fix_minuseq(hptr2[0], jpc_fix_mul(jpc_dbltofix(2.0 *
-			  ALPHA), lptr2[0]));
-			++hptr2;
-			++lptr2;
-			hptr += stride;
-		}
-		n = numrows - llen - parity - (parity == (numrows & 1));
-		while (n-- > 0) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			jpc_fix_minuseq(hptr2[0], jpc_fix_mul(jpc_dbltofix(ALPHA),
-			  jpc_fix_add(lptr2[0], lptr2[stride])));
-			++lptr2;
-			++hptr2;
+			jpc_nsflt_lift(ops, hptr, lptr, 0, 1, numcols, stride, c);
 			hptr += stride;
-			lptr += stride;
 		}
-		if (parity == (numrows & 1)) {
-			lptr2 = lptr;
-			hptr2 = hptr;
-			jpc_fix_minuseq(hptr2[0], jpc_fix_mul(jpc_dbltofix(2.0 *
-			  ALPHA), lptr2[0]));
-			++lptr2;
-			++hptr2;
+		n = len - llen - parity - (parity == (len & 1));
+		jpc_nsflt_lift(ops, hptr, lptr, stride, n, numcols, stride, c);
+		hptr += n * stride;
+		lptr += n * stride;
+		if (parity == (len & 1)) {
+			jpc_nsflt_lift(ops, hptr, lptr, 0, 1, numcols, stride, c);
 		}
+	}
+}
 
+/* Compute d += c * (s + s[off]) at n successive positions of the
+  sequences.  With an offset of zero, this is the mirrored update
+  d += 2 * c * s used at the ends. */
+static void jpc_nsflt_lift(const jpc_qmfb_kernops_t *ops, float *d,
+  float *s, int off, int n, int numcols, int stride, float c)
+{
+	if (n <= 0) {
+		return;
+	}
+	if (stride == 1) {
+		/* The positions of a row are contiguous. */
+		(*ops->liftflt)(d, s, off, 1, n, 0, c);
 	} else {
-
-#if defined(WT_LENONE)
-		if (parity) {
-			lptr2 = &a[0];
-			lptr2[0] >>= 1;
-			++lptr2;
-		}
-#endif
-
+		(*ops->liftflt)(d, s, off, n, numcols, stride, c);
 	}
-
 }
 
-int jpc_ns_analyze(jpc_fix_t *a, int xstart, int ystart, int width, int height,
-  int stride)
+/* Compute a *= c at n successive positions of the sequences. */
+static void jpc_nsflt_scale(const jpc_qmfb_kernops_t *ops, float *a, int n,
+  int numcols, int stride, float c)
 {
-
-	int numrows = height;
-	int numcols = width;
-	int rowparity = ystart & 1;
-	int colparity = xstart & 1;
-	int i;
-	jpc_fix_t *startptr;
-	int maxcols;
-
-	maxcols = (numcols / JPC_QMFB_COLGRPSIZE) * JPC_QMFB_COLGRPSIZE;
-	startptr = &a[0];
-	for (i = 0; i < maxcols; i += JPC_QMFB_COLGRPSIZE) {
-		jpc_qmfb_split_colgrp(startptr, numrows, stride, rowparity);
-		jpc_ns_fwdlift_colgrp(startptr, numrows, stride, rowparity);
-		startptr += JPC_QMFB_COLGRPSIZE;
+	if (n <= 0) {
+		return;
 	}
-	if (maxcols < numcols) {
-		jpc_qmfb_split_colres(startptr, numrows, numcols - maxcols, stride,
-		  rowparity);
-		jpc_ns_fwdlift_colres(startptr, numrows, numcols - maxcols, stride,
-		  rowparity);
+	if (stride == 1) {
+		(*ops->scaleflt)(a, 1, n, 0, c);
+	} else {
+		(*ops->scaleflt)(a, n, numcols, stride, c);
 	}
+}
 
-	startptr = &a[0];
-	for (i = 0; i < numrows; ++i) {
-		jpc_qmfb_split_row(startptr, numcols, colparity);
-		jpc_ns_fwdlift_row(startptr, numcols, colparity);
-		startptr += stride;
-	}
+/******************************************************************************\
+* Transforms of the columns computed a row at a time.
+\******************************************************************************/
 
-	return 0;
+/*
+ * The lifting steps of a transform of the columns update the lowpass and
+ * the highpass rows in turn (the highpass rows first for analysis, and the
+ * lowpass rows first for synthesis), each from the rows on either side of
+ * it.  When row r is pushed, step k can be applied to row r - 1 - k, as the
+ * rows next to it have had the steps before k applied.  So each row is
+ * complete numliftsteps pushes after it was put, and it is needed by the
+ * row after it for one more push.  The rows are kept in a ring of
+ * numliftsteps + 2 rows.  As the scaling after analysis must not be seen
+ * by that last lifting step, a row that comes out of analysis is scaled in
+ * a row of its own.  The results are those of the transform of the entire
+ * columns, sample for sample.
+ */
+
+/* Is row i of the columns a lowpass row? */
+#define	JPC_QMFB_ISLOWPASS(lines, i) \
+	((((i) + (lines)->parity) & 1) == 0)
+
+/* Get the place of row i of the columns in the ring of rows. */
+#define	JPC_QMFB_LINESROW(lines, i) \
+	jas_matrix_getref((lines)->rows, (i) % ((lines)->qmfb->numliftsteps + \
+	  2), 0)
+
+jpc_qmfb_lines_t *jpc_qmfb_lines_create(jpc_qmfb2d_t *qmfb, int inverse,
+  int numrows, int numcols, int parity)
+{
+	jpc_qmfb_lines_t *lines;
 
+	if (!(lines = jas_malloc(sizeof(jpc_qmfb_lines_t)))) {
+		return 0;
+	}
+	lines->qmfb = qmfb;
+	lines->ops = jpc_qmfb_getkernops();
+	lines->inverse = inverse;
+	lines->numrows = numrows;
+	lines->numcols = numcols;
+	lines->parity = parity;
+	lines->rowno = 0;
+	if (!(lines->rows = jas_matrix_create(qmfb->numliftsteps + 3,
+	  numcols))) {
+		jas_free(lines);
+		return 0;
+	}
+	return lines;
 }
 
-int jpc_ns_synthesize(jpc_fix_t *a, int xstart, int ystart, int width,
-  int height, int stride)
+void jpc_qmfb_lines_destroy(jpc_qmfb_lines_t *lines)
 {
+	jas_matrix_destroy(lines->rows);
+	jas_free(lines);
+}
 
-	int numrows = height;
-	int numcols = width;
-	int rowparity = ystart & 1;
-	int colparity = xstart & 1;
-	int maxcols;
-	jpc_fix_t *startptr;
+jpc_fix_t *jpc_qmfb_lines_getrow(jpc_qmfb_lines_t *lines)
+{
+	return JPC_QMFB_LINESROW(lines, lines->rowno);
+}
+
+jpc_fix_t *jpc_qmfb_lines_push(jpc_qmfb_lines_t *lines)
+{
+	jpc_qmfb2d_t *qmfb;
+	jpc_fix_t *row;
+	jpc_fix_t *outrow;
+	int rowno;
+	int stepno;
 	int i;
 
-	startptr = &a[0];
-	for (i = 0; i < numrows; ++i) {
-		jpc_ns_invlift_row(startptr, numcols, colparity);
-		jpc_qmfb_join_row(startptr, numcols, colparity);
-		startptr += stride;
-	}
+	qmfb = lines->qmfb;
+	rowno = lines->rowno++;
 
-	maxcols = (numcols / JPC_QMFB_COLGRPSIZE) * JPC_QMFB_COLGRPSIZE;
-	startptr = &a[0];
-	for (i = 0; i < maxcols; i += JPC_QMFB_COLGRPSIZE) {
-		jpc_ns_invlift_colgrp(startptr, numrows, stride, rowparity);
-		jpc_qmfb_join_colgrp(startptr, numrows, stride, rowparity);
-		startptr += JPC_QMFB_COLGRPSIZE;
-	}
-	if (maxcols < numcols) {
-		jpc_ns_invlift_colres(startptr, numrows, numcols - maxcols, stride,
-		  rowparity);
-		jpc_qmfb_join_colres(startptr, numrows, numcols - maxcols, stride,
-		  rowparity);
+	/* The rows are scaled before synthesis. */
+	if (lines->inverse && rowno < lines->numrows) {
+		(*qmfb->scalerow)(lines->ops, 1, JPC_QMFB_ISLOWPASS(lines, rowno),
+		  lines->numrows, JPC_QMFB_LINESROW(lines, rowno), lines->numcols);
 	}
 
-	return 0;
+	/* Apply each lifting step to the row that is now ready for it. */
+	if (lines->numrows > 1) {
+		for (stepno = 0; stepno < qmfb->numliftsteps; ++stepno) {
+			i = rowno - 1 - stepno;
+			if (i < 0 || i >= lines->numrows ||
+			  JPC_QMFB_ISLOWPASS(lines, i) != (lines->inverse ?
+			  !(stepno & 1) : (stepno & 1))) {
+				continue;
+			}
+			(*qmfb->liftrow)(lines->ops, lines->inverse, stepno,
+			  JPC_QMFB_LINESROW(lines, i), JPC_QMFB_LINESROW(lines,
+			  (i > 0) ? (i - 1) : (i + 1)), (i > 0 && i + 1 <
+			  lines->numrows) ? JPC_QMFB_LINESROW(lines, i + 1) : 0,
+			  lines->numcols);
+		}
+	}
 
+	/* The last lifting step has just been applied to the next row out. */
+	i = rowno - qmfb->numliftsteps;
+	if (i < 0 || i >= lines->numrows) {
+		return 0;
+	}
+	row = JPC_QMFB_LINESROW(lines, i);
+
+	/* The rows are scaled after analysis. */
+	if (!lines->inverse) {
+		outrow = jas_matrix_getref(lines->rows, qmfb->numliftsteps + 2, 0);
+		memcpy(outrow, row, lines->numcols * sizeof(jpc_fix_t));
+		(*qmfb->scalerow)(lines->ops, 0, JPC_QMFB_ISLOWPASS(lines, i),
+		  lines->numrows, outrow, lines->numcols);
+		row = outrow;
+	}
+	return row;
 }
-
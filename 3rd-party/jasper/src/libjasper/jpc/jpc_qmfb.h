@@ -76,6 +76,8 @@
 
 #include "jasper/jas_seq.h"
 
+#include "jpc_fix.h"
+
 /******************************************************************************\
 * Constants.
 \******************************************************************************/
@@ -84,10 +86,107 @@
 #define	JPC_QMFB1D_FT	1	/* 5/3 */
 #define	JPC_QMFB1D_NS	2	/* 9/7 */
 
+/* The largest magnitude of a sample in the 16-bit 5/3 transform. */
+#define	JPC_QMFB_MAX16	0x7fff
+
 /******************************************************************************\
 * Types.
 \******************************************************************************/
 
+/* The kernels used by the vectorized transforms.  There is a set of kernels
+  for each supported instruction set, and a portable set written in C. */
+typedef struct {
+
+	/* Compute d[i] += (s[i] + s[i + off] + round) >> shift for the first
+	  numcols samples of each of numrows rows.  Both d and s advance by
+	  stride from one row to the next. */
+	void (*liftadd)(jpc_fix_t *d, jpc_fix_t *s, int off, int numrows,
+	  int numcols, int stride, int round, int shift);
+
+	/* As liftadd, but subtracting from d[i]. */
+	void (*liftsub)(jpc_fix_t *d, jpc_fix_t *s, int off, int numrows,
+	  int numcols, int stride, int round, int shift);
+
+	/* Set e[k] = a[2k] and o[k] = a[2k + 1] for k < n.  Either e or o may
+	  be the same as a. */
+	void (*deinterleave)(jpc_fix_t *a, jpc_fix_t *e, jpc_fix_t *o, int n);
+
+	/* Set a[2k] = e[k] and a[2k + 1] = o[k] for k < n.  Either e or o may
+	  lie within a, provided that the samples written never overtake the
+	  samples still to be read. */
+	void (*interleave)(jpc_fix_t *a, jpc_fix_t *e, jpc_fix_t *o, int n);
+
+	/* The remaining kernels work on single-precision floating-point
+	  samples.  These are stored in the place of the 32-bit integer
+	  samples of a matrix. */
+
+	/* Compute d[i] += c * (s[i] + s[i + off]), as liftadd. */
+	void (*liftflt)(float *d, float *s, int off, int numrows, int numcols,
+	  int stride, float c);
+
+	/* Compute d[i] *= c for the first numcols samples of each of numrows
+	  rows. */
+	void (*scaleflt)(float *d, int numrows, int numcols, int stride,
+	  float c);
+
+	/* Replace each of the n integers a[i] by the float a[i] * scale. */
+	void (*inttoflt)(jpc_fix_t *a, int n, float scale);
+
+	/* Replace each of the n floats x in a by the integer
+	  floor(min(max(x + offset, minval), maxval)). */
+	void (*flttoint)(jpc_fix_t *a, int n, float offset, float minval,
+	  float maxval);
+
+	/* Replace each of the n floats x in a by the integer x * scale rounded
+	  toward zero. */
+	void (*quantflt)(jpc_fix_t *a, int n, float scale);
+
+	/* Apply the forward (irreversible) color transform to n samples. */
+	void (*ictflt)(float *c0, float *c1, float *c2, int n);
+
+	/* Apply the inverse (irreversible) color transform to n samples. */
+	void (*iictflt)(float *c0, float *c1, float *c2, int n);
+
+	/* The remaining kernels work on 16-bit integer samples, which fill
+	  twice as many lanes as 32-bit ones.  Every sum is formed without
+	  overflow, so only the results need to fit in 16 bits. */
+
+	/* As liftadd, for 16-bit samples.  Only the two steps of the 5/3
+	  transform are supported, namely round = 0 with shift = 1 and round = 2
+	  with shift = 2. */
+	void (*liftadd16)(int_least16_t *d, int_least16_t *s, int off,
+	  int numrows, int numcols, int stride, int round, int shift);
+
+	/* As liftadd16, but subtracting from d[i]. */
+	void (*liftsub16)(int_least16_t *d, int_least16_t *s, int off,
+	  int numrows, int numcols, int stride, int round, int shift);
+
+	/* As deinterleave, for 16-bit samples. */
+	void (*deinterleave16)(int_least16_t *a, int_least16_t *e,
+	  int_least16_t *o, int n);
+
+	/* As interleave, for 16-bit samples. */
+	void (*interleave16)(int_least16_t *a, int_least16_t *e,
+	  int_least16_t *o, int n);
+
+	/* Set b[i] to a[i] + adjust, saturated to 16 bits, for i < n.  The
+	  largest magnitude of the b[i] is returned. */
+	int (*pack16)(jpc_fix_t *a, int_least16_t *b, int n, int adjust);
+
+	/* Set a[i] to min(max(b[i] + adjust, minval), maxval) for i < n. */
+	void (*unpack16)(int_least16_t *b, jpc_fix_t *a, int n, int adjust,
+	  int minval, int maxval);
+
+	/* Apply the forward (reversible) color transform to n samples. */
+	void (*rct16)(int_least16_t *c0, int_least16_t *c1, int_least16_t *c2,
+	  int n);
+
+	/* Apply the inverse (reversible) color transform to n samples. */
+	void (*irct16)(int_least16_t *c0, int_least16_t *c1, int_least16_t *c2,
+	  int n);
+
+} jpc_qmfb_kernops_t;
+
 /******************************************************************************\
 * Functions.
 \******************************************************************************/
@@ -105,9 +204,91 @@ typedef struct {
 	int (*synthesize)(int *, int, int, int, int, int);
 	double *lpenergywts;
 	double *hpenergywts;
+	/* The same transform on 16-bit samples (or null if not supported). */
+	int (*analyze16)(int_least16_t *, int, int, int, int, int);
+	int (*synthesize16)(int_least16_t *, int, int, int, int, int);
+	/* The transform of a single row of the given width, whose first sample
+	  has the given x-coordinate. */
+	int (*analyzerow)(jpc_fix_t *, int, int);
+	int (*synthesizerow)(jpc_fix_t *, int, int);
+	/* The number of lifting steps of the transform of the columns. */
+	int numliftsteps;
+	/* Apply a lifting step of the analysis (or synthesis) of the columns
+	  to the first numcols samples of the row d, from the rows s0 and s1
+	  on either side of it.  At the ends of the columns, s1 is null and s0
+	  also stands in for the missing row. */
+	void (*liftrow)(const jpc_qmfb_kernops_t *, int, int, jpc_fix_t *,
+	  jpc_fix_t *, jpc_fix_t *, int);
+	/* Scale a lowpass (or highpass) row of the analysis (or synthesis)
+	  of columns with the given number of rows, as the transform of the
+	  columns requires. */
+	void (*scalerow)(const jpc_qmfb_kernops_t *, int, int, int, jpc_fix_t *,
+	  int);
 } jpc_qmfb2d_t;
 
 extern jpc_qmfb2d_t jpc_ft_qmfb2d;
 extern jpc_qmfb2d_t jpc_ns_qmfb2d;
 
+/* The 9/7 transform computed in single-precision floating point.  The
+  samples are floats stored in the place of the integer samples. */
+extern jpc_qmfb2d_t jpc_nsflt_qmfb2d;
+
+/* Determine the best instruction set supported by the processor.  This is
+  called once (by jpc_initluts) before any code stream is coded, so the
+  processor is never queried by several threads at a time. */
+void jpc_qmfb_initkernops(void);
+
+/* Get the kernels for the instruction set chosen by jpc_qmfb_initkernops
+  (or the generic kernels if it has not been called). */
+const jpc_qmfb_kernops_t *jpc_qmfb_getkernops(void);
+
+/* The state of the analysis (or synthesis) of the columns of an array that
+  is computed a row at a time, holding only the few rows that the lifting
+  steps still need.  The rows are put in order (with jpc_qmfb_lines_getrow
+  and jpc_qmfb_lines_push), and the transformed rows come out in the same
+  order, each one a fixed number of rows later.  For analysis, the rows put
+  are the rows of the array, and the rows that come out are lowpass and
+  highpass rows interleaved in the same way.  Synthesis is the reverse. */
+typedef struct {
+
+	/* The QMFB, and the kernels used. */
+	jpc_qmfb2d_t *qmfb;
+	const jpc_qmfb_kernops_t *ops;
+
+	/* Is this synthesis (rather than analysis)? */
+	int inverse;
+
+	/* The number of rows and columns of the array, and the parity of its
+	  rows (i.e., the parity of the y-coordinate of the first row). */
+	int numrows;
+	int numcols;
+	int parity;
+
+	/* The rows held (numliftsteps + 2 of them), and a row for the output
+	  of analysis. */
+	jas_matrix_t *rows;
+
+	/* The number of rows pushed so far. */
+	int rowno;
+
+} jpc_qmfb_lines_t;
+
+/* Create the state for the analysis (or synthesis) of the columns of an
+  array a row at a time. */
+jpc_qmfb_lines_t *jpc_qmfb_lines_create(jpc_qmfb2d_t *qmfb, int inverse,
+  int numrows, int numcols, int parity);
+
+/* Destroy the state for a transform of the columns. */
+void jpc_qmfb_lines_destroy(jpc_qmfb_lines_t *lines);
+
+/* Get the place to put the next row of the array (before pushing it). */
+jpc_fix_t *jpc_qmfb_lines_getrow(jpc_qmfb_lines_t *lines);
+
+/* Push the row just put (or, once all numrows rows have been pushed, no row
+  at all).  The next transformed row is returned if it is complete, and
+  null otherwise.  It stays valid until the next push (and a row out of
+  analysis can be changed in place).  All of the rows come out after
+  numrows + numliftsteps pushes. */
+jpc_fix_t *jpc_qmfb_lines_push(jpc_qmfb_lines_t *lines);
+
 #endif
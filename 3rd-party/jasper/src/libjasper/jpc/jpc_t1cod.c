@@ -76,6 +76,7 @@
 
 #include "jasper/jas_types.h"
 #include "jasper/jas_math.h"
+#include "jasper/jas_thread.h"
 
 #include "jpc_bs.h"
 #include "jpc_dec.h"
@@ -231,7 +232,19 @@ int JPC_ISTERMINATED(int passno, int firstpassno, int numpasses, int termall,
 * Lookup table code.
 \******************************************************************************/
 
+/* Have the lookup tables been built? */
+static int jpc_lutsinitialized = 0;
+
+static void jpc_buildluts(void);
+
 void jpc_initluts()
+{
+	/* The tables never change, so they only need to be built once, even
+	  if several threads create decoders or encoders at the same time. */
+	jas_thread_once(&jpc_lutsinitialized, jpc_buildluts);
+}
+
+static void jpc_buildluts()
 {
 	int i;
 	int orient;
@@ -243,6 +256,10 @@ void jpc_initluts()
 /* XXX - hack */
 jpc_initmqctxs();
 
+	/* Choose the transform kernels as well, so that the processor is only
+	  queried once. */
+	jpc_qmfb_initkernops();
+
 	for (orient = 0; orient < 4; ++orient) {
 		for (i = 0; i < 256; ++i) {
 			jpc_zcctxnolut[(orient << 8) | i] = jpc_getzcctxno(i, orient);
@@ -152,11 +152,17 @@ int jpc_dec_decodecblks(jpc_dec_t *dec, jpc_dec_tile_t *tile)
 	int prccnt;
 	jpc_dec_cblk_t *cblk;
 	int cblkcnt;
+	int ret;
 
 	for (compcnt = dec->numcomps, tcomp = tile->tcomps; compcnt > 0;
 	  --compcnt, ++tcomp) {
-		for (rlvlcnt = tcomp->numrlvls, rlvl = tcomp->rlvls;
+		/* The highest resolution levels being discarded are never
+		  decoded. */
+		for (rlvlcnt = tcomp->numrlvls - dec->reduce, rlvl = tcomp->rlvls;
 		  rlvlcnt > 0; --rlvlcnt, ++rlvl) {
+			if (jpc_dec_step(dec, tile)) {
+				return -1;
+			}
 			if (!rlvl->bands) {
 				continue;
 			}
@@ -173,8 +179,24 @@ int jpc_dec_decodecblks(jpc_dec_t *dec, jpc_dec_tile_t *tile)
 					for (cblkcnt = prc->numcblks,
 					  cblk = prc->cblks; cblkcnt > 0;
 					  --cblkcnt, ++cblk) {
-						if (jpc_dec_decodecblk(dec, tile, tcomp,
-						  band, cblk, 1, JPC_MAXLYRS)) {
+						/* Skip code blocks that are not needed to
+						  reconstruct the decode window. */
+						if (cblk->xend <= band->winxstart ||
+						  cblk->xstart >= band->winxend ||
+						  cblk->yend <= band->winystart ||
+						  cblk->ystart >= band->winyend) {
+							continue;
+						}
+						ret = jpc_dec_decodecblk(dec, tile, tcomp,
+						  band, cblk, 1, dec->maxlyrs);
+						if (dec->ctx) {
+							/* The code block is completely decoded, so
+							  the scratch storage can be given back to
+							  the context. */
+							cblk->flags = 0;
+							cblk->mqdec = 0;
+						}
+						if (ret) {
 							return -1;
 						}
 					}
@@ -187,6 +209,66 @@ int jpc_dec_decodecblks(jpc_dec_t *dec, jpc_dec_tile_t *tile)
 	return 0;
 }
 
+int jpc_dec_decodecblkrows(jpc_dec_t *dec, jpc_dec_tile_t *tile,
+  jpc_dec_tcomp_t *tcomp, jpc_dec_rlvl_t *rlvl, jpc_dec_band_t *band,
+  uint_fast32_t ystart, uint_fast32_t yend)
+{
+	jpc_dec_prc_t *prc;
+	int prccnt;
+	jpc_dec_cblk_t *cblk;
+	int cblkcnt;
+	int ret;
+
+	for (prccnt = rlvl->numprcs, prc = band->prcs; prccnt > 0;
+	  --prccnt, ++prc) {
+		if (!prc->cblks || prc->yend <= ystart || prc->ystart >= yend) {
+			continue;
+		}
+		/* The code blocks of a precinct are in raster order, and the rows
+		  are at most a row of code blocks. */
+		cblk = &prc->cblks[((JAS_MAX(ystart, prc->ystart) >>
+		  rlvl->cblkheightexpn) - (prc->ystart >> rlvl->cblkheightexpn)) *
+		  prc->numhcblks];
+		for (cblkcnt = prc->numhcblks; cblkcnt > 0; --cblkcnt, ++cblk) {
+			if (cblk->ystart < ystart || cblk->ystart >= yend ||
+			  cblk->xend <= band->winxstart ||
+			  cblk->xstart >= band->winxend ||
+			  cblk->yend <= band->winystart ||
+			  cblk->ystart >= band->winyend) {
+				continue;
+			}
+			if (!(cblk->data = jas_seq2d_create(0, 0, 0, 0))) {
+				return -1;
+			}
+			jas_seq2d_bindsub(cblk->data, band->data, cblk->xstart,
+			  cblk->ystart, cblk->xend, cblk->yend);
+			ret = jpc_dec_decodecblk(dec, tile, tcomp, band, cblk, 1,
+			  dec->maxlyrs);
+			jas_matrix_destroy(cblk->data);
+			cblk->data = 0;
+			if (dec->ctx) {
+				cblk->flags = 0;
+				cblk->mqdec = 0;
+			} else {
+				/* The code block is not needed again. */
+				if (cblk->flags) {
+					jas_matrix_destroy(cblk->flags);
+					cblk->flags = 0;
+				}
+				if (cblk->mqdec) {
+					jpc_mqdec_destroy(cblk->mqdec);
+					cblk->mqdec = 0;
+				}
+			}
+			if (ret) {
+				return -1;
+			}
+		}
+	}
+
+	return 0;
+}
+
 static int jpc_dec_decodecblk(jpc_dec_t *dec, jpc_dec_tile_t *tile, jpc_dec_tcomp_t *tcomp, jpc_dec_band_t *band,
   jpc_dec_cblk_t *cblk, int dopartial, int maxlyrs)
 {
@@ -204,8 +286,15 @@ static int jpc_dec_decodecblk(jpc_dec_t *dec, jpc_dec_tile_t *tile, jpc_dec_tcom
 
 	if (!cblk->flags) {
 		/* Note: matrix is assumed to be zeroed */
-		if (!(cblk->flags = jas_matrix_create(jas_matrix_numrows(cblk->data) +
-		  2, jas_matrix_numcols(cblk->data) + 2))) {
+		if (dec->ctx) {
+			cblk->flags = jpc_dec_ctx_getflags(dec->ctx,
+			  jas_matrix_numrows(cblk->data) + 2,
+			  jas_matrix_numcols(cblk->data) + 2);
+		} else {
+			cblk->flags = jas_matrix_create(jas_matrix_numrows(cblk->data) +
+			  2, jas_matrix_numcols(cblk->data) + 2);
+		}
+		if (!cblk->flags) {
 			return -1;
 		}
 	}
@@ -219,7 +308,9 @@ static int jpc_dec_decodecblk(jpc_dec_t *dec, jpc_dec_tile_t *tile, jpc_dec_tcom
 		jas_stream_setrwcount(seg->stream, 0);
 		if (seg->type == JPC_SEG_MQ) {
 			if (!cblk->mqdec) {
-				if (!(cblk->mqdec = jpc_mqdec_create(JPC_NUMCTXS, 0))) {
+				if (!(cblk->mqdec = (dec->ctx) ?
+				  jpc_dec_ctx_getmqdec(dec->ctx) :
+				  jpc_mqdec_create(JPC_NUMCTXS, 0))) {
 					return -1;
 				}
 				jpc_mqdec_setctxs(cblk->mqdec, JPC_NUMCTXS, jpc_mqctxs);
@@ -85,4 +85,10 @@
 /* Decode all of the code blocks for a particular tile. */
 int jpc_dec_decodecblks(jpc_dec_t *dec, jpc_dec_tile_t *tile);
 
+/* Decode the code blocks of a band that start in the rows ystart to
+  yend - 1 into the band data, and free the storage used for them. */
+int jpc_dec_decodecblkrows(jpc_dec_t *dec, jpc_dec_tile_t *tile,
+  jpc_dec_tcomp_t *tcomp, jpc_dec_rlvl_t *rlvl, jpc_dec_band_t *band,
+  uint_fast32_t ystart, uint_fast32_t yend);
+
 #endif
@@ -130,6 +130,9 @@ int jpc_enc_enccblks(jpc_enc_t *enc)
 	for (tcmpt = tile->tcmpts; tcmpt != endcomps; ++tcmpt) {
 		endlvls = &tcmpt->rlvls[tcmpt->numrlvls];
 		for (lvl = tcmpt->rlvls; lvl != endlvls; ++lvl) {
+			if (jpc_enc_step(enc)) {
+				return -1;
+			}
 			if (!lvl->bands) {
 				continue;
 			}
@@ -177,6 +180,68 @@ int jpc_enc_enccblks(jpc_enc_t *enc)
 	return 0;
 }
 
+int jpc_enc_enccblkrows(jpc_enc_t *enc, jpc_enc_tcmpt_t *tcmpt,
+  jpc_enc_band_t *band, uint_fast32_t tly, uint_fast32_t bry)
+{
+	jpc_enc_rlvl_t *lvl;
+	jpc_enc_prc_t *prc;
+	int prcno;
+	jpc_enc_cblk_t *cblk;
+	int cblkcnt;
+	int i;
+	int j;
+	int mx;
+	int v;
+	int ret;
+
+	lvl = band->rlvl;
+	for (prcno = 0, prc = band->prcs; prcno < lvl->numprcs; ++prcno, ++prc) {
+		if (!prc->cblks || prc->bry <= tly || prc->tly >= bry) {
+			continue;
+		}
+		/* The code blocks of a precinct are in raster order, and the rows
+		  are at most a row of code blocks. */
+		cblk = &prc->cblks[((JAS_MAX(tly, prc->tly) >> lvl->cblkheightexpn) -
+		  (prc->tly >> lvl->cblkheightexpn)) * prc->numhcblks];
+		for (cblkcnt = prc->numhcblks; cblkcnt > 0; --cblkcnt, ++cblk) {
+			if (!(cblk->data = jas_seq2d_create(0, 0, 0, 0))) {
+				return -1;
+			}
+			jas_seq2d_bindsub(cblk->data, band->data, cblk->tlx, cblk->tly,
+			  cblk->brx, cblk->bry);
+			mx = 0;
+			for (i = 0; i < jas_matrix_numrows(cblk->data); ++i) {
+				for (j = 0; j < jas_matrix_numcols(cblk->data); ++j) {
+					v = abs(jas_matrix_get(cblk->data, i, j));
+					if (v > mx) {
+						mx = v;
+					}
+				}
+			}
+			cblk->numbps = JAS_MAX(jpc_firstone(mx) + 1 - JPC_NUMEXTRABITS, 0);
+			cblk->numimsbs = band->numbps - cblk->numbps;
+			assert(cblk->numimsbs >= 0);
+			ret = jpc_enc_enccblk(enc, cblk->stream, tcmpt, band, cblk);
+
+			/* Only the coded data is needed from now on. */
+			jas_matrix_destroy(cblk->data);
+			cblk->data = 0;
+			if (cblk->flags) {
+				jas_matrix_destroy(cblk->flags);
+				cblk->flags = 0;
+			}
+			if (cblk->mqenc) {
+				jpc_mqenc_destroy(cblk->mqenc);
+				cblk->mqenc = 0;
+			}
+			if (ret) {
+				return -1;
+			}
+		}
+	}
+	return 0;
+}
+
 int getthebyte(jas_stream_t *in, long off)
 {
 	int c;
@@ -86,6 +86,11 @@
 /* Encode all of the code blocks. */
 int jpc_enc_enccblks(jpc_enc_t *enc);
 
+/* Encode the code blocks of a band that start in the rows tly to bry - 1
+  (from the band data), and free the storage used for them. */
+int jpc_enc_enccblkrows(jpc_enc_t *enc, jpc_enc_tcmpt_t *tcmpt,
+  jpc_enc_band_t *band, uint_fast32_t tly, uint_fast32_t bry);
+
 /* Encode a single code block. */
 int jpc_enc_enccblk(jpc_enc_t *enc, jas_stream_t *out, jpc_enc_tcmpt_t *comp,
   jpc_enc_band_t *band, jpc_enc_cblk_t *cblk);
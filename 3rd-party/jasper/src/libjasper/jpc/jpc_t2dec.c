@@ -99,6 +99,7 @@ static int jpc_getcommacode(jpc_bitstream_t *in);
 static int jpc_getnumnewpasses(jpc_bitstream_t *in);
 static int jpc_dec_decodepkt(jpc_dec_t *dec, jas_stream_t *pkthdrstream, jas_stream_t *in, int compno, int lvlno,
   int prcno, int lyrno);
+static int jpc_dec_getsegdata(jpc_dec_seg_t *seg, jas_stream_t *in);
 
 /******************************************************************************\
 * Code.
@@ -153,6 +154,50 @@ static int jpc_getnumnewpasses(jpc_bitstream_t *in)
 	return n;
 }
 
+/* Append the packet body data of a code block segment to the segment
+  stream.  When the input is a view of memory, a segment whose data is
+  contiguous is itself a view of the input data rather than a copy of it. */
+static int jpc_dec_getsegdata(jpc_dec_seg_t *seg, jas_stream_t *in)
+{
+	const uchar *data;
+	jas_stream_t *stream;
+
+	if (!seg->stream && seg->cnt > 0 &&
+	  (data = jas_stream_getview(in, seg->cnt))) {
+		if (!(seg->stream = jas_stream_memview(data, seg->cnt))) {
+			return -1;
+		}
+		return 0;
+	}
+
+	if (seg->stream && jas_stream_isview(seg->stream) && seg->cnt > 0) {
+		/* The segment continues in a later packet, so its data is no
+		  longer contiguous and must be copied. */
+		if (!(stream = jas_stream_memopen(0, 0))) {
+			return -1;
+		}
+		if (jas_stream_rewind(seg->stream) < 0 ||
+		  jas_stream_copy(stream, seg->stream, -1)) {
+			jas_stream_close(stream);
+			return -1;
+		}
+		jas_stream_close(seg->stream);
+		seg->stream = stream;
+	}
+
+	if (!seg->stream) {
+		if (!(seg->stream = jas_stream_memopen(0, 0))) {
+			return -1;
+		}
+	}
+	if (seg->cnt > 0) {
+		if (jpc_getdata(in, seg->stream, seg->cnt) < 0) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
 static int jpc_dec_decodepkt(jpc_dec_t *dec, jas_stream_t *pkthdrstream, jas_stream_t *in, int compno, int rlvlno,
   int prcno, int lyrno)
 {
@@ -193,9 +238,13 @@ static int jpc_dec_decodepkt(jpc_dec_t *dec, jas_stream_t *pkthdrstream, jas_str
 	  variable. */
 	bodylen = 0;
 
-	discard = (lyrno >= dec->maxlyrs);
-
 	tile = dec->curtile;
+
+	/* The data for discarded resolution levels is never decoded, so it
+	  need not be kept either. */
+	discard = (lyrno >= dec->maxlyrs) || (rlvlno >=
+	  tile->tcomps[compno].numrlvls - dec->reduce);
+
 	cp = tile->cp;
 	ccp = &cp->ccps[compno];
 
@@ -382,20 +431,13 @@ hdroffstart = jas_stream_getrwcount(pkthdrstream);
 			  ++cblkno, ++cblk) {
 				seg = cblk->curseg;
 				while (seg) {
-					if (!seg->stream) {
-						if (!(seg->stream = jas_stream_memopen(0, 0))) {
-							return -1;
-						}
-					}
 #if 0
 jas_eprintf("lyrno=%02d, compno=%02d, lvlno=%02d, prcno=%02d, bandno=%02d, cblkno=%02d, passno=%02d numpasses=%02d cnt=%d numbps=%d, numimsbs=%d\n", lyrno, compno, rlvlno, prcno, band - rlvl->bands, cblk - prc->cblks, seg->passno, seg->numpasses, seg->cnt, band->numbps, cblk->numimsbs);
 #endif
-					if (seg->cnt > 0) {
-						if (jpc_getdata(in, seg->stream, seg->cnt) < 0) {
-							return -1;
-						}
-						seg->cnt = 0;
+					if (jpc_dec_getsegdata(seg, in)) {
+						return -1;
 					}
+					seg->cnt = 0;
 					if (seg->numpasses >= seg->maxpasses) {
 						cblk->curseg = seg->next;
 					}
@@ -445,6 +487,15 @@ if (dec->maxpkts >= 0 && dec->numpkts >= dec->maxpkts) {
 	jas_eprintf("warning: stopping decode prematurely as requested\n");
 	return 0;
 }
+		/* In a layer-progressive order, all of the packets that remain in
+		  the tile-part are for layers that are not wanted, so there is
+		  no need to parse them.  (This is not possible when the tile-part
+		  extends to the end of the code stream.) */
+		if (jpc_pi_lyrno(pi) >= dec->maxlyrs && jpc_pi_prg(pi) ==
+		  JPC_COD_LRCPPRG && !jpc_pchglist_numpchgs(pi->pchglist) &&
+		  dec->curtileendoff > 0) {
+			return jpc_dec_skiptiledata(dec);
+		}
 		if (jas_getdbglevel() >= 1) {
 			jas_eprintf("packet offset=%08ld prg=%d cmptno=%02d "
 			  "rlvlno=%02d prcno=%03d lyrno=%02d\n", (long)
@@ -72,8 +72,11 @@
 \******************************************************************************/
 
 #include <assert.h>
+#include <limits.h>
+#include <string.h>
 
 #include "jasper/jas_malloc.h"
+#include "jasper/jas_math.h"
 #include "jasper/jas_seq.h"
 
 #include "jpc_tsfb.h"
@@ -85,6 +88,29 @@
 void jpc_tsfb_getbands2(jpc_tsfb_t *tsfb, int locxstart, int locystart,
   int xstart, int ystart, int xend, int yend, jpc_tsfb_band_t **bands,
   int numlvls);
+static void jpc_tsfb_expandwin(jpc_tsfb_t *tsfb, int start, int end,
+  int *winstart, int *winend);
+static int jpc_tsfb_synthesizewin2(jpc_tsfb_t *tsfb, jpc_fix_t *a, int stride,
+  int xstart, int ystart, int xend, int yend, int winxstart, int winystart,
+  int winxend, int winyend, int numlvls);
+static void jpc_tsfb_getbandwins2(jpc_tsfb_t *tsfb, int xstart, int ystart,
+  int xend, int yend, int winxstart, int winystart, int winxend,
+  int winyend, jpc_tsfb_band_t **bands, int numlvls);
+static int jpc_tsfb_analyze16lvls(jpc_tsfb_t *tsfb, int_least16_t *a,
+  int xstart, int ystart, int width, int height, int stride, int numlvls);
+static int jpc_tsfb_synthesize16lvls(jpc_tsfb_t *tsfb, int_least16_t *a,
+  int xstart, int ystart, int width, int height, int stride, int numlvls);
+static jpc_tsfb_lines_t *jpc_tsfb_lines_create(jpc_tsfb_t *tsfb,
+  int numlvls, jpc_tsfb_rowfunc_t rowfunc, void *arg);
+static int jpc_tsfb_analyzelvl(jpc_tsfb_lines_t *lines, int lvlno,
+  jpc_fix_t *row);
+static int jpc_tsfb_synthesizelvl(jpc_tsfb_lines_t *lines, int lvlno,
+  jpc_fix_t **row);
+
+/* The number of samples on either side of an output sample that it depends
+  on for one level of synthesis (i.e., the number of lifting steps). */
+#define	JPC_TSFB_WINMARGIN(tsfb) \
+	(((tsfb)->qmfb == &jpc_ft_qmfb2d) ? 2 : 4)
 
 /******************************************************************************\
 *
@@ -119,6 +145,13 @@ void jpc_tsfb_destroy(jpc_tsfb_t *tsfb)
 	free(tsfb);
 }
 
+void jpc_tsfb_setfltmode(jpc_tsfb_t *tsfb)
+{
+	if (tsfb->qmfb == &jpc_ns_qmfb2d) {
+		tsfb->qmfb = &jpc_nsflt_qmfb2d;
+	}
+}
+
 int jpc_tsfb_analyze(jpc_tsfb_t *tsfb, jas_seq2d_t *a)
 {
 	return (tsfb->numlvls > 0) ? jpc_tsfb_analyze2(tsfb, jas_seq2d_getref(a,
@@ -154,6 +187,24 @@ int jpc_tsfb_synthesize(jpc_tsfb_t *tsfb, jas_seq2d_t *a)
 	  jas_seq2d_height(a), jas_seq2d_rowstep(a), tsfb->numlvls - 1) : 0;
 }
 
+int jpc_tsfb_synthesizelvls(jpc_tsfb_t *tsfb, jas_seq2d_t *a, int numlvls)
+{
+	int n;
+	int xstart;
+	int ystart;
+
+	/* The coarsest numlvls levels occupy the top-left corner of the
+	  array, so only the size of the region to synthesize changes. */
+	n = tsfb->numlvls - numlvls;
+	xstart = JPC_CEILDIVPOW2(jas_seq2d_xstart(a), n);
+	ystart = JPC_CEILDIVPOW2(jas_seq2d_ystart(a), n);
+	return (numlvls > 0) ? jpc_tsfb_synthesize2(tsfb,
+	  jas_seq2d_getref(a, jas_seq2d_xstart(a), jas_seq2d_ystart(a)),
+	  xstart, ystart, JPC_CEILDIVPOW2(jas_seq2d_xend(a), n) - xstart,
+	  JPC_CEILDIVPOW2(jas_seq2d_yend(a), n) - ystart,
+	  jas_seq2d_rowstep(a), numlvls - 1) : 0;
+}
+
 int jpc_tsfb_synthesize2(jpc_tsfb_t *tsfb, int *a, int xstart, int ystart,
   int width, int height, int stride, int numlvls)
 {
@@ -174,6 +225,619 @@ int jpc_tsfb_synthesize2(jpc_tsfb_t *tsfb, int *a, int xstart, int ystart,
 	return 0;
 }
 
+/******************************************************************************\
+* Code for synthesis of a window.
+\******************************************************************************/
+
+/* Expand a (nonempty) window by the support of the synthesis filters,
+  without going outside of the region. */
+
+/******************************************************************************\
+* 16-bit transforms.
+\******************************************************************************/
+
+/*
+ * The bounds below hold for the 5/3 transform, the only one with a 16-bit
+ * version.  For one level of the (1-D) transform of samples of magnitude at
+ * most m, the lowpass samples are at most 1.5 m + 1 in magnitude (1.5 being
+ * the 1-norm of the lowpass filter, and the rounding adding less than one),
+ * and the highpass samples at most 2 m.  Synthesis from lowpass samples of
+ * magnitude at most s and highpass samples of magnitude at most d gives
+ * samples of magnitude at most s + 1.5 d + 1.  Every intermediate sample is
+ * within the same bounds.
+ */
+
+long jpc_tsfb_analyze16bound(jpc_tsfb_t *tsfb, long maxmag)
+{
+	long bound;
+	int lvlno;
+
+	if (tsfb->numlvls > 0 && !tsfb->qmfb->analyze16) {
+		return -1;
+	}
+	/* At each level, the HH band is the largest, at four times the largest
+	  input sample.  The LL band (the input to the next level) is at most
+	  2.25 times as large as the input, plus 2.5. */
+	bound = maxmag;
+	for (lvlno = 0; lvlno < tsfb->numlvls; ++lvlno) {
+		bound = JAS_MAX(bound, 4 * maxmag + 2);
+		if (bound > JPC_QMFB_MAX16) {
+			return -1;
+		}
+		maxmag = (9 * maxmag + 10) / 4;
+	}
+	return bound;
+}
+
+long jpc_tsfb_synthesize16bound(jpc_tsfb_t *tsfb, long *maxmags)
+{
+	long bound;
+	int lvlno;
+
+	if (tsfb->numlvls > 0 && !tsfb->qmfb->synthesize16) {
+		return -1;
+	}
+	/* With LL samples of magnitude at most a, and samples in the other
+	  bands of magnitude at most b, the rows of the upper and lower halves
+	  are synthesized to magnitudes of at most a + 1.5 b + 1 and 2.5 b + 1.
+	  The columns are then synthesized to a magnitude of at most
+	  a + 5.25 b + 3.5. */
+	bound = maxmags[0];
+	for (lvlno = 1; lvlno <= tsfb->numlvls; ++lvlno) {
+		if (maxmags[lvlno] > JPC_QMFB_MAX16) {
+			return -1;
+		}
+		bound += (21 * maxmags[lvlno] + 3) / 4 + 4;
+		if (bound > JPC_QMFB_MAX16) {
+			return -1;
+		}
+	}
+	return bound;
+}
+
+int jpc_tsfb_analyze16(jpc_tsfb_t *tsfb, int_least16_t *a, int xstart,
+  int ystart, int width, int height, int stride)
+{
+	return (tsfb->numlvls > 0) ? jpc_tsfb_analyze16lvls(tsfb, a, xstart,
+	  ystart, width, height, stride, tsfb->numlvls - 1) : 0;
+}
+
+static int jpc_tsfb_analyze16lvls(jpc_tsfb_t *tsfb, int_least16_t *a,
+  int xstart, int ystart, int width, int height, int stride, int numlvls)
+{
+	if (width > 0 && height > 0) {
+		if ((*tsfb->qmfb->analyze16)(a, xstart, ystart, width, height,
+		  stride)) {
+			return -1;
+		}
+		if (numlvls > 0) {
+			if (jpc_tsfb_analyze16lvls(tsfb, a, JPC_CEILDIVPOW2(xstart, 1),
+			  JPC_CEILDIVPOW2(ystart, 1), JPC_CEILDIVPOW2(xstart + width,
+			  1) - JPC_CEILDIVPOW2(xstart, 1), JPC_CEILDIVPOW2(ystart +
+			  height, 1) - JPC_CEILDIVPOW2(ystart, 1), stride,
+			  numlvls - 1)) {
+				return -1;
+			}
+		}
+	}
+	return 0;
+}
+
+int jpc_tsfb_synthesize16(jpc_tsfb_t *tsfb, int_least16_t *a, int xstart,
+  int ystart, int width, int height, int stride)
+{
+	return (tsfb->numlvls > 0) ? jpc_tsfb_synthesize16lvls(tsfb, a, xstart,
+	  ystart, width, height, stride, tsfb->numlvls - 1) : 0;
+}
+
+static int jpc_tsfb_synthesize16lvls(jpc_tsfb_t *tsfb, int_least16_t *a,
+  int xstart, int ystart, int width, int height, int stride, int numlvls)
+{
+	if (numlvls > 0) {
+		if (jpc_tsfb_synthesize16lvls(tsfb, a, JPC_CEILDIVPOW2(xstart, 1),
+		  JPC_CEILDIVPOW2(ystart, 1), JPC_CEILDIVPOW2(xstart + width, 1) -
+		  JPC_CEILDIVPOW2(xstart, 1), JPC_CEILDIVPOW2(ystart + height, 1) -
+		  JPC_CEILDIVPOW2(ystart, 1), stride, numlvls - 1)) {
+			return -1;
+		}
+	}
+	if (width > 0 && height > 0) {
+		if ((*tsfb->qmfb->synthesize16)(a, xstart, ystart, width, height,
+		  stride)) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/******************************************************************************\
+* Transforms done a row at a time.
+\******************************************************************************/
+
+/*
+ * Each level of a transform done a row at a time transforms its columns
+ * with a jpc_qmfb_lines_t, and its rows one at a time as they go in (for
+ * synthesis) or come out (for analysis).  A lowpass row of a level is made
+ * of a row of the next coarser level (or the LL band) and a row of the HL
+ * band, and a highpass row of a row of the LH band and a row of the HH
+ * band.  For synthesis, each level takes part in the transform of the
+ * expanded window, as jpc_tsfb_synthesizewin does, and the results are the
+ * same.
+ */
+
+static jpc_tsfb_lines_t *jpc_tsfb_lines_create(jpc_tsfb_t *tsfb,
+  int numlvls, jpc_tsfb_rowfunc_t rowfunc, void *arg)
+{
+	jpc_tsfb_lines_t *lines;
+	int lvlno;
+
+	if (!(lines = jas_malloc(sizeof(jpc_tsfb_lines_t)))) {
+		return 0;
+	}
+	lines->tsfb = tsfb;
+	lines->numlvls = numlvls;
+	lines->rowfunc = rowfunc;
+	lines->arg = arg;
+	for (lvlno = 0; lvlno <= numlvls; ++lvlno) {
+		lines->lvls[lvlno].rowno = 0;
+		lines->lvls[lvlno].lines = 0;
+		lines->lvls[lvlno].buf = 0;
+	}
+	return lines;
+}
+
+void jpc_tsfb_lines_destroy(jpc_tsfb_lines_t *lines)
+{
+	jpc_tsfb_linelvl_t *lvl;
+	int lvlno;
+
+	for (lvlno = 0, lvl = lines->lvls; lvlno <= lines->numlvls;
+	  ++lvlno, ++lvl) {
+		if (lvl->lines) {
+			jpc_qmfb_lines_destroy(lvl->lines);
+		}
+		if (lvl->buf) {
+			jas_free(lvl->buf);
+		}
+	}
+	jas_free(lines);
+}
+
+jpc_tsfb_lines_t *jpc_tsfb_analyzelines(jpc_tsfb_t *tsfb, int xstart,
+  int ystart, int xend, int yend, jpc_tsfb_rowfunc_t putrow, void *arg)
+{
+	jpc_tsfb_lines_t *lines;
+	jpc_tsfb_linelvl_t *lvl;
+	int lvlno;
+
+	if (!(lines = jpc_tsfb_lines_create(tsfb, tsfb->numlvls, putrow,
+	  arg))) {
+		return 0;
+	}
+	for (lvlno = tsfb->numlvls; lvlno >= 0; --lvlno) {
+		lvl = &lines->lvls[lvlno];
+		lvl->xstart = xstart;
+		lvl->ystart = ystart;
+		lvl->xend = xend;
+		lvl->yend = yend;
+		lvl->numlcols = JPC_CEILDIVPOW2(xend, 1) - JPC_CEILDIVPOW2(xstart, 1);
+		if (lvlno > 0 && xstart < xend && ystart < yend) {
+			if (!(lvl->lines = jpc_qmfb_lines_create(tsfb->qmfb, 0,
+			  yend - ystart, xend - xstart, ystart & 1))) {
+				jpc_tsfb_lines_destroy(lines);
+				return 0;
+			}
+		}
+		xstart = JPC_CEILDIVPOW2(xstart, 1);
+		ystart = JPC_CEILDIVPOW2(ystart, 1);
+		xend = JPC_CEILDIVPOW2(xend, 1);
+		yend = JPC_CEILDIVPOW2(yend, 1);
+	}
+	return lines;
+}
+
+int jpc_tsfb_putline(jpc_tsfb_lines_t *lines, jpc_fix_t *row)
+{
+	return jpc_tsfb_analyzelvl(lines, lines->numlvls, row);
+}
+
+/* Put the next row of a level.  Once the last row is put, the rest of the
+  rows of the level (and so of the coarser levels) come out. */
+static int jpc_tsfb_analyzelvl(jpc_tsfb_lines_t *lines, int lvlno,
+  jpc_fix_t *row)
+{
+	jpc_tsfb_linelvl_t *lvl;
+	jpc_qmfb_lines_t *qmfblines;
+	jpc_fix_t *outrow;
+	int bandno;
+	int width;
+	int y;
+
+	lvl = &lines->lvls[lvlno];
+	if (!lvlno) {
+		/* This is a row of the LL band. */
+		return (*lines->rowfunc)(lines->arg, 0, lvl->ystart + lvl->rowno++,
+		  row);
+	}
+
+	qmfblines = lvl->lines;
+	width = lvl->xend - lvl->xstart;
+	bandno = 3 * (lvlno - 1) + 1;
+	memcpy(jpc_qmfb_lines_getrow(qmfblines), row, width * sizeof(jpc_fix_t));
+	do {
+		if (!(outrow = jpc_qmfb_lines_push(qmfblines))) {
+			continue;
+		}
+		if ((*lines->tsfb->qmfb->analyzerow)(outrow, lvl->xstart, width)) {
+			return -1;
+		}
+		y = lvl->ystart + lvl->rowno++;
+		if (!(y & 1)) {
+			/* A lowpass row goes to the next level and the HL band. */
+			if (lvl->numlcols > 0 && jpc_tsfb_analyzelvl(lines, lvlno - 1,
+			  outrow)) {
+				return -1;
+			}
+			if (width > lvl->numlcols && (*lines->rowfunc)(lines->arg,
+			  bandno, y >> 1, &outrow[lvl->numlcols])) {
+				return -1;
+			}
+		} else {
+			/* A highpass row goes to the LH and HH bands. */
+			if (lvl->numlcols > 0 && (*lines->rowfunc)(lines->arg,
+			  bandno + 1, y >> 1, outrow)) {
+				return -1;
+			}
+			if (width > lvl->numlcols && (*lines->rowfunc)(lines->arg,
+			  bandno + 2, y >> 1, &outrow[lvl->numlcols])) {
+				return -1;
+			}
+		}
+	} while (qmfblines->rowno >= qmfblines->numrows && qmfblines->rowno <
+	  qmfblines->numrows + lines->tsfb->qmfb->numliftsteps);
+	return 0;
+}
+
+jpc_tsfb_lines_t *jpc_tsfb_synthesizelines(jpc_tsfb_t *tsfb, int numlvls,
+  int xstart, int ystart, int xend, int yend, int winxstart, int winystart,
+  int winxend, int winyend, jpc_tsfb_rowfunc_t getrow, void *arg)
+{
+	jpc_tsfb_lines_t *lines;
+	jpc_tsfb_linelvl_t *lvl;
+	int lvlno;
+
+	if (!(lines = jpc_tsfb_lines_create(tsfb, numlvls, getrow, arg))) {
+		return 0;
+	}
+	if (winxstart >= winxend || winystart >= winyend) {
+		/* Nothing is needed from any level. */
+		winxstart = winxend = xstart;
+		winystart = winyend = ystart;
+	}
+	for (lvlno = numlvls; lvlno >= 0; --lvlno) {
+		lvl = &lines->lvls[lvlno];
+		lvl->winxstart = winxstart;
+		lvl->winystart = winystart;
+		lvl->winxend = winxend;
+		lvl->winyend = winyend;
+		if (lvlno > 0) {
+			/* Determine the part of the region that the window depends
+			  on. */
+			jpc_tsfb_expandwin(tsfb, xstart, xend, &winxstart, &winxend);
+			jpc_tsfb_expandwin(tsfb, ystart, yend, &winystart, &winyend);
+		}
+		lvl->xstart = winxstart;
+		lvl->ystart = winystart;
+		lvl->xend = winxend;
+		lvl->yend = winyend;
+		lvl->numlcols = JPC_CEILDIVPOW2(winxend, 1) -
+		  JPC_CEILDIVPOW2(winxstart, 1);
+		if (winxstart < winxend && winystart < winyend) {
+			if (lvlno > 0) {
+				if (!(lvl->lines = jpc_qmfb_lines_create(tsfb->qmfb, 1,
+				  winyend - winystart, winxend - winxstart,
+				  winystart & 1))) {
+					jpc_tsfb_lines_destroy(lines);
+					return 0;
+				}
+			} else if (!numlvls) {
+				if (!(lvl->buf = jas_malloc((winxend - winxstart) *
+				  sizeof(jpc_fix_t)))) {
+					jpc_tsfb_lines_destroy(lines);
+					return 0;
+				}
+			}
+		}
+		/* The lowpass samples needed are the window at the next level. */
+		xstart = JPC_CEILDIVPOW2(xstart, 1);
+		ystart = JPC_CEILDIVPOW2(ystart, 1);
+		xend = JPC_CEILDIVPOW2(xend, 1);
+		yend = JPC_CEILDIVPOW2(yend, 1);
+		winxstart = JPC_CEILDIVPOW2(winxstart, 1);
+		winystart = JPC_CEILDIVPOW2(winystart, 1);
+		winxend = JPC_CEILDIVPOW2(winxend, 1);
+		winyend = JPC_CEILDIVPOW2(winyend, 1);
+	}
+	return lines;
+}
+
+int jpc_tsfb_getline(jpc_tsfb_lines_t *lines, jpc_fix_t **row)
+{
+	jpc_tsfb_linelvl_t *lvl;
+
+	if (!lines->numlvls) {
+		/* There is only the LL band. */
+		lvl = &lines->lvls[0];
+		*row = lvl->buf;
+		return (*lines->rowfunc)(lines->arg, 0, lvl->winystart +
+		  lvl->rowno++, lvl->buf);
+	}
+	return jpc_tsfb_synthesizelvl(lines, lines->numlvls, row);
+}
+
+/* Synthesize the next row of the window of a level. */
+static int jpc_tsfb_synthesizelvl(jpc_tsfb_lines_t *lines, int lvlno,
+  jpc_fix_t **row)
+{
+	jpc_tsfb_linelvl_t *lvl;
+	jpc_qmfb_lines_t *qmfblines;
+	jpc_fix_t *inrow;
+	jpc_fix_t *outrow;
+	jpc_fix_t *lrow;
+	int bandno;
+	int width;
+	int y;
+
+	lvl = &lines->lvls[lvlno];
+	qmfblines = lvl->lines;
+	width = lvl->xend - lvl->xstart;
+	bandno = 3 * (lvlno - 1) + 1;
+	for (;;) {
+		if (qmfblines->rowno < qmfblines->numrows) {
+			/* Put the next row, synthesized from the rows of the bands. */
+			inrow = jpc_qmfb_lines_getrow(qmfblines);
+			y = lvl->ystart + qmfblines->rowno;
+			if (!(y & 1)) {
+				if (lvl->numlcols > 0) {
+					if (lvlno > 1) {
+						if (jpc_tsfb_synthesizelvl(lines, lvlno - 1, &lrow)) {
+							return -1;
+						}
+						memcpy(inrow, lrow, lvl->numlcols * sizeof(jpc_fix_t));
+					} else if ((*lines->rowfunc)(lines->arg, 0, y >> 1,
+					  inrow)) {
+						return -1;
+					}
+				}
+				if (width > lvl->numlcols && (*lines->rowfunc)(lines->arg,
+				  bandno, y >> 1, &inrow[lvl->numlcols])) {
+					return -1;
+				}
+			} else {
+				if (lvl->numlcols > 0 && (*lines->rowfunc)(lines->arg,
+				  bandno + 1, y >> 1, inrow)) {
+					return -1;
+				}
+				if (width > lvl->numlcols && (*lines->rowfunc)(lines->arg,
+				  bandno + 2, y >> 1, &inrow[lvl->numlcols])) {
+					return -1;
+				}
+			}
+			if ((*lines->tsfb->qmfb->synthesizerow)(inrow, lvl->xstart,
+			  width)) {
+				return -1;
+			}
+		}
+		if ((outrow = jpc_qmfb_lines_push(qmfblines))) {
+			/* Only the rows of the window are wanted. */
+			y = lvl->ystart + lvl->rowno++;
+			if (y >= lvl->winystart && y < lvl->winyend) {
+				*row = &outrow[lvl->winxstart - lvl->xstart];
+				return 0;
+			}
+		}
+	}
+}
+
+/******************************************************************************\
+*
+\******************************************************************************/
+
+static void jpc_tsfb_expandwin(jpc_tsfb_t *tsfb, int start, int end,
+  int *winstart, int *winend)
+{
+	if (*winstart < *winend) {
+		*winstart = JAS_MAX(start, *winstart - JPC_TSFB_WINMARGIN(tsfb));
+		*winend = JAS_MIN(end, *winend + JPC_TSFB_WINMARGIN(tsfb));
+	}
+}
+
+int jpc_tsfb_synthesizewin(jpc_tsfb_t *tsfb, jas_seq2d_t *a, int numlvls,
+  int winxstart, int winystart, int winxend, int winyend)
+{
+	int n;
+
+	n = tsfb->numlvls - numlvls;
+	return (numlvls > 0) ? jpc_tsfb_synthesizewin2(tsfb,
+	  jas_seq2d_getref(a, jas_seq2d_xstart(a), jas_seq2d_ystart(a)),
+	  jas_seq2d_rowstep(a), JPC_CEILDIVPOW2(jas_seq2d_xstart(a), n),
+	  JPC_CEILDIVPOW2(jas_seq2d_ystart(a), n),
+	  JPC_CEILDIVPOW2(jas_seq2d_xend(a), n),
+	  JPC_CEILDIVPOW2(jas_seq2d_yend(a), n), winxstart, winystart,
+	  winxend, winyend, numlvls) : 0;
+}
+
+/* Synthesize the window of the region at the top-left corner of a.  Only
+  the window is written back to a, in the same place that a synthesis of
+  the entire region would have put it. */
+
+static int jpc_tsfb_synthesizewin2(jpc_tsfb_t *tsfb, jpc_fix_t *a, int stride,
+  int xstart, int ystart, int xend, int yend, int winxstart, int winystart,
+  int winxend, int winyend, int numlvls)
+{
+	int expxstart;
+	int expystart;
+	int expxend;
+	int expyend;
+	int width;
+	int height;
+	int numlcols;
+	int numlrows;
+	int numwinlcols;
+	int numwinlrows;
+	int i;
+	int k;
+	jpc_fix_t *b;
+	jpc_fix_t *srcptr;
+
+	if (winxstart >= winxend || winystart >= winyend) {
+		return 0;
+	}
+
+	/* Determine the part of the region that the window depends on. */
+	expxstart = winxstart;
+	expxend = winxend;
+	expystart = winystart;
+	expyend = winyend;
+	jpc_tsfb_expandwin(tsfb, xstart, xend, &expxstart, &expxend);
+	jpc_tsfb_expandwin(tsfb, ystart, yend, &expystart, &expyend);
+
+	/* The lowpass samples needed are the window at the next level. */
+	if (numlvls > 1) {
+		if (jpc_tsfb_synthesizewin2(tsfb, a, stride,
+		  JPC_CEILDIVPOW2(xstart, 1), JPC_CEILDIVPOW2(ystart, 1),
+		  JPC_CEILDIVPOW2(xend, 1), JPC_CEILDIVPOW2(yend, 1),
+		  JPC_CEILDIVPOW2(expxstart, 1), JPC_CEILDIVPOW2(expystart, 1),
+		  JPC_CEILDIVPOW2(expxend, 1), JPC_CEILDIVPOW2(expyend, 1),
+		  numlvls - 1)) {
+			return -1;
+		}
+	}
+
+	/* Gather the lowpass and highpass samples for the expanded window
+	  into a buffer with the same layout as the entire region. */
+	width = expxend - expxstart;
+	height = expyend - expystart;
+	/* The buffer is indexed with an int, and its size must fit in a
+	  size_t. */
+	if (width > INT_MAX / height || JAS_CAST(size_t, width * height) >
+	  ((size_t) -1) / sizeof(jpc_fix_t)) {
+		return -1;
+	}
+	if (!(b = jas_malloc(JAS_CAST(size_t, width * height) *
+	  sizeof(jpc_fix_t)))) {
+		return -1;
+	}
+	numlcols = JPC_CEILDIVPOW2(xend, 1) - JPC_CEILDIVPOW2(xstart, 1);
+	numlrows = JPC_CEILDIVPOW2(yend, 1) - JPC_CEILDIVPOW2(ystart, 1);
+	numwinlcols = JPC_CEILDIVPOW2(expxend, 1) -
+	  JPC_CEILDIVPOW2(expxstart, 1);
+	numwinlrows = JPC_CEILDIVPOW2(expyend, 1) -
+	  JPC_CEILDIVPOW2(expystart, 1);
+	for (i = 0; i < height; ++i) {
+		if (i < numwinlrows) {
+			k = JPC_CEILDIVPOW2(expystart, 1) - JPC_CEILDIVPOW2(ystart, 1) + i;
+		} else {
+			k = numlrows + JPC_FLOORDIVPOW2(expystart, 1) -
+			  JPC_FLOORDIVPOW2(ystart, 1) + i - numwinlrows;
+		}
+		srcptr = &a[k * stride];
+		memcpy(&b[i * width], &srcptr[JPC_CEILDIVPOW2(expxstart, 1) -
+		  JPC_CEILDIVPOW2(xstart, 1)], numwinlcols * sizeof(jpc_fix_t));
+		memcpy(&b[i * width + numwinlcols], &srcptr[numlcols +
+		  JPC_FLOORDIVPOW2(expxstart, 1) - JPC_FLOORDIVPOW2(xstart, 1)],
+		  (width - numwinlcols) * sizeof(jpc_fix_t));
+	}
+
+	if ((*tsfb->qmfb->synthesize)(b, expxstart, expystart, width, height,
+	  width)) {
+		jas_free(b);
+		return -1;
+	}
+
+	for (i = winystart; i < winyend; ++i) {
+		memcpy(&a[(i - ystart) * stride + winxstart - xstart],
+		  &b[(i - expystart) * width + winxstart - expxstart],
+		  (winxend - winxstart) * sizeof(jpc_fix_t));
+	}
+
+	jas_free(b);
+	return 0;
+}
+
+int jpc_tsfb_getbandwins(jpc_tsfb_t *tsfb, int numlvls, uint_fast32_t xstart,
+  uint_fast32_t ystart, uint_fast32_t xend, uint_fast32_t yend,
+  uint_fast32_t winxstart, uint_fast32_t winystart, uint_fast32_t winxend,
+  uint_fast32_t winyend, jpc_tsfb_band_t *bands)
+{
+	jpc_tsfb_band_t *band;
+
+	band = bands;
+	jpc_tsfb_getbandwins2(tsfb, xstart, ystart, xend, yend, winxstart,
+	  winystart, winxend, winyend, &band, numlvls);
+	return band - bands;
+}
+
+static void jpc_tsfb_getbandwins2(jpc_tsfb_t *tsfb, int xstart, int ystart,
+  int xend, int yend, int winxstart, int winystart, int winxend,
+  int winyend, jpc_tsfb_band_t **bands, int numlvls)
+{
+	jpc_tsfb_band_t *band;
+
+	if (winxstart >= winxend || winystart >= winyend) {
+		/* Nothing is needed from any band. */
+		winxstart = winxend = xstart;
+		winystart = winyend = ystart;
+	}
+
+	if (numlvls > 0) {
+
+		jpc_tsfb_expandwin(tsfb, xstart, xend, &winxstart, &winxend);
+		jpc_tsfb_expandwin(tsfb, ystart, yend, &winystart, &winyend);
+
+		jpc_tsfb_getbandwins2(tsfb, JPC_CEILDIVPOW2(xstart, 1),
+		  JPC_CEILDIVPOW2(ystart, 1), JPC_CEILDIVPOW2(xend, 1),
+		  JPC_CEILDIVPOW2(yend, 1), JPC_CEILDIVPOW2(winxstart, 1),
+		  JPC_CEILDIVPOW2(winystart, 1), JPC_CEILDIVPOW2(winxend, 1),
+		  JPC_CEILDIVPOW2(winyend, 1), bands, numlvls - 1);
+
+		band = *bands;
+		band->xstart = JPC_FLOORDIVPOW2(winxstart, 1);
+		band->ystart = JPC_CEILDIVPOW2(winystart, 1);
+		band->xend = JPC_FLOORDIVPOW2(winxend, 1);
+		band->yend = JPC_CEILDIVPOW2(winyend, 1);
+		band->orient = JPC_TSFB_HL;
+		++(*bands);
+
+		band = *bands;
+		band->xstart = JPC_CEILDIVPOW2(winxstart, 1);
+		band->ystart = JPC_FLOORDIVPOW2(winystart, 1);
+		band->xend = JPC_CEILDIVPOW2(winxend, 1);
+		band->yend = JPC_FLOORDIVPOW2(winyend, 1);
+		band->orient = JPC_TSFB_LH;
+		++(*bands);
+
+		band = *bands;
+		band->xstart = JPC_FLOORDIVPOW2(winxstart, 1);
+		band->ystart = JPC_FLOORDIVPOW2(winystart, 1);
+		band->xend = JPC_FLOORDIVPOW2(winxend, 1);
+		band->yend = JPC_FLOORDIVPOW2(winyend, 1);
+		band->orient = JPC_TSFB_HH;
+		++(*bands);
+
+	} else {
+
+		band = *bands;
+		band->xstart = winxstart;
+		band->ystart = winystart;
+		band->xend = winxend;
+		band->yend = winyend;
+		band->orient = JPC_TSFB_LL;
+		++(*bands);
+
+	}
+}
+
 int jpc_tsfb_getbands(jpc_tsfb_t *tsfb, uint_fast32_t xstart,
   uint_fast32_t ystart, uint_fast32_t xend, uint_fast32_t yend,
   jpc_tsfb_band_t *bands)
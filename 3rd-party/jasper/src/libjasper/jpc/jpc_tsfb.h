@@ -114,6 +114,67 @@ typedef struct {
 	jpc_qmfb2d_t *qmfb;
 } jpc_tsfb_t;
 
+/* A function that gets (or puts) the samples of row y of a band, for
+  synthesis (or analysis) done a row at a time.  The bands are numbered
+  in the same order as by jpc_tsfb_getbands.  For synthesis, the samples
+  are those of the part of the band given by jpc_tsfb_getbandwins, and are
+  copied to buf.  For analysis, they are those of the entire band, and are
+  at buf.  A nonzero value is returned on failure. */
+typedef int (*jpc_tsfb_rowfunc_t)(void *arg, int bandno, int y,
+  jpc_fix_t *buf);
+
+/* The state of one level of a transform done a row at a time. */
+typedef struct {
+
+	/* The part of the region at this level that is transformed.  For
+	  synthesis, this is the part that the window depends on. */
+	int xstart;
+	int ystart;
+	int xend;
+	int yend;
+
+	/* The part of the region that is produced (for synthesis only). */
+	int winxstart;
+	int winystart;
+	int winxend;
+	int winyend;
+
+	/* The number of lowpass columns. */
+	int numlcols;
+
+	/* The number of rows that have come out of the transform of the
+	  columns. */
+	int rowno;
+
+	/* The transform of the columns (or null for the coarsest LL band, or
+	  if there is nothing to transform). */
+	jpc_qmfb_lines_t *lines;
+
+	/* A row for the LL band when there is no synthesis at all. */
+	jpc_fix_t *buf;
+
+} jpc_tsfb_linelvl_t;
+
+/* The state of an analysis (or synthesis) done a row at a time, which
+  holds only the few rows of each level that the transform still needs.
+  Level zero is the LL band, and the finest level is numlvls. */
+typedef struct {
+
+	/* The TSFB. */
+	jpc_tsfb_t *tsfb;
+
+	/* The number of levels. */
+	int numlvls;
+
+	/* The per-level state. */
+	jpc_tsfb_linelvl_t lvls[JPC_TSFB_MAXDEPTH + 1];
+
+	/* The function that gets (or puts) the rows of the bands. */
+	jpc_tsfb_rowfunc_t rowfunc;
+	void *arg;
+
+} jpc_tsfb_lines_t;
+
 /******************************************************************************\
 * Functions.
 \******************************************************************************/
@@ -124,15 +185,88 @@ jpc_tsfb_t *jpc_cod_gettsfb(int qmfbid, int numlevels);
 /* Destroy a TSFB. */
 void jpc_tsfb_destroy(jpc_tsfb_t *tsfb);
 
+/* Compute the 9/7 transform of a TSFB in single-precision floating point.
+  The samples to be transformed are then floats stored in the place of the
+  integer samples.  A TSFB for the 5/3 transform is left as it is. */
+void jpc_tsfb_setfltmode(jpc_tsfb_t *tsfb);
+
 /* Perform analysis. */
 int jpc_tsfb_analyze(jpc_tsfb_t *tsfb, jas_seq2d_t *x);
 
 /* Perform synthesis. */
 int jpc_tsfb_synthesize(jpc_tsfb_t *tsfb, jas_seq2d_t *x);
 
+/* Perform synthesis for only the coarsest numlvls levels (i.e., produce
+  a reduced-resolution result in the top-left corner of x). */
+int jpc_tsfb_synthesizelvls(jpc_tsfb_t *tsfb, jas_seq2d_t *x, int numlvls);
+
+/* Perform synthesis for the coarsest numlvls levels, but only as much as
+  is needed for the window [winxstart,winxend) x [winystart,winyend) of the
+  result.  Only the window is written to x. */
+int jpc_tsfb_synthesizewin(jpc_tsfb_t *tsfb, jas_seq2d_t *x, int numlvls,
+  int winxstart, int winystart, int winxend, int winyend);
+
+/* Prepare to perform analysis of the region [xstart,xend) x [ystart,yend)
+  a row at a time.  The rows of the bands are put with putrow as soon as
+  they are complete. */
+jpc_tsfb_lines_t *jpc_tsfb_analyzelines(jpc_tsfb_t *tsfb, int xstart,
+  int ystart, int xend, int yend, jpc_tsfb_rowfunc_t putrow, void *arg);
+
+/* Analyze the next row of the region.  The row is left as it was. */
+int jpc_tsfb_putline(jpc_tsfb_lines_t *lines, jpc_fix_t *row);
+
+/* Prepare to perform synthesis for the coarsest numlvls levels of the
+  region [xstart,xend) x [ystart,yend) a row at a time, but only as much as
+  is needed for the window [winxstart,winxend) x [winystart,winyend) of the
+  result (see jpc_tsfb_synthesizewin).  The rows of the bands are got with
+  getrow as they are needed. */
+jpc_tsfb_lines_t *jpc_tsfb_synthesizelines(jpc_tsfb_t *tsfb, int numlvls,
+  int xstart, int ystart, int xend, int yend, int winxstart, int winystart,
+  int winxend, int winyend, jpc_tsfb_rowfunc_t getrow, void *arg);
+
+/* Synthesize the next row of the window.  The samples of the row are left
+  at *row until the next call. */
+int jpc_tsfb_getline(jpc_tsfb_lines_t *lines, jpc_fix_t **row);
+
+/* Destroy the state of an analysis or synthesis done a row at a time. */
+void jpc_tsfb_lines_destroy(jpc_tsfb_lines_t *lines);
+
+/* Get a bound on the magnitude of the samples during analysis (done by
+  jpc_tsfb_analyze16) of samples of magnitude at most maxmag.  If this
+  cannot be done with 16-bit samples, -1 is returned instead. */
+long jpc_tsfb_analyze16bound(jpc_tsfb_t *tsfb, long maxmag);
+
+/* Get a bound on the magnitude of the samples during synthesis (done by
+  jpc_tsfb_synthesize16), where maxmags[0] is the largest magnitude in the
+  LL band, and maxmags[r] is the largest magnitude in the other bands of
+  resolution level r.  If this cannot be done with 16-bit samples, -1 is
+  returned instead. */
+long jpc_tsfb_synthesize16bound(jpc_tsfb_t *tsfb, long *maxmags);
+
+/* Perform analysis of 16-bit samples.  The samples of the region
+  [xstart,xstart+width) x [ystart,ystart+height) are at a, with rows stride
+  samples apart.  The bound from jpc_tsfb_analyze16bound must be checked
+  first. */
+int jpc_tsfb_analyze16(jpc_tsfb_t *tsfb, int_least16_t *a, int xstart,
+  int ystart, int width, int height, int stride);
+
+/* Perform synthesis of 16-bit samples, as jpc_tsfb_analyze16.  The bound
+  from jpc_tsfb_synthesize16bound must be checked first. */
+int jpc_tsfb_synthesize16(jpc_tsfb_t *tsfb, int_least16_t *a, int xstart,
+  int ystart, int width, int height, int stride);
+
 /* Get band information for a TSFB. */
 int jpc_tsfb_getbands(jpc_tsfb_t *tsfb, uint_fast32_t xstart,
   uint_fast32_t ystart, uint_fast32_t xend, uint_fast32_t yend,
   jpc_tsfb_band_t *bands);
 
+/* Get the part of each band (for the coarsest numlvls levels) that is
+  needed to synthesize the window [winxstart,winxend) x [winystart,winyend)
+  of the region.  Only the coordinates and orientation of each band are
+  set, in the same order as jpc_tsfb_getbands. */
+int jpc_tsfb_getbandwins(jpc_tsfb_t *tsfb, int numlvls, uint_fast32_t xstart,
+  uint_fast32_t ystart, uint_fast32_t xend, uint_fast32_t yend,
+  uint_fast32_t winxstart, uint_fast32_t winystart, uint_fast32_t winxend,
+  uint_fast32_t winyend, jpc_tsfb_band_t *bands);
+
 #endif
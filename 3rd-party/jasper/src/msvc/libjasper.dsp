@@ -141,6 +141,10 @@ SOURCE=..\libjasper\base\jas_string.c
 # End Source File
 # Begin Source File
 
+SOURCE=..\libjasper\base\jas_thread.c
+# End Source File
+# Begin Source File
+
 SOURCE=..\libjasper\base\jas_tmr.c
 # End Source File
 # Begin Source File
@@ -305,6 +309,10 @@ SOURCE=..\libjasper\include\jasper\jas_icc.h
 # End Source File
 # Begin Source File
 
+SOURCE=..\libjasper\include\jasper\jas_thread.h
+# End Source File
+# Begin Source File
+
 SOURCE=..\libjasper\include\jasper\jas_tmr.h
 # End Source File
 # Begin Source File
@@ -11,6 +11,7 @@
 ////////////////////////////////////////////////////////////////////////
 
 using Jpeg2000Filetype.Properties;
+using Microsoft.Win32.SafeHandles;
 using System;
 using System.IO;
 using System.Runtime.InteropServices;
@@ -31,7 +32,8 @@ namespace Jpeg2000Filetype
 			ProfileCreation = -5,
 			ProfileConversion = -6,
 			ImageBufferWrite = -7,
-			EncodeFailure = -8
+			EncodeFailure = -8,
+			Cancelled = -9
 		}
 
 		[StructLayout(LayoutKind.Sequential)]
@@ -47,12 +49,59 @@ namespace Jpeg2000Filetype
 			public double dpcmY;
 		}
 
+		internal enum ColorSpace : int
+		{
+			Unknown = 0,
+			XYZ = 1,
+			Lab = 2,
+			Gray = 3,
+			RGB = 4,
+			YCbCr = 5
+		}
+
+		[StructLayout(LayoutKind.Sequential)]
+		internal struct ImageInfo
+		{
+			public int width;
+			public int height;
+			public int channels;
+			public int bitDepth;
+			public ColorSpace colorSpace;
+			public int tileWidth;
+			public int tileHeight;
+			public int tilesAcross;
+			public int tilesDown;
+			public int resolutionLevels;
+			public int qualityLayers;
+			public double dpcmX;
+			public double dpcmY;
+		}
+
+		[StructLayout(LayoutKind.Sequential)]
+		internal struct DecodeParams
+		{
+			public int reduce;
+			public int regionX;
+			public int regionY;
+			public int regionWidth;
+			public int regionHeight;
+			public int maxLayers;
+			[MarshalAs(UnmanagedType.U1)]
+			public bool readAhead;
+			[MarshalAs(UnmanagedType.U1)]
+			public bool useFloat;
+			[MarshalAs(UnmanagedType.FunctionPtr)]
+			public ProgressDelegate progress;
+		}
+
 		[StructLayout(LayoutKind.Sequential)]
 		internal struct EncodeParams
 		{
 			public int quality;
 			public double dpcmX;
 			public double dpcmY;
+			[MarshalAs(UnmanagedType.FunctionPtr)]
+			public ProgressDelegate progress;
 		}
 
 		[UnmanagedFunctionPointer(CallingConvention.StdCall)]
@@ -61,6 +110,20 @@ namespace Jpeg2000Filetype
 		private delegate int WriteDelegate(IntPtr buffer, int count);
 		[UnmanagedFunctionPointer(CallingConvention.StdCall)]
 		private delegate int SeekDelegate(int offset, int origin);
+		[UnmanagedFunctionPointer(CallingConvention.StdCall)]
+		internal delegate IntPtr AllocateSurfaceDelegate(int width, int height, out int stride);
+		/// <summary>
+		/// Reports the fraction of the work that has been done, from 0 to 1.
+		/// </summary>
+		/// <returns><c>true</c> to continue; <c>false</c> to cancel the operation.</returns>
+		[UnmanagedFunctionPointer(CallingConvention.StdCall)]
+		[return: MarshalAs(UnmanagedType.U1)]
+		internal delegate bool ProgressDelegate(double progress);
+		/// <summary>
+		/// Called when an image of a batch has been decoded, the calls are made one at a time from the native worker threads.
+		/// </summary>
+		[UnmanagedFunctionPointer(CallingConvention.StdCall)]
+		internal delegate void BatchCompleteDelegate(int index, CodecError result, ref ImageData output);
 
 		[StructLayout(LayoutKind.Sequential)]
 		private sealed class IOCallbacks
@@ -73,14 +136,91 @@ namespace Jpeg2000Filetype
 			public SeekDelegate Seek;
 		}
 
+		// The native IOCallbacks structure of a batch entry, the batch takes an array of them.
+		[StructLayout(LayoutKind.Sequential)]
+		private struct BatchSource
+		{
+			[MarshalAs(UnmanagedType.FunctionPtr)]
+			public ReadDelegate Read;
+			[MarshalAs(UnmanagedType.FunctionPtr)]
+			public WriteDelegate Write;
+			[MarshalAs(UnmanagedType.FunctionPtr)]
+			public SeekDelegate Seek;
+		}
+
+		/// <summary>
+		/// Owns the native codec context that keeps the decoder scratch buffers alive between calls.
+		/// </summary>
+		/// <remarks>
+		/// A context must not be used by more than one thread at a time.
+		/// </remarks>
+		internal sealed class CodecContextHandle : SafeHandleZeroOrMinusOneIsInvalid
+		{
+			private CodecContextHandle() : base(true)
+			{
+			}
+
+			protected override bool ReleaseHandle()
+			{
+				if (IntPtr.Size == 8)
+				{
+					IO_x64.DestroyCodecContext(handle);
+				}
+				else
+				{
+					IO_x86.DestroyCodecContext(handle);
+				}
+
+				return true;
+			}
+		}
+
 		[SuppressUnmanagedCodeSecurity]
 		private static class IO_x86
 		{
 			[DllImport("Jpeg2000IO_x86.dll", CallingConvention = CallingConvention.StdCall)]
-			internal static extern CodecError DecodeFile(IOCallbacks callbacks, out ImageData output);
+			internal static extern CodecContextHandle CreateCodecContext();
+
+			[DllImport("Jpeg2000IO_x86.dll", CallingConvention = CallingConvention.StdCall)]
+			internal static extern void DestroyCodecContext(IntPtr context);
+
+			[DllImport("Jpeg2000IO_x86.dll", CallingConvention = CallingConvention.StdCall)]
+			internal static extern CodecError DecodeFile(CodecContextHandle context, IOCallbacks callbacks, DecodeParams parameters, out ImageData output);
+
+			[DllImport("Jpeg2000IO_x86.dll", CallingConvention = CallingConvention.StdCall)]
+			internal static extern CodecError DecodeFileToSurface(
+				CodecContextHandle context,
+				IOCallbacks callbacks,
+				DecodeParams parameters,
+				AllocateSurfaceDelegate allocate,
+				out double dpcmX,
+				out double dpcmY);
+
+			[DllImport("Jpeg2000IO_x86.dll", CallingConvention = CallingConvention.StdCall)]
+			internal static extern CodecError ProbeFile(CodecContextHandle context, IOCallbacks callbacks, out ImageInfo info);
+
+			[DllImport("Jpeg2000IO_x86.dll", CallingConvention = CallingConvention.StdCall)]
+			internal static extern CodecError DecodeBatch(
+				[In] BatchSource[] sources,
+				[Out] ImageData[] outputs,
+				[Out] CodecError[] results,
+				int count,
+				DecodeParams parameters,
+				BatchCompleteDelegate completed);
+
+			[DllImport("Jpeg2000IO_x86.dll", CallingConvention = CallingConvention.StdCall)]
+			internal static extern CodecError DecodeMemory(
+				CodecContextHandle context,
+				IntPtr data,
+				UIntPtr size,
+				DecodeParams parameters,
+				AllocateSurfaceDelegate allocate,
+				out double dpcmX,
+				out double dpcmY);
 
 			[DllImport("Jpeg2000IO_x86.dll", CallingConvention = CallingConvention.StdCall)]
 			internal static extern CodecError EncodeFile(
+				CodecContextHandle context,
 				IntPtr inData,
 				int width,
 				int height,
@@ -89,18 +229,71 @@ namespace Jpeg2000Filetype
 				EncodeParams parameters,
 				IOCallbacks callbacks);
 
+			[DllImport("Jpeg2000IO_x86.dll", CallingConvention = CallingConvention.StdCall)]
+			internal static extern CodecError EncodeToMemory(
+				CodecContextHandle context,
+				IntPtr inData,
+				int width,
+				int height,
+				int stride,
+				int channelCount,
+				EncodeParams parameters,
+				out IntPtr output,
+				out UIntPtr outputSize);
+
 			[DllImport("Jpeg2000IO_x86.dll", CallingConvention = CallingConvention.StdCall)]
 			internal static extern void FreeImageData(ref ImageData data);
+
+			[DllImport("Jpeg2000IO_x86.dll", CallingConvention = CallingConvention.StdCall)]
+			internal static extern void FreeEncodedData(IntPtr data);
 		}
 
 		[SuppressUnmanagedCodeSecurity]
 		private static class IO_x64
 		{
 			[DllImport("Jpeg2000IO_x64.dll", CallingConvention = CallingConvention.StdCall)]
-			internal static extern CodecError DecodeFile(IOCallbacks callbacks, out ImageData output);
+			internal static extern CodecContextHandle CreateCodecContext();
+
+			[DllImport("Jpeg2000IO_x64.dll", CallingConvention = CallingConvention.StdCall)]
+			internal static extern void DestroyCodecContext(IntPtr context);
+
+			[DllImport("Jpeg2000IO_x64.dll", CallingConvention = CallingConvention.StdCall)]
+			internal static extern CodecError DecodeFile(CodecContextHandle context, IOCallbacks callbacks, DecodeParams parameters, out ImageData output);
+
+			[DllImport("Jpeg2000IO_x64.dll", CallingConvention = CallingConvention.StdCall)]
+			internal static extern CodecError DecodeFileToSurface(
+				CodecContextHandle context,
+				IOCallbacks callbacks,
+				DecodeParams parameters,
+				AllocateSurfaceDelegate allocate,
+				out double dpcmX,
+				out double dpcmY);
+
+			[DllImport("Jpeg2000IO_x64.dll", CallingConvention = CallingConvention.StdCall)]
+			internal static extern CodecError ProbeFile(CodecContextHandle context, IOCallbacks callbacks, out ImageInfo info);
+
+			[DllImport("Jpeg2000IO_x64.dll", CallingConvention = CallingConvention.StdCall)]
+			internal static extern CodecError DecodeBatch(
+				[In] BatchSource[] sources,
+				[Out] ImageData[] outputs,
+				[Out] CodecError[] results,
+				int count,
+				DecodeParams parameters,
+				BatchCompleteDelegate completed);
+
+			[DllImport("Jpeg2000IO_x64.dll", CallingConvention = CallingConvention.StdCall)]
+			internal static extern CodecError DecodeMemory(
+				CodecContextHandle context,
+				IntPtr data,
+				UIntPtr size,
+				DecodeParams parameters,
+				AllocateSurfaceDelegate allocate,
+				out double dpcmX,
+				out double dpcmY);
 
 			[DllImport("Jpeg2000IO_x64.dll", CallingConvention = CallingConvention.StdCall)]
 			internal static extern CodecError EncodeFile(
+				CodecContextHandle context,
 				IntPtr inData,
 				int width,
 				int height,
@@ -109,11 +302,102 @@ namespace Jpeg2000Filetype
 				EncodeParams parameters,
 				IOCallbacks callbacks);
 
+			[DllImport("Jpeg2000IO_x64.dll", CallingConvention = CallingConvention.StdCall)]
+			internal static extern CodecError EncodeToMemory(
+				CodecContextHandle context,
+				IntPtr inData,
+				int width,
+				int height,
+				int stride,
+				int channelCount,
+				EncodeParams parameters,
+				out IntPtr output,
+				out UIntPtr outputSize);
+
 			[DllImport("Jpeg2000IO_x64.dll", CallingConvention = CallingConvention.StdCall)]
 			internal static extern void FreeImageData(ref ImageData data);
+
+			[DllImport("Jpeg2000IO_x64.dll", CallingConvention = CallingConvention.StdCall)]
+			internal static extern void FreeEncodedData(IntPtr data);
+		}
+
+		public static CodecContextHandle CreateCodecContext()
+		{
+			CodecContextHandle context;
+			if (IntPtr.Size == 8)
+			{
+				context = IO_x64.CreateCodecContext();
+			}
+			else
+			{
+				context = IO_x86.CreateCodecContext();
+			}
+
+			if (context.IsInvalid)
+			{
+				context.Dispose();
+				throw new OutOfMemoryException();
+			}
+
+			return context;
+		}
+
+		public static CodecError DecodeFile(CodecContextHandle context, Stream input, DecodeParams parameters, out ImageData output)
+		{
+			StreamIOCallbacks streamCallbacks = new StreamIOCallbacks(input);
+			IOCallbacks callbacks = new IOCallbacks()
+			{
+				Read = new ReadDelegate(streamCallbacks.Read),
+				Write = new WriteDelegate(streamCallbacks.Write),
+				Seek = new SeekDelegate(streamCallbacks.Seek)
+			};
+
+			CodecError result;
+			if (IntPtr.Size == 8)
+			{
+				result = IO_x64.DecodeFile(context, callbacks, parameters, out output);
+			}
+			else
+			{
+				result = IO_x86.DecodeFile(context, callbacks, parameters, out output);
+			}
+
+			GC.KeepAlive(callbacks);
+			GC.KeepAlive(streamCallbacks);
+			GC.KeepAlive(parameters.progress);
+
+			return result;
+		}
+
+		public static CodecError DecodeFileToSurface(CodecContextHandle context, Stream input, DecodeParams parameters, AllocateSurfaceDelegate allocate, out double dpcmX, out double dpcmY)
+		{
+			StreamIOCallbacks streamCallbacks = new StreamIOCallbacks(input);
+			IOCallbacks callbacks = new IOCallbacks()
+			{
+				Read = new ReadDelegate(streamCallbacks.Read),
+				Write = new WriteDelegate(streamCallbacks.Write),
+				Seek = new SeekDelegate(streamCallbacks.Seek)
+			};
+
+			CodecError result;
+			if (IntPtr.Size == 8)
+			{
+				result = IO_x64.DecodeFileToSurface(context, callbacks, parameters, allocate, out dpcmX, out dpcmY);
+			}
+			else
+			{
+				result = IO_x86.DecodeFileToSurface(context, callbacks, parameters, allocate, out dpcmX, out dpcmY);
+			}
+
+			GC.KeepAlive(callbacks);
+			GC.KeepAlive(streamCallbacks);
+			GC.KeepAlive(allocate);
+			GC.KeepAlive(parameters.progress);
+
+			return result;
 		}
 
-		public static unsafe CodecError DecodeFile(Stream input, out ImageData output)
+		public static CodecError ProbeFile(CodecContextHandle context, Stream input, out ImageInfo info)
 		{
 			StreamIOCallbacks streamCallbacks = new StreamIOCallbacks(input);
 			IOCallbacks callbacks = new IOCallbacks()
@@ -126,11 +410,11 @@ namespace Jpeg2000Filetype
 			CodecError result;
 			if (IntPtr.Size == 8)
 			{
-				result = IO_x64.DecodeFile(callbacks, out output);
+				result = IO_x64.ProbeFile(context, callbacks, out info);
 			}
 			else
 			{
-				result = IO_x86.DecodeFile(callbacks, out output);
+				result = IO_x86.ProbeFile(context, callbacks, out info);
 			}
 
 			GC.KeepAlive(callbacks);
@@ -139,6 +423,84 @@ namespace Jpeg2000Filetype
 			return result;
 		}
 
+		/// <summary>
+		/// Decodes the input streams concurrently on a pool of native worker threads.
+		/// </summary>
+		/// <remarks>
+		/// Each stream is only used by one thread at a time. The output images must be released with <see cref="FreeImageData"/>.
+		/// </remarks>
+		public static CodecError DecodeBatch(Stream[] inputs, DecodeParams parameters, ImageData[] outputs, CodecError[] results, BatchCompleteDelegate completed)
+		{
+			BatchSource[] sources = new BatchSource[inputs.Length];
+
+			for (int i = 0; i < inputs.Length; i++)
+			{
+				StreamIOCallbacks streamCallbacks = new StreamIOCallbacks(inputs[i]);
+
+				sources[i].Read = new ReadDelegate(streamCallbacks.Read);
+				sources[i].Write = new WriteDelegate(streamCallbacks.Write);
+				sources[i].Seek = new SeekDelegate(streamCallbacks.Seek);
+			}
+
+			CodecError result;
+			if (IntPtr.Size == 8)
+			{
+				result = IO_x64.DecodeBatch(sources, outputs, results, inputs.Length, parameters, completed);
+			}
+			else
+			{
+				result = IO_x86.DecodeBatch(sources, outputs, results, inputs.Length, parameters, completed);
+			}
+
+			GC.KeepAlive(sources);
+			GC.KeepAlive(completed);
+
+			return result;
+		}
+
+		public static CodecError DecodeMemory(CodecContextHandle context, byte[] data, int offset, int length, DecodeParams parameters, AllocateSurfaceDelegate allocate, out double dpcmX, out double dpcmY)
+		{
+			if (data == null)
+			{
+				throw new ArgumentNullException("data");
+			}
+			// The native code trusts the offset and length, so they must not reach past the end of the array.
+			if (offset < 0 || offset > data.Length)
+			{
+				throw new ArgumentOutOfRangeException("offset");
+			}
+			if (length < 0 || length > data.Length - offset)
+			{
+				throw new ArgumentOutOfRangeException("length");
+			}
+
+			// The byte array is pinned while the native code reads it in place.
+			CodecError result;
+			GCHandle handle = GCHandle.Alloc(data, GCHandleType.Pinned);
+			try
+			{
+				IntPtr start = Marshal.UnsafeAddrOfPinnedArrayElement(data, offset);
+
+				if (IntPtr.Size == 8)
+				{
+					result = IO_x64.DecodeMemory(context, start, new UIntPtr((uint)length), parameters, allocate, out dpcmX, out dpcmY);
+				}
+				else
+				{
+					result = IO_x86.DecodeMemory(context, start, new UIntPtr((uint)length), parameters, allocate, out dpcmX, out dpcmY);
+				}
+			}
+			finally
+			{
+				handle.Free();
+			}
+
+			GC.KeepAlive(allocate);
+			GC.KeepAlive(parameters.progress);
+
+			return result;
+		}
+
 		public static void FreeImageData(ref ImageData data)
 		{
 			if (IntPtr.Size == 8)
@@ -151,7 +513,7 @@ namespace Jpeg2000Filetype
 			}
 		}
 
-		public static void EncodeFile(IntPtr inData, int width, int height, int stride, int channelCount, EncodeParams parameters, Stream output)
+		public static void EncodeFile(CodecContextHandle context, IntPtr inData, int width, int height, int stride, int channelCount, EncodeParams parameters, Stream output)
 		{
 			StreamIOCallbacks streamCallbacks = new StreamIOCallbacks(output);
 			IOCallbacks callbacks = new IOCallbacks()
@@ -164,15 +526,59 @@ namespace Jpeg2000Filetype
 			CodecError result;
 			if (IntPtr.Size == 8)
 			{
-				result = IO_x64.EncodeFile(inData, width, height, stride, channelCount, parameters, callbacks);
+				result = IO_x64.EncodeFile(context, inData, width, height, stride, channelCount, parameters, callbacks);
 			}
 			else
 			{
-				result = IO_x86.EncodeFile(inData, width, height, stride, channelCount, parameters, callbacks);
+				result = IO_x86.EncodeFile(context, inData, width, height, stride, channelCount, parameters, callbacks);
 			}
 			GC.KeepAlive(callbacks);
 			GC.KeepAlive(streamCallbacks);
+			GC.KeepAlive(parameters.progress);
+
+			ThrowIfEncodeFailed(result);
+		}
+
+		public static void EncodeToMemory(CodecContextHandle context, IntPtr inData, int width, int height, int stride, int channelCount, EncodeParams parameters, Stream output)
+		{
+			IntPtr encodedData;
+			UIntPtr encodedSize;
+
+			CodecError result;
+			if (IntPtr.Size == 8)
+			{
+				result = IO_x64.EncodeToMemory(context, inData, width, height, stride, channelCount, parameters, out encodedData, out encodedSize);
+			}
+			else
+			{
+				result = IO_x86.EncodeToMemory(context, inData, width, height, stride, channelCount, parameters, out encodedData, out encodedSize);
+			}
+			GC.KeepAlive(parameters.progress);
+
+			try
+			{
+				ThrowIfEncodeFailed(result);
+
+				WriteNativeBuffer(encodedData, (long)encodedSize.ToUInt64(), output);
+			}
+			finally
+			{
+				if (encodedData != IntPtr.Zero)
+				{
+					if (IntPtr.Size == 8)
+					{
+						IO_x64.FreeEncodedData(encodedData);
+					}
+					else
+					{
+						IO_x86.FreeEncodedData(encodedData);
+					}
+				}
+			}
+		}
 
+		private static void ThrowIfEncodeFailed(CodecError result)
+		{
 			if (result != CodecError.Ok)
 			{
 				string message = string.Empty;
@@ -189,12 +595,33 @@ namespace Jpeg2000Filetype
 					case CodecError.ImageBufferWrite:
 						message = Resources.ImageBufferWrite;
 						break;
+					case CodecError.Cancelled:
+						throw new OperationCanceledException();
 				}
 
 				throw new FormatException(message);
 			}
 		}
 
+		private static void WriteNativeBuffer(IntPtr data, long length, Stream output)
+		{
+			// Copy in chunks that stay below the large object heap threshold.
+			const int BufferSize = 81920;
+
+			byte[] buffer = new byte[(int)Math.Min(length, BufferSize)];
+			long offset = 0;
+
+			while (offset < length)
+			{
+				int count = (int)Math.Min(length - offset, buffer.Length);
+
+				Marshal.Copy(new IntPtr(data.ToInt64() + offset), buffer, 0, count);
+				output.Write(buffer, 0, count);
+
+				offset += count;
+			}
+		}
+
 		private sealed class StreamIOCallbacks
 		{
 			private readonly Stream stream;
@@ -226,6 +653,12 @@ namespace Jpeg2000Filetype
 
 			public int Seek(int offset, int origin)
 			{
+				if (!stream.CanSeek)
+				{
+					// Let the codec fall back to sequential access instead of throwing through the native code.
+					return -1;
+				}
+
 				return (int)stream.Seek(offset, (SeekOrigin)origin);
 			}
 		}
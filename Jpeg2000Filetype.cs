@@ -23,6 +23,23 @@ namespace Jpeg2000Filetype
 	[PluginSupportInfo(typeof(PluginSupportInfo))]
 	public sealed class Jpeg2000Filetype : PropertyBasedFileType, IFileTypeFactory
 	{
+		// Each thread keeps its own context so that consecutive loads and saves reuse the decoder scratch buffers.
+		[ThreadStatic]
+		private static FileIO.CodecContextHandle codecContext;
+
+		private static FileIO.CodecContextHandle CodecContext
+		{
+			get
+			{
+				if (codecContext == null)
+				{
+					codecContext = FileIO.CreateCodecContext();
+				}
+
+				return codecContext;
+			}
+		}
+
 		internal static string StaticName
 		{
 			get
@@ -41,87 +58,76 @@ namespace Jpeg2000Filetype
 			return new FileType[] { new Jpeg2000Filetype() };
 		}
 
-		protected unsafe override Document OnLoad(Stream input)
+		protected override Document OnLoad(Stream input)
 		{
-			FileIO.ImageData image;
-
-			FileIO.CodecError result = FileIO.DecodeFile(input, out image);
+			Document doc = null;
+			BitmapLayer layer = null;
 
-			if (result == FileIO.CodecError.Ok)
+			FileIO.AllocateSurfaceDelegate allocate = delegate (int width, int height, out int stride)
 			{
-				Document doc = new Document(image.width, image.height);
-				BitmapLayer layer = new BitmapLayer(image.width, image.height) { IsBackground = true };
-
-				Surface surf = layer.Surface;
-
-				if (!image.hasAlpha)
+				// The native code cannot handle a managed exception, so report an allocation failure instead.
+				try
 				{
-					new UnaryPixelOps.SetAlphaChannelTo255().Apply(surf, surf.Bounds);
+					doc = new Document(width, height);
+					layer = new BitmapLayer(width, height) { IsBackground = true };
 				}
-
-				byte* scan0 = (byte*)image.data.ToPointer();
-
-				if (image.channels >= 3)
+				catch (OutOfMemoryException)
 				{
-					int stride = image.width * image.channels;
-					for (int y = 0; y < image.height; y++)
-					{
-						ColorBgra* p = surf.GetRowAddressUnchecked(y);
-						byte* src = scan0 + (y * stride);
-
-						for (int x = 0; x < image.width; x++)
-						{
-							p->R = src[0]; // JP2 uses RGB pixel order.
-							p->G = src[1];
-							p->B = src[2];
-
-							if (image.hasAlpha)
-							{
-								p->A = src[3];
-							}
-
-							p++;
-							src += image.channels;
-						}
-					}
+					stride = 0;
+					return IntPtr.Zero;
 				}
-				else
-				{
-					for (int y = 0; y < image.height; y++)
-					{
-						ColorBgra* p = surf.GetRowAddressUnchecked(y);
-						byte* src = scan0 + (y * image.width);
 
-						for (int x = 0; x < image.width; x++)
-						{
-							p->R = p->G = p->B = src[0]; // gray scale image
+				stride = layer.Surface.Stride;
+				return layer.Surface.Scan0.Pointer;
+			};
 
-							if (image.hasAlpha)
-							{
-								p->A = src[1];
-							}
+			double dpcmX;
+			double dpcmY;
 
-							p++;
-							src += image.channels;
-						}
-					}
-				}
+			// Paint.NET always loads the image at its full resolution.
+			FileIO.DecodeParams parameters = new FileIO.DecodeParams();
+
+			FileIO.CodecError result;
+
+			byte[] data;
+			int offset;
+			int length;
+			if (TryGetMemoryBuffer(input, out data, out offset, out length))
+			{
+				// The codec reads the file in place when it is already in memory.
+				result = FileIO.DecodeMemory(CodecContext, data, offset, length, parameters, allocate, out dpcmX, out dpcmY);
+			}
+			else
+			{
+				// Keep reading the stream while the codec decodes, it may be on slow storage.
+				parameters.readAhead = true;
+				result = FileIO.DecodeFileToSurface(CodecContext, input, parameters, allocate, out dpcmX, out dpcmY);
+			}
 
-				if (image.dpcmX > 0.0 && image.dpcmY > 0.0)
+			if (result == FileIO.CodecError.Ok)
+			{
+				if (dpcmX > 0.0 && dpcmY > 0.0)
 				{
 					doc.DpuUnit = MeasurementUnit.Centimeter;
-					doc.DpuX = image.dpcmX;
-					doc.DpuY = image.dpcmY;
+					doc.DpuX = dpcmX;
+					doc.DpuY = dpcmY;
 				}
 
-				FileIO.FreeImageData(ref image);
-
 				doc.Layers.Add(layer);
 
 				return doc;
 			}
 			else
 			{
+				if (layer != null)
+				{
+					layer.Dispose();
+				}
+				if (doc != null)
+				{
+					doc.Dispose();
+				}
+
 				string error = string.Empty;
 				switch (result)
 				{
@@ -171,6 +177,56 @@ namespace Jpeg2000Filetype
 			return info;
 		}
 
+		/// <summary>
+		/// Gets the unread part of the input when it is already held in the buffer of a <see cref="MemoryStream"/>.
+		/// </summary>
+		/// <remarks>
+		/// Other streams are not read into memory first, as that would only add a copy of the file.
+		/// </remarks>
+		private static bool TryGetMemoryBuffer(Stream input, out byte[] data, out int offset, out int length)
+		{
+			data = null;
+			offset = 0;
+			length = 0;
+
+			MemoryStream memoryStream = input as MemoryStream;
+			if (memoryStream == null)
+			{
+				return false;
+			}
+
+			byte[] buffer;
+			try
+			{
+				buffer = memoryStream.GetBuffer();
+			}
+			catch (UnauthorizedAccessException)
+			{
+				// The buffer was not created as publicly visible.
+				return false;
+			}
+
+			// The stream only starts at the beginning of its buffer when its capacity covers the whole buffer,
+			// otherwise the positions cannot be mapped to buffer offsets.
+			if (memoryStream.Capacity != buffer.Length)
+			{
+				return false;
+			}
+
+			long position = memoryStream.Position;
+			long end = memoryStream.Length;
+			if (position >= end || end > buffer.Length)
+			{
+				return false;
+			}
+
+			data = buffer;
+			offset = (int)position;
+			length = (int)(end - position);
+
+			return true;
+		}
+
 		private static unsafe int CountChannels(Surface scratchSurface)
 		{
 			int width = scratchSurface.Width;
@@ -209,6 +265,24 @@ namespace Jpeg2000Filetype
 			FileIO.EncodeParams parameters = new FileIO.EncodeParams();
 			parameters.quality = quality;
 
+			if (progressCallback != null)
+			{
+				parameters.progress = (double progress) =>
+				{
+					try
+					{
+						progressCallback(this, new ProgressEventArgs(progress * 100.0));
+					}
+					catch (OperationCanceledException)
+					{
+						// Exceptions cannot be thrown through the native code, the encoder stops and FileIO throws a new one.
+						return false;
+					}
+
+					return true;
+				};
+			}
+
 			switch (input.DpuUnit)
 			{
 				case MeasurementUnit.Centimeter:
@@ -230,7 +304,9 @@ namespace Jpeg2000Filetype
 				input.Render(ra, true);
 			}
 
+			// The codec writes straight to the output stream, in a single pass when it is seekable.
 			FileIO.EncodeFile(
+				CodecContext,
 				scratchSurface.Scan0.Pointer,
 				scratchSurface.Width,
 				scratchSurface.Height,
@@ -15,8 +15,18 @@
 #include "jasper\jasper.h"
 #include "jp2_cod.h"
 #include "scoped.h"
+#include <atomic>
+#include <climits>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include <vector>
 
+struct CodecContext
+{
+	jpc_dec_ctx_t* decoder;
+};
+
 namespace
 {
 	int ReadOp(jas_stream_obj_t* obj, unsigned char* buf, int cnt)
@@ -45,56 +55,406 @@ namespace
 		return 0;
 	}
 
-	class JasPerInit
+	// Reads the input on a background thread into a ring of buffers ahead of the decoder, so that the decoding
+	// overlaps the latency of host streams that can block. The host stream is never used by both threads at once,
+	// a seek waits for the pending read to finish and discards the buffered data unless the target is inside it.
+	// The buffer that was consumed last is kept, since JasPer seeks back over the data that it has read ahead itself.
+	class ReadAheadStream
 	{
 	public:
-		JasPerInit() : initialized(jas_init() == 0)
+		// Opens a stream that reads the callbacks ahead, or returns NULL if the read-ahead thread cannot be started.
+		static jas_stream_t* Open(IOCallbacks* callbacks)
 		{
+			ReadAheadStream* readAhead;
+
+			try
+			{
+				readAhead = new ReadAheadStream(callbacks);
+			}
+			catch (std::bad_alloc&)
+			{
+				return nullptr;
+			}
+
+			// The stream owns the object, it is destroyed by the close operation.
+			jas_stream_t* stream = jas_stream_create_ops(&ops, readAhead, "r");
+			if (!stream)
+			{
+				delete readAhead;
+				return nullptr;
+			}
+
+			try
+			{
+				readAhead->thread = std::thread(&ReadAheadStream::Run, readAhead);
+			}
+			catch (std::system_error&)
+			{
+				jas_stream_close(stream);
+				return nullptr;
+			}
+
+			return stream;
 		}
-		~JasPerInit()
+
+		~ReadAheadStream()
 		{
-			if (initialized)
 			{
-				jas_cleanup();
+				std::lock_guard<std::mutex> lock(mutex);
+				stopping = true;
+			}
+			changed.notify_all();
+
+			if (thread.joinable())
+			{
+				thread.join();
 			}
 		}
-		operator bool() const
+
+	private:
+		ReadAheadStream(IOCallbacks* callbacks) : callbacks(callbacks), buffers(BufferCount), head(0), filled(0), offset(0), retained(false),
+			position(callbacks->Seek(0, SEEK_CUR)), seekable(position >= 0), reading(false), paused(false), stopping(false), endOfFile(false),
+			failed(false)
 		{
-			return initialized;
+			for (size_t i = 0; i < buffers.size(); i++)
+			{
+				buffers[i].data.resize(BufferSize);
+				buffers[i].length = 0;
+			}
 		}
+		ReadAheadStream(const ReadAheadStream&) = delete;
+		ReadAheadStream& operator=(const ReadAheadStream&) = delete;
 
-	private:
-		bool initialized;
+		struct Buffer
+		{
+			std::vector<unsigned char> data;
+			int length;
+		};
+
+		static const int BufferCount = 4;
+		static const int BufferSize = 256 * 1024;
+
+		static int ReadOp(jas_stream_obj_t* obj, unsigned char* buf, int cnt)
+		{
+			return static_cast<ReadAheadStream*>(obj)->Read(buf, cnt);
+		}
+
+		static long SeekOp(jas_stream_obj_t* obj, long offset, int origin)
+		{
+			return static_cast<ReadAheadStream*>(obj)->Seek(offset, origin);
+		}
+
+		static int CloseOp(jas_stream_obj_t* obj)
+		{
+			delete static_cast<ReadAheadStream*>(obj);
+			return 0;
+		}
+
+		// Fills the free buffers of the ring until the end of the file is reached.
+		void Run()
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+
+			while (true)
+			{
+				changed.wait(lock, [this] { return stopping || (!paused && !endOfFile && !failed && filled < BufferCount - 1); });
+				if (stopping)
+				{
+					break;
+				}
+
+				Buffer& buffer = buffers[(head + filled) % BufferCount];
+
+				// The free buffer is not touched by the decoder, so the host stream is read without holding the lock.
+				reading = true;
+				lock.unlock();
+				int length = callbacks->Read(buffer.data.data(), BufferSize);
+				lock.lock();
+				reading = false;
+
+				if (length > 0)
+				{
+					buffer.length = length;
+					filled++;
+				}
+				else if (length == 0)
+				{
+					endOfFile = true;
+				}
+				else
+				{
+					failed = true;
+				}
+
+				changed.notify_all();
+			}
+		}
+
+		int Read(unsigned char* buf, int cnt)
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+
+			changed.wait(lock, [this] { return filled > 0 || endOfFile || failed; });
+			if (filled == 0)
+			{
+				return failed ? -1 : 0;
+			}
+
+			int done = 0;
+
+			while (done < cnt && filled > 0)
+			{
+				Buffer& buffer = buffers[head];
+				const int available = buffer.length - offset;
+				const int count = available < cnt - done ? available : cnt - done;
+
+				memcpy(buf + done, buffer.data.data() + offset, count);
+				done += count;
+				offset += count;
+
+				if (offset == buffer.length)
+				{
+					Advance();
+				}
+			}
+
+			position += done;
+			changed.notify_all();
+
+			return done;
+		}
+
+		long Seek(long seekOffset, int origin)
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+
+			if (!seekable)
+			{
+				return -1;
+			}
+
+			if (origin == SEEK_CUR)
+			{
+				seekOffset += position;
+				origin = SEEK_SET;
+			}
+
+			if (origin == SEEK_SET && Skip(seekOffset))
+			{
+				return position;
+			}
+
+			// Wait for the pending read, the host stream cannot be used by both threads at once.
+			// The data that it reads may already reach the target.
+			paused = true;
+			changed.wait(lock, [this] { return !reading; });
+
+			long result = position;
+
+			if (origin != SEEK_SET || !Skip(seekOffset))
+			{
+				result = callbacks->Seek(seekOffset, origin);
+				if (result >= 0)
+				{
+					head = 0;
+					filled = 0;
+					offset = 0;
+					retained = false;
+					position = result;
+					endOfFile = false;
+					failed = false;
+				}
+			}
+
+			paused = false;
+			changed.notify_all();
+
+			return result;
+		}
+
+		// Moves to the target if it is within the buffered data or the buffer that was consumed last.
+		bool Skip(long target)
+		{
+			if (target < position)
+			{
+				const long back = position - target;
+				const int previous = (head + BufferCount - 1) % BufferCount;
+
+				if (back <= offset)
+				{
+					offset -= static_cast<int>(back);
+				}
+				else if (retained && back - offset <= buffers[previous].length)
+				{
+					// The reader leaves one buffer free, so it never fills the buffer before the head.
+					head = previous;
+					filled++;
+					offset = buffers[head].length - static_cast<int>(back - offset);
+					retained = false;
+				}
+				else
+				{
+					return false;
+				}
+			}
+			else
+			{
+				if (target - position > GetBufferedLength())
+				{
+					return false;
+				}
+
+				long skip = target - position;
+
+				while (skip > 0)
+				{
+					const int available = buffers[head].length - offset;
+
+					if (skip < available)
+					{
+						offset += static_cast<int>(skip);
+						break;
+					}
+
+					skip -= available;
+					Advance();
+				}
+
+				changed.notify_all();
+			}
+
+			position = target;
+
+			return true;
+		}
+
+		// Releases the buffer at the head of the ring, it is kept for seeking back until the reader needs it.
+		void Advance()
+		{
+			head = (head + 1) % BufferCount;
+			filled--;
+			offset = 0;
+			retained = true;
+		}
+
+		long GetBufferedLength() const
+		{
+			long length = -offset;
+
+			for (int i = 0; i < filled; i++)
+			{
+				length += buffers[(head + i) % BufferCount].length;
+			}
+
+			return length;
+		}
+
+		static jas_stream_ops_t ops;
+
+		IOCallbacks* callbacks;
+		std::vector<Buffer> buffers;
+		int head;
+		int filled;
+		int offset;
+		bool retained;
+		long position;
+		const bool seekable;
+		bool reading;
+		bool paused;
+		bool stopping;
+		bool endOfFile;
+		bool failed;
+		std::mutex mutex;
+		std::condition_variable changed;
+		std::thread thread;
 	};
-}
 
-int __stdcall DecodeFile(IOCallbacks* callbacks, ImageData* output)
-{
-	JasPerInit init;
-	int x, y;
+	jas_stream_ops_t ReadAheadStream::ops = { &ReadAheadStream::ReadOp, &WriteOp, &ReadAheadStream::SeekOp, &ReadAheadStream::CloseOp };
 
-	int err = errOk;
+	jas_stream_ops_t decodeOps = { &ReadOp, &WriteOp, &SeekOp, &CloseOp };
 
-	if (!init)
+	// Opens the input stream of a decoder, the data is read ahead on a background thread when requested.
+	jas_stream_t* OpenDecodeStream(IOCallbacks* callbacks, const DecodeParams& params)
 	{
-		return errInitFailure;
+		if (params.readAhead)
+		{
+			jas_stream_t* stream = ReadAheadStream::Open(callbacks);
+			if (stream)
+			{
+				return stream;
+			}
+		}
+
+		return jas_stream_create_ops(&decodeOps, callbacks, "r");
 	}
 
-	jas_stream_ops_t ops;
-	ops.read_ = &ReadOp;
-	ops.write_ = &WriteOp;
-	ops.seek_ = &SeekOp;
-	ops.close_ = &CloseOp;
+	// Forwards the JasPer progress reports to the caller, and remembers if the caller cancelled the operation.
+	class ProgressReporter
+	{
+	public:
+		ProgressReporter(ProgressFn callback) : callback(callback), cancelled(false)
+		{
+			progress.func = &ProgressReporter::Report;
+			progress.arg = this;
+		}
+		jas_progress_t* get()
+		{
+			return callback != nullptr ? &progress : nullptr;
+		}
+		bool IsCancelled() const
+		{
+			return cancelled;
+		}
 
-	ScopedJasPerStream in(jas_stream_create_ops(&ops, callbacks, "r"));
-	if (!in)
+	private:
+		ProgressReporter(const ProgressReporter&) = delete;
+		ProgressReporter& operator=(const ProgressReporter&) = delete;
+
+		static int Report(void* arg, double done)
+		{
+			ProgressReporter* reporter = static_cast<ProgressReporter*>(arg);
+
+			if (!reporter->callback(done))
+			{
+				reporter->cancelled = true;
+				return 1;
+			}
+
+			return 0;
+		}
+
+		ProgressFn callback;
+		jas_progress_t progress;
+		bool cancelled;
+	};
+
+	class JasPerInit
 	{
-		return errOutOfMemory;
-	}
+	public:
+		// JasPer has already been initialized when a context is used.
+		JasPerInit(const CodecContext* context) : owned(context == nullptr), initialized(!owned || jas_init() == 0)
+		{
+		}
+		~JasPerInit()
+		{
+			if (owned && initialized)
+			{
+				jas_cleanup();
+			}
+		}
+		operator bool() const
+		{
+			return initialized;
+		}
 
-	try
+	private:
+		bool owned;
+		bool initialized;
+	};
+
+	ScopedJasPerImage DecodeImage(jas_stream_t* in, const CodecContext* context, const DecodeParams& params)
 	{
-		int format = jas_image_getfmt(in.get());
+		int format = jas_image_getfmt(in);
 		if (format < 0)
 		{
 			throw((int)errUnknownFormat);
@@ -106,30 +466,46 @@ int __stdcall DecodeFile(IOCallbacks* callbacks, ImageData* output)
 			throw((int)errUnknownFormat);
 		}
 
-		/* Decode the image. */
-		ScopedJasPerImage image((*info->ops.decode)(in.get(), nullptr));
-		if (!image)
+		/* Decode the image, reusing the scratch storage of the context if possible. */
+		jpc_dec_ctx_t* decoderContext = context != nullptr ? context->decoder : nullptr;
+
+		char decOps[128];
+		int decOpsLength = sprintf_s(decOps, sizeof(decOps), "reduce=%d", params.reduce);
+
+		if (params.useFloat)
 		{
-			throw((int)errDecodeFailure);
+			decOpsLength += sprintf_s(decOps + decOpsLength, sizeof(decOps) - decOpsLength, " float");
 		}
 
-		output->dpcmX = output->dpcmY = 0.0;
+		if (params.regionWidth > 0 && params.regionHeight > 0)
+		{
+			decOpsLength += sprintf_s(decOps + decOpsLength, sizeof(decOps) - decOpsLength, " region=%d,%d,%d,%d", params.regionX, params.regionY,
+				params.regionX + params.regionWidth, params.regionY + params.regionHeight);
+		}
 
-		if (image->captureRes.hNumerator > 0 &&
-			image->captureRes.vNumerator > 0 &&
-			image->captureRes.hDenomerator > 0 &&
-			image->captureRes.vDenomerator > 0 &&
-			image->captureRes.hExponent >= 0 &&
-			image->captureRes.vExponent >= 0)
+		if (params.maxLayers > 0)
 		{
-			const jas_image_resolution_t* resc = &image->captureRes;
+			decOpsLength += sprintf_s(decOps + decOpsLength, sizeof(decOps) - decOpsLength, " maxlyrs=%d", params.maxLayers);
+		}
 
-			double hres = (static_cast<double>(resc->hNumerator) / static_cast<double>(resc->hDenomerator)) * pow(10.0, static_cast<double>(resc->hExponent));
-			double vres = (static_cast<double>(resc->vNumerator) / static_cast<double>(resc->vDenomerator)) * pow(10.0, static_cast<double>(resc->vExponent));
+		ProgressReporter progress(params.progress);
 
-			// convert pixels per meter to pixels per centimeter
-			output->dpcmX = hres / 100.0;
-			output->dpcmY = vres / 100.0;
+		ScopedJasPerImage image;
+		if (info->ops.decode == jp2_decode)
+		{
+			image.reset(jp2_decode2(in, decOps, decoderContext, progress.get()));
+		}
+		else if (info->ops.decode == jpc_decode)
+		{
+			image.reset(jpc_decode2(in, decOps, decoderContext, progress.get()));
+		}
+		else
+		{
+			image.reset((*info->ops.decode)(in, nullptr));
+		}
+		if (!image)
+		{
+			throw((int)(progress.IsCancelled() ? errCancelled : errDecodeFailure));
 		}
 
 		/* Create a color profile if needed. */
@@ -144,17 +520,12 @@ int __stdcall DecodeFile(IOCallbacks* callbacks, ImageData* output)
 			}
 		}
 
-		int width = jas_image_cmptwidth(image, 0);
-		int height = jas_image_cmptheight(image, 0);
-		int depth = jas_image_cmptprec(image, 0);
-
 		if (image->numcmpts_ > 64 || image->numcmpts_ < 0)
 		{
 			throw((int)errTooManyComponents);
 		}
 
-		output->width = width;
-		output->height = height;
+		const int depth = jas_image_cmptprec(image, 0);
 
 		// <LD> 01/Jan/2005: Always force conversion to sRGB. Seems to be required for many types of JPEG2000 file.
 		if (image->numcmpts_ >= 3 && depth <= 8 && image->clrspc_ != JAS_CLRSPC_SRGB && image->cmprof_ != nullptr)
@@ -173,44 +544,256 @@ int __stdcall DecodeFile(IOCallbacks* callbacks, ImageData* output)
 			image.swap(newimage);
 		}
 
-		std::vector<ScopedJasPerMatrix> bufs;
-		bufs.reserve(image->numcmpts_);
+		return image;
+	}
 
-		for (int i = 0; i < image->numcmpts_; ++i)
+	void GetImageResolution(const jas_image_resolution_t* resc, double* dpcmX, double* dpcmY)
+	{
+		*dpcmX = *dpcmY = 0.0;
+
+		if (resc->hNumerator > 0 &&
+			resc->vNumerator > 0 &&
+			resc->hDenomerator > 0 &&
+			resc->vDenomerator > 0 &&
+			resc->hExponent >= 0 &&
+			resc->vExponent >= 0)
 		{
-			ScopedJasPerMatrix matrix(jas_matrix_create(1, width));
-			if (!matrix)
-			{
-				throw((int)errOutOfMemory);
-			}
 
-			// The vector will assume ownership of the matrix.
-			bufs.push_back(std::move(matrix));
-		}
+			double hres = (static_cast<double>(resc->hNumerator) / static_cast<double>(resc->hDenomerator)) * pow(10.0, static_cast<double>(resc->hExponent));
+			double vres = (static_cast<double>(resc->vNumerator) / static_cast<double>(resc->vDenomerator)) * pow(10.0, static_cast<double>(resc->vExponent));
 
-		int shift = 0;
-		if (depth > 8)
-		{
-			shift = depth - 8;
+			// convert pixels per meter to pixels per centimeter
+			*dpcmX = hres / 100.0;
+			*dpcmY = vres / 100.0;
 		}
+	}
 
-		int outLen, stride, index0, index1, index2;
+	struct SurfaceSource
+	{
+		const BYTE* scan0;
+		int stride;
+		int channelCount;
+	};
 
-		const int alphaIndex = jas_image_getcmptbytype(image.get(), JAS_IMAGE_CT_OPACITY);
+	int ReadComponentOp(jas_image_srcobj_t* obj, int cmptno, jas_image_coord_t x, jas_image_coord_t y,
+		jas_image_coord_t width, jas_image_coord_t height, jas_matrix_t* data)
+	{
+		const SurfaceSource* source = reinterpret_cast<const SurfaceSource*>(obj);
 
-		const bool hasAlpha = alphaIndex >= 0;
+		// Paint.NET uses BGRA order, gray scale images are read from the blue channel.
+		static const int rgbaOffsets[] = { 2, 1, 0, 3 };
+		const int offset = source->channelCount >= 3 ? rgbaOffsets[cmptno] : 0;
 
-		output->hasAlpha = hasAlpha;
+		// The encoder expects the unsigned 8-bit samples to be level shifted to the signed range.
+		const jas_seqent_t adjust = 1 << (8 - 1);
 
-		switch (jas_clrspc_fam(image->clrspc_))
+		if (jas_matrix_numrows(data) != height || jas_matrix_numcols(data) != width)
 		{
-			case JAS_CLRSPC_FAM_RGB:
+			return -1;
+		}
 
-				output->channels = hasAlpha ? 4 : 3;
+		for (jas_image_coord_t i = 0; i < height; i++)
+		{
+			const BYTE* src = source->scan0 + (static_cast<size_t>(y + i) * source->stride) + (x * 4) + offset;
+			jas_seqent_t* dst = jas_matrix_getref(data, i, 0);
 
-				stride = width * output->channels;
-				outLen = stride * height;
-				output->data = HeapAlloc(GetProcessHeap(), 0, outLen);
+			for (jas_image_coord_t j = 0; j < width; j++)
+			{
+				dst[j] = static_cast<jas_seqent_t>(*src) - adjust;
+				src += 4;
+			}
+		}
+
+		return 0;
+	}
+
+	std::vector<ScopedJasPerMatrix> CreateRowBuffers(int count, int width)
+	{
+		std::vector<ScopedJasPerMatrix> bufs;
+		bufs.reserve(count);
+
+		for (int i = 0; i < count; ++i)
+		{
+			ScopedJasPerMatrix matrix(jas_matrix_create(1, width));
+			if (!matrix)
+			{
+				throw((int)errOutOfMemory);
+			}
+
+			// The vector will assume ownership of the matrix.
+			bufs.push_back(std::move(matrix));
+		}
+
+		return bufs;
+	}
+
+	// Checks whether a component holds 8-bit samples in memory that cover the whole image,
+	// so its rows can be copied without converting them through jas_image_readcmpt.
+	bool HasByteRows(jas_image_t* image, int cmptno, int width, int height)
+	{
+		return jas_image_cmptdatatype(image, cmptno) == JAS_IMAGE_DATA_UINT8 &&
+			jas_image_cmptwidth(image, cmptno) == width &&
+			jas_image_cmptheight(image, cmptno) == height;
+	}
+
+	const BYTE* GetByteRow(jas_image_t* image, int cmptno, int y)
+	{
+		return static_cast<const BYTE*>(jas_image_cmptrow(image, cmptno, y));
+	}
+
+	void DecodeToSurface(jas_stream_t* in, const CodecContext* context, const DecodeParams& params, AllocateSurfaceFn allocate, double* dpcmX, double* dpcmY)
+	{
+		ScopedJasPerImage image(DecodeImage(in, context, params));
+
+		GetImageResolution(&image->captureRes, dpcmX, dpcmY);
+
+		const int width = jas_image_cmptwidth(image, 0);
+		const int height = jas_image_cmptheight(image, 0);
+		const int depth = jas_image_cmptprec(image, 0);
+
+		const int shift = depth > 8 ? depth - 8 : 0;
+
+		const int alphaIndex = jas_image_getcmptbytype(image.get(), JAS_IMAGE_CT_OPACITY);
+
+		const bool hasAlpha = alphaIndex >= 0;
+
+		int index0, index1, index2;
+
+		switch (jas_clrspc_fam(image->clrspc_))
+		{
+			case JAS_CLRSPC_FAM_RGB:
+				index0 = jas_image_getcmptbytype(image.get(), JAS_IMAGE_CT_RGB_R);
+				index1 = jas_image_getcmptbytype(image.get(), JAS_IMAGE_CT_RGB_G);
+				index2 = jas_image_getcmptbytype(image.get(), JAS_IMAGE_CT_RGB_B);
+				break;
+			case JAS_CLRSPC_FAM_GRAY:
+				// The gray channel is replicated into the red, green and blue channels.
+				index0 = index1 = index2 = jas_image_getcmptbytype(image.get(), JAS_IMAGE_CT_GRAY_Y);
+				break;
+			default:
+				throw((int)errUnknownFormat);
+		}
+
+		if (index0 < 0 || index1 < 0 || index2 < 0)
+		{
+			throw((int)errUnknownFormat);
+		}
+
+		// The red, green, blue and alpha row buffers, the gray images share a single color buffer.
+		std::vector<ScopedJasPerMatrix> bufs(CreateRowBuffers(4, width));
+
+		jas_matrix_t* red = bufs[0].get();
+		jas_matrix_t* green = index1 == index0 ? red : bufs[1].get();
+		jas_matrix_t* blue = index2 == index0 ? red : bufs[2].get();
+		jas_matrix_t* alpha = bufs[3].get();
+
+		int stride = 0;
+		BYTE* scan0 = reinterpret_cast<BYTE*>(allocate(width, height, &stride));
+		if (!scan0)
+		{
+			throw((int)errOutOfMemory);
+		}
+
+		if (HasByteRows(image.get(), index0, width, height) &&
+			HasByteRows(image.get(), index1, width, height) &&
+			HasByteRows(image.get(), index2, width, height) &&
+			(!hasAlpha || HasByteRows(image.get(), alphaIndex, width, height)))
+		{
+			for (int y = 0; y < height; y++)
+			{
+				const BYTE* r = GetByteRow(image.get(), index0, y);
+				const BYTE* g = GetByteRow(image.get(), index1, y);
+				const BYTE* b = GetByteRow(image.get(), index2, y);
+				const BYTE* a = hasAlpha ? GetByteRow(image.get(), alphaIndex, y) : nullptr;
+
+				BYTE* dst = scan0 + (static_cast<size_t>(y) * stride);
+				for (int x = 0; x < width; x++)
+				{
+					// Paint.NET uses BGRA order.
+					dst[0] = b[x];
+					dst[1] = g[x];
+					dst[2] = r[x];
+					dst[3] = a ? a[x] : 255;
+
+					dst += 4;
+				}
+			}
+
+			return;
+		}
+
+		for (int y = 0; y < height; y++)
+		{
+			jas_image_readcmpt(image.get(), index0, 0, y, width, 1, red);
+
+			if (green != red)
+			{
+				jas_image_readcmpt(image.get(), index1, 0, y, width, 1, green);
+			}
+
+			if (blue != red)
+			{
+				jas_image_readcmpt(image.get(), index2, 0, y, width, 1, blue);
+			}
+
+			if (hasAlpha)
+			{
+				jas_image_readcmpt(image.get(), alphaIndex, 0, y, width, 1, alpha);
+			}
+
+			BYTE* dst = scan0 + (static_cast<size_t>(y) * stride);
+			for (int x = 0; x < width; x++)
+			{
+				// Paint.NET uses BGRA order.
+				dst[0] = static_cast<BYTE>((jas_matrix_getv(blue, x)>>shift));
+				dst[1] = static_cast<BYTE>((jas_matrix_getv(green, x)>>shift));
+				dst[2] = static_cast<BYTE>((jas_matrix_getv(red, x)>>shift));
+				dst[3] = hasAlpha ? static_cast<BYTE>((jas_matrix_getv(alpha, x)>>shift)) : 255;
+
+				dst += 4;
+			}
+		}
+	}
+
+	void DecodeToImageData(jas_stream_t* in, const CodecContext* context, const DecodeParams& params, ImageData* output)
+	{
+		ScopedJasPerImage image(DecodeImage(in, context, params));
+
+		GetImageResolution(&image->captureRes, &output->dpcmX, &output->dpcmY);
+
+		int x, y;
+		int width = jas_image_cmptwidth(image, 0);
+		int height = jas_image_cmptheight(image, 0);
+		int depth = jas_image_cmptprec(image, 0);
+
+		output->width = width;
+		output->height = height;
+
+		std::vector<ScopedJasPerMatrix> bufs(CreateRowBuffers(image->numcmpts_, width));
+
+		int shift = 0;
+		if (depth > 8)
+		{
+			shift = depth - 8;
+		}
+
+		int outLen, stride, index0, index1, index2;
+
+		const int alphaIndex = jas_image_getcmptbytype(image.get(), JAS_IMAGE_CT_OPACITY);
+
+		const bool hasAlpha = alphaIndex >= 0;
+
+		output->hasAlpha = hasAlpha;
+
+		switch (jas_clrspc_fam(image->clrspc_))
+		{
+			case JAS_CLRSPC_FAM_RGB:
+
+				output->channels = hasAlpha ? 4 : 3;
+
+				stride = width * output->channels;
+				outLen = stride * height;
+				output->data = HeapAlloc(GetProcessHeap(), 0, outLen);
 
 				if (!output->data)
 				{
@@ -221,6 +804,38 @@ int __stdcall DecodeFile(IOCallbacks* callbacks, ImageData* output)
 				index1 = jas_image_getcmptbytype(image.get(), JAS_IMAGE_CT_RGB_G);
 				index2 = jas_image_getcmptbytype(image.get(), JAS_IMAGE_CT_RGB_B);
 
+				if (index0 >= 0 && index1 >= 0 && index2 >= 0 &&
+					HasByteRows(image.get(), index0, width, height) &&
+					HasByteRows(image.get(), index1, width, height) &&
+					HasByteRows(image.get(), index2, width, height) &&
+					(!hasAlpha || HasByteRows(image.get(), alphaIndex, width, height)))
+				{
+					for (y = 0; y < height; y++)
+					{
+						const BYTE* r = GetByteRow(image.get(), index0, y);
+						const BYTE* g = GetByteRow(image.get(), index1, y);
+						const BYTE* b = GetByteRow(image.get(), index2, y);
+						const BYTE* a = hasAlpha ? GetByteRow(image.get(), alphaIndex, y) : nullptr;
+
+						BYTE* data = reinterpret_cast<BYTE*>(output->data) + (y * stride);
+						for (x = 0; x < width; x++)
+						{
+							data[0] = r[x];
+							data[1] = g[x];
+							data[2] = b[x];
+
+							if (a)
+							{
+								data[3] = a[x];
+							}
+
+							data += output->channels;
+						}
+					}
+
+					break;
+				}
+
 				for (y = 0; y < height; y++)
 				{
 					jas_image_readcmpt(image.get(), index0, 0, y, width, 1, bufs[0].get());
@@ -262,12 +877,35 @@ int __stdcall DecodeFile(IOCallbacks* callbacks, ImageData* output)
 					throw((int)errOutOfMemory);
 				}
 
-				width = jas_image_cmptwidth(image, 0);
-				height = jas_image_cmptheight(image, 0);
-				depth = jas_image_cmptprec(image, 0);
-
 				index0 = jas_image_getcmptbytype(image.get(), JAS_IMAGE_CT_GRAY_Y);
 
+				if (index0 >= 0 &&
+					HasByteRows(image.get(), index0, width, height) &&
+					(!hasAlpha || HasByteRows(image.get(), alphaIndex, width, height)))
+				{
+					for (y = 0; y < height; y++)
+					{
+						const BYTE* gray = GetByteRow(image.get(), index0, y);
+						const BYTE* a = hasAlpha ? GetByteRow(image.get(), alphaIndex, y) : nullptr;
+
+						BYTE* data = reinterpret_cast<BYTE*>(output->data) + (y * stride);
+						if (!a)
+						{
+							memcpy(data, gray, width);
+							continue;
+						}
+
+						for (x = 0; x < width; x++)
+						{
+							data[0] = gray[x];
+							data[1] = a[x];
+							data += 2;
+						}
+					}
+
+					break;
+				}
+
 				for (y = 0; y < height; y++) {
 					jas_image_readcmpt(image.get(), index0, 0, y, width, 1, bufs[0].get());
 
@@ -292,63 +930,98 @@ int __stdcall DecodeFile(IOCallbacks* callbacks, ImageData* output)
 
 				break;
 			default:
-				err = errUnknownFormat;
-				break;
+				throw((int)errUnknownFormat);
 		}
 	}
-	catch (int error)
-	{
-		err = error;
-	}
-	catch (std::bad_alloc&)
+
+	struct codec_context_deleter
 	{
-		err = errOutOfMemory;
-	}
+		void operator()(CodecContext* context)
+		{
+			DestroyCodecContext(context);
+		}
+	};
 
-	return err;
-}
+	typedef std::unique_ptr<CodecContext, codec_context_deleter> ScopedCodecContext;
 
-void __stdcall FreeImageData(ImageData* image)
-{
-	if (image != nullptr && image->data != nullptr)
+	// Hands out the images of a batch to the worker threads, each worker decodes with its own codec context.
+	class BatchDecoder
 	{
-		HeapFree(GetProcessHeap(), 0, image->data);
-		image->data = nullptr;
-		image->channels = 0;
-		image->width = 0;
-		image->height = 0;
-		image->hasAlpha = false;
-		image->dpcmX = 0.0;
-		image->dpcmY = 0.0;
-	}
-}
+	public:
+		BatchDecoder(IOCallbacks* sources, ImageData* outputs, int* results, int count, const DecodeParams& params, BatchCompleteFn completed) :
+			sources(sources), outputs(outputs), results(results), count(count), params(params), completed(completed), next(0)
+		{
+		}
 
-int __stdcall EncodeFile(void* inData, int width, int height, int stride, int channelCount, EncodeParams params, IOCallbacks* callbacks)
-{
-	JasPerInit init;
-	jas_image_cmptparm_t cmptparms[4];
-	int i, x, y;
+		void Run(const CodecContext* context)
+		{
+			for (int index = next++; index < count; index = next++)
+			{
+				const int result = Decode(context, index);
 
-	int format = 0, error = errOk;
+				results[index] = result;
 
-	if (!init)
-		return errInitFailure;
+				if (completed != nullptr)
+				{
+					std::lock_guard<std::mutex> lock(completedMutex);
+					completed(index, result, &outputs[index]);
+				}
+			}
+		}
 
-	jas_stream_ops_t ops;
-	ops.read_ = &ReadOp;
-	ops.write_ = &WriteOp;
-	ops.seek_ = &SeekOp;
-	ops.close_ = &CloseOp;
+	private:
+		BatchDecoder(const BatchDecoder&) = delete;
+		BatchDecoder& operator=(const BatchDecoder&) = delete;
 
-	ScopedJasPerStream out(jas_stream_create_ops(&ops, callbacks, "w"));
-	if (!out)
-	{
-		return errOutOfMemory;
-	}
+		int Decode(const CodecContext* context, int index)
+		{
+			ImageData* output = &outputs[index];
+			ZeroMemory(output, sizeof(ImageData));
 
-	try
+			ScopedJasPerStream in(OpenDecodeStream(&sources[index], params));
+			if (!in)
+			{
+				return errOutOfMemory;
+			}
+
+			int err = errOk;
+
+			try
+			{
+				DecodeToImageData(in.get(), context, params, output);
+			}
+			catch (int error)
+			{
+				err = error;
+			}
+			catch (std::bad_alloc&)
+			{
+				err = errOutOfMemory;
+			}
+
+			if (err != errOk)
+			{
+				FreeImageData(output);
+			}
+
+			return err;
+		}
+
+		IOCallbacks* sources;
+		ImageData* outputs;
+		int* results;
+		const int count;
+		const DecodeParams params;
+		BatchCompleteFn completed;
+		std::atomic<int> next;
+		std::mutex completedMutex;
+	};
+
+	void EncodeImage(jas_stream_t* out, void* inData, int width, int height, int stride, int channelCount, const EncodeParams& params)
 	{
-		for (i = 0; i < channelCount; i++)
+		jas_image_cmptparm_t cmptparms[4];
+
+		for (int i = 0; i < channelCount; i++)
 		{
 			cmptparms[i].tlx = 0;
 			cmptparms[i].tly = 0;
@@ -360,7 +1033,15 @@ int __stdcall EncodeFile(void* inData, int width, int height, int stride, int ch
 			cmptparms[i].sgnd = false;
 		}
 
-		ScopedJasPerImage image(jas_image_create(channelCount, cmptparms, JAS_CLRSPC_UNKNOWN));
+		static jas_image_srcops_t srcops = { &ReadComponentOp };
+
+		SurfaceSource source;
+		source.scan0 = reinterpret_cast<const BYTE*>(inData);
+		source.stride = stride;
+		source.channelCount = channelCount;
+
+		// The encoder reads the pixels directly from the surface when it creates each tile.
+		ScopedJasPerImage image(jas_image_createfromsrc(channelCount, cmptparms, JAS_CLRSPC_UNKNOWN, &srcops, &source));
 		if (!image)
 		{
 			throw((int)errOutOfMemory);
@@ -384,57 +1065,6 @@ int __stdcall EncodeFile(void* inData, int width, int height, int stride, int ch
 			jas_image_setcmpttype(image, 0,	JAS_IMAGE_CT_COLOR(JAS_CLRSPC_CHANIND_GRAY_Y));
 		}
 
-		std::vector<ScopedJasPerMatrix> cmpts;
-		cmpts.reserve(channelCount);
-
-		for (i = 0; i < channelCount; i++)
-		{
-			ScopedJasPerMatrix matrix(jas_matrix_create(1, width));
-			if (!matrix)
-			{
-				throw((int)errOutOfMemory);
-			}
-
-			// The vector will assume ownership of the matrix.
-			cmpts.push_back(std::move(matrix));
-		}
-
-		BYTE* scan0 = reinterpret_cast<BYTE*>(inData);
-
-		for (y = 0; y < height; y++)
-		{
-			BYTE* src = scan0 + (y * stride);
-			for (x = 0; x < width; x++)
-			{
-				if (channelCount >= 3)
-				{
-					jas_matrix_setv(cmpts[0], x, src[2]); // Paint.NET uses BGR order
-					jas_matrix_setv(cmpts[1], x, src[1]);
-					jas_matrix_setv(cmpts[2], x, src[0]);
-
-					if (channelCount == 4)
-					{
-						jas_matrix_setv(cmpts[3], x, src[3]);
-					}
-				}
-				else
-				{
-					jas_matrix_setv(cmpts[0], x, src[0]);
-				}
-
-				src += 4;
-			}
-
-			for (i = 0; i < channelCount; i++)
-			{
-				if (jas_image_writecmpt(image.get(), i, 0, y, width, 1, cmpts[i].get()))
-				{
-					throw((int)errImageBufferWrite);
-				}
-			}
-
-		}
-
 		ZeroMemory(&image->captureRes, sizeof(jas_image_resolution_t));
 		if (params.dpcmX > 0.0 && params.dpcmY > 0.0)
 		{
@@ -468,8 +1098,6 @@ int __stdcall EncodeFile(void* inData, int width, int height, int stride, int ch
 			}
 		}
 
-		int outFmt = jas_image_strtofmt("jp2");
-
 		char encOps[32];
 		ZeroMemory(encOps, sizeof(encOps));
 
@@ -479,16 +1107,346 @@ int __stdcall EncodeFile(void* inData, int width, int height, int stride, int ch
 			sprintf_s(encOps, sizeof(encOps), "rate=%.9f", 100.0f / pow(static_cast<float>(115 - params.quality), 2.0f));
 		}
 
-		if (jas_image_encode(image.get(), out.get(), outFmt, encOps))
+		ProgressReporter progress(params.progress);
+
+		if (jp2_encode2(image.get(), out, encOps, progress.get()))
 		{
-			throw((int)errEncodeFailed);
+			throw((int)(progress.IsCancelled() ? errCancelled : errEncodeFailed));
 		}
 
-		jas_stream_flush(out.get());
+		jas_stream_flush(out);
 	}
-	catch (int errorCode)
+}
+
+CodecContext* __stdcall CreateCodecContext()
+{
+	CodecContext* context = new (std::nothrow) CodecContext();
+	if (!context)
 	{
-		error = errorCode;
+		return nullptr;
+	}
+
+	if (jas_init() != 0)
+	{
+		delete context;
+		return nullptr;
+	}
+
+	context->decoder = jpc_dec_ctx_create();
+	if (!context->decoder)
+	{
+		jas_cleanup();
+		delete context;
+		return nullptr;
+	}
+
+	return context;
+}
+
+void __stdcall DestroyCodecContext(CodecContext* context)
+{
+	if (context != nullptr)
+	{
+		jpc_dec_ctx_destroy(context->decoder);
+		jas_cleanup();
+		delete context;
+	}
+}
+
+int __stdcall DecodeFile(CodecContext* context, IOCallbacks* callbacks, DecodeParams params, ImageData* output)
+{
+	JasPerInit init(context);
+
+	int err = errOk;
+
+	if (!init)
+	{
+		return errInitFailure;
+	}
+
+	ScopedJasPerStream in(OpenDecodeStream(callbacks, params));
+	if (!in)
+	{
+		return errOutOfMemory;
+	}
+
+	try
+	{
+		DecodeToImageData(in.get(), context, params, output);
+	}
+	catch (int error)
+	{
+		err = error;
+	}
+	catch (std::bad_alloc&)
+	{
+		err = errOutOfMemory;
+	}
+
+	return err;
+}
+
+int __stdcall DecodeFileToSurface(CodecContext* context, IOCallbacks* callbacks, DecodeParams params, AllocateSurfaceFn allocate, double* dpcmX, double* dpcmY)
+{
+	JasPerInit init(context);
+
+	int err = errOk;
+
+	if (!init)
+	{
+		return errInitFailure;
+	}
+
+	ScopedJasPerStream in(OpenDecodeStream(callbacks, params));
+	if (!in)
+	{
+		return errOutOfMemory;
+	}
+
+	try
+	{
+		DecodeToSurface(in.get(), context, params, allocate, dpcmX, dpcmY);
+	}
+	catch (int error)
+	{
+		err = error;
+	}
+	catch (std::bad_alloc&)
+	{
+		err = errOutOfMemory;
+	}
+
+	return err;
+}
+
+int __stdcall DecodeBatch(IOCallbacks* sources, ImageData* outputs, int* results, int count, DecodeParams params, BatchCompleteFn completed)
+{
+	if (count <= 0)
+	{
+		return errOk;
+	}
+
+	// The progress would be reported by several threads at once.
+	params.progress = nullptr;
+
+	unsigned int workerCount = std::thread::hardware_concurrency();
+	if (workerCount == 0)
+	{
+		workerCount = 1;
+	}
+	else if (workerCount > static_cast<unsigned int>(count))
+	{
+		workerCount = static_cast<unsigned int>(count);
+	}
+
+	try
+	{
+		// The contexts are created up front, the first one initializes the JasPer tables that the workers share.
+		std::vector<ScopedCodecContext> contexts;
+		contexts.reserve(workerCount);
+
+		for (unsigned int i = 0; i < workerCount; i++)
+		{
+			ScopedCodecContext context(CreateCodecContext());
+			if (!context)
+			{
+				break;
+			}
+
+			contexts.push_back(std::move(context));
+		}
+
+		if (contexts.empty())
+		{
+			return errInitFailure;
+		}
+
+		BatchDecoder decoder(sources, outputs, results, count, params, completed);
+
+		std::vector<std::thread> workers;
+		workers.reserve(contexts.size() - 1);
+
+		try
+		{
+			for (size_t i = 1; i < contexts.size(); i++)
+			{
+				workers.emplace_back(&BatchDecoder::Run, &decoder, contexts[i].get());
+			}
+		}
+		catch (std::system_error&)
+		{
+			// Continue with the workers that could be started.
+		}
+
+		// The calling thread also takes part in the decoding.
+		decoder.Run(contexts[0].get());
+
+		for (size_t i = 0; i < workers.size(); i++)
+		{
+			workers[i].join();
+		}
+	}
+	catch (std::bad_alloc&)
+	{
+		return errOutOfMemory;
+	}
+
+	return errOk;
+}
+
+int __stdcall DecodeMemory(CodecContext* context, const void* data, size_t size, DecodeParams params, AllocateSurfaceFn allocate, double* dpcmX, double* dpcmY)
+{
+	JasPerInit init(context);
+
+	int err = errOk;
+
+	if (!init)
+	{
+		return errInitFailure;
+	}
+
+	// The JasPer streams use int for their buffer sizes and positions.
+	if (size > INT_MAX)
+	{
+		return errDecodeFailure;
+	}
+
+	// The decoder reads the file data in place.
+	ScopedJasPerStream in(jas_stream_memview(reinterpret_cast<const unsigned char*>(data), static_cast<int>(size)));
+	if (!in)
+	{
+		return errOutOfMemory;
+	}
+
+	try
+	{
+		DecodeToSurface(in.get(), context, params, allocate, dpcmX, dpcmY);
+	}
+	catch (int error)
+	{
+		err = error;
+	}
+	catch (std::bad_alloc&)
+	{
+		err = errOutOfMemory;
+	}
+
+	return err;
+}
+
+int __stdcall ProbeFile(CodecContext* context, IOCallbacks* callbacks, ImageInfo* info)
+{
+	JasPerInit init(context);
+
+	if (!init)
+	{
+		return errInitFailure;
+	}
+
+	jas_stream_ops_t ops;
+	ops.read_ = &ReadOp;
+	ops.write_ = &WriteOp;
+	ops.seek_ = &SeekOp;
+	ops.close_ = &CloseOp;
+
+	ScopedJasPerStream in(jas_stream_create_ops(&ops, callbacks, "r"));
+	if (!in)
+	{
+		return errOutOfMemory;
+	}
+
+	int format = jas_image_getfmt(in.get());
+	if (format < 0)
+	{
+		return errUnknownFormat;
+	}
+
+	jas_image_fmtinfo_t* fmtinfo = jas_image_lookupfmtbyid(format);
+	if (!fmtinfo)
+	{
+		return errUnknownFormat;
+	}
+
+	// Only the file and main code stream headers are read, none of the tiles are decoded.
+	jas_image_info_t header;
+	int result;
+	if (fmtinfo->ops.decode == jp2_decode)
+	{
+		result = jp2_probe(in.get(), &header);
+	}
+	else if (fmtinfo->ops.decode == jpc_decode)
+	{
+		result = jpc_probe(in.get(), &header);
+	}
+	else
+	{
+		return errUnknownFormat;
+	}
+
+	if (result != 0)
+	{
+		return errDecodeFailure;
+	}
+
+	info->width = header.width;
+	info->height = header.height;
+	info->channels = header.numcmpts;
+	info->bitDepth = header.prec;
+	info->colorSpace = jas_clrspc_fam(header.clrspc);
+	info->tileWidth = header.tilewidth;
+	info->tileHeight = header.tileheight;
+	info->tilesAcross = header.numhtiles;
+	info->tilesDown = header.numvtiles;
+	info->resolutionLevels = header.numrlvls;
+	info->qualityLayers = header.numlyrs;
+	GetImageResolution(&header.captureRes, &info->dpcmX, &info->dpcmY);
+
+	return errOk;
+}
+
+void __stdcall FreeImageData(ImageData* image)
+{
+	if (image != nullptr && image->data != nullptr)
+	{
+		HeapFree(GetProcessHeap(), 0, image->data);
+		image->data = nullptr;
+		image->channels = 0;
+		image->width = 0;
+		image->height = 0;
+		image->hasAlpha = false;
+		image->dpcmX = 0.0;
+		image->dpcmY = 0.0;
+	}
+}
+
+int __stdcall EncodeFile(CodecContext* context, void* inData, int width, int height, int stride, int channelCount, EncodeParams params, IOCallbacks* callbacks)
+{
+	JasPerInit init(context);
+
+	int error = errOk;
+
+	if (!init)
+		return errInitFailure;
+
+	jas_stream_ops_t ops;
+	ops.read_ = &ReadOp;
+	ops.write_ = &WriteOp;
+	ops.seek_ = &SeekOp;
+	ops.close_ = &CloseOp;
+
+	ScopedJasPerStream out(jas_stream_create_ops(&ops, callbacks, "w"));
+	if (!out)
+	{
+		return errOutOfMemory;
+	}
+
+	try
+	{
+		EncodeImage(out.get(), inData, width, height, stride, channelCount, params);
+	}
+	catch (int errorCode)
+	{
+		error = errorCode;
 	}
 	catch (std::bad_alloc&)
 	{
@@ -496,4 +1454,57 @@ int __stdcall EncodeFile(void* inData, int width, int height, int stride, int ch
 	}
 
 	return error;
+}
+
+int __stdcall EncodeToMemory(CodecContext* context, void* inData, int width, int height, int stride, int channelCount, EncodeParams params, void** output, size_t* outputSize)
+{
+	JasPerInit init(context);
+
+	int error = errOk;
+
+	*output = nullptr;
+	*outputSize = 0;
+
+	if (!init)
+		return errInitFailure;
+
+	// A growable memory stream, its buffer is handed to the caller when the encoding is complete.
+	ScopedJasPerStream out(jas_stream_memopen(nullptr, 0));
+	if (!out)
+	{
+		return errOutOfMemory;
+	}
+
+	try
+	{
+		EncodeImage(out.get(), inData, width, height, stride, channelCount, params);
+
+		long length = 0;
+		unsigned char* buffer = jas_stream_memrelease(out.get(), &length);
+		if (!buffer)
+		{
+			throw((int)errOutOfMemory);
+		}
+
+		*output = buffer;
+		*outputSize = static_cast<size_t>(length);
+	}
+	catch (int errorCode)
+	{
+		error = errorCode;
+	}
+	catch (std::bad_alloc&)
+	{
+		error = errOutOfMemory;
+	}
+
+	return error;
+}
+
+void __stdcall FreeEncodedData(void* data)
+{
+	if (data != nullptr)
+	{
+		jas_free(data);
+	}
 }
\ No newline at end of file
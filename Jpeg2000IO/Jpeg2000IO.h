@@ -22,6 +22,13 @@
 typedef int (__stdcall *ReadFn)(void* buffer, int count);
 typedef int (__stdcall *WriteFn)(void* buffer, int count);
 typedef long (__stdcall *SeekFn)(long offset, int origin);
+// Returns a pointer to a 32-bit BGRA surface of the specified size and its stride in bytes, or NULL on failure.
+typedef void* (__stdcall *AllocateSurfaceFn)(int width, int height, int* stride);
+// Reports the fraction of the work that has been done, from 0 to 1. Returning false cancels the operation.
+typedef bool (__stdcall *ProgressFn)(double progress);
+
+// A context holds the codec state that can be reused across many images, it must not be used by more than one thread at a time.
+struct CodecContext;
 
 struct IOCallbacks
 {
@@ -41,13 +48,57 @@ struct ImageData
 	double dpcmY;
 };
 
+// The image information that can be read without decoding the image.
+struct ImageInfo
+{
+	int width;
+	int height;
+	int channels;
+	int bitDepth;
+	int colorSpace;
+	int tileWidth;
+	int tileHeight;
+	int tilesAcross;
+	int tilesDown;
+	int resolutionLevels;
+	int qualityLayers;
+	double dpcmX;
+	double dpcmY;
+};
+
+struct DecodeParams
+{
+	// The number of the highest resolution levels to discard, each level halves the width and height of the image.
+	int reduce;
+	// The part of the image to decode, in full resolution reference grid coordinates. A zero width or height decodes the whole image.
+	int regionX;
+	int regionY;
+	int regionWidth;
+	int regionHeight;
+	// The number of quality layers to decode, zero decodes all of them.
+	int maxLayers;
+	// Reads the file on a background thread ahead of the decoder, for host streams that can block (e.g. on network storage).
+	// The callbacks are then called from that thread, but never from two threads at once.
+	bool readAhead;
+	// Decodes irreversible (9/7) images with the faster single-precision floating-point pipeline instead of fixed point.
+	// The output may differ slightly from that of the fixed-point decoder, which is the default.
+	bool useFloat;
+	// Optional, may be NULL.
+	ProgressFn progress;
+};
+
 struct EncodeParams
 {
 	int quality;
 	double dpcmX;
 	double dpcmY;
+	// Optional, may be NULL.
+	ProgressFn progress;
 };
 
+// Called when an image of a batch has been decoded, the calls are made one at a time from the worker threads.
+typedef void (__stdcall *BatchCompleteFn)(int index, int result, ImageData* output);
+
 #define errOk 1
 #define errInitFailure  0
 #define errOutOfMemory  -1
@@ -58,9 +109,28 @@ struct EncodeParams
 #define errProfileConversion -6
 #define errImageBufferWrite -7
 #define errEncodeFailed -8
+#define errCancelled -9
+
+// The ImageInfo color space families, these match the JasPer color space family values.
+#define colorSpaceUnknown 0
+#define colorSpaceXYZ 1
+#define colorSpaceLab 2
+#define colorSpaceGray 3
+#define colorSpaceRGB 4
+#define colorSpaceYCbCr 5
 
-JPEG2000IO_API int __stdcall DecodeFile(IOCallbacks* callbacks, ImageData* output);
-JPEG2000IO_API int __stdcall EncodeFile(void* inData, int width, int height, int stride, int channelCount, EncodeParams params, IOCallbacks* callbacks);
+JPEG2000IO_API CodecContext* __stdcall CreateCodecContext();
+JPEG2000IO_API void __stdcall DestroyCodecContext(CodecContext* context);
+JPEG2000IO_API int __stdcall DecodeFile(CodecContext* context, IOCallbacks* callbacks, DecodeParams params, ImageData* output);
+JPEG2000IO_API int __stdcall DecodeFileToSurface(CodecContext* context, IOCallbacks* callbacks, DecodeParams params, AllocateSurfaceFn allocate, double* dpcmX, double* dpcmY);
+JPEG2000IO_API int __stdcall ProbeFile(CodecContext* context, IOCallbacks* callbacks, ImageInfo* info);
+// Decodes the images read from the sources into the outputs on a pool of worker threads, the result of each image is stored in results.
+// The progress callback of the params is not used.
+JPEG2000IO_API int __stdcall DecodeBatch(IOCallbacks* sources, ImageData* outputs, int* results, int count, DecodeParams params, BatchCompleteFn completed);
+JPEG2000IO_API int __stdcall DecodeMemory(CodecContext* context, const void* data, size_t size, DecodeParams params, AllocateSurfaceFn allocate, double* dpcmX, double* dpcmY);
+JPEG2000IO_API int __stdcall EncodeFile(CodecContext* context, void* inData, int width, int height, int stride, int channelCount, EncodeParams params, IOCallbacks* callbacks);
+JPEG2000IO_API int __stdcall EncodeToMemory(CodecContext* context, void* inData, int width, int height, int stride, int channelCount, EncodeParams params, void** output, size_t* outputSize);
 JPEG2000IO_API void __stdcall FreeImageData(ImageData * image);
+JPEG2000IO_API void __stdcall FreeEncodedData(void* data);
 
 #endif
\ No newline at end of file